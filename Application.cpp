@@ -1,7 +1,13 @@
 #include "Application.h"
+#include "Profiler.h"
 
 #include <iostream>
 #include <sstream>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+#include <functional>
+#include <set>
 
 #include <glm/vec3.hpp>
 #include <glm/glm.hpp>
@@ -16,11 +22,23 @@
 #include "Transform.h"
 #include "RotateCallback.h"
 #include "LOD.h"
+#include "LODSelector.h"
+#include "MeshSimplifier.h"
+#include "Impostors.h"
+#include "OcclusionCuller.h"
+#include "SceneBVH.h"
+#include "WorldPartition.h"
+#include "TextureStreamer.h"
+#include "TextureArrayPacker.h"
+#include "BindlessTextures.h"
+#include "TextureBaker.h"
+#include "MipGenerator.h"
 #include "LightMoveCallback.h"
 #include "SortedGroup.h"
 #include "DepthCameraSetPositionCallback.h"
 #include "DrawCameraStatus.h"
 #include "Skybox.h"
+#include "RenderStats.h"
 #include "glm/ext.hpp"
 #include <cstdlib>
 
@@ -32,11 +50,18 @@ Application::Application(unsigned int width, unsigned height)
 	m_camera = m_fpsCamera;
 
   	m_fpsCounter = std::make_shared<FPSCounter>();
+	m_gpuProfiler = std::make_shared<GPUProfiler>();
+	m_programCache = std::make_shared<ProgramCache>();
+	m_renderTargetPool = std::make_shared<RenderTargetPool>();
+	m_threadPool = std::make_shared<ThreadPool>();
+	MipGenerator::setThreadPool(m_threadPool);
+	m_programLoadMs = 0.0;
 	m_drawCameraStatus = std::make_shared<DrawCameraStatus>();
 }
 
 bool Application::initResources(const std::string& model_filename, const std::string& vshader_filename, std::string& fshader_filename)
 {
+	m_initStart = std::chrono::high_resolution_clock::now();
 	m_loadedVShader = vshader_filename;
 	m_loadedFShader = fshader_filename;
 	m_loadedFilename = model_filename;
@@ -46,19 +71,22 @@ bool Application::initResources(const std::string& model_filename, const std::st
 	m_depthProgram = glCreateProgram();
 	m_skyboxProgram = glCreateProgram();
 	m_billboardProgram = glCreateProgram();
+	m_compositeProgram = glCreateProgram();
 	m_gpuComputeProgram = glCreateProgram();
 	m_gpuProgram = glCreateProgram();
+	m_gpuSortProgram = glCreateProgram();
 
 	m_renderVisitor = std::shared_ptr<RenderVisitor>(new RenderVisitor());
 	m_updateVisitor = std::shared_ptr<UpdateVisitor>(new UpdateVisitor());
 
-	m_skybox = std::shared_ptr<Skybox>(new Skybox());
-	m_gpuParticles = std::shared_ptr<GPUParticles>(new GPUParticles(1 << 21)); //2 million particles, bitshift gives us a nice number that is raised by 3 by (1 << 7).
-																			   //Other good numbers to put here are (1 << 15), (1 << 9). Using a number that can't be raised by 3 will result in certian artifacts such as
-																			   //certain particles not moving.
+	m_skybox = std::shared_ptr<Skybox>(new Skybox(m_threadPool));
+	m_gpuParticles = std::shared_ptr<GPUParticles>(new GPUParticles(1 << 21)); //At most 2 million live particles, only the live ones are simulated and drawn
 
 	m_renderParticles = false;
 
+	m_programCache->resetStatistics();
+	auto programsStart = std::chrono::high_resolution_clock::now();
+
 	if (!initShaders(&m_program, vshader_filename, fshader_filename))
 	{
 		std::cout << "Could not initilize phong program" << std::endl;
@@ -89,40 +117,105 @@ bool Application::initResources(const std::string& model_filename, const std::st
 		return false;
 	}
 
+	if(!initShaders(&m_compositeProgram, "shaders/oit-composite.vert.glsl", "shaders/oit-composite.frag.glsl"))
+	{
+		std::cout << "Could not initilize transparency composite program, transparent geometry is blended in scene order" << std::endl;
+		m_orderIndependentTransparency = false;
+	}
+
 	if(!initGpuShaders(&m_gpuProgram, "shaders/gpu-particles/gpu.vert.glsl", "shaders/gpu-particles/gpu.frag.glsl", "shaders/gpu-particles/gpu.geo.glsl"))
 	{
 		std::cout << "Could not initilize gpu default program" << std::endl;
 		return false;
 	}
 
-	if(!initComputeShader(&m_gpuComputeProgram, "shaders/gpu-particles/gpu.comp.glsl"))
+	if(m_particleBackend == GPUParticles::BACKEND_COMPUTE && !initComputeShader(&m_gpuComputeProgram, "shaders/gpu-particles/gpu.comp.glsl"))
 	{
-		std::cout << "Could not initilize GPU compute program" << std::endl;
-		return false;
+		std::cout << "Could not initilize GPU compute program, simulating the particles on the CPU" << std::endl;
+		m_particleBackend = GPUParticles::BACKEND_CPU;
+	}
+
+	//Without the sort program the particles are drawn additive in simulation order
+	if(!initComputeShader(&m_gpuSortProgram, "shaders/gpu-particles/sort.comp.glsl"))
+	{
+		std::cout << "Could not initilize GPU particle sort program, particles are drawn unsorted" << std::endl;
+		m_gpuSortProgram = 0;
+	}
+
+	m_programLoadMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - programsStart).count();
+	std::cout << "Programs ready in " << m_programLoadMs << " ms (" << m_programCache->getHits() << " from cache, " << m_programCache->getMisses() << " compiled)" << std::endl;
+
+	//Variants of the phong program are compiled when a state first needs them
+	m_phongPermutations = std::shared_ptr<ShaderPermutations>(new ShaderPermutations(m_program, vshader_filename, fshader_filename, m_programCache));
+	m_phongPermutations->setProgramCreatedCallback([this](GLuint program) { applyFrameUniforms(m_camera, program, m_renderShadowmap); });
+
+	//Billboards only use the OIT define, the other features compile to the same program
+	m_billboardPermutations = std::shared_ptr<ShaderPermutations>(new ShaderPermutations(m_billboardProgram, "shaders/billboard-shading.vert.glsl", "shaders/billboard-shading.frag.glsl", m_programCache));
+	m_billboardPermutations->setProgramCreatedCallback([this](GLuint program) { applyFrameUniforms(m_camera, program, false); });
+
+	m_transparencyPass = std::shared_ptr<TransparencyPass>(new TransparencyPass(m_renderTargetPool, m_compositeProgram));
+	m_sortedGroups.clear();
+
+	ShaderPermutations::Features impostorFeatures;
+	impostorFeatures.impostor = true;
+	impostorFeatures.shadows = false;
+	impostorFeatures.numLights = 0;
+	impostorFeatures.textured = false;
+	impostorFeatures.alphaBlend = false;
+	m_impostorProgram = m_billboardPermutations->get(impostorFeatures);
+	m_impostors = std::shared_ptr<Impostors>(new Impostors(m_camera, m_renderTargetPool));
+
+	m_occlusionCuller = std::shared_ptr<OcclusionCuller>(new OcclusionCuller());
+	setOcclusionCulling(m_occlusionCulling);
+
+	m_sceneBVH = std::shared_ptr<SceneBVH>(new SceneBVH());
+	m_renderVisitor->setSceneBVH(m_sceneBVH);
+
+	if (m_textureStreaming)
+	{
+		m_textureStreamer = std::shared_ptr<TextureStreamer>(new TextureStreamer(m_threadPool));
+	}
+
+	if (BindlessTextures::setEnabled(m_bindlessTextures))
+	{
+		std::cout << "Drawing textures through bindless handles" << std::endl;
 	}
 
 	m_fpsCamera->init(m_program);
 	m_fpsCamera->setScreenSize(m_screenSize);
 
-	m_shadowmap = std::shared_ptr<Shadowmap>(new Shadowmap(m_depthProgram));
+	m_shadowmap = std::shared_ptr<Shadowmap>(new Shadowmap(m_depthProgram, m_renderTargetPool, Shadowmap::MAX_CASCADES, m_shadowResolution, RenderTargetPool::depthFormat(m_shadowDepthBits)));
 	m_shadowmap->init(m_screenSize);
+	m_shadowmap->ignoreProgram(m_billboardProgram);
 
 	std::string ext = vr::FileSystem::getFileExtension(model_filename);
 	std::shared_ptr<Obj> obj;
 
 	std::shared_ptr<State> defaultState = std::shared_ptr<State>(new State(m_program));
+	defaultState->setPermutations(m_phongPermutations);
 
 	m_rootNode = std::shared_ptr<Group>(new Group(defaultState));
 
 	m_rootNode->setName("root");
 
+	//Selects the level of every LOD in the scene in one update
+	m_lodSelector = std::shared_ptr<LODSelector>(new LODSelector(m_camera));
+	m_lodSelector->setBias(m_lodBias);
+	m_rootNode->addUpdateCallback(m_lodSelector);
+	m_rootNode->addUpdateCallback(m_impostors);
+
+	std::vector<std::shared_ptr<Obj>> loadedObjs;
+	std::vector<std::shared_ptr<Transform>> loadedNodes;
+	std::vector<std::shared_ptr<Obj>> impostorObjs;
+	std::vector<std::shared_ptr<Transform>> impostorNodes;
+
 	if (ext == "xml" || ext == "XML")
 	{
 		std::shared_ptr<XmlScene> scene = std::shared_ptr<XmlScene>(new XmlScene);
 
 		std::cout << "Loading xml" << std::endl;
 
-		if (!loadXml(model_filename, scene))
+		if (!loadXml(model_filename, scene, m_textureStreamer.get()))
 		{
 			return false;
 		}
@@ -133,15 +226,67 @@ bool Application::initResources(const std::string& model_filename, const std::st
 		for(int i = 0; i < scene->objects.size(); i++)
 		{
 			std::shared_ptr<Obj> obj = scene->objects[i];
-			std::shared_ptr<Transform> n = parseObj(obj);
+			std::shared_ptr<Transform> n;
+			if (obj->lodRatios.empty())
+			{
+				n = parseObj(obj);
+			}
+			else
+			{
+				n = buildAutoLOD(obj, obj->lodRatios);
+			}
 			m_rootNode->addChild(n);
+			loadedObjs.push_back(obj);
+			loadedNodes.push_back(n);
+
+			//Baked once the lights are in place
+			if (obj->impostorDistance > 0)
+			{
+				impostorObjs.push_back(obj);
+				impostorNodes.push_back(n);
+			}
 		}
 
-		if (m_rootNode->getChildren().empty())
+		//A partitioned scene streams the rest of its nodes around the camera
+		if (scene->cellSize > 0)
+		{
+			m_worldPartition = std::shared_ptr<WorldPartition>(new WorldPartition(m_camera, m_threadPool, m_rootNode, [this](std::shared_ptr<Obj> obj) { return parseObj(obj); }));
+			m_worldPartition->setGrid(scene->cellSize, scene->streamRadius, size_t(scene->memoryBudget * 1024 * 1024));
+			for (auto& node : scene->streamedNodes)
+			{
+				m_worldPartition->add(node);
+			}
+			m_rootNode->addUpdateCallback(m_worldPartition);
+			std::cout << "Streaming " << scene->streamedNodes.size() << " nodes in cells of " << scene->cellSize << " units" << std::endl;
+
+			//Baking covers the streamed models too, their textures are baked by loading each file once on the pool
+			if (TextureBaker::isEnabled())
+			{
+				std::set<std::string> paths;
+				std::vector<std::future<void>> bakes;
+				for (auto& node : scene->streamedNodes)
+				{
+					if (paths.insert(node.path).second)
+					{
+						std::string path = node.path;
+						bakes.push_back(m_threadPool->submit([path]() { loadObj(path, true); }));
+					}
+				}
+
+				for (auto& bake : bakes)
+				{
+					bake.wait();
+				}
+			}
+		}
+
+		if (m_rootNode->getChildren().empty() && scene->streamedNodes.empty())
 		{
 			std::cerr << "Empty scene, something when wrong when loading files" << std::endl;
 			return false;
 		}
+
+		addOccluders(loadedObjs, loadedNodes);
 	}
 	else
 	{
@@ -158,6 +303,7 @@ bool Application::initResources(const std::string& model_filename, const std::st
 
 	std::shared_ptr<Transform> lightTransform = parseObj(loadObj("models/Sun/13913_Sun_v2_l3.obj"));
 	lightTransform->setInitialTransform(glm::mat4(1));
+	lightTransform->setDynamic(true);
 	//m_rootNode->addChild(lightTransform);
 
 	m_lightMoveCallback = std::shared_ptr<LightMoveCallback>(new LightMoveCallback(light1, lightTransform, m_camera));
@@ -165,7 +311,52 @@ bool Application::initResources(const std::string& model_filename, const std::st
 	m_rootNode->getState()->add(light1);
 	m_rootNode->addUpdateCallback(m_lightMoveCallback);
 
+	if (!impostorNodes.empty())
+	{
+		//The views are baked once, they need the final textures
+		if (m_textureStreamer)
+		{
+			m_textureStreamer->flush();
+		}
+
+		//The views are lit by the scene lights without shadows, the shadow map does not exist yet
+		ShaderPermutations::Features bakeFeatures;
+		bakeFeatures.shadows = false;
+		std::shared_ptr<State> bakeState = std::shared_ptr<State>(new State(m_phongPermutations->get(bakeFeatures)));
+		bakeState->add(light1);
+
+		for (size_t i = 0; i < impostorNodes.size(); i++)
+		{
+			m_impostors->add(impostorNodes[i], impostorObjs[i]->filename, impostorObjs[i]->impostorDistance, bakeState);
+		}
+	}
+
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		m_sceneBVH->build(m_rootNode);
+		double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+		std::cout << "Built the scene hierarchy over " << m_sceneBVH->getNumEntries() << " geometries (" << m_sceneBVH->getNumNodes() << " nodes) in " << ms << " ms" << std::endl;
+	}
+
+	//Packing copies whole chains, the streamed textures have to be complete first
+	if (m_textureArrays)
+	{
+		if (m_textureStreamer)
+		{
+			m_textureStreamer->flush();
+		}
+
+		TextureArrayPacker packer;
+		packer.pack(*m_sceneBVH);
+		std::cout << "Packed " << packer.getNumPacked() << " textures into " << packer.getNumArrays() << " texture arrays" << std::endl;
+	}
+
+	m_gpuParticles->setBackend(m_particleBackend);
+	m_gpuParticles->setThreadPool(m_threadPool);
+	m_gpuParticles->setSortProgram(m_gpuSortProgram);
+	m_gpuParticles->setRenderTargetPool(m_renderTargetPool);
 	m_gpuParticles->init(m_gpuProgram);
+	m_gpuParticles->setProfiler(m_gpuProfiler);
 
 	initView(m_camera);
 
@@ -200,35 +391,95 @@ void Application::initView(std::shared_ptr<Camera> camera)
 
 void Application::update(GLFWwindow* window)
 {
+	PROFILE_SCOPE("Frame");
+
+	RenderStats::reset();
+	m_gpuProfiler->beginFrame();
+
 	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-	m_updateVisitor->visit(*m_rootNode);
+	//Transparent states enable blending for themselves, nothing left over from the last frame should blend the opaque scene
+	glDisable(GL_BLEND);
+	m_renderVisitor->setFilter(m_orderIndependentTransparency ? RenderVisitor::FILTER_OPAQUE : RenderVisitor::FILTER_ALL);
+
+	{
+		PROFILE_SCOPE("UpdateVisitor");
+		m_updateVisitor->visit(*m_rootNode);
+	}
+
+	//Only the geometry below transforms that moved in the update gets new bounds, streamed cells change the tree itself
+	if (m_worldPartition && m_worldPartition->getVersion() != m_partitionVersion)
+	{
+		m_partitionVersion = m_worldPartition->getVersion();
+		m_sceneBVH->build(m_rootNode);
+	}
+	else
+	{
+		m_sceneBVH->refit();
+	}
+
+	//The demand comes from the last cull, the levels uploaded now are drawn this frame
+	if (m_textureStreamer)
+	{
+		m_textureStreamer->update(m_camera, *m_sceneBVH);
+	}
 
 	//Render skybox
+	m_gpuProfiler->beginPass("skybox");
 	m_skybox->render(m_skyboxProgram, m_camera);
+	m_gpuProfiler->endPass();
 
 	//Apply sintime for animation on multi textured objects
 	glUniform1f(glGetUniformLocation(m_program, "sinTime"), glm::sin(glfwGetTime()));
 
 	//Apply shadowmap
+	m_phongPermutations->setShadowsEnabled(m_renderShadowmap);
+
+	std::shared_ptr<Texture> renderedShadowmap;
+
 	if(m_renderShadowmap)
 	{
-		std::shared_ptr<Texture> renderedShadowmap = m_shadowmap->render(m_program, m_camera, m_rootNode);
+		m_gpuProfiler->beginPass("shadowmap");
+		renderedShadowmap = m_shadowmap->render(m_program, m_camera, m_rootNode);
+		m_gpuProfiler->endPass();
+
+		m_gpuProfiler->beginPass("phong");
 		renderedShadowmap->bind();
 		render(m_camera, m_program);
 		renderedShadowmap->unbind();
+		m_gpuProfiler->endPass();
 	}
 	else
 	{
+		m_gpuProfiler->beginPass("phong");
 		render(m_camera, m_program);
+		m_gpuProfiler->endPass();
 	}
 
 	//Render toon without shadows
+	m_gpuProfiler->beginPass("toon");
 	render(m_camera, m_toonProgram);
+	m_gpuProfiler->endPass();
 
 	//Render billboard
+	m_gpuProfiler->beginPass("billboard");
 	render(m_camera, m_billboardProgram);
+	m_gpuProfiler->endPass();
+
+	//The billboard pass gave the impostor variant the camera
+	m_gpuProfiler->beginPass("impostors");
+	m_impostors->render(m_impostorProgram);
+	m_gpuProfiler->endPass();
+
+	if(m_orderIndependentTransparency)
+	{
+		m_gpuProfiler->beginPass("transparent");
+		renderTransparent(m_camera, renderedShadowmap);
+		m_gpuProfiler->endPass();
+	}
+
+	m_gpuProfiler->beginPass("text");
 
 	//Render FPS counter
 	m_fpsCounter->render(window);
@@ -236,11 +487,31 @@ void Application::update(GLFWwindow* window)
 	//Render camera status
 	m_drawCameraStatus->render(window, m_lightMoveCallback);
 
+	//Render GPU pass timings
+	m_gpuProfiler->render(window);
+
+	m_gpuProfiler->endPass();
+
 	std::shared_ptr<Light> light = m_rootNode->getState()->getLights().front();
 	m_camera->init(m_program);
 	m_camera->apply(m_program);
 	m_gpuParticles->setActive(m_renderParticles);
 	m_gpuParticles->render((glm::vec3(light->getPosition() * glm::vec4(15.0f, 15.0f, 15.0f, 1.0f))), m_camera, m_gpuProgram, m_gpuComputeProgram);
+
+	m_gpuProfiler->endFrame();
+	m_renderTargetPool->endFrame();
+
+	if (m_firstFrame)
+	{
+		m_firstFrame = false;
+		double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - m_initStart).count();
+		std::cout << "First frame " << ms << " ms after loading started";
+		if (m_textureStreamer)
+		{
+			std::cout << ", " << m_textureStreamer->getNumDecoding() << " textures still decoding";
+		}
+		std::cout << std::endl;
+	}
 }
 
 void Application::processInput(GLFWwindow* window)
@@ -262,23 +533,235 @@ void Application::processInput(GLFWwindow* window)
 			m_renderShadowmap = !m_renderShadowmap;
 			m_wait = true;
 		}
+		if (glfwGetKey(window, GLFW_KEY_MINUS) == GLFW_PRESS || glfwGetKey(window, GLFW_KEY_EQUAL) == GLFW_PRESS)
+		{
+			m_wait = true;
+			m_lodBias += glfwGetKey(window, GLFW_KEY_EQUAL) == GLFW_PRESS ? 0.5f : -0.5f;
+			m_lodSelector->setBias(m_lodBias);
+			std::cout << "LOD bias " << m_lodBias << ", levels switch at " << std::exp2(m_lodBias) << " pixels of error" << std::endl;
+		}
+		if (glfwGetKey(window, GLFW_KEY_4) == GLFW_PRESS)
+		{
+			m_wait = true;
+			setShadowQuality(m_shadowResolution >= 4096 ? 512 : m_shadowResolution * 2, m_shadowDepthBits);
+			std::cout << "Shadow resolution " << m_shadowResolution << ", " << m_renderTargetPool->getMemoryUsage() / (1024 * 1024) << " MB of render targets" << std::endl;
+		}
 		if (glfwGetKey(window, GLFW_KEY_6) == GLFW_PRESS)
 		{
 			m_wait = true;
 			m_renderParticles = !m_renderParticles;
 		}
+		if (glfwGetKey(window, GLFW_KEY_3) == GLFW_PRESS)
+		{
+			m_wait = true;
+			bool alpha = m_gpuParticles->getBlendMode() == GPUParticles::BLEND_ADDITIVE;
+			m_gpuParticles->setBlendMode(alpha ? GPUParticles::BLEND_ALPHA : GPUParticles::BLEND_ADDITIVE);
+			std::cout << (alpha ? "Alpha blended particles, sorted back to front" : "Additive particles") << std::endl;
+		}
+		if (glfwGetKey(window, GLFW_KEY_0) == GLFW_PRESS)
+		{
+			m_wait = true;
+			if (m_occlusionCulling)
+			{
+				std::cout << "Occlusion culling hid " << m_occlusionCuller->getCulled() << " of " << m_occlusionCuller->getTested() << " objects in the last frame" << std::endl;
+			}
+			setOcclusionCulling(!m_occlusionCulling);
+			std::cout << "Occlusion culling " << (m_occlusionCulling ? "on" : "off") << std::endl;
+		}
+		if (glfwGetKey(window, GLFW_KEY_1) == GLFW_PRESS)
+		{
+			m_wait = true;
+			setOrderIndependentTransparency(!m_orderIndependentTransparency);
+			std::cout << (m_orderIndependentTransparency ? "Order independent transparency" : "Sorted transparency") << std::endl;
+		}
+		if (glfwGetKey(window, GLFW_KEY_2) == GLFW_PRESS)
+		{
+			m_wait = true;
+			m_gpuParticles->setSoftParticles(!m_gpuParticles->getSoftParticles());
+			std::cout << "Soft particles " << (m_gpuParticles->getSoftParticles() ? "on" : "off") << std::endl;
+		}
+		if (glfwGetKey(window, GLFW_KEY_5) == GLFW_PRESS)
+		{
+			m_wait = true;
+			m_gpuProfiler->setOverlayEnabled(!m_gpuProfiler->isOverlayEnabled());
+		}
+		if (glfwGetKey(window, GLFW_KEY_F7) == GLFW_PRESS)
+		{
+			m_wait = true;
+			Profiler::writeTrace();
+		}
+		if (glfwGetKey(window, GLFW_KEY_F6) == GLFW_PRESS)
+		{
+			m_wait = true;
+			m_gpuProfiler->setLogging(!m_gpuProfiler->isLogging());
+		}
+		if (glfwGetKey(window, GLFW_KEY_F5) == GLFW_PRESS)
+		{
+			m_wait = true;
+			m_recordingPath = !m_recordingPath;
+
+			if(m_recordingPath)
+			{
+				std::cout << "Recording camera path" << std::endl;
+				m_recordedPath = std::shared_ptr<CameraPath>(new CameraPath());
+				m_recordingStart = glfwGetTime();
+			}
+			else if(m_recordedPath->save("camera_path.txt"))
+			{
+				std::cout << "Saved " << m_recordedPath->size() << " keyframes to camera_path.txt" << std::endl;
+			}
+		}
+	}
+
+	if(m_recordingPath)
+	{
+		m_recordedPath->addKeyframe(float(glfwGetTime() - m_recordingStart), m_camera->getPosition(), m_camera->getDirection());
 	}
 
+	//Picks once per click, the left button is taken by the camera
+	bool picking = glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_RIGHT) == GLFW_PRESS;
+	if (picking && !m_picking)
+	{
+		pick(window);
+	}
+	m_picking = picking;
+
 	m_fpsCamera->processInput(window);
 	m_lightMoveCallback->processInput(window);
 }
 
+void Application::pick(GLFWwindow* window)
+{
+	double x, y;
+	glfwGetCursorPos(window, &x, &y);
+
+	glm::uvec2 screenSize = m_camera->getScreenSize();
+	glm::vec2 ndc = glm::vec2(2.0f * float(x) / float(screenSize.x) - 1.0f, 1.0f - 2.0f * float(y) / float(screenSize.y));
+
+	//The ray goes from the near plane to the far plane through the cursor
+	glm::mat4 toWorld = glm::inverse(m_camera->getProjection() * m_camera->getView());
+	glm::vec4 nearPoint = toWorld * glm::vec4(ndc.x, ndc.y, -1.0f, 1.0f);
+	glm::vec4 farPoint = toWorld * glm::vec4(ndc.x, ndc.y, 1.0f, 1.0f);
+	glm::vec3 origin = glm::vec3(nearPoint) / nearPoint.w;
+	glm::vec3 direction = glm::vec3(farPoint) / farPoint.w - origin;
+
+	SceneBVH::Hit hit;
+	if (m_sceneBVH->pick(origin, direction, hit))
+	{
+		std::cout << "Picked " << m_sceneBVH->getPath(hit.entry) << " at (" << hit.position.x << ", " << hit.position.y << ", " << hit.position.z << "), " << hit.distance * glm::length(direction) << " units away" << std::endl;
+	}
+	else
+	{
+		std::cout << "Nothing picked" << std::endl;
+	}
+}
+
 void Application::reloadScene()
 {
 	initResources(m_loadedFilename, m_loadedVShader, m_loadedFShader);
 	initView(m_fpsCamera);
 }
 
+std::shared_ptr<Camera> Application::getCamera()
+{
+	return m_camera;
+}
+
+std::shared_ptr<GPUProfiler> Application::getGPUProfiler()
+{
+	return m_gpuProfiler;
+}
+
+void Application::setShadowQuality(unsigned int resolution, unsigned int depthBits)
+{
+	m_shadowResolution = resolution;
+	m_shadowDepthBits = depthBits;
+
+	if (m_shadowmap)
+	{
+		m_shadowmap->setQuality(m_shadowResolution, RenderTargetPool::depthFormat(m_shadowDepthBits));
+	}
+}
+
+std::shared_ptr<RenderTargetPool> Application::getRenderTargetPool()
+{
+	return m_renderTargetPool;
+}
+
+std::shared_ptr<ThreadPool> Application::getThreadPool()
+{
+	return m_threadPool;
+}
+
+void Application::setParticleBackend(GPUParticles::Backend backend)
+{
+	m_particleBackend = backend;
+}
+
+void Application::setTextureStreaming(bool flag)
+{
+	m_textureStreaming = flag;
+}
+
+std::shared_ptr<TextureStreamer> Application::getTextureStreamer()
+{
+	return m_textureStreamer;
+}
+
+void Application::setTextureArrays(bool flag)
+{
+	m_textureArrays = flag;
+}
+
+void Application::setBindlessTextures(bool flag)
+{
+	m_bindlessTextures = flag;
+}
+
+GLuint Application::getParticleProgram()
+{
+	return m_gpuProgram;
+}
+
+GLuint Application::getParticleComputeProgram()
+{
+	return m_gpuComputeProgram;
+}
+
+void Application::setOrderIndependentTransparency(bool flag)
+{
+	m_orderIndependentTransparency = flag;
+
+	//Sorting is only needed when transparent geometry is blended in scene order
+	for(auto& group : m_sortedGroups)
+	{
+		group->setSortingEnabled(!flag);
+	}
+}
+
+void Application::setOcclusionCulling(bool flag)
+{
+	m_occlusionCulling = flag;
+
+	//The toon, billboard and transparent passes use the same camera, so they test against the same depth
+	m_renderVisitor->setOcclusionCuller(flag ? m_occlusionCuller : nullptr);
+}
+
+std::shared_ptr<ProgramCache> Application::getProgramCache()
+{
+	return m_programCache;
+}
+
+double Application::getProgramLoadMs()
+{
+	return m_programLoadMs;
+}
+
+BoundingBox Application::getSceneBoundingBox()
+{
+	return m_rootNode->calculateBoundingBox();
+}
+
 void Application::setScreenSize(unsigned int width, unsigned int height)
 {
 	m_camera->setScreenSize(glm::uvec2(width, height));
@@ -286,14 +769,86 @@ void Application::setScreenSize(unsigned int width, unsigned int height)
 }
 
 void Application::render(std::shared_ptr<Camera> camera, GLuint program)
+{
+	if(program == m_program)
+	{
+		for(GLuint variant : m_phongPermutations->getPrograms())
+		{
+			applyFrameUniforms(camera, variant, m_renderShadowmap);
+		}
+
+		//The first pass of the frame, the camera matrices were just updated
+		glm::mat4 viewProjection = camera->getProjection() * camera->getView();
+		m_sceneBVH->cull(viewProjection);
+
+		if(m_occlusionCulling)
+		{
+			m_occlusionCuller->render(viewProjection);
+		}
+	}
+	else if(program == m_billboardProgram)
+	{
+		for(GLuint variant : m_billboardPermutations->getPrograms())
+		{
+			applyFrameUniforms(camera, variant, false);
+		}
+	}
+	else
+	{
+		applyFrameUniforms(camera, program, false);
+	}
+
+	PROFILE_SCOPE("RenderVisitor");
+	m_renderVisitor->resetState();
+	m_renderVisitor->visit(*m_rootNode);
+
+	//The first pass tests every geometry once, the later passes repeat the same tests
+	if(program == m_program && m_occlusionCulling)
+	{
+		m_occlusionCuller->endCounting();
+	}
+}
+
+void Application::renderTransparent(std::shared_ptr<Camera> camera, std::shared_ptr<Texture> shadowmap)
+{
+	PROFILE_FUNCTION();
+
+	if(!m_transparencyPass->begin(m_screenSize))
+	{
+		return;
+	}
+
+	if(shadowmap)
+	{
+		shadowmap->bind();
+	}
+
+	//The frame uniforms were applied by the opaque passes
+	m_renderVisitor->setFilter(RenderVisitor::FILTER_TRANSPARENT);
+	m_renderVisitor->resetState();
+	m_renderVisitor->visit(*m_rootNode);
+	m_renderVisitor->drawTransparent();
+	m_renderVisitor->setFilter(RenderVisitor::FILTER_OPAQUE);
+
+	if(shadowmap)
+	{
+		shadowmap->unbind();
+	}
+
+	m_transparencyPass->composite();
+}
+
+void Application::applyFrameUniforms(std::shared_ptr<Camera> camera, GLuint program, bool shadows)
 {
 	glUseProgram(program);
 	camera->init(program);
 	camera->apply(program);
 	glUseProgram(0);
 
-	m_renderVisitor->resetState();
-	m_renderVisitor->visit(*m_rootNode);
+	if(shadows)
+	{
+		m_shadowmap->apply(program);
+	}
 }
 
 bool Application::initShaders(GLuint *program, const std::string& vshader_filename, const std::string& fshader_filename)
@@ -302,11 +857,17 @@ bool Application::initShaders(GLuint *program, const std::string& vshader_filena
 	GLint link_ok = GL_FALSE;
 	GLint validate_ok = GL_FALSE;
 	GLuint vs, fs;
+
+	uint64_t key = m_programCache->key({ { GL_VERTEX_SHADER, vshader_filename }, { GL_FRAGMENT_SHADER, fshader_filename } });
+	if (m_programCache->load(*program, key))
+		return true;
+
 	if ((vs = vr::loadShader(vshader_filename, GL_VERTEX_SHADER)) == 0) return false;
 	if ((fs = vr::loadShader(fshader_filename, GL_FRAGMENT_SHADER)) == 0) return false;
 
 	glAttachShader(*program, vs);
 	glAttachShader(*program, fs);
+	glProgramParameteri(*program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
 	glLinkProgram(*program);
 	glGetProgramiv(*program, GL_LINK_STATUS, &link_ok);
 
@@ -327,6 +888,8 @@ bool Application::initShaders(GLuint *program, const std::string& vshader_filena
 		return false;
 	}
 
+	m_programCache->store(*program, key);
+
 	return true;
 }
 
@@ -337,9 +900,14 @@ bool Application::initComputeShader(GLuint *program, const std::string& filename
 
 	GLuint cs;
 
-	cs = vr::loadShader("shaders/gpu-particles/gpu.comp.glsl", GL_COMPUTE_SHADER);
+	uint64_t key = m_programCache->key({ { GL_COMPUTE_SHADER, filename } });
+	if (m_programCache->load(*program, key))
+		return true;
+
+	if ((cs = vr::loadShader(filename, GL_COMPUTE_SHADER)) == 0) return false;
 
 	glAttachShader(*program, cs);
+	glProgramParameteri(*program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
 	glLinkProgram(*program);
 
 	glGetProgramiv(*program, GL_LINK_STATUS, &link_ok);
@@ -361,6 +929,8 @@ bool Application::initComputeShader(GLuint *program, const std::string& filename
 		return false;
 	}
 
+	m_programCache->store(*program, key);
+
 	return true;
 }
 
@@ -371,6 +941,10 @@ bool Application::initGpuShaders(GLuint *program, const std::string& vshader_fil
 	GLint validate_ok = GL_FALSE;
 	GLuint vs, fs, gs;
 
+	uint64_t key = m_programCache->key({ { GL_VERTEX_SHADER, vshader_filename }, { GL_GEOMETRY_SHADER, gshader_filename }, { GL_FRAGMENT_SHADER, fshader_filename } });
+	if (m_programCache->load(*program, key))
+		return true;
+
 	vs = vr::loadShader(vshader_filename, GL_VERTEX_SHADER);
 	gs = vr::loadShader(gshader_filename, GL_GEOMETRY_SHADER);
 	fs = vr::loadShader(fshader_filename, GL_FRAGMENT_SHADER);
@@ -383,6 +957,7 @@ bool Application::initGpuShaders(GLuint *program, const std::string& vshader_fil
 	glProgramParameteriEXT(*program, GL_GEOMETRY_VERTICES_OUT_EXT, 4);
 
 	glAttachShader(*program, fs);
+	glProgramParameteri(*program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
 	glLinkProgram(*program);
 
 	glGetProgramiv(*program, GL_LINK_STATUS, &link_ok);
@@ -404,6 +979,8 @@ bool Application::initGpuShaders(GLuint *program, const std::string& vshader_fil
 		return false;
 	}
 
+	m_programCache->store(*program, key);
+
 	return true;
 }
 
@@ -445,6 +1022,123 @@ std::shared_ptr<Transform> Application::parseObj(std::shared_ptr<Obj> obj)
 	return n;
 }
 
+std::shared_ptr<LOD> Application::buildAutoLOD(std::shared_ptr<Obj> obj, const std::vector<float>& ratios)
+{
+	PROFILE_FUNCTION();
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	std::shared_ptr<LOD> lod(new LOD(m_camera));
+	lod->setName("LOD_" + obj->name);
+
+	//The LOD places the object, the levels only keep the transforms of the meshes
+	std::shared_ptr<Obj> level = std::shared_ptr<Obj>(new Obj(*obj));
+	level->initialTransform = glm::mat4(1);
+	lod->addChild(parseObj(level), 0.0f);
+
+	MeshSimplifier simplifier;
+	std::vector<std::vector<Mesh>> meshLevels(obj->meshes.size());
+	std::vector<float> errors(ratios.size(), 0.0f);
+
+	for(int i = 0; i < obj->meshes.size(); i++)
+	{
+		std::vector<float> meshErrors;
+		simplifier.buildChain(obj->meshes[i], ratios, meshLevels[i], meshErrors);
+
+		//The errors are in the space of each mesh, the LOD compares them in the space of the object
+		const glm::mat4& m = obj->meshes[i].object2world;
+		float scale = std::max(glm::length(glm::vec3(m[0])), std::max(glm::length(glm::vec3(m[1])), glm::length(glm::vec3(m[2]))));
+
+		for(size_t k = 0; k < ratios.size(); k++)
+		{
+			errors[k] = std::max(errors[k], meshErrors[k] * scale);
+		}
+	}
+
+	size_t triangles = 0;
+	for(size_t k = 0; k < ratios.size(); k++)
+	{
+		for(int i = 0; i < obj->meshes.size(); i++)
+		{
+			level->meshes[i] = meshLevels[i][k];
+			triangles += level->meshes[i].elements.size() / 3;
+		}
+
+		lod->addChild(parseObj(level), errors[k]);
+	}
+
+	lod->setInitialTransform(obj->initialTransform);
+
+	//The levels are switched while the camera moves
+	lod->setDynamic(true);
+	m_lodSelector->add(lod);
+
+	double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	std::cout << "Generated " << ratios.size() << " LOD levels for " << obj->name << " (" << triangles << " triangles) in " << ms << " ms" << std::endl;
+
+	return lod;
+}
+
+void Application::addOccluders(const std::vector<std::shared_ptr<Obj>>& objs, const std::vector<std::shared_ptr<Transform>>& nodes)
+{
+	PROFILE_FUNCTION();
+
+	const size_t maxOccluders = 24;
+	const size_t triangleBudget = 1024;
+
+	//The largest objects hide the most, small ones would only cost rasterization time
+	std::vector<std::pair<float, size_t>> sizes;
+	for (size_t i = 0; i < nodes.size(); i++)
+	{
+		sizes.push_back({ nodes[i]->calculateBoundingBox().getRadius(), i });
+	}
+	std::sort(sizes.begin(), sizes.end(), std::greater<std::pair<float, size_t>>());
+	sizes.resize(std::min(sizes.size(), maxOccluders));
+
+	m_occlusionCuller->clear();
+
+	//A proxy bulging out of its mesh would hide geometry that is visible
+	MeshSimplifier simplifier;
+	simplifier.setConservative(true);
+	size_t total = 0;
+	for (auto& size : sizes)
+	{
+		std::shared_ptr<Obj> obj = objs[size.second];
+
+		size_t objTriangles = 0;
+		for (auto& mesh : obj->meshes)
+		{
+			objTriangles += mesh.elements.size() / 3;
+		}
+
+		std::vector<glm::vec3> triangles;
+		for (auto& mesh : obj->meshes)
+		{
+			const Mesh* source = &mesh;
+			Mesh simplified;
+
+			//Every mesh keeps its share of the budget
+			size_t meshTriangles = mesh.elements.size() / 3;
+			size_t target = std::max<size_t>(1, triangleBudget * meshTriangles / std::max<size_t>(objTriangles, 1));
+			if (meshTriangles > target)
+			{
+				simplifier.simplify(mesh, target, simplified);
+				source = &simplified;
+			}
+
+			for (GLushort element : source->elements)
+			{
+				triangles.push_back(glm::vec3(mesh.object2world * source->vertices[element]));
+			}
+		}
+
+		total += triangles.size() / 3;
+		m_occlusionCuller->addOccluder(nodes[size.second], triangles);
+	}
+
+	std::cout << "Occlusion culling with " << sizes.size() << " occluders, " << total << " triangles" << std::endl;
+}
+
 std::shared_ptr<Transform> Application::buildQuad()
 {
 	std::shared_ptr<Transform> transform = std::shared_ptr<Transform>(new Transform());
@@ -483,6 +1177,7 @@ std::shared_ptr<Transform> Application::buildQuad()
 	texture->create("textures/tree.png", 0, false);
 
 	transform->setState(std::shared_ptr<State>(new State(m_billboardProgram)));
+	transform->getState()->setPermutations(m_billboardPermutations);
 	transform->getState()->setTexture(texture, 0);
 
 	transform->getState()->enableAlphaBlending(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
@@ -497,7 +1192,7 @@ std::shared_ptr<Transform> Application::buildQuad()
 
 std::shared_ptr<Transform> Application::buildSuzanne(std::string model_filename)
 {
-	std::shared_ptr<Obj> obj = loadObj(model_filename);
+	std::shared_ptr<Obj> obj = loadObj(model_filename, false, m_textureStreamer.get());
 
 	if (!obj)
 	{
@@ -509,41 +1204,28 @@ std::shared_ptr<Transform> Application::buildSuzanne(std::string model_filename)
 	transform->scale(glm::vec3(1, 1, 1));
 	transform->translate(glm::vec3(10, 0, 0));
 	transform->addUpdateCallback(std::shared_ptr<RotateCallback>(new RotateCallback()));
+	transform->setDynamic(true);
 
 	return transform;
 }
 
 std::shared_ptr<Transform> Application::buildCow()
 {
-	std::shared_ptr<LOD> lod(new LOD(m_camera));
-
-	std::vector<std::string> lodModels;
+	std::shared_ptr<Obj> obj = loadObj("models/cow/cow_0.99.obj");
 
-	lodModels.push_back("models/cow/cow_0.99.obj");
-	lodModels.push_back("models/cow/cow_0.5.obj");
-	lodModels.push_back("models/cow/cow_0.3.obj");
-	lodModels.push_back("models/cow/cow_0.1.obj");
-	lodModels.push_back("models/cow/cow_0.05.obj");
-	lodModels.push_back("models/cow/cow_0.01.obj");
-
-	for(int i = 0; i < 6; i++)
+	if (!obj)
 	{
-		std::shared_ptr<Obj> obj = loadObj(lodModels[i]);
-
-		if (!obj)
-		{
-			continue;
-		}
-
-		std::shared_ptr<Transform> transform = parseObj(obj);
-		transform->setState(std::shared_ptr<State>(new State()));
-		transform->getState()->setPolygonMode(GL_LINE);
-		lod->addChild(transform);
+		return std::shared_ptr<Transform>(new Transform());
 	}
 
-	lodModels.clear();
+	obj->name = "cow";
+	std::shared_ptr<LOD> lod = buildAutoLOD(obj, { 0.5f, 0.3f, 0.1f, 0.05f, 0.01f });
 
-	m_rootNode->addUpdateCallback(lod);
+	for(auto level : lod->getChildren())
+	{
+		level->setState(std::shared_ptr<State>(new State()));
+		level->getState()->setPolygonMode(GL_LINE);
+	}
 
 	lod->scale(glm::vec3(0.01f, 0.01f, 0.01f));
 
@@ -747,6 +1429,8 @@ void Application::buildGeometry(std::string model_filename)
 	}
 
 	m_rootNode->addUpdateCallback(forest);
+	m_sortedGroups.push_back(forest);
+	forest->setSortingEnabled(!m_orderIndependentTransparency);
 	m_rootNode->addChild(forest);
 	m_rootNode->addChild(buildQuad());
 }
\ No newline at end of file
@@ -2,6 +2,7 @@
 
 #pragma once
 
+#include <chrono>
 #include <memory>
 #include <vector>
 #include <sstream>
@@ -17,10 +18,25 @@
 #include "Shadowmap.h"
 #include "RenderToTexture.h"
 #include "GPUParticles.h"
+#include "CameraPath.h"
+#include "GPUProfiler.h"
+#include "ProgramCache.h"
+#include "ShaderPermutations.h"
+#include "RenderTargetPool.h"
+#include "ThreadPool.h"
+#include "TransparencyPass.h"
 
 class LightMoveCallback;
 class Skybox;
 class DrawCameraStatus;
+class SortedGroup;
+class LODSelector;
+class LOD;
+class Impostors;
+class OcclusionCuller;
+class SceneBVH;
+class WorldPartition;
+class TextureStreamer;
 
 /// <summary>
 /// The application
@@ -73,12 +89,132 @@ class Application
         /// Reloads the application
         /// </summary>
         void reloadScene();
+
+        /// <summary>
+        /// Returns the active camera
+        /// </summary>
+        /// <returns>The camera</returns>
+        std::shared_ptr<Camera> getCamera();
+
+        /// <summary>
+        /// Returns the bounding box of the loaded scene
+        /// </summary>
+        /// <returns>The bounding box</returns>
+        BoundingBox getSceneBoundingBox();
+
+        /// <summary>
+        /// Returns the GPU profiler measuring the passes of update
+        /// </summary>
+        /// <returns>The profiler</returns>
+        std::shared_ptr<GPUProfiler> getGPUProfiler();
+
+        /// <summary>
+        /// Returns the program binary cache used when initilizing the shaders
+        /// </summary>
+        /// <returns>The cache</returns>
+        std::shared_ptr<ProgramCache> getProgramCache();
+
+        /// <summary>
+        /// Returns the time it took to create all programs in the last initResources
+        /// </summary>
+        /// <returns>The time in milliseconds</returns>
+        double getProgramLoadMs();
+
+        /// <summary>
+        /// Sets the resolution and depth bits of the shadow cascades, can be called before initResources
+        /// </summary>
+        /// <param name="resolution">The width and height of every cascade</param>
+        /// <param name="depthBits">16, 24 or 32</param>
+        void setShadowQuality(unsigned int resolution, unsigned int depthBits);
+
+        /// <summary>
+        /// Returns the pool the render targets are allocated from
+        /// </summary>
+        /// <returns>The pool</returns>
+        std::shared_ptr<RenderTargetPool> getRenderTargetPool();
+
+        /// <summary>
+        /// Returns the worker threads shared by the engine
+        /// </summary>
+        /// <returns>The pool</returns>
+        std::shared_ptr<ThreadPool> getThreadPool();
+
+        /// <summary>
+        /// Sets where the particles are simulated, has to be called before initResources
+        /// </summary>
+        /// <param name="backend">The backend</param>
+        void setParticleBackend(GPUParticles::Backend backend);
+
+        /// <summary>
+        /// Sets if the textures of the scene are streamed in over the first frames or uploaded while loading, has to be
+        /// called before initResources
+        /// </summary>
+        /// <param name="flag">The flag</param>
+        void setTextureStreaming(bool flag);
+
+        /// <summary>
+        /// Returns the texture streamer, null when textures are not streamed
+        /// </summary>
+        std::shared_ptr<TextureStreamer> getTextureStreamer();
+
+        /// <summary>
+        /// Sets if the textures of the scene are packed into texture arrays once loaded, see TextureArrayPacker. Streamed
+        /// textures are loaded completely first. Has to be called before initResources
+        /// </summary>
+        /// <param name="flag">The flag</param>
+        void setTextureArrays(bool flag);
+
+        /// <summary>
+        /// Sets if textures are drawn through bindless handles where the driver supports them, see BindlessTextures. Has
+        /// to be called before initResources
+        /// </summary>
+        /// <param name="flag">The flag</param>
+        void setBindlessTextures(bool flag);
+
+        /// <summary>
+        /// Returns the program drawing the particles
+        /// </summary>
+        GLuint getParticleProgram();
+
+        /// <summary>
+        /// Returns the compute program simulating the particles
+        /// </summary>
+        GLuint getParticleComputeProgram();
+
+        /// <summary>
+        /// Sets if transparent geometry is drawn with weighted blended order independent transparency, or blended
+        /// in the order of the scene graph with sorted groups
+        /// </summary>
+        /// <param name="flag">The flag</param>
+        void setOrderIndependentTransparency(bool flag);
+
+        /// <summary>
+        /// Sets if geometry hidden behind the largest objects of the scene is skipped
+        /// </summary>
+        /// <param name="flag">The flag</param>
+        void setOcclusionCulling(bool flag);
     private:
         //Variables
         std::shared_ptr<Group> m_rootNode;
         std::shared_ptr<RenderVisitor> m_renderVisitor;
         std::shared_ptr<UpdateVisitor> m_updateVisitor;
         std::shared_ptr<FPSCounter> m_fpsCounter;
+        std::shared_ptr<GPUProfiler> m_gpuProfiler;
+        std::shared_ptr<ProgramCache> m_programCache;
+        std::shared_ptr<RenderTargetPool> m_renderTargetPool;
+        std::shared_ptr<ThreadPool> m_threadPool;
+        std::shared_ptr<ShaderPermutations> m_phongPermutations;
+        std::shared_ptr<ShaderPermutations> m_billboardPermutations;
+        std::shared_ptr<TransparencyPass> m_transparencyPass;
+        std::vector<std::shared_ptr<SortedGroup>> m_sortedGroups;
+        std::shared_ptr<LODSelector> m_lodSelector;
+        std::shared_ptr<Impostors> m_impostors;
+        std::shared_ptr<OcclusionCuller> m_occlusionCuller;
+        std::shared_ptr<SceneBVH> m_sceneBVH;
+        std::shared_ptr<WorldPartition> m_worldPartition;
+        unsigned long long m_partitionVersion = 0;
+        std::shared_ptr<TextureStreamer> m_textureStreamer;
+        double m_programLoadMs;
         std::shared_ptr<DrawCameraStatus> m_drawCameraStatus;
         std::shared_ptr<Camera> m_camera;
         std::shared_ptr<Camera> m_fpsCamera;
@@ -92,19 +228,39 @@ class Application
         std::string m_loadedFShader;
         glm::uvec2 m_screenSize;
         bool m_renderShadowmap = true;
+        bool m_orderIndependentTransparency = true;
+        float m_lodBias = 0;
+        bool m_occlusionCulling = true;
+        bool m_picking = false;
+        unsigned int m_shadowResolution = 1024;
+        unsigned int m_shadowDepthBits = 32;
         bool m_renderParticles = false;
+        GPUParticles::Backend m_particleBackend = GPUParticles::BACKEND_COMPUTE;
+        bool m_textureStreaming = true;
+        bool m_textureArrays = false;
+        bool m_bindlessTextures = false;
+        std::chrono::high_resolution_clock::time_point m_initStart;
+        bool m_firstFrame = true;
         bool m_wait = false;
         int m_tick = 0;
 
+        //Camera path recording, used by the benchmark
+        std::shared_ptr<CameraPath> m_recordedPath;
+        bool m_recordingPath = false;
+        double m_recordingStart = 0;
+
         GLuint m_program;
         GLuint m_toonProgram;
         GLuint m_depthProgram;
         GLuint m_skyboxProgram;
         GLuint m_billboardProgram;
+        GLuint m_compositeProgram;
+        GLuint m_impostorProgram;
 
         //GPU particles
         GLuint m_gpuProgram;
         GLuint m_gpuComputeProgram;
+        GLuint m_gpuSortProgram;
         std::shared_ptr<Texture> particleTex;
         GLuint vao{};
         //End of GPU particles
@@ -115,6 +271,21 @@ class Application
         /// <param name="program">The program to render on</param>
         void render(std::shared_ptr<Camera> camera, GLuint program);
 
+        /// <summary>
+        /// Renders the transparent geometry with order independent transparency over what has been rendered
+        /// </summary>
+        /// <param name="camera">The camera</param>
+        /// <param name="shadowmap">The shadow map of the frame, may be nullptr</param>
+        void renderTransparent(std::shared_ptr<Camera> camera, std::shared_ptr<Texture> shadowmap);
+
+        /// <summary>
+        /// Applies the per frame uniforms (camera, animation time and shadows) to a program
+        /// </summary>
+        /// <param name="camera">The camera to apply</param>
+        /// <param name="program">The program</param>
+        /// <param name="shadows">Flag for if the shadowmap uniforms should be applied</param>
+        void applyFrameUniforms(std::shared_ptr<Camera> camera, GLuint program, bool shadows);
+
         /// <summary>
         /// Initilizes the application shaders for a given program
         /// </summary>
@@ -137,6 +308,27 @@ class Application
         /// <returns>The transform for the parsed object</returns>
         std::shared_ptr<Transform> parseObj(std::shared_ptr<Obj> model_filename);
 
+        /// <summary>
+        /// Builds a LOD for an object, with levels simplified from its meshes
+        /// </summary>
+        /// <param name="obj">The object, shown at full detail as the first level</param>
+        /// <param name="ratios">The triangle ratios of the simplified levels, decreasing</param>
+        /// <returns>The LOD, added to the LOD selector</returns>
+        std::shared_ptr<LOD> buildAutoLOD(std::shared_ptr<Obj> obj, const std::vector<float>& ratios);
+
+        /// <summary>
+        /// Gives the largest objects of the scene to the occlusion culler, simplified when they have many triangles
+        /// </summary>
+        /// <param name="objs">The loaded objects</param>
+        /// <param name="nodes">The node placing every object</param>
+        void addOccluders(const std::vector<std::shared_ptr<Obj>>& objs, const std::vector<std::shared_ptr<Transform>>& nodes);
+
+        /// <summary>
+        /// Picks the object under the cursor with the scene hierarchy and prints it
+        /// </summary>
+        /// <param name="window">The window the cursor is in</param>
+        void pick(GLFWwindow* window);
+
 
         std::shared_ptr<Transform> buildQuad();
 
@@ -0,0 +1,314 @@
+#include "BVHBenchmark.h"
+#include "SceneBVH.h"
+#include "Geometry.h"
+#include "Group.h"
+#include "NodeVisitor.h"
+#include "Transform.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <stack>
+
+namespace
+{
+    //The objects fill a cube, the camera orbits inside it and looks at the middle, so most objects are behind or beside it
+    const float EXTENT = 500.0f;
+    const float ORBIT_RADIUS = 300.0f;
+    const float ORBIT_STEP = 0.01f;
+    const unsigned int MOVING_EVERY = 100;
+    const unsigned int PICKS_PER_UPDATE = 64;
+
+    glm::vec3 orbitEye(unsigned int update)
+    {
+        float angle = update * ORBIT_STEP;
+        return glm::vec3(std::cos(angle), 0.3f, std::sin(angle)) * ORBIT_RADIUS;
+    }
+
+    /// <summary>
+    /// Frustum culling as a walk over the scene graph, the way the visitors find geometry
+    /// </summary>
+    class FrustumWalk : public NodeVisitor
+    {
+        public:
+            FrustumWalk(const glm::mat4& viewProjection) : m_visible(0)
+            {
+                SceneBVH::extractPlanes(viewProjection, m_planes);
+                m_transforms.push(glm::mat4(1.0f));
+            }
+
+            void visit(Group& g) override
+            {
+                g.accept(*this);
+            }
+
+            void visit(Transform& t) override
+            {
+                m_transforms.push(m_transforms.top() * t.getModelMatrix());
+                t.acceptChildren(*this);
+                m_transforms.pop();
+            }
+
+            void visit(Geometry& g) override
+            {
+                if(SceneBVH::intersects(m_planes, SceneBVH::transform(g.getLocalBoundingBox(), m_transforms.top())))
+                {
+                    m_visible++;
+                }
+            }
+
+            unsigned int getVisible()
+            {
+                return m_visible;
+            }
+
+        private:
+            glm::vec4 m_planes[6];
+            std::stack<glm::mat4> m_transforms;
+            unsigned int m_visible;
+    };
+
+    template<typename F>
+    double measureMs(F function)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        function();
+        return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    }
+}
+
+BVHBenchmark::BVHBenchmark() :
+    m_objects(100000),
+    m_warmupUpdates(10),
+    m_measuredUpdates(100),
+    m_buildMs(0.0),
+    m_nodes(0),
+    m_mismatches(0)
+{
+}
+
+void BVHBenchmark::setSize(unsigned int objects, unsigned int warmup, unsigned int measured)
+{
+    m_objects = std::max(objects, 1u);
+    m_warmupUpdates = warmup;
+    m_measuredUpdates = std::max(measured, 1u);
+}
+
+bool BVHBenchmark::run(const std::string& outFilename)
+{
+    m_results.clear();
+    m_mismatches = 0;
+
+    std::cout << "Benchmarking the scene hierarchy over " << m_objects << " objects: " << m_warmupUpdates << " warm-up updates, " << m_measuredUpdates << " measured updates" << std::endl;
+
+    //Every object shares a unit cube, only the vertices and elements are needed so nothing is uploaded
+    std::shared_ptr<Geometry> cube = std::shared_ptr<Geometry>(new Geometry());
+    for(int i = 0; i < 8; i++)
+    {
+        cube->addVertex((i & 1) ? 0.5f : -0.5f, (i & 2) ? 0.5f : -0.5f, (i & 4) ? 0.5f : -0.5f, 1.0f);
+    }
+    const GLushort elements[] = { 0, 1, 3, 0, 3, 2, 4, 6, 7, 4, 7, 5, 0, 4, 5, 0, 5, 1, 2, 3, 7, 2, 7, 6, 0, 2, 6, 0, 6, 4, 1, 5, 7, 1, 7, 3 };
+    for(GLushort element : elements)
+    {
+        cube->addElement(element);
+    }
+
+    std::shared_ptr<Group> root = std::shared_ptr<Group>(new Group());
+    root->setName("root");
+
+    std::mt19937 random(1);
+    std::uniform_real_distribution<float> position(-EXTENT, EXTENT);
+    std::uniform_real_distribution<float> size(1.0f, 10.0f);
+
+    std::vector<std::shared_ptr<Transform>> moving;
+    std::vector<glm::vec3> centers;
+
+    for(unsigned int i = 0; i < m_objects; i++)
+    {
+        glm::vec3 center = glm::vec3(position(random), position(random), position(random));
+        centers.push_back(center);
+
+        std::shared_ptr<Transform> transform = std::shared_ptr<Transform>(new Transform());
+        transform->translate(center);
+        transform->scale(glm::vec3(size(random)));
+        transform->addChild(cube);
+        root->addChild(transform);
+
+        if(i % MOVING_EVERY == 0)
+        {
+            transform->setDynamic(true);
+            moving.push_back(transform);
+        }
+    }
+
+    SceneBVH bvh;
+    m_buildMs = measureMs([&]() { bvh.build(root); });
+    m_nodes = bvh.getNumNodes();
+
+    Result refit = { "refit, 1% moved", 0.0, 0.0 };
+    Result frustum = { "frustum", 0.0, 0.0 };
+    Result frustumWalk = { "frustum, scene graph walk", 0.0, 0.0 };
+    Result sphere = { "sphere", 0.0, 0.0 };
+    Result sphereLinear = { "sphere, linear", 0.0, 0.0 };
+    Result pick = { "pick x64", 0.0, 0.0 };
+
+    std::vector<uint32_t> found;
+    std::uniform_int_distribution<unsigned int> object(0, m_objects - 1);
+
+    for(unsigned int update = 0; update < m_warmupUpdates + m_measuredUpdates; update++)
+    {
+        bool measured = update >= m_warmupUpdates;
+
+        //The moving objects sway back and forth, so they stay spread through the cube
+        float offset = std::sin(update * 0.1f) - std::sin((update - 1.0f) * 0.1f);
+        for(auto& transform : moving)
+        {
+            transform->translate(glm::vec3(offset, 0.0f, -offset));
+        }
+
+        double ms = measureMs([&]() { bvh.refit(); });
+        if(measured)
+        {
+            refit.msPerUpdate += ms;
+            refit.resultsPerUpdate += bvh.getLastMoved();
+        }
+
+        glm::vec3 eye = orbitEye(update);
+        glm::mat4 viewProjection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 1.0f, 2000.0f) * glm::lookAt(eye, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+        found.clear();
+        ms = measureMs([&]() { bvh.queryFrustum(viewProjection, found); });
+        size_t frustumCount = found.size();
+
+        FrustumWalk walk(viewProjection);
+        double walkMs = measureMs([&]() { walk.visit(*root); });
+
+        if(frustumCount != walk.getVisible())
+        {
+            m_mismatches++;
+        }
+
+        if(measured)
+        {
+            frustum.msPerUpdate += ms;
+            frustum.resultsPerUpdate += frustumCount;
+            frustumWalk.msPerUpdate += walkMs;
+            frustumWalk.resultsPerUpdate += walk.getVisible();
+        }
+
+        glm::vec3 center = centers[object(random)];
+        float radius = EXTENT * 0.1f;
+
+        found.clear();
+        ms = measureMs([&]() { bvh.querySphere(center, radius, found); });
+        size_t sphereCount = found.size();
+
+        size_t linearCount = 0;
+        double linearMs = measureMs([&]()
+        {
+            for(uint32_t entry = 0; entry < bvh.getNumEntries(); entry++)
+            {
+                const BoundingBox& box = bvh.getWorldBoundingBox(entry);
+                glm::vec3 offset = glm::clamp(center, box.min(), box.max()) - center;
+                if(glm::dot(offset, offset) <= radius * radius)
+                {
+                    linearCount++;
+                }
+            }
+        });
+
+        if(sphereCount != linearCount)
+        {
+            m_mismatches++;
+        }
+
+        if(measured)
+        {
+            sphere.msPerUpdate += ms;
+            sphere.resultsPerUpdate += sphereCount;
+            sphereLinear.msPerUpdate += linearMs;
+            sphereLinear.resultsPerUpdate += linearCount;
+        }
+
+        //Rays from the camera towards random objects, the moving ones may have swayed out of the way
+        unsigned int hits = 0;
+        ms = measureMs([&]()
+        {
+            for(unsigned int i = 0; i < PICKS_PER_UPDATE; i++)
+            {
+                SceneBVH::Hit hit;
+                if(bvh.pick(eye, centers[object(random)] - eye, hit))
+                {
+                    hits++;
+                }
+            }
+        });
+
+        if(measured)
+        {
+            pick.msPerUpdate += ms;
+            pick.resultsPerUpdate += hits;
+        }
+    }
+
+    for(Result* result : { &refit, &frustum, &frustumWalk, &sphere, &sphereLinear, &pick })
+    {
+        result->msPerUpdate /= m_measuredUpdates;
+        result->resultsPerUpdate /= m_measuredUpdates;
+        m_results.push_back(*result);
+    }
+
+    std::cout << "build: " << m_buildMs << " ms, " << m_nodes << " nodes" << std::endl;
+    for(auto& result : m_results)
+    {
+        std::cout << result.name << ": " << result.msPerUpdate << " ms per update (" << result.resultsPerUpdate << " results)" << std::endl;
+    }
+
+    if(m_mismatches > 0)
+    {
+        std::cerr << "The hierarchy disagreed with the linear walks in " << m_mismatches << " queries" << std::endl;
+    }
+
+    std::ofstream out(outFilename);
+    if(!out.is_open())
+    {
+        std::cerr << "Could not write BVH benchmark report: " << outFilename << std::endl;
+        return false;
+    }
+
+    writeReport(out);
+    std::cout << "BVH benchmark report written to " << outFilename << std::endl;
+
+    return m_mismatches == 0;
+}
+
+void BVHBenchmark::writeReport(std::ostream& out)
+{
+    out << "{" << std::endl;
+    out << "  \"objects\": " << m_objects << "," << std::endl;
+    out << "  \"warmupUpdates\": " << m_warmupUpdates << "," << std::endl;
+    out << "  \"measuredUpdates\": " << m_measuredUpdates << "," << std::endl;
+    out << "  \"buildMs\": " << m_buildMs << "," << std::endl;
+    out << "  \"nodes\": " << m_nodes << "," << std::endl;
+    out << "  \"mismatches\": " << m_mismatches << "," << std::endl;
+    out << "  \"results\": [" << std::endl;
+
+    for(size_t i = 0; i < m_results.size(); i++)
+    {
+        const Result& result = m_results[i];
+
+        out << "    { \"case\": \"" << result.name << "\", "
+            << "\"msPerUpdate\": " << result.msPerUpdate << ", "
+            << "\"resultsPerUpdate\": " << result.resultsPerUpdate << " }"
+            << (i + 1 == m_results.size() ? "" : ",") << std::endl;
+    }
+
+    out << "  ]" << std::endl;
+    out << "}" << std::endl;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+/// <summary>
+/// Measures the scene hierarchy on a large amount of objects spread through a cube. The build is timed once, then every
+/// update moves 1% of the objects and refits, and culls, overlaps and picks around a camera orbiting the cube. Frustum
+/// culling and the sphere overlap are also measured as linear walks over the scene graph and the objects for comparison,
+/// and their results are checked against the hierarchy.
+/// </summary>
+class BVHBenchmark
+{
+    public:
+        /// <summary>
+        /// Constructor
+        /// </summary>
+        BVHBenchmark();
+
+        /// <summary>
+        /// Sets the amount of objects and updates
+        /// </summary>
+        /// <param name="objects">The amount of objects</param>
+        /// <param name="warmup">Updates run before measuring starts</param>
+        /// <param name="measured">Updates measured</param>
+        void setSize(unsigned int objects, unsigned int warmup, unsigned int measured);
+
+        /// <summary>
+        /// Runs the benchmark and writes the report
+        /// </summary>
+        /// <param name="outFilename">The file to write the JSON report to</param>
+        /// <returns>Flag for if the benchmark completed and the hierarchy agreed with the linear walks</returns>
+        bool run(const std::string& outFilename);
+
+    private:
+        /// <summary>
+        /// The time of one operation
+        /// </summary>
+        struct Result
+        {
+            std::string name;
+            double msPerUpdate;
+            double resultsPerUpdate;
+        };
+
+        unsigned int m_objects;
+        unsigned int m_warmupUpdates;
+        unsigned int m_measuredUpdates;
+        double m_buildMs;
+        unsigned int m_nodes;
+        unsigned int m_mismatches;
+        std::vector<Result> m_results;
+
+        /// <summary>
+        /// Writes the report
+        /// </summary>
+        void writeReport(std::ostream& out);
+};
@@ -0,0 +1,248 @@
+#include "Benchmark.h"
+#include "BindlessTextures.h"
+#include "Application.h"
+#include "CameraPath.h"
+#include "RenderStats.h"
+#include "GPUProfiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+
+Benchmark::Benchmark(std::shared_ptr<Application> application, std::shared_ptr<CameraPath> path) :
+    m_application(application),
+    m_path(path),
+    m_warmupFrames(100),
+    m_measuredFrames(1000)
+{
+}
+
+void Benchmark::setFrames(unsigned int warmup, unsigned int measured)
+{
+    m_warmupFrames = warmup;
+    m_measuredFrames = std::max(measured, 1u);
+}
+
+bool Benchmark::run(GLFWwindow* window, const std::string& sceneName, const std::string& outFilename)
+{
+    if(!m_path || m_path->size() == 0)
+    {
+        std::cerr << "Benchmark has no camera path to replay" << std::endl;
+        return false;
+    }
+
+    unsigned int totalFrames = m_warmupFrames + m_measuredFrames;
+
+    m_cpuFrameMs.assign(m_measuredFrames, 0.0);
+    m_gpuFrameMs.assign(m_measuredFrames, 0.0);
+    m_drawCalls.assign(m_measuredFrames, 0.0);
+    m_triangles.assign(m_measuredFrames, 0.0);
+    m_stateChanges.assign(m_measuredFrames, 0.0);
+    m_textureBinds.assign(m_measuredFrames, 0.0);
+    m_gpuPassMs.clear();
+
+    //Double buffered so reading back frame i-2 does not stall on the frame currently in flight
+    GLuint queries[2];
+    glGenQueries(2, queries);
+
+    std::shared_ptr<GPUProfiler> profiler = m_application->getGPUProfiler();
+    unsigned long long resolvedFrames = profiler->getResolvedFrames();
+
+    std::cout << "Benchmarking " << sceneName << ": " << m_warmupFrames << " warm-up frames, " << m_measuredFrames << " measured frames" << std::endl;
+
+    for(unsigned int frame = 0; frame < totalFrames; frame++)
+    {
+        GLuint query = queries[frame % 2];
+
+        if(frame >= 2 && frame - 2 >= m_warmupFrames)
+        {
+            GLuint64 elapsed = 0;
+            glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed);
+            m_gpuFrameMs[frame - 2 - m_warmupFrames] = elapsed / 1e6;
+        }
+
+        //Warm-up frames hold the first keyframe, measured frames are spread evenly over the path
+        float t = 0.0f;
+        if(frame >= m_warmupFrames && m_measuredFrames > 1)
+        {
+            t = m_path->getDuration() * float(frame - m_warmupFrames) / float(m_measuredFrames - 1);
+        }
+        m_path->apply(t, m_application->getCamera());
+
+        auto start = std::chrono::high_resolution_clock::now();
+
+        glBeginQuery(GL_TIME_ELAPSED, query);
+        m_application->update(window);
+        glEndQuery(GL_TIME_ELAPSED);
+
+        glfwSwapBuffers(window);
+        glfwPollEvents();
+
+        auto end = std::chrono::high_resolution_clock::now();
+
+        bool resolved = profiler->getResolvedFrames() != resolvedFrames;
+        resolvedFrames = profiler->getResolvedFrames();
+
+        if(frame >= m_warmupFrames)
+        {
+            unsigned int i = frame - m_warmupFrames;
+            m_cpuFrameMs[i] = std::chrono::duration<double, std::milli>(end - start).count();
+            m_drawCalls[i] = RenderStats::getDrawCalls();
+            m_triangles[i] = double(RenderStats::getTriangles());
+            m_stateChanges[i] = RenderStats::getStateChanges();
+            m_textureBinds[i] = RenderStats::getTextureBinds();
+
+            //The profiler resolves frames a couple of frames late and drops some, its results are only new when it resolved one
+            if(resolved)
+            {
+                for(auto& pass : profiler->getResults())
+                {
+                    m_gpuPassMs[pass.name].push_back(pass.ms);
+                }
+            }
+        }
+
+        if(glfwWindowShouldClose(window))
+        {
+            std::cerr << "Benchmark aborted at frame " << frame << std::endl;
+            glDeleteQueries(2, queries);
+            return false;
+        }
+    }
+
+    //Collect the queries of the last two frames
+    for(unsigned int frame = std::max(totalFrames, 2u) - 2; frame < totalFrames; frame++)
+    {
+        if(frame >= m_warmupFrames)
+        {
+            GLuint64 elapsed = 0;
+            glGetQueryObjectui64v(queries[frame % 2], GL_QUERY_RESULT, &elapsed);
+            m_gpuFrameMs[frame - m_warmupFrames] = elapsed / 1e6;
+        }
+    }
+
+    glDeleteQueries(2, queries);
+
+    writeReport(std::cout, sceneName);
+
+    std::ofstream file(outFilename);
+    if(!file.is_open())
+    {
+        std::cerr << "Could not write benchmark report: " << outFilename << std::endl;
+        return false;
+    }
+
+    writeReport(file, sceneName);
+    std::cout << "Benchmark report written to " << outFilename << std::endl;
+
+    return true;
+}
+
+void Benchmark::writeStatistics(std::ostream& out, const std::string& name, std::vector<double> values, bool last)
+{
+    if(values.empty())
+    {
+        values.push_back(0.0);
+    }
+
+    std::sort(values.begin(), values.end());
+
+    //Nearest-rank percentile on the sorted samples
+    auto percentile = [&values](double p)
+    {
+        size_t rank = size_t(std::ceil(p / 100.0 * values.size()));
+        return values[std::min(std::max(rank, size_t(1)), values.size()) - 1];
+    };
+
+    double mean = std::accumulate(values.begin(), values.end(), 0.0) / values.size();
+
+    out << "  \"" << name << "\": { "
+        << "\"mean\": " << mean << ", "
+        << "\"min\": " << values.front() << ", "
+        << "\"p50\": " << percentile(50) << ", "
+        << "\"p90\": " << percentile(90) << ", "
+        << "\"p95\": " << percentile(95) << ", "
+        << "\"p99\": " << percentile(99) << ", "
+        << "\"max\": " << values.back() << " }" << (last ? "" : ",") << std::endl;
+}
+
+void Benchmark::writeReport(std::ostream& out, const std::string& sceneName)
+{
+    glm::uvec2 screenSize = m_application->getCamera()->getScreenSize();
+
+    out << "{" << std::endl;
+    out << "  \"scene\": \"" << escape(sceneName) << "\"," << std::endl;
+    out << "  \"renderer\": \"" << escape((const char*)glGetString(GL_RENDERER)) << "\"," << std::endl;
+    out << "  \"glVersion\": \"" << escape((const char*)glGetString(GL_VERSION)) << "\"," << std::endl;
+    out << "  \"resolution\": [" << screenSize.x << ", " << screenSize.y << "]," << std::endl;
+    out << "  \"warmupFrames\": " << m_warmupFrames << "," << std::endl;
+    out << "  \"measuredFrames\": " << m_measuredFrames << "," << std::endl;
+    out << "  \"pathKeyframes\": " << m_path->size() << "," << std::endl;
+    out << "  \"pathDuration\": " << m_path->getDuration() << "," << std::endl;
+    out << "  \"programLoadMs\": " << m_application->getProgramLoadMs() << "," << std::endl;
+    out << "  \"programCacheHits\": " << m_application->getProgramCache()->getHits() << "," << std::endl;
+    out << "  \"programCacheMisses\": " << m_application->getProgramCache()->getMisses() << "," << std::endl;
+    out << "  \"renderTargetBytes\": " << m_application->getRenderTargetPool()->getMemoryUsage() << "," << std::endl;
+    out << "  \"bindlessTextures\": " << BindlessTextures::getNumTextures() << "," << std::endl;
+    writeStatistics(out, "cpuFrameMs", m_cpuFrameMs);
+    writeStatistics(out, "gpuFrameMs", m_gpuFrameMs);
+    writeStatistics(out, "drawCalls", m_drawCalls);
+    writeStatistics(out, "triangles", m_triangles);
+    writeStatistics(out, "stateChanges", m_stateChanges);
+    writeStatistics(out, "textureBinds", m_textureBinds);
+
+    out << "  \"gpuPassMs\": {" << std::endl;
+    size_t passIndex = 0;
+    for(auto& pass : m_gpuPassMs)
+    {
+        out << "  ";
+        writeStatistics(out, pass.first, pass.second, ++passIndex == m_gpuPassMs.size());
+    }
+    out << "  }" << std::endl;
+    out << "}" << std::endl;
+}
+
+std::string Benchmark::escape(const std::string& value)
+{
+    //Scene paths on Windows are full of backslashes
+    std::string escaped;
+    for(char c : value)
+    {
+        switch(c)
+        {
+            case '"':
+                escaped += "\\\"";
+                break;
+            case '\\':
+                escaped += "\\\\";
+                break;
+            case '\n':
+                escaped += "\\n";
+                break;
+            case '\r':
+                escaped += "\\r";
+                break;
+            case '\t':
+                escaped += "\\t";
+                break;
+            default:
+                if((unsigned char)c < 0x20)
+                {
+                    char code[8];
+                    std::snprintf(code, sizeof(code), "\\u%04x", (unsigned char)c);
+                    escaped += code;
+                }
+                else
+                {
+                    escaped += c;
+                }
+                break;
+        }
+    }
+
+    return escaped;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+#include <map>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+class Application;
+class CameraPath;
+
+/// <summary>
+/// Deterministic benchmark driver. Replays a camera path through the application for a fixed
+/// amount of warm-up and measured frames and reports the frame statistics as JSON.
+/// </summary>
+class Benchmark
+{
+    public:
+        /// <summary>
+        /// Constructor
+        /// </summary>
+        /// <param name="application">The application to benchmark, with resources already initilized</param>
+        /// <param name="path">The camera path to replay</param>
+        Benchmark(std::shared_ptr<Application> application, std::shared_ptr<CameraPath> path);
+
+        /// <summary>
+        /// Sets the amount of frames to run
+        /// </summary>
+        /// <param name="warmup">Frames rendered before measuring starts</param>
+        /// <param name="measured">Frames measured, the camera path is spread over these</param>
+        void setFrames(unsigned int warmup, unsigned int measured);
+
+        /// <summary>
+        /// Runs the benchmark and writes the report
+        /// </summary>
+        /// <param name="window">The GLFW window</param>
+        /// <param name="sceneName">The name of the scene, written to the report</param>
+        /// <param name="outFilename">The file to write the JSON report to</param>
+        /// <returns>Flag for if the benchmark completed or not</returns>
+        bool run(GLFWwindow* window, const std::string& sceneName, const std::string& outFilename);
+
+    private:
+        std::shared_ptr<Application> m_application;
+        std::shared_ptr<CameraPath> m_path;
+        unsigned int m_warmupFrames;
+        unsigned int m_measuredFrames;
+
+        std::vector<double> m_cpuFrameMs;
+        std::vector<double> m_gpuFrameMs;
+        std::vector<double> m_drawCalls;
+        std::vector<double> m_triangles;
+        std::vector<double> m_stateChanges;
+        std::vector<double> m_textureBinds;
+        std::map<std::string, std::vector<double>> m_gpuPassMs;
+
+        /// <summary>
+        /// Writes the summary statistics of a series as a JSON object
+        /// </summary>
+        void writeStatistics(std::ostream& out, const std::string& name, std::vector<double> values, bool last = false);
+
+        /// <summary>
+        /// Writes the full report
+        /// </summary>
+        void writeReport(std::ostream& out, const std::string& sceneName);
+
+        /// <summary>
+        /// Returns a string with quotes, backslashes and control characters escaped for a JSON string
+        /// </summary>
+        static std::string escape(const std::string& value);
+};
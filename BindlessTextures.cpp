@@ -0,0 +1,98 @@
+#include "BindlessTextures.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <iostream>
+
+bool BindlessTextures::s_enabled = false;
+GLuint BindlessTextures::s_buffer = 0;
+size_t BindlessTextures::s_capacity = 0;
+std::vector<BindlessTextures::Entry> BindlessTextures::s_entries;
+std::vector<int> BindlessTextures::s_free;
+
+bool BindlessTextures::isSupported()
+{
+    return GLEW_ARB_bindless_texture;
+}
+
+bool BindlessTextures::setEnabled(bool flag)
+{
+    if(flag && !isSupported())
+    {
+        std::cerr << "GL_ARB_bindless_texture is not supported, textures are bound per draw" << std::endl;
+        flag = false;
+    }
+
+    s_enabled = flag;
+    return s_enabled;
+}
+
+bool BindlessTextures::isEnabled()
+{
+    return s_enabled;
+}
+
+int BindlessTextures::add(GLuint64 handle, int layer)
+{
+    Entry entry;
+    entry.handle[0] = GLuint(handle & 0xffffffffu);
+    entry.handle[1] = GLuint(handle >> 32);
+    entry.layer = layer;
+    entry.padding = 0;
+
+    int index;
+    if(!s_free.empty())
+    {
+        index = s_free.back();
+        s_free.pop_back();
+        s_entries[index] = entry;
+    }
+    else
+    {
+        index = (int)s_entries.size();
+        s_entries.push_back(entry);
+    }
+
+    write(index);
+    return index;
+}
+
+void BindlessTextures::remove(int index)
+{
+    //The entry is left in the buffer, no draw refers to it anymore
+    s_free.push_back(index);
+}
+
+size_t BindlessTextures::getNumTextures()
+{
+    return s_entries.size() - s_free.size();
+}
+
+void BindlessTextures::write(int index)
+{
+    PROFILE_FUNCTION();
+
+    //Entries are added while drawing, the draw adding one reads it right away, so it is written at once
+    if(s_entries.size() > s_capacity)
+    {
+        s_capacity = std::max<size_t>(64, s_capacity * 2);
+
+        if(s_buffer == 0)
+        {
+            glGenBuffers(1, &s_buffer);
+        }
+
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, s_buffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, s_capacity * sizeof(Entry), nullptr, GL_DYNAMIC_DRAW);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, s_entries.size() * sizeof(Entry), s_entries.data());
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+        //Nothing else uses the binding, it stays bound for every draw after
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BINDING, s_buffer);
+        return;
+    }
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, s_buffer);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, index * sizeof(Entry), sizeof(Entry), &s_entries[index]);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
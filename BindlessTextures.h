@@ -0,0 +1,75 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstddef>
+#include <vector>
+
+/// <summary>
+/// The table of bindless texture handles read by the material shaders, kept in a shader storage buffer at BINDING. Each
+/// entry is a resident handle and the layer sampled from it, -1 unless the handle is a texture array, see
+/// TextureArrayPacker. A texture gets its entry the first time it is drawn, so the draws after only send its index and
+/// bind nothing. Textures still changing their storage or base level, like those streaming in, can not have a handle yet
+/// and are bound as before. Needs GL_ARB_bindless_texture, without it the mode stays off and every texture is bound.
+/// </summary>
+class BindlessTextures
+{
+    public:
+        static const GLuint BINDING = 9;
+
+        /// <summary>
+        /// Returns if the driver supports bindless textures
+        /// </summary>
+        static bool isSupported();
+
+        /// <summary>
+        /// Sets if textures are drawn bindless, stays off when not supported
+        /// </summary>
+        /// <returns>Flag for if the mode is on</returns>
+        static bool setEnabled(bool flag);
+
+        /// <summary>
+        /// Returns if textures are drawn bindless
+        /// </summary>
+        static bool isEnabled();
+
+        /// <summary>
+        /// Adds an entry to the table, the handle has to be resident
+        /// </summary>
+        /// <param name="handle">The handle of a texture or texture array</param>
+        /// <param name="layer">The layer sampled from an array, -1 for a texture</param>
+        /// <returns>The index of the entry</returns>
+        static int add(GLuint64 handle, int layer);
+
+        /// <summary>
+        /// Frees an entry, its index is given to the next texture added
+        /// </summary>
+        static void remove(int index);
+
+        /// <summary>
+        /// Returns the amount of entries in use
+        /// </summary>
+        static size_t getNumTextures();
+
+    private:
+        /// <summary>
+        /// An entry as the shaders read it, the handle split in two 32 bit halves
+        /// </summary>
+        struct Entry
+        {
+            GLuint handle[2];
+            GLint layer;
+            GLint padding;
+        };
+
+        static bool s_enabled;
+        static GLuint s_buffer;
+        static size_t s_capacity;
+        static std::vector<Entry> s_entries;
+        static std::vector<int> s_free;
+
+        /// <summary>
+        /// Writes an entry to the buffer, growing it when full
+        /// </summary>
+        static void write(int index);
+};
@@ -0,0 +1,248 @@
+#include "BlockCompressor.h"
+#include "Profiler.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cfloat>
+#include <cstdint>
+#include <cstdlib>
+
+namespace
+{
+    uint16_t to565(const glm::vec3& color)
+    {
+        glm::vec3 c = glm::clamp(color, glm::vec3(0.0f), glm::vec3(255.0f));
+        uint16_t r = uint16_t(c.x * 31.0f / 255.0f + 0.5f);
+        uint16_t g = uint16_t(c.y * 63.0f / 255.0f + 0.5f);
+        uint16_t b = uint16_t(c.z * 31.0f / 255.0f + 0.5f);
+        return uint16_t((r << 11) | (g << 5) | b);
+    }
+
+    glm::vec3 from565(uint16_t color)
+    {
+        //Expanded the way the hardware does, the high bits repeat in the low ones
+        int r = (color >> 11) & 31;
+        int g = (color >> 5) & 63;
+        int b = color & 31;
+        return glm::vec3(float((r << 3) | (r >> 2)), float((g << 2) | (g >> 4)), float((b << 3) | (b >> 2)));
+    }
+
+    void write16(unsigned char* destination, uint16_t value)
+    {
+        destination[0] = (unsigned char)(value & 0xff);
+        destination[1] = (unsigned char)(value >> 8);
+    }
+}
+
+bool BlockCompressor::encode(const MipChain& source, MipChain& result)
+{
+    PROFILE_FUNCTION();
+
+    if(source.levels.empty() || source.isCompressed())
+    {
+        return false;
+    }
+
+    bool opaque = isOpaque(source);
+    result.format = opaque ? GL_COMPRESSED_RGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    result.levels.clear();
+
+    size_t blockBytes = MipChain::getBlockBytes(result.format);
+    unsigned char texels[16][4];
+
+    for(auto& level : source.levels)
+    {
+        MipChain::Level encoded;
+        encoded.width = level.width;
+        encoded.height = level.height;
+
+        int blocksWide = (level.width + 3) / 4;
+        int blocksHigh = (level.height + 3) / 4;
+        encoded.data.resize(size_t(blocksWide) * blocksHigh * blockBytes);
+
+        for(int by = 0; by < blocksHigh; by++)
+        {
+            for(int bx = 0; bx < blocksWide; bx++)
+            {
+                //Blocks over the edge of small levels repeat the last row and column, the texels outside are never sampled
+                for(int i = 0; i < 16; i++)
+                {
+                    int x = std::min(bx * 4 + (i & 3), level.width - 1);
+                    int y = std::min(by * 4 + (i >> 2), level.height - 1);
+                    const unsigned char* texel = level.data.data() + (size_t(y) * level.width + x) * 4;
+                    std::copy(texel, texel + 4, texels[i]);
+                }
+
+                unsigned char* block = encoded.data.data() + (size_t(by) * blocksWide + bx) * blockBytes;
+                if(opaque)
+                {
+                    encodeColors(texels, block);
+                }
+                else
+                {
+                    encodeAlpha(texels, block);
+                    encodeColors(texels, block + 8);
+                }
+            }
+        }
+
+        result.levels.push_back(std::move(encoded));
+    }
+
+    return true;
+}
+
+bool BlockCompressor::isOpaque(const MipChain& chain)
+{
+    const MipChain::Level& level = chain.levels.front();
+    for(size_t i = 3; i < level.data.size(); i += 4)
+    {
+        if(level.data[i] != 255)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void BlockCompressor::encodeColors(const unsigned char texels[16][4], unsigned char* block)
+{
+    glm::vec3 colors[16];
+    glm::vec3 mean(0.0f);
+    for(int i = 0; i < 16; i++)
+    {
+        colors[i] = glm::vec3(texels[i][0], texels[i][1], texels[i][2]);
+        mean += colors[i];
+    }
+    mean /= 16.0f;
+
+    //The principal axis by power iteration on the covariance, a few steps are enough for 16 texels
+    float covariance[6] = { 0, 0, 0, 0, 0, 0 };
+    for(int i = 0; i < 16; i++)
+    {
+        glm::vec3 d = colors[i] - mean;
+        covariance[0] += d.x * d.x;
+        covariance[1] += d.x * d.y;
+        covariance[2] += d.x * d.z;
+        covariance[3] += d.y * d.y;
+        covariance[4] += d.y * d.z;
+        covariance[5] += d.z * d.z;
+    }
+
+    glm::vec3 axis(1.0f, 1.0f, 1.0f);
+    for(int i = 0; i < 8; i++)
+    {
+        glm::vec3 next(covariance[0] * axis.x + covariance[1] * axis.y + covariance[2] * axis.z,
+                       covariance[1] * axis.x + covariance[3] * axis.y + covariance[4] * axis.z,
+                       covariance[2] * axis.x + covariance[4] * axis.y + covariance[5] * axis.z);
+        float length = glm::length(next);
+        if(length < FLT_EPSILON)
+        {
+            break;
+        }
+        axis = next / length;
+    }
+
+    float minProjection = FLT_MAX;
+    float maxProjection = -FLT_MAX;
+    for(int i = 0; i < 16; i++)
+    {
+        float projection = glm::dot(colors[i] - mean, axis);
+        minProjection = std::min(minProjection, projection);
+        maxProjection = std::max(maxProjection, projection);
+    }
+
+    //Pulled in by a sixteenth of the range, the extremes are rarely worth a palette color of their own
+    float inset = (maxProjection - minProjection) / 16.0f;
+    uint16_t color0 = to565(mean + axis * (maxProjection - inset));
+    uint16_t color1 = to565(mean + axis * (minProjection + inset));
+
+    //The four color mode needs the first endpoint to be the larger one
+    if(color0 < color1)
+    {
+        std::swap(color0, color1);
+    }
+
+    write16(block, color0);
+    write16(block + 2, color1);
+
+    uint32_t indices = 0;
+    if(color0 != color1)
+    {
+        glm::vec3 palette[4];
+        palette[0] = from565(color0);
+        palette[1] = from565(color1);
+        palette[2] = (palette[0] * 2.0f + palette[1]) / 3.0f;
+        palette[3] = (palette[0] + palette[1] * 2.0f) / 3.0f;
+
+        for(int i = 0; i < 16; i++)
+        {
+            uint32_t best = 0;
+            float bestDistance = FLT_MAX;
+            for(uint32_t p = 0; p < 4; p++)
+            {
+                glm::vec3 d = colors[i] - palette[p];
+                float distance = glm::dot(d, d);
+                if(distance < bestDistance)
+                {
+                    bestDistance = distance;
+                    best = p;
+                }
+            }
+            indices |= best << (i * 2);
+        }
+    }
+
+    block[4] = (unsigned char)(indices & 0xff);
+    block[5] = (unsigned char)((indices >> 8) & 0xff);
+    block[6] = (unsigned char)((indices >> 16) & 0xff);
+    block[7] = (unsigned char)(indices >> 24);
+}
+
+void BlockCompressor::encodeAlpha(const unsigned char texels[16][4], unsigned char* block)
+{
+    int alpha0 = 0;
+    int alpha1 = 255;
+    for(int i = 0; i < 16; i++)
+    {
+        alpha0 = std::max(alpha0, int(texels[i][3]));
+        alpha1 = std::min(alpha1, int(texels[i][3]));
+    }
+
+    block[0] = (unsigned char)alpha0;
+    block[1] = (unsigned char)alpha1;
+
+    //With alpha0 above alpha1 the palette is the two endpoints and six steps between them
+    int palette[8] = { alpha0, alpha1, 0, 0, 0, 0, 0, 0 };
+    for(int i = 1; i < 7; i++)
+    {
+        palette[i + 1] = ((7 - i) * alpha0 + i * alpha1 + 3) / 7;
+    }
+
+    uint64_t indices = 0;
+    if(alpha0 != alpha1)
+    {
+        for(int i = 0; i < 16; i++)
+        {
+            uint64_t best = 0;
+            int bestDistance = 256;
+            for(int p = 0; p < 8; p++)
+            {
+                int distance = std::abs(int(texels[i][3]) - palette[p]);
+                if(distance < bestDistance)
+                {
+                    bestDistance = distance;
+                    best = uint64_t(p);
+                }
+            }
+            indices |= best << (i * 3);
+        }
+    }
+
+    for(int i = 0; i < 6; i++)
+    {
+        block[2 + i] = (unsigned char)((indices >> (i * 8)) & 0xff);
+    }
+}
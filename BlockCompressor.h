@@ -0,0 +1,37 @@
+#pragma once
+
+#include "MipChain.h"
+
+/// <summary>
+/// Encodes GL_RGBA8 mip chains to BC1 (DXT1) when every texel is opaque and to BC3 (DXT5) otherwise, 8 and 4 times smaller
+/// than the pixels. The colors of a block are fit along their principal axis: the endpoints are the extremes of the
+/// projection onto it, pulled in slightly so the rounding to 5:6:5 spreads evenly, and every texel takes the nearest of the
+/// four palette colors. Alpha takes the eight level mode between the smallest and largest alpha of the block.
+/// </summary>
+class BlockCompressor
+{
+    public:
+        /// <summary>
+        /// Encodes every level of a chain
+        /// </summary>
+        /// <param name="source">The chain, GL_RGBA8</param>
+        /// <param name="result">The encoded chain</param>
+        /// <returns>Flag for if the source could be encoded</returns>
+        static bool encode(const MipChain& source, MipChain& result);
+
+        /// <summary>
+        /// Returns if every texel of a chain is opaque
+        /// </summary>
+        static bool isOpaque(const MipChain& chain);
+
+    private:
+        /// <summary>
+        /// Encodes the colors of a block of 16 texels into 8 bytes of BC1
+        /// </summary>
+        static void encodeColors(const unsigned char texels[16][4], unsigned char* block);
+
+        /// <summary>
+        /// Encodes the alpha of a block of 16 texels into 8 bytes of BC3
+        /// </summary>
+        static void encodeAlpha(const unsigned char texels[16][4], unsigned char* block);
+};
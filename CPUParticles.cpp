@@ -0,0 +1,362 @@
+#include "CPUParticles.h"
+#include "ThreadPool.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define PARTICLES_X86
+#include <immintrin.h>
+#endif
+
+//The AVX2 kernel is compiled for AVX2 on its own, the rest of the engine stays on the baseline instruction set
+#if defined(PARTICLES_X86) && (defined(__GNUC__) || defined(__clang__))
+#define PARTICLES_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#else
+#define PARTICLES_TARGET_AVX2
+#endif
+
+namespace
+{
+    /// <summary>
+    /// The arrays and constants of one integration step
+    /// </summary>
+    struct Step
+    {
+        float* px;
+        float* py;
+        float* pz;
+        float* vx;
+        float* vy;
+        float* vz;
+        float* life;
+        glm::vec3 follow;
+        float acceleration;
+        float deltaTime;
+    };
+
+    //Same hash as the compute shader, so both backends emit the same particles for the same seed
+    uint32_t hash(uint32_t x)
+    {
+        x ^= x >> 16;
+        x *= 0x7feb352dU;
+        x ^= x >> 15;
+        x *= 0x846ca68bU;
+        x ^= x >> 16;
+        return x;
+    }
+
+    float random(uint32_t& state)
+    {
+        state = hash(state);
+        return float(state) / 4294967295.0f;
+    }
+
+    void integrateScalar(const Step& s, size_t begin, size_t end)
+    {
+        for(size_t i = begin; i < end; i++)
+        {
+            float dx = s.follow.x - s.px[i];
+            float dy = s.follow.y - s.py[i];
+            float dz = s.follow.z - s.pz[i];
+            float k = s.acceleration / std::sqrt(dx * dx + dy * dy + dz * dz);
+
+            s.vx[i] += dx * k;
+            s.vy[i] += dy * k;
+            s.vz[i] += dz * k;
+            s.px[i] += s.vx[i] * s.deltaTime;
+            s.py[i] += s.vy[i] * s.deltaTime;
+            s.pz[i] += s.vz[i] * s.deltaTime;
+            s.life[i] -= s.deltaTime;
+        }
+    }
+
+#ifdef PARTICLES_X86
+    void integrateSSE(const Step& s, size_t begin, size_t end)
+    {
+        const __m128 fx = _mm_set1_ps(s.follow.x);
+        const __m128 fy = _mm_set1_ps(s.follow.y);
+        const __m128 fz = _mm_set1_ps(s.follow.z);
+        const __m128 acceleration = _mm_set1_ps(s.acceleration);
+        const __m128 dt = _mm_set1_ps(s.deltaTime);
+
+        size_t i = begin;
+        for(; i + 4 <= end; i += 4)
+        {
+            __m128 px = _mm_loadu_ps(s.px + i);
+            __m128 py = _mm_loadu_ps(s.py + i);
+            __m128 pz = _mm_loadu_ps(s.pz + i);
+
+            __m128 dx = _mm_sub_ps(fx, px);
+            __m128 dy = _mm_sub_ps(fy, py);
+            __m128 dz = _mm_sub_ps(fz, pz);
+            __m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz)));
+            __m128 k = _mm_div_ps(acceleration, length);
+
+            __m128 vx = _mm_add_ps(_mm_loadu_ps(s.vx + i), _mm_mul_ps(dx, k));
+            __m128 vy = _mm_add_ps(_mm_loadu_ps(s.vy + i), _mm_mul_ps(dy, k));
+            __m128 vz = _mm_add_ps(_mm_loadu_ps(s.vz + i), _mm_mul_ps(dz, k));
+
+            _mm_storeu_ps(s.vx + i, vx);
+            _mm_storeu_ps(s.vy + i, vy);
+            _mm_storeu_ps(s.vz + i, vz);
+            _mm_storeu_ps(s.px + i, _mm_add_ps(px, _mm_mul_ps(vx, dt)));
+            _mm_storeu_ps(s.py + i, _mm_add_ps(py, _mm_mul_ps(vy, dt)));
+            _mm_storeu_ps(s.pz + i, _mm_add_ps(pz, _mm_mul_ps(vz, dt)));
+            _mm_storeu_ps(s.life + i, _mm_sub_ps(_mm_loadu_ps(s.life + i), dt));
+        }
+
+        integrateScalar(s, i, end);
+    }
+
+    PARTICLES_TARGET_AVX2 void integrateAVX2(const Step& s, size_t begin, size_t end)
+    {
+        const __m256 fx = _mm256_set1_ps(s.follow.x);
+        const __m256 fy = _mm256_set1_ps(s.follow.y);
+        const __m256 fz = _mm256_set1_ps(s.follow.z);
+        const __m256 acceleration = _mm256_set1_ps(s.acceleration);
+        const __m256 dt = _mm256_set1_ps(s.deltaTime);
+
+        size_t i = begin;
+        for(; i + 8 <= end; i += 8)
+        {
+            __m256 px = _mm256_loadu_ps(s.px + i);
+            __m256 py = _mm256_loadu_ps(s.py + i);
+            __m256 pz = _mm256_loadu_ps(s.pz + i);
+
+            __m256 dx = _mm256_sub_ps(fx, px);
+            __m256 dy = _mm256_sub_ps(fy, py);
+            __m256 dz = _mm256_sub_ps(fz, pz);
+            __m256 length = _mm256_sqrt_ps(_mm256_fmadd_ps(dz, dz, _mm256_fmadd_ps(dy, dy, _mm256_mul_ps(dx, dx))));
+            __m256 k = _mm256_div_ps(acceleration, length);
+
+            __m256 vx = _mm256_fmadd_ps(dx, k, _mm256_loadu_ps(s.vx + i));
+            __m256 vy = _mm256_fmadd_ps(dy, k, _mm256_loadu_ps(s.vy + i));
+            __m256 vz = _mm256_fmadd_ps(dz, k, _mm256_loadu_ps(s.vz + i));
+
+            _mm256_storeu_ps(s.vx + i, vx);
+            _mm256_storeu_ps(s.vy + i, vy);
+            _mm256_storeu_ps(s.vz + i, vz);
+            _mm256_storeu_ps(s.px + i, _mm256_fmadd_ps(vx, dt, px));
+            _mm256_storeu_ps(s.py + i, _mm256_fmadd_ps(vy, dt, py));
+            _mm256_storeu_ps(s.pz + i, _mm256_fmadd_ps(vz, dt, pz));
+            _mm256_storeu_ps(s.life + i, _mm256_sub_ps(_mm256_loadu_ps(s.life + i), dt));
+        }
+
+        integrateScalar(s, i, end);
+    }
+#endif
+}
+
+CPUParticles::CPUParticles(unsigned int capacity) :
+    m_positionX(capacity),
+    m_positionY(capacity),
+    m_positionZ(capacity),
+    m_velocityX(capacity),
+    m_velocityY(capacity),
+    m_velocityZ(capacity),
+    m_life(capacity),
+    m_id(capacity),
+    m_dead((capacity + GRAIN - 1) / GRAIN),
+    m_capacity(capacity),
+    m_aliveCount(0),
+    m_seed(0),
+    m_nextId(0),
+    m_kernel(bestKernel()),
+    m_maxThreads(0)
+{
+}
+
+void CPUParticles::setThreadPool(std::shared_ptr<ThreadPool> pool, unsigned int maxThreads)
+{
+    m_pool = pool;
+    m_maxThreads = maxThreads;
+}
+
+void CPUParticles::setKernel(Kernel kernel)
+{
+    m_kernel = std::min(kernel, bestKernel());
+}
+
+CPUParticles::Kernel CPUParticles::getKernel()
+{
+    return m_kernel;
+}
+
+template<typename F>
+void CPUParticles::forEachChunk(size_t count, F function)
+{
+    if(m_pool)
+    {
+        m_pool->parallelFor(count, GRAIN, function, m_maxThreads);
+        return;
+    }
+
+    for(size_t begin = 0; begin < count; begin += GRAIN)
+    {
+        function(begin, std::min(begin + GRAIN, count));
+    }
+}
+
+void CPUParticles::simulate(float deltaTime, glm::vec3 followPosition, unsigned int emitCount, const Emitter& emitter, float* output, uint32_t* ids)
+{
+    PROFILE_SCOPE("CPUParticles::simulate");
+
+    //New particles are appended behind the live ones
+    unsigned int first = m_aliveCount;
+    unsigned int emit = std::min(emitCount, m_capacity - m_aliveCount);
+    uint32_t seed = hash(m_seed++);
+    uint32_t firstId = m_nextId;
+    m_nextId += emit;
+
+    forEachChunk(emit, [&](size_t begin, size_t end)
+    {
+        for(size_t i = begin; i < end; i++)
+        {
+            uint32_t state = hash(uint32_t(i) ^ seed);
+            float x = random(state) * 2.0f - 1.0f;
+            float y = random(state) * 2.0f - 1.0f;
+            float z = random(state) * 2.0f - 1.0f;
+
+            size_t index = first + i;
+            m_positionX[index] = emitter.position.x + x * emitter.size.x;
+            m_positionY[index] = emitter.position.y + y * emitter.size.y;
+            m_positionZ[index] = emitter.position.z + z * emitter.size.z;
+            m_velocityX[index] = m_velocityY[index] = m_velocityZ[index] = 0.0f;
+            m_life[index] = emitter.lifetime.x + (emitter.lifetime.y - emitter.lifetime.x) * random(state);
+            m_id[index] = firstId + uint32_t(i);
+        }
+    });
+
+    m_aliveCount += emit;
+
+    Step step = { m_positionX.data(), m_positionY.data(), m_positionZ.data(), m_velocityX.data(), m_velocityY.data(), m_velocityZ.data(), m_life.data(),
+                  followPosition, 1000.0f * std::min(0.05f, deltaTime), deltaTime };
+    Kernel kernel = m_kernel;
+
+    //Integrate every chunk, remember the particles that died and write the survivors for drawing
+    forEachChunk(m_aliveCount, [&](size_t begin, size_t end)
+    {
+        switch(kernel)
+        {
+#ifdef PARTICLES_X86
+            case KERNEL_AVX2:
+                integrateAVX2(step, begin, end);
+                break;
+            case KERNEL_SSE:
+                integrateSSE(step, begin, end);
+                break;
+#endif
+            default:
+                integrateScalar(step, begin, end);
+                break;
+        }
+
+        std::vector<uint32_t>& dead = m_dead[begin / GRAIN];
+        dead.clear();
+
+        for(size_t i = begin; i < end; i++)
+        {
+            if(step.life[i] <= 0.0f)
+            {
+                dead.push_back(uint32_t(i));
+            }
+
+            if(output)
+            {
+                output[i * 4 + 0] = step.px[i];
+                output[i * 4 + 1] = step.py[i];
+                output[i * 4 + 2] = step.pz[i];
+                output[i * 4 + 3] = step.life[i];
+            }
+
+            if(ids)
+            {
+                ids[i] = m_id[i];
+            }
+        }
+    });
+
+    removeDead(output, ids);
+}
+
+void CPUParticles::removeDead(float* output, uint32_t* ids)
+{
+    size_t chunks = (m_aliveCount + GRAIN - 1) / GRAIN;
+
+    //Highest index first, so the particle swapped in from the back is always alive
+    for(size_t chunk = chunks; chunk-- > 0;)
+    {
+        std::vector<uint32_t>& dead = m_dead[chunk];
+
+        for(auto index = dead.rbegin(); index != dead.rend(); ++index)
+        {
+            uint32_t last = --m_aliveCount;
+
+            if(*index != last)
+            {
+                m_positionX[*index] = m_positionX[last];
+                m_positionY[*index] = m_positionY[last];
+                m_positionZ[*index] = m_positionZ[last];
+                m_velocityX[*index] = m_velocityX[last];
+                m_velocityY[*index] = m_velocityY[last];
+                m_velocityZ[*index] = m_velocityZ[last];
+                m_life[*index] = m_life[last];
+                m_id[*index] = m_id[last];
+
+                if(output)
+                {
+                    std::copy(output + last * 4, output + last * 4 + 4, output + *index * 4);
+                }
+
+                if(ids)
+                {
+                    ids[*index] = ids[last];
+                }
+            }
+        }
+
+        dead.clear();
+    }
+}
+
+unsigned int CPUParticles::getAliveCount()
+{
+    return m_aliveCount;
+}
+
+unsigned int CPUParticles::getCapacity()
+{
+    return m_capacity;
+}
+
+CPUParticles::Kernel CPUParticles::bestKernel()
+{
+#if defined(PARTICLES_X86) && (defined(__GNUC__) || defined(__clang__))
+    if(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+    {
+        return KERNEL_AVX2;
+    }
+    return KERNEL_SSE;
+#elif defined(PARTICLES_X86) && defined(__AVX2__)
+    return KERNEL_AVX2;
+#elif defined(PARTICLES_X86)
+    return KERNEL_SSE;
+#else
+    return KERNEL_SCALAR;
+#endif
+}
+
+const char* CPUParticles::kernelName(Kernel kernel)
+{
+    switch(kernel)
+    {
+        case KERNEL_AVX2:
+            return "avx2";
+        case KERNEL_SSE:
+            return "sse";
+        default:
+            return "scalar";
+    }
+}
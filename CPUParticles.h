@@ -0,0 +1,127 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+class ThreadPool;
+
+/// <summary>
+/// CPU version of the particle simulation in shaders/gpu-particles/gpu.comp.glsl, for machines without
+/// compute shaders and for running headless. Particles are stored as separate arrays per component, the
+/// live ones packed at the front, and integrated 8 (AVX2) or 4 (SSE) at a time across the threads of a pool.
+/// Dead particles are swapped with the last live one, so the cost follows the live count. Every particle keeps
+/// the id it was emitted with while it moves between slots.
+/// </summary>
+class CPUParticles
+{
+    public:
+        /// <summary>
+        /// The integration kernel
+        /// </summary>
+        enum Kernel
+        {
+            KERNEL_SCALAR,
+            KERNEL_SSE,
+            KERNEL_AVX2
+        };
+
+        /// <summary>
+        /// Where new particles appear and how long they live
+        /// </summary>
+        struct Emitter
+        {
+            glm::vec3 position;
+            glm::vec3 size;
+            glm::vec2 lifetime;
+        };
+
+        /// <summary>
+        /// Constructor
+        /// </summary>
+        /// <param name="capacity">The maximum amount of live particles</param>
+        CPUParticles(unsigned int capacity);
+
+        /// <summary>
+        /// Sets the pool the integration is spread over, without a pool it runs on the calling thread
+        /// </summary>
+        /// <param name="pool">The pool</param>
+        /// <param name="maxThreads">Limits the threads used including the caller, 0 uses all</param>
+        void setThreadPool(std::shared_ptr<ThreadPool> pool, unsigned int maxThreads = 0);
+
+        /// <summary>
+        /// Sets the kernel, kernels the processor does not support fall back to the best supported one
+        /// </summary>
+        /// <param name="kernel">The kernel</param>
+        void setKernel(Kernel kernel);
+
+        /// <summary>
+        /// Returns the kernel in use
+        /// </summary>
+        Kernel getKernel();
+
+        /// <summary>
+        /// Emits, integrates and kills particles for one step
+        /// </summary>
+        /// <param name="deltaTime">The step in seconds</param>
+        /// <param name="followPosition">The position the particles are pulled towards</param>
+        /// <param name="emitCount">The amount of particles to emit, limited by the free capacity</param>
+        /// <param name="emitter">The emitter</param>
+        /// <param name="output">Receives x, y, z and the remaining life of every live particle, may be nullptr</param>
+        /// <param name="ids">Receives the id of every live particle in the order of output, may be nullptr</param>
+        void simulate(float deltaTime, glm::vec3 followPosition, unsigned int emitCount, const Emitter& emitter, float* output, uint32_t* ids = nullptr);
+
+        /// <summary>
+        /// Returns the amount of live particles
+        /// </summary>
+        unsigned int getAliveCount();
+
+        /// <summary>
+        /// Returns the maximum amount of live particles
+        /// </summary>
+        unsigned int getCapacity();
+
+        /// <summary>
+        /// Returns the fastest kernel the processor supports
+        /// </summary>
+        static Kernel bestKernel();
+
+        /// <summary>
+        /// Returns the name of a kernel
+        /// </summary>
+        static const char* kernelName(Kernel kernel);
+
+    private:
+        static const size_t GRAIN = 16384;
+
+        std::vector<float> m_positionX;
+        std::vector<float> m_positionY;
+        std::vector<float> m_positionZ;
+        std::vector<float> m_velocityX;
+        std::vector<float> m_velocityY;
+        std::vector<float> m_velocityZ;
+        std::vector<float> m_life;
+        std::vector<uint32_t> m_id;
+        std::vector<std::vector<uint32_t>> m_dead;
+
+        unsigned int m_capacity;
+        unsigned int m_aliveCount;
+        uint32_t m_seed;
+        uint32_t m_nextId;
+        Kernel m_kernel;
+        std::shared_ptr<ThreadPool> m_pool;
+        unsigned int m_maxThreads;
+
+        /// <summary>
+        /// Runs a function over [0, count) on the pool, or on the calling thread without one
+        /// </summary>
+        template<typename F>
+        void forEachChunk(size_t count, F function);
+
+        /// <summary>
+        /// Swaps the dead particles with the live ones at the back
+        /// </summary>
+        void removeDead(float* output, uint32_t* ids);
+};
@@ -0,0 +1,172 @@
+#include "CameraPath.h"
+#include "Camera.h"
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <algorithm>
+
+CameraPath::CameraPath()
+{
+}
+
+std::shared_ptr<CameraPath> CameraPath::createOrbit(BoundingBox box, unsigned int keyframes, float duration)
+{
+    std::shared_ptr<CameraPath> path = std::shared_ptr<CameraPath>(new CameraPath());
+
+    glm::vec3 center = box.getCenter();
+    float radius = box.getRadius();
+
+    //Same framing as Application::initView, but sweeping around the scene and bobbing in height
+    for(unsigned int i = 0; i <= keyframes; i++)
+    {
+        float t = float(i) / float(keyframes);
+        float angle = t * 2.0f * 3.14159265359f;
+        float distance = radius * (0.6f + 0.4f * glm::cos(angle * 2.0f));
+        float height = radius * (0.15f + 0.25f * (0.5f + 0.5f * glm::sin(angle * 3.0f)));
+
+        glm::vec3 eye = center + glm::vec3(glm::sin(angle) * distance, height, glm::cos(angle) * distance);
+        glm::vec3 direction = glm::normalize(center - eye);
+
+        path->addKeyframe(t * duration, eye, direction);
+    }
+
+    return path;
+}
+
+bool CameraPath::load(const std::string& filename)
+{
+    std::ifstream file(filename);
+
+    if(!file.is_open())
+    {
+        std::cerr << "Could not open camera path: " << filename << std::endl;
+        return false;
+    }
+
+    clear();
+
+    std::string line;
+    while(std::getline(file, line))
+    {
+        if(line.empty() || line[0] == '#')
+        {
+            continue;
+        }
+
+        std::istringstream str(line);
+        Keyframe keyframe;
+
+        str >> keyframe.time
+            >> keyframe.position.x >> keyframe.position.y >> keyframe.position.z
+            >> keyframe.direction.x >> keyframe.direction.y >> keyframe.direction.z;
+
+        if(str.fail())
+        {
+            std::cerr << "Invalid keyframe in camera path " << filename << ": " << line << std::endl;
+            return false;
+        }
+
+        addKeyframe(keyframe.time, keyframe.position, keyframe.direction);
+    }
+
+    return !m_keyframes.empty();
+}
+
+bool CameraPath::save(const std::string& filename)
+{
+    std::ofstream file(filename);
+
+    if(!file.is_open())
+    {
+        std::cerr << "Could not write camera path: " << filename << std::endl;
+        return false;
+    }
+
+    file << "# time px py pz dx dy dz" << std::endl;
+
+    for(auto& keyframe : m_keyframes)
+    {
+        file << keyframe.time << " "
+             << keyframe.position.x << " " << keyframe.position.y << " " << keyframe.position.z << " "
+             << keyframe.direction.x << " " << keyframe.direction.y << " " << keyframe.direction.z << std::endl;
+    }
+
+    return true;
+}
+
+void CameraPath::addKeyframe(float time, glm::vec3 position, glm::vec3 direction)
+{
+    Keyframe keyframe;
+    keyframe.time = time;
+    keyframe.position = position;
+    keyframe.direction = glm::normalize(direction);
+    m_keyframes.push_back(keyframe);
+}
+
+void CameraPath::clear()
+{
+    m_keyframes.clear();
+}
+
+void CameraPath::apply(float time, std::shared_ptr<Camera> camera)
+{
+    if(m_keyframes.empty())
+    {
+        return;
+    }
+
+    if(m_keyframes.size() == 1)
+    {
+        camera->set(m_keyframes[0].position, m_keyframes[0].direction, glm::vec3(0.0f, 1.0f, 0.0f));
+        return;
+    }
+
+    time = glm::clamp(m_keyframes.front().time + time, m_keyframes.front().time, m_keyframes.back().time);
+
+    //Find the segment [i, i+1] containing the time
+    size_t i = 0;
+    while(i + 2 < m_keyframes.size() && m_keyframes[i + 1].time < time)
+    {
+        i++;
+    }
+
+    const Keyframe& k0 = m_keyframes[i > 0 ? i - 1 : i];
+    const Keyframe& k1 = m_keyframes[i];
+    const Keyframe& k2 = m_keyframes[i + 1];
+    const Keyframe& k3 = m_keyframes[std::min(i + 2, m_keyframes.size() - 1)];
+
+    float segment = k2.time - k1.time;
+    float t = segment > 0.0f ? (time - k1.time) / segment : 0.0f;
+
+    glm::vec3 position = catmullRom(k0.position, k1.position, k2.position, k3.position, t);
+    glm::vec3 direction = glm::normalize(catmullRom(k0.direction, k1.direction, k2.direction, k3.direction, t));
+
+    camera->set(position, direction, glm::vec3(0.0f, 1.0f, 0.0f));
+}
+
+float CameraPath::getDuration()
+{
+    if(m_keyframes.empty())
+    {
+        return 0.0f;
+    }
+
+    return m_keyframes.back().time - m_keyframes.front().time;
+}
+
+size_t CameraPath::size()
+{
+    return m_keyframes.size();
+}
+
+glm::vec3 CameraPath::catmullRom(const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2, const glm::vec3& p3, float t)
+{
+    float t2 = t * t;
+    float t3 = t2 * t;
+
+    return 0.5f * ((2.0f * p1) +
+                   (-p0 + p2) * t +
+                   (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * t2 +
+                   (-p0 + 3.0f * p1 - 3.0f * p2 + p3) * t3);
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "BoundingBox.h"
+
+class Camera;
+
+/// <summary>
+/// A camera spline made out of keyframes. The path is either recorded while flying around,
+/// loaded from disk or scripted around the scene bounds, and is evaluated with Catmull-Rom
+/// interpolation so it can be replayed deterministically.
+/// </summary>
+class CameraPath
+{
+    public:
+        /// <summary>
+        /// A single keyframe on the path
+        /// </summary>
+        struct Keyframe
+        {
+            float time;
+            glm::vec3 position;
+            glm::vec3 direction;
+        };
+
+        /// <summary>
+        /// Constructor
+        /// </summary>
+        CameraPath();
+
+        /// <summary>
+        /// Creates a scripted orbit around the bounding box, looking at its center
+        /// </summary>
+        /// <param name="box">The bounding box to orbit</param>
+        /// <param name="keyframes">The amount of keyframes on the orbit</param>
+        /// <param name="duration">The duration of the orbit in seconds</param>
+        /// <returns>The path</returns>
+        static std::shared_ptr<CameraPath> createOrbit(BoundingBox box, unsigned int keyframes = 16, float duration = 20.0f);
+
+        /// <summary>
+        /// Loads a path from a text file. Every line is "time px py pz dx dy dz"
+        /// </summary>
+        /// <param name="filename">The file</param>
+        /// <returns>Flag for if the file could be loaded or not</returns>
+        bool load(const std::string& filename);
+
+        /// <summary>
+        /// Saves the path to a text file in the same format as load
+        /// </summary>
+        /// <param name="filename">The file</param>
+        /// <returns>Flag for if the file could be saved or not</returns>
+        bool save(const std::string& filename);
+
+        /// <summary>
+        /// Appends a keyframe, keyframes has to be added in time order
+        /// </summary>
+        /// <param name="time">The time of the keyframe</param>
+        /// <param name="position">The camera position</param>
+        /// <param name="direction">The camera direction</param>
+        void addKeyframe(float time, glm::vec3 position, glm::vec3 direction);
+
+        /// <summary>
+        /// Removes all keyframes
+        /// </summary>
+        void clear();
+
+        /// <summary>
+        /// Evaluates the path at a given time and places the camera there
+        /// </summary>
+        /// <param name="time">The time since the first keyframe, clamped to the duration of the path</param>
+        /// <param name="camera">The camera to place</param>
+        void apply(float time, std::shared_ptr<Camera> camera);
+
+        /// <summary>
+        /// Returns the duration of the path
+        /// </summary>
+        /// <returns>The duration in seconds</returns>
+        float getDuration();
+
+        /// <summary>
+        /// Returns the amount of keyframes
+        /// </summary>
+        /// <returns>The amount of keyframes</returns>
+        size_t size();
+
+    private:
+        std::vector<Keyframe> m_keyframes;
+
+        /// <summary>
+        /// Catmull-Rom interpolation between p1 and p2
+        /// </summary>
+        glm::vec3 catmullRom(const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2, const glm::vec3& p3, float t);
+};
@@ -0,0 +1,217 @@
+#include "DDSFile.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+
+namespace
+{
+    const uint32_t DDS_MAGIC = 0x20534444; //"DDS "
+    const uint32_t FOURCC_DXT1 = 0x31545844;
+    const uint32_t FOURCC_DXT5 = 0x35545844;
+    const uint32_t FOURCC_DX10 = 0x30315844;
+
+    const uint32_t DDSD_CAPS = 0x1;
+    const uint32_t DDSD_HEIGHT = 0x2;
+    const uint32_t DDSD_WIDTH = 0x4;
+    const uint32_t DDSD_PIXELFORMAT = 0x1000;
+    const uint32_t DDSD_MIPMAPCOUNT = 0x20000;
+    const uint32_t DDSD_LINEARSIZE = 0x80000;
+    const uint32_t DDPF_FOURCC = 0x4;
+    const uint32_t DDSCAPS_COMPLEX = 0x8;
+    const uint32_t DDSCAPS_TEXTURE = 0x1000;
+    const uint32_t DDSCAPS_MIPMAP = 0x400000;
+
+    const uint32_t DXGI_FORMAT_BC1_UNORM = 71;
+    const uint32_t DXGI_FORMAT_BC3_UNORM = 77;
+    const uint32_t DXGI_FORMAT_BC7_UNORM = 98;
+
+    //The header as stored after the magic, DDS is little endian like every platform this runs on
+    struct Header
+    {
+        uint32_t size;
+        uint32_t flags;
+        uint32_t height;
+        uint32_t width;
+        uint32_t pitchOrLinearSize;
+        uint32_t depth;
+        uint32_t mipMapCount;
+        uint32_t reserved1[11];
+        uint32_t pixelFormatSize;
+        uint32_t pixelFormatFlags;
+        uint32_t fourCC;
+        uint32_t rgbBitCount;
+        uint32_t bitMasks[4];
+        uint32_t caps[4];
+        uint32_t reserved2;
+    };
+
+    struct HeaderDX10
+    {
+        uint32_t dxgiFormat;
+        uint32_t resourceDimension;
+        uint32_t miscFlag;
+        uint32_t arraySize;
+        uint32_t miscFlags2;
+    };
+}
+
+bool DDSFile::load(const std::string& filename, MipChain& chain)
+{
+    std::ifstream file(filename, std::ios::binary);
+    if(!file.is_open())
+    {
+        return false;
+    }
+
+    uint32_t magic = 0;
+    Header header = {};
+    file.read((char*)&magic, sizeof(magic));
+    file.read((char*)&header, sizeof(header));
+
+    if(!file || magic != DDS_MAGIC || header.size != sizeof(Header) || !(header.pixelFormatFlags & DDPF_FOURCC) || header.width == 0 || header.height == 0)
+    {
+        std::cerr << "Not a DDS file with a compressed format: " << filename << std::endl;
+        return false;
+    }
+
+    uint32_t format = header.fourCC;
+    if(format == FOURCC_DX10)
+    {
+        HeaderDX10 dx10 = {};
+        file.read((char*)&dx10, sizeof(dx10));
+        format = dx10.dxgiFormat;
+    }
+
+    switch(format)
+    {
+        case FOURCC_DXT1:
+        case DXGI_FORMAT_BC1_UNORM:
+            chain.format = GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+            break;
+        case FOURCC_DXT5:
+        case DXGI_FORMAT_BC3_UNORM:
+            chain.format = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+            break;
+        case DXGI_FORMAT_BC7_UNORM:
+            chain.format = GL_COMPRESSED_RGBA_BPTC_UNORM;
+            break;
+        default:
+            std::cerr << "Unsupported DDS format " << format << ": " << filename << std::endl;
+            return false;
+    }
+
+    //A full chain halves the larger side down to a single texel
+    uint32_t maxLevels = 1;
+    for(uint32_t side = std::max(header.width, header.height); side > 1; side /= 2)
+    {
+        maxLevels++;
+    }
+
+    uint32_t levels = (header.flags & DDSD_MIPMAPCOUNT) ? header.mipMapCount : 1u;
+    if(levels == 0 || levels > maxLevels)
+    {
+        std::cerr << "Invalid mip count " << levels << " for " << header.width << "x" << header.height << " in DDS file: " << filename << std::endl;
+        return false;
+    }
+
+    //The header is not trusted with the size of the data, a short file is rejected before anything is allocated
+    size_t blockBytes = MipChain::getBlockBytes(chain.format);
+    size_t bytes = 0;
+    uint32_t width = header.width;
+    uint32_t height = header.height;
+    for(uint32_t i = 0; i < levels; i++)
+    {
+        bytes += ((size_t(width) + 3) / 4) * ((size_t(height) + 3) / 4) * blockBytes;
+        width = std::max(width / 2, 1u);
+        height = std::max(height / 2, 1u);
+    }
+
+    std::streamoff offset = file.tellg();
+    file.seekg(0, std::ios::end);
+    std::streamoff length = file.tellg();
+    file.seekg(offset);
+    if(!file || offset < 0 || uint64_t(length - offset) < bytes)
+    {
+        std::cerr << "Truncated DDS file: " << filename << std::endl;
+        return false;
+    }
+
+    chain.levels.clear();
+
+    width = header.width;
+    height = header.height;
+    for(uint32_t i = 0; i < levels; i++)
+    {
+        MipChain::Level level;
+        level.width = int(width);
+        level.height = int(height);
+        level.data.resize(((size_t(width) + 3) / 4) * ((size_t(height) + 3) / 4) * blockBytes);
+        file.read((char*)level.data.data(), level.data.size());
+        chain.levels.push_back(std::move(level));
+
+        width = std::max(width / 2, 1u);
+        height = std::max(height / 2, 1u);
+    }
+
+    if(!file)
+    {
+        std::cerr << "Truncated DDS file: " << filename << std::endl;
+        chain.levels.clear();
+        return false;
+    }
+
+    return true;
+}
+
+bool DDSFile::save(const std::string& filename, const MipChain& chain)
+{
+    uint32_t fourCC = 0;
+    switch(chain.format)
+    {
+        case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+        case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+            fourCC = FOURCC_DXT1;
+            break;
+        case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+            fourCC = FOURCC_DXT5;
+            break;
+        default:
+            std::cerr << "Only BC1 and BC3 are written to DDS files: " << filename << std::endl;
+            return false;
+    }
+
+    if(chain.levels.empty())
+    {
+        return false;
+    }
+
+    Header header = {};
+    header.size = sizeof(Header);
+    header.flags = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_MIPMAPCOUNT | DDSD_LINEARSIZE;
+    header.height = uint32_t(chain.levels[0].height);
+    header.width = uint32_t(chain.levels[0].width);
+    header.pitchOrLinearSize = uint32_t(chain.levels[0].data.size());
+    header.mipMapCount = uint32_t(chain.levels.size());
+    header.pixelFormatSize = 32;
+    header.pixelFormatFlags = DDPF_FOURCC;
+    header.fourCC = fourCC;
+    header.caps[0] = DDSCAPS_TEXTURE | (chain.levels.size() > 1 ? DDSCAPS_MIPMAP | DDSCAPS_COMPLEX : 0);
+
+    std::ofstream file(filename, std::ios::binary);
+    if(!file.is_open())
+    {
+        std::cerr << "Could not write DDS file: " << filename << std::endl;
+        return false;
+    }
+
+    file.write((const char*)&DDS_MAGIC, sizeof(DDS_MAGIC));
+    file.write((const char*)&header, sizeof(header));
+    for(auto& level : chain.levels)
+    {
+        file.write((const char*)level.data.data(), level.data.size());
+    }
+
+    return bool(file);
+}
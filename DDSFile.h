@@ -0,0 +1,30 @@
+#pragma once
+
+#include <string>
+
+#include "MipChain.h"
+
+/// <summary>
+/// Reads and writes block compressed mip chains as DDS files. BC1 and BC3 are written with their DXT1 and DXT5 codes,
+/// BC1, BC3 and BC7 are read, BC7 only from files with the DX10 header. The rows are kept in the order they are stored, so
+/// files written by other tools, which store the top row first, show upside down on models that flip their images.
+/// </summary>
+class DDSFile
+{
+    public:
+        /// <summary>
+        /// Reads a chain
+        /// </summary>
+        /// <param name="filename">The file</param>
+        /// <param name="chain">The chain read</param>
+        /// <returns>Flag for if the file was read and holds a supported format</returns>
+        static bool load(const std::string& filename, MipChain& chain);
+
+        /// <summary>
+        /// Writes a chain
+        /// </summary>
+        /// <param name="filename">The file</param>
+        /// <param name="chain">The chain, BC1 or BC3</param>
+        /// <returns>Flag for if the file was written</returns>
+        static bool save(const std::string& filename, const MipChain& chain);
+};
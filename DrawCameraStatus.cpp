@@ -39,5 +39,14 @@ void DrawCameraStatus::render(GLFWwindow* window, std::shared_ptr<LightMoveCallb
     vr::Text::drawText(width, height, 10, 200, "TUTORIAL: Press 9 to toggle shadowmap with a delay on half a second");
     vr::Text::drawText(width, height, 10, 220, "TUTORIAL: Press 8 for manual light, 7 for automatic.");
     vr::Text::drawText(width, height, 10, 240, "You move around the manual light by moving around the camera");
-    vr::Text::drawText(width, height, 10, 290, "Press 6 to activate particle animation");
+    vr::Text::drawText(width, height, 10, 290, "Press 6 to start/stop emitting particles");
+    vr::Text::drawText(width, height, 10, 310, "Press F5 to start/stop recording a camera path (camera_path.txt)");
+    vr::Text::drawText(width, height, 10, 330, "Press 5 to toggle the GPU pass timings, F6 to log them to gpu_profile.csv");
+    vr::Text::drawText(width, height, 10, 350, "Press F7 to write a CPU trace (cpu_trace.json)");
+    vr::Text::drawText(width, height, 10, 370, "Press 4 to cycle the shadow resolution (512 to 4096)");
+    vr::Text::drawText(width, height, 10, 390, "Press 3 to switch additive/alpha blended particles, 2 to toggle soft particles");
+    vr::Text::drawText(width, height, 10, 410, "Press 1 to switch between order independent and sorted transparency");
+    vr::Text::drawText(width, height, 10, 430, "Press - and = to lower or raise the LOD bias");
+    vr::Text::drawText(width, height, 10, 450, "Press 0 to toggle occlusion culling");
+    vr::Text::drawText(width, height, 10, 470, "Right click to pick an object");
 }
\ No newline at end of file
@@ -2,58 +2,151 @@
 #include <vector>
 #include <iostream>
 #include <cmath>
+#include <algorithm>
 #include "glm/ext.hpp"
+#include "RenderStats.h"
+#include "GPUProfiler.h"
+#include "CPUParticles.h"
+#include "ThreadPool.h"
+#include "RenderTargetPool.h"
 
-GPUParticles::GPUParticles(unsigned int emitNum) : m_start(std::chrono::high_resolution_clock::now()), m_particleTexture(nullptr), m_active(true), m_emitNum(emitNum)
+GPUParticles::GPUParticles(unsigned int capacity) :
+	m_start(std::chrono::high_resolution_clock::now()),
+	m_particleTexture(nullptr),
+	m_active(true),
+	m_capacity(capacity),
+	m_emitAccumulator(0.0f),
+	m_lifetime(4.0f, 8.0f),
+	m_emitterPosition(-36.0f, 89.0f, -36.0f),
+	m_emitterSize(64.0f),
+	m_current(0),
+	m_frame(0),
+	m_aliveCount(0),
+	m_aliveCountFrame(0),
+	m_blendMode(BLEND_ADDITIVE),
+	m_softParticles(true),
+	m_softness(2.0f),
+	m_tileLimit(256),
+	m_sortProgram(0),
+	m_sortCapacity(0),
+	m_keyBuffer(0),
+	m_valueBuffer(0),
+	m_sortedBuffer(0),
+	m_tileBuffer(0),
+	m_tileGrid(0),
+	m_vao(0),
+	m_positionBuffer(0),
+	m_velocityBuffer(0),
+	m_deadBuffer(0),
+	m_counterBuffer(0),
+	m_indirectBuffer(0),
+	m_drawBuffer(0),
+	m_backend(BACKEND_COMPUTE),
+	m_streamBuffer(0),
+	m_streamData(nullptr),
+	m_streamRegionSize(0),
+	m_streamIdBuffer(0),
+	m_streamIds(nullptr),
+	m_streamIdRegionSize(0),
+	m_streamRegion(0)
 {
+	//Enough to keep the pool about full at the average lifetime
+	m_emitRate = m_capacity / ((m_lifetime.x + m_lifetime.y) * 0.5f);
 
+	m_aliveBuffers[0] = m_aliveBuffers[1] = 0;
+
+	for (unsigned int i = 0; i < READBACK_LATENCY; i++)
+	{
+		m_readbackBuffers[i] = 0;
+		m_readbackFences[i] = nullptr;
+		m_readbackFrames[i] = 0;
+	}
+
+	for (unsigned int i = 0; i < STREAM_REGIONS; i++)
+	{
+		m_streamFences[i] = nullptr;
+	}
+
+	for (unsigned int i = 0; i < EMIT_HISTORY; i++)
+	{
+		m_emitHistory[i] = 0;
+	}
 }
 
-void GPUParticles::init(GLuint program)
+GPUParticles::~GPUParticles()
 {
-	std::vector<float> positions;
+	for (unsigned int i = 0; i < READBACK_LATENCY; i++)
+	{
+		if (m_readbackFences[i])
+		{
+			glDeleteSync(m_readbackFences[i]);
+		}
+	}
 
-	positions.reserve(m_emitNum);
+	for (unsigned int i = 0; i < STREAM_REGIONS; i++)
+	{
+		if (m_streamFences[i])
+		{
+			glDeleteSync(m_streamFences[i]);
+		}
+	}
 
-    int div3 = std::pow(m_emitNum, (1.0f/3.0f));
+	if (m_streamData)
+	{
+		glUnmapNamedBuffer(m_streamBuffer);
+	}
 
-	for (float i = 0; i < div3*div3*div3; i++)
+	if (m_streamIds)
 	{
-		positions.push_back((rand() % div3) - 100);
-		positions.push_back((rand() % div3) + 25);
-		positions.push_back((rand() % div3) - 100);
-		positions.push_back(1.0f);
+		glUnmapNamedBuffer(m_streamIdBuffer);
 	}
-	std::vector<float> vel(m_emitNum * 4, 0);
 
+	glDeleteBuffers(READBACK_LATENCY, m_readbackBuffers);
+	glDeleteBuffers(1, &m_positionBuffer);
+	glDeleteBuffers(1, &m_velocityBuffer);
+	glDeleteBuffers(1, &m_deadBuffer);
+	glDeleteBuffers(2, m_aliveBuffers);
+	glDeleteBuffers(1, &m_counterBuffer);
+	glDeleteBuffers(1, &m_indirectBuffer);
+	glDeleteBuffers(1, &m_drawBuffer);
+	glDeleteBuffers(1, &m_streamBuffer);
+	glDeleteBuffers(1, &m_streamIdBuffer);
+	glDeleteBuffers(1, &m_keyBuffer);
+	glDeleteBuffers(1, &m_valueBuffer);
+	glDeleteBuffers(1, &m_sortedBuffer);
+	glDeleteBuffers(1, &m_tileBuffer);
+	glDeleteVertexArrays(1, &m_vao);
+}
+
+void GPUParticles::init(GLuint program)
+{
 	glEnable(GL_BLEND);
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE);
 	glDisable(GL_DEPTH_TEST);
 
-	GLuint posBuffer;
-	GLuint velBuffer;
-	glCreateBuffers(1, &posBuffer);
-	glCreateBuffers(1, &velBuffer);
-
-	glNamedBufferStorage(posBuffer, positions.size() * sizeof(float), positions.data(), GL_DYNAMIC_STORAGE_BIT);
-	glNamedBufferStorage(velBuffer, vel.size() * sizeof(float), vel.data(), GL_DYNAMIC_STORAGE_BIT);
-	positions.clear();
-	vel.clear();
+	if (m_backend == BACKEND_COMPUTE && !GLEW_VERSION_4_3 && !GLEW_ARB_compute_shader)
+	{
+		std::cout << "Compute shaders are not supported, simulating the particles on the CPU" << std::endl;
+		m_backend = BACKEND_CPU;
+	}
 
-	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, posBuffer);
-	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, velBuffer);
+	if (m_backend == BACKEND_COMPUTE)
+	{
+		initCompute();
+	}
+	else
+	{
+		initCPU();
+	}
 
+	//Both backends leave the live particles packed, x, y, z and the remaining life
 	glGenVertexArrays(1, &m_vao);
 	glBindVertexArray(m_vao);
-
-	glUseProgram(program);
-	glBindBuffer(GL_ARRAY_BUFFER, posBuffer);
-	glVertexAttribPointer(glGetAttribLocation(program, "position"), 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void *)0);
-	glEnableVertexAttribArray(glGetAttribLocation(program, "position"));
-
-	glBindBuffer(GL_ARRAY_BUFFER, velBuffer);
-	glVertexAttribPointer(glGetAttribLocation(program, "velocity"), 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void *)0);
-	glEnableVertexAttribArray(glGetAttribLocation(program, "velocity"));
+	glBindBuffer(GL_ARRAY_BUFFER, m_backend == BACKEND_COMPUTE ? m_drawBuffer : m_streamBuffer);
+	glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void *)0);
+	glEnableVertexAttribArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindVertexArray(0);
 
     //Create texture
 	m_particleTexture = std::shared_ptr<Texture>(new Texture());
@@ -65,44 +158,480 @@ void GPUParticles::init(GLuint program)
 	m_particleTexture->setParameteri(GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 	m_particleTexture->setParameteri(GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 	m_particleTexture->unbind();
+}
 
-	glBindVertexArray(0);
-	glUseProgram(0);
+void GPUParticles::initCompute()
+{
+	//Every particle starts out dead, so the free list holds every index
+	std::vector<GLuint> dead(m_capacity);
+	for (unsigned int i = 0; i < m_capacity; i++)
+	{
+		dead[i] = i;
+	}
+
+	//Dead count, the alive count of both lists and the emit count of the frame
+	GLuint counters[4] = { m_capacity, 0, 0, 0 };
+
+	//Emit dispatch, simulate dispatch and the draw arrays command, written by the compute stages
+	GLuint indirect[10] = { 0, 1, 1, 0, 1, 1, 0, 1, 0, 0 };
+
+	glCreateBuffers(1, &m_positionBuffer);
+	glCreateBuffers(1, &m_velocityBuffer);
+	glCreateBuffers(1, &m_deadBuffer);
+	glCreateBuffers(2, m_aliveBuffers);
+	glCreateBuffers(1, &m_counterBuffer);
+	glCreateBuffers(1, &m_indirectBuffer);
+	glCreateBuffers(1, &m_drawBuffer);
+	glCreateBuffers(READBACK_LATENCY, m_readbackBuffers);
+
+	glNamedBufferStorage(m_positionBuffer, m_capacity * 4 * sizeof(float), nullptr, 0);
+	glNamedBufferStorage(m_velocityBuffer, m_capacity * 4 * sizeof(float), nullptr, 0);
+	glNamedBufferStorage(m_deadBuffer, dead.size() * sizeof(GLuint), dead.data(), 0);
+	glNamedBufferStorage(m_aliveBuffers[0], m_capacity * sizeof(GLuint), nullptr, 0);
+	glNamedBufferStorage(m_aliveBuffers[1], m_capacity * sizeof(GLuint), nullptr, 0);
+	glNamedBufferStorage(m_counterBuffer, sizeof(counters), counters, 0);
+	glNamedBufferStorage(m_indirectBuffer, sizeof(indirect), indirect, 0);
+	glNamedBufferStorage(m_drawBuffer, m_capacity * 4 * sizeof(float), nullptr, 0);
+
+	for (unsigned int i = 0; i < READBACK_LATENCY; i++)
+	{
+		glNamedBufferStorage(m_readbackBuffers[i], sizeof(GLuint), nullptr, GL_CLIENT_STORAGE_BIT);
+	}
 }
 
-void GPUParticles::render(glm::vec3 followPosition, std::shared_ptr<Camera> cam, GLuint program, GLuint computeProgram)
+void GPUParticles::initCPU()
 {
-	glBindVertexArray(m_vao);
-	glEnable(GL_BLEND);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE);
-	glDisable(GL_DEPTH_TEST);
-	m_particleTexture->bind();
+	m_cpuParticles = std::shared_ptr<CPUParticles>(new CPUParticles(m_capacity));
+	m_cpuParticles->setThreadPool(m_threadPool);
+
+	//Regions start on the storage buffer alignment, so the sort can bind one region as its source
+	GLint alignment = 256;
+	glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+	alignment = std::max(alignment, GLint(4 * sizeof(float)));
+	m_streamRegionSize = ((m_capacity * 4 * sizeof(float) + alignment - 1) / alignment) * alignment;
+	m_streamIdRegionSize = ((m_capacity * sizeof(uint32_t) + alignment - 1) / alignment) * alignment;
 
-    std::chrono::duration<float> elapsedTime = std::chrono::high_resolution_clock::now() - m_start;
+	//Only the draw count is used, the sort reads the live count from it like on the compute backend
+	GLuint indirect[10] = { 0, 1, 1, 0, 1, 1, 0, 1, 0, 0 };
+	glCreateBuffers(1, &m_indirectBuffer);
+	glNamedBufferStorage(m_indirectBuffer, sizeof(indirect), indirect, GL_DYNAMIC_STORAGE_BIT);
+
+	GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	glCreateBuffers(1, &m_streamBuffer);
+	glNamedBufferStorage(m_streamBuffer, m_streamRegionSize * STREAM_REGIONS, nullptr, flags);
+	m_streamData = (float*)glMapNamedBufferRange(m_streamBuffer, 0, m_streamRegionSize * STREAM_REGIONS, flags);
+
+	//The ids of the particles in the same order, the tile thinning hashes them instead of the slots that change as particles die
+	glCreateBuffers(1, &m_streamIdBuffer);
+	glNamedBufferStorage(m_streamIdBuffer, m_streamIdRegionSize * STREAM_REGIONS, nullptr, flags);
+	m_streamIds = (uint32_t*)glMapNamedBufferRange(m_streamIdBuffer, 0, m_streamIdRegionSize * STREAM_REGIONS, flags);
+
+	std::cout << "Simulating particles on the CPU with the " << CPUParticles::kernelName(m_cpuParticles->getKernel()) << " kernel" << std::endl;
+}
+
+void GPUParticles::render(glm::vec3 followPosition, std::shared_ptr<Camera> cam, GLuint program, GLuint computeProgram)
+{
+	std::chrono::duration<float> elapsedTime = std::chrono::high_resolution_clock::now() - m_start;
 	const float deltaTime = elapsedTime.count();
-    m_start = std::chrono::high_resolution_clock::now();
+	m_start = std::chrono::high_resolution_clock::now();
+
+	update(deltaTime, followPosition, computeProgram);
+	draw(cam, program);
+}
+
+unsigned int GPUParticles::takeEmitCount(float deltaTime)
+{
+	//Whole particles are emitted, the rest carries over to the next frame
+	if (!m_active)
+	{
+		m_emitAccumulator = 0.0f;
+		return 0;
+	}
+
+	m_emitAccumulator += m_emitRate * std::min(deltaTime, 0.1f);
+	unsigned int emitCount = (unsigned int)std::min(m_emitAccumulator, float(m_capacity));
+	m_emitAccumulator -= emitCount;
+	return emitCount;
+}
+
+void GPUParticles::update(float deltaTime, glm::vec3 followPosition, GLuint computeProgram)
+{
+	unsigned int emitCount = takeEmitCount(deltaTime);
+	m_emitHistory[m_frame % EMIT_HISTORY] = emitCount;
+
+	if (m_backend == BACKEND_COMPUTE)
+	{
+		if(m_profiler) m_profiler->beginPass("particles compute");
+		updateCompute(deltaTime, followPosition, emitCount, computeProgram);
+		if(m_profiler) m_profiler->endPass();
+	}
+	else
+	{
+		updateCPU(deltaTime, followPosition, emitCount);
+	}
+
+	m_frame++;
+}
+
+void GPUParticles::updateCompute(float deltaTime, glm::vec3 followPosition, unsigned int emitCount, GLuint computeProgram)
+{
+	//Pick up the live count of an earlier frame if the GPU is done with it
+	unsigned int slot = m_frame % READBACK_LATENCY;
+	if (m_readbackFences[slot])
+	{
+		GLenum status = glClientWaitSync(m_readbackFences[slot], 0, 0);
+		if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED)
+		{
+			glGetNamedBufferSubData(m_readbackBuffers[slot], 0, sizeof(GLuint), &m_aliveCount);
+			m_aliveCountFrame = m_readbackFrames[slot];
+			glDeleteSync(m_readbackFences[slot]);
+			m_readbackFences[slot] = nullptr;
+		}
+	}
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_positionBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, m_velocityBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, m_deadBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, m_aliveBuffers[m_current]);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, m_aliveBuffers[1 - m_current]);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, m_counterBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 6, m_indirectBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 7, m_drawBuffer);
+	glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, m_indirectBuffer);
 
 	glUseProgram(computeProgram);
-	glUniform1f(glGetUniformLocation(computeProgram, "deltaTime"), deltaTime);
-	glUniform1i(glGetUniformLocation(computeProgram, "isActive"), m_active);
+	glUniform1ui(glGetUniformLocation(computeProgram, "current"), m_current);
+	glUniform1ui(glGetUniformLocation(computeProgram, "requestedEmit"), emitCount);
+	glUniform1ui(glGetUniformLocation(computeProgram, "seed"), m_frame);
+	glUniform3fv(glGetUniformLocation(computeProgram, "emitterPosition"), 1, glm::value_ptr(m_emitterPosition));
+	glUniform3fv(glGetUniformLocation(computeProgram, "emitterSize"), 1, glm::value_ptr(m_emitterSize));
+	glUniform2fv(glGetUniformLocation(computeProgram, "lifetime"), 1, glm::value_ptr(m_lifetime));
 	glUniform3fv(glGetUniformLocation(computeProgram, "followPosition"), 1, glm::value_ptr(followPosition));
+	glUniform1f(glGetUniformLocation(computeProgram, "deltaTime"), deltaTime);
+
+	GLint stage = glGetUniformLocation(computeProgram, "stage");
+
+	//Clamps the emission to the free list and sizes the emit and simulate dispatches
+	glUniform1i(stage, STAGE_ARGS);
+	glDispatchCompute(1, 1, 1);
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+
+	glUniform1i(stage, STAGE_EMIT);
+	glDispatchComputeIndirect(0);
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+	//Dead particles go back to the free list, survivors are compacted into the other alive list
+	glUniform1i(stage, STAGE_SIMULATE);
+	glDispatchComputeIndirect(3 * sizeof(GLuint));
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+	glUniform1i(stage, STAGE_FINALIZE);
+	glDispatchCompute(1, 1, 1);
+	//The buffer update bit makes the live count written by the shader visible to the readback copy
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+
+	glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, 0);
+	glUseProgram(0);
+
+	if (!m_readbackFences[slot])
+	{
+		glCopyNamedBufferSubData(m_indirectBuffer, m_readbackBuffers[slot], 6 * sizeof(GLuint), 0, sizeof(GLuint));
+		m_readbackFences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		m_readbackFrames[slot] = m_frame + 1;
+	}
+
+	m_current = 1 - m_current;
+}
+
+void GPUParticles::updateCPU(float deltaTime, glm::vec3 followPosition, unsigned int emitCount)
+{
+	m_streamRegion = (m_streamRegion + 1) % STREAM_REGIONS;
+
+	//The region was last drawn STREAM_REGIONS frames ago, this only waits when the GPU is that far behind
+	GLsync& fence = m_streamFences[m_streamRegion];
+	if (fence)
+	{
+		while (true)
+		{
+			GLenum status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+			if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED || status == GL_WAIT_FAILED)
+			{
+				break;
+			}
+		}
+
+		glDeleteSync(fence);
+		fence = nullptr;
+	}
+
+	float* region = m_streamData + (m_streamRegionSize / sizeof(float)) * m_streamRegion;
+	uint32_t* ids = m_streamIds + (m_streamIdRegionSize / sizeof(uint32_t)) * m_streamRegion;
+
+	CPUParticles::Emitter emitter = { m_emitterPosition, m_emitterSize, m_lifetime };
+	m_cpuParticles->simulate(deltaTime, followPosition, emitCount, emitter, region, ids);
+	m_aliveCount = m_cpuParticles->getAliveCount();
+	m_aliveCountFrame = m_frame + 1;
+
+	glNamedBufferSubData(m_indirectBuffer, 6 * sizeof(GLuint), sizeof(GLuint), &m_aliveCount);
+}
+
+unsigned int GPUParticles::getAliveBound()
+{
+	//The count read back covers the frames before m_aliveCountFrame, everything emitted since can at most add to it
+	unsigned int frames = m_frame - m_aliveCountFrame;
+	if (frames > EMIT_HISTORY)
+	{
+		return m_capacity;
+	}
+
+	unsigned long long bound = m_aliveCount;
+	for (unsigned int i = 0; i < frames; i++)
+	{
+		bound += m_emitHistory[(m_aliveCountFrame + i) % EMIT_HISTORY];
+	}
+
+	return (unsigned int)std::min(bound, (unsigned long long)m_capacity);
+}
+
+bool GPUParticles::sortAndBin(std::shared_ptr<Camera> cam, const glm::mat4& projection)
+{
+	bool sortDepth = m_blendMode == BLEND_ALPHA;
+	bool binning = m_tileLimit > 0;
+
+	if (m_sortProgram == 0 || (!sortDepth && !binning))
+	{
+		return false;
+	}
+
+	unsigned int bound = getAliveBound();
+	if (bound == 0)
+	{
+		return false;
+	}
+
+	if (!m_keyBuffer)
+	{
+		m_sortCapacity = SORT_BLOCK;
+		while (m_sortCapacity < m_capacity)
+		{
+			m_sortCapacity *= 2;
+		}
+
+		glCreateBuffers(1, &m_keyBuffer);
+		glCreateBuffers(1, &m_valueBuffer);
+		glCreateBuffers(1, &m_sortedBuffer);
+		glNamedBufferStorage(m_keyBuffer, m_sortCapacity * sizeof(float), nullptr, 0);
+		glNamedBufferStorage(m_valueBuffer, m_sortCapacity * sizeof(GLuint), nullptr, 0);
+		glNamedBufferStorage(m_sortedBuffer, m_capacity * 4 * sizeof(float), nullptr, 0);
+	}
+
+	//Bitonic sort works on powers of two, the padding is sized by the live count and not the capacity
+	unsigned int padded = SORT_BLOCK;
+	while (padded < bound)
+	{
+		padded *= 2;
+	}
+
+	glm::uvec2 screenSize = cam->getScreenSize();
+	glm::uvec2 tileGrid = (screenSize + glm::uvec2(TILE_SIZE - 1)) / TILE_SIZE;
 
-	glDispatchCompute(m_emitNum / 64, 1, 1);
+	if (binning)
+	{
+		if (!m_tileBuffer || tileGrid != m_tileGrid)
+		{
+			glDeleteBuffers(1, &m_tileBuffer);
+			glCreateBuffers(1, &m_tileBuffer);
+			glNamedBufferStorage(m_tileBuffer, std::max(tileGrid.x * tileGrid.y, 1u) * sizeof(GLuint), nullptr, 0);
+			m_tileGrid = tileGrid;
+		}
+
+		glClearNamedBufferData(m_tileBuffer, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, m_tileBuffer);
+	}
+
+	if (m_backend == BACKEND_COMPUTE)
+	{
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_drawBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, m_aliveBuffers[m_current]);
+	}
+	else
+	{
+		glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 0, m_streamBuffer, m_streamRegionSize * m_streamRegion, m_streamRegionSize);
+		glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 3, m_streamIdBuffer, m_streamIdRegionSize * m_streamRegion, m_streamIdRegionSize);
+	}
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, m_keyBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, m_valueBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 6, m_indirectBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 7, m_sortedBuffer);
+
+	glUseProgram(m_sortProgram);
+	glUniform1ui(glGetUniformLocation(m_sortProgram, "paddedCount"), padded);
+	glUniformMatrix4fv(glGetUniformLocation(m_sortProgram, "view"), 1, GL_FALSE, glm::value_ptr(cam->getView()));
+	glUniformMatrix4fv(glGetUniformLocation(m_sortProgram, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
+	glUniform1i(glGetUniformLocation(m_sortProgram, "backToFront"), sortDepth);
+	glUniform1i(glGetUniformLocation(m_sortProgram, "binning"), binning);
+	glUniform2ui(glGetUniformLocation(m_sortProgram, "tileGrid"), tileGrid.x, tileGrid.y);
+	glUniform1ui(glGetUniformLocation(m_sortProgram, "tileSize"), TILE_SIZE);
+	glUniform1ui(glGetUniformLocation(m_sortProgram, "tileLimit"), m_tileLimit);
+	glUniform2f(glGetUniformLocation(m_sortProgram, "screenSize"), float(screenSize.x), float(screenSize.y));
+
+	GLint stage = glGetUniformLocation(m_sortProgram, "stage");
+	GLint k = glGetUniformLocation(m_sortProgram, "k");
+	GLint j = glGetUniformLocation(m_sortProgram, "j");
+
+	//Keys are the view depth, negated for back to front. The tiles are counted on the way
+	glUniform1i(stage, SORT_STAGE_KEYS);
+	glDispatchCompute(padded / (SORT_BLOCK / 2), 1, 1);
 	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+	if (sortDepth)
+	{
+		//Blocks are sorted in shared memory, then merged. Only merge steps with pairs a block or more apart go through the buffers
+		glUniform1i(stage, SORT_STAGE_SORT_LOCAL);
+		glDispatchCompute(padded / SORT_BLOCK, 1, 1);
+		glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+		for (unsigned int size = SORT_BLOCK * 2; size <= padded; size *= 2)
+		{
+			glUniform1ui(k, size);
+
+			glUniform1i(stage, SORT_STAGE_MERGE_GLOBAL);
+			for (unsigned int distance = size / 2; distance >= SORT_BLOCK; distance /= 2)
+			{
+				glUniform1ui(j, distance);
+				glDispatchCompute(padded / SORT_BLOCK, 1, 1);
+				glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+			}
+
+			glUniform1i(stage, SORT_STAGE_MERGE_LOCAL);
+			glDispatchCompute(padded / SORT_BLOCK, 1, 1);
+			glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+		}
+	}
+
+	glUniform1i(stage, SORT_STAGE_GATHER);
+	glDispatchCompute(padded / (SORT_BLOCK / 2), 1, 1);
+	glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+
 	glUseProgram(0);
 
+	return true;
+}
+
+void GPUParticles::draw(std::shared_ptr<Camera> cam, GLuint program)
+{
+	//The scene projection, so the particles can be depth tested against the scene and binned in screen tiles
+	glm::mat4 projection = cam->getProjection();
+
+	if(m_profiler) m_profiler->beginPass("particles sort");
+	bool sorted = sortAndBin(cam, projection);
+	if(m_profiler) m_profiler->endPass();
+
+	if(m_profiler) m_profiler->beginPass("particles draw");
+
+	//Soft particles are tested against the scene without writing depth and fade against a copy of it
+	std::shared_ptr<Texture> sceneDepth;
+	if (m_softParticles)
+	{
+		glEnable(GL_DEPTH_TEST);
+		glDepthMask(GL_FALSE);
+
+		if (m_renderTargetPool)
+		{
+			glm::uvec2 screenSize = cam->getScreenSize();
+			sceneDepth = m_renderTargetPool->acquire({ screenSize.x, screenSize.y, 1, GL_DEPTH_COMPONENT24, 0, false }, SCENE_DEPTH_SLOT);
+		}
+
+		if (sceneDepth)
+		{
+			glCopyTextureSubImage2D(sceneDepth->getId(), 0, 0, 0, 0, 0, cam->getScreenSize()[0], cam->getScreenSize()[1]);
+			sceneDepth->bind();
+			sceneDepth->setParameteri(GL_TEXTURE_COMPARE_MODE, GL_NONE);
+		}
+	}
+	else
+	{
+		glDisable(GL_DEPTH_TEST);
+	}
+
+	glBindVertexArray(m_vao);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, m_blendMode == BLEND_ALPHA ? GL_ONE_MINUS_SRC_ALPHA : GL_ONE);
+	m_particleTexture->bind();
+
+	//The vertices come from the sorted buffer, or straight from where the simulation left them
+	glBindBuffer(GL_ARRAY_BUFFER, sorted ? m_sortedBuffer : (m_backend == BACKEND_COMPUTE ? m_drawBuffer : m_streamBuffer));
+	glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void *)0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
 	glUseProgram(program);
 
-	glm::mat4 projection = glm::perspective(cam->getFov(), float(cam->getScreenSize()[0] / cam->getScreenSize()[1]), 0.0f, 1e3f); //we want a bigger farplane
+	glm::vec2 nearFar = cam->getNearFar();
 	glUniformMatrix4fv(glGetUniformLocation(program, "view"), 1, GL_FALSE, glm::value_ptr(cam->getView()));
 	glUniformMatrix4fv(glGetUniformLocation(program, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
-    glUniform1i(glGetUniformLocation(program, "particleTexture"), 0);
+	glUniform1i(glGetUniformLocation(program, "particleTexture"), 0);
+	glUniform1i(glGetUniformLocation(program, "sceneDepth"), SCENE_DEPTH_SLOT);
+	glUniform1i(glGetUniformLocation(program, "softParticles"), sceneDepth != nullptr);
+	glUniform1f(glGetUniformLocation(program, "softness"), m_softness);
+	glUniform2fv(glGetUniformLocation(program, "nearFar"), 1, glm::value_ptr(nearFar));
+
+	if (m_backend == BACKEND_COMPUTE)
+	{
+		//The vertex count is the live count written by the finalize stage
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_indirectBuffer);
+		glDrawArraysIndirect(GL_POINTS, (void*)(6 * sizeof(GLuint)));
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	}
+	else
+	{
+		//Every region holds a full capacity, so the region is selected with the first vertex
+		GLint first = sorted ? 0 : GLint(m_streamRegion * (m_streamRegionSize / (4 * sizeof(float))));
+		glDrawArrays(GL_POINTS, first, m_aliveCount);
+
+		//The sort reads the region too, so the fence goes after both
+		if (m_streamFences[m_streamRegion])
+		{
+			glDeleteSync(m_streamFences[m_streamRegion]);
+		}
+		m_streamFences[m_streamRegion] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
+
+	RenderStats::addDrawCall(m_aliveCount * 2); //Every point is expanded into a quad by the geometry shader
 
-	glDrawArrays(GL_POINTS, 0, m_emitNum);
 	m_particleTexture->unbind();
+	if (sceneDepth)
+	{
+		sceneDepth->unbind();
+		m_renderTargetPool->release(sceneDepth);
+	}
+
 	glUseProgram(0);
 	glBindVertexArray(0);
+	glDepthMask(GL_TRUE);
 	glEnable(GL_DEPTH_TEST);
+
+	if(m_profiler) m_profiler->endPass();
+}
+
+void GPUParticles::setBackend(Backend backend)
+{
+	m_backend = backend;
+}
+
+GPUParticles::Backend GPUParticles::getBackend()
+{
+	return m_backend;
+}
+
+void GPUParticles::setThreadPool(std::shared_ptr<ThreadPool> pool)
+{
+	m_threadPool = pool;
+
+	if (m_cpuParticles)
+	{
+		m_cpuParticles->setThreadPool(pool);
+	}
 }
 
 void GPUParticles::setActive(bool flag)
@@ -113,4 +642,70 @@ void GPUParticles::setActive(bool flag)
 bool GPUParticles::getActive()
 {
 	return m_active;
-}
\ No newline at end of file
+}
+
+void GPUParticles::setProfiler(std::shared_ptr<GPUProfiler> profiler)
+{
+	m_profiler = profiler;
+}
+
+void GPUParticles::setEmitRate(float rate)
+{
+	m_emitRate = std::max(rate, 0.0f);
+}
+
+void GPUParticles::setLifetime(float minLifetime, float maxLifetime)
+{
+	m_lifetime = glm::vec2(std::max(minLifetime, 0.0f), std::max(maxLifetime, minLifetime));
+}
+
+unsigned int GPUParticles::getAliveCount()
+{
+	return m_aliveCount;
+}
+
+unsigned int GPUParticles::getCapacity()
+{
+	return m_capacity;
+}
+
+void GPUParticles::setBlendMode(BlendMode mode)
+{
+	m_blendMode = mode;
+}
+
+GPUParticles::BlendMode GPUParticles::getBlendMode()
+{
+	return m_blendMode;
+}
+
+void GPUParticles::setSoftParticles(bool flag, float softness)
+{
+	m_softParticles = flag;
+	m_softness = std::max(softness, 1e-3f);
+}
+
+bool GPUParticles::getSoftParticles()
+{
+	return m_softParticles;
+}
+
+void GPUParticles::setTileLimit(unsigned int limit)
+{
+	m_tileLimit = limit;
+}
+
+unsigned int GPUParticles::getTileLimit()
+{
+	return m_tileLimit;
+}
+
+void GPUParticles::setSortProgram(GLuint program)
+{
+	m_sortProgram = program;
+}
+
+void GPUParticles::setRenderTargetPool(std::shared_ptr<RenderTargetPool> pool)
+{
+	m_renderTargetPool = pool;
+}
@@ -8,24 +8,95 @@
 #include <glm/gtc/type_ptr.hpp>
 #include "Texture.h"
 #include <chrono>
+#include <cstdint>
 #include <ratio>
 #include "Camera.h"
 
+class GPUProfiler;
+class CPUParticles;
+class ThreadPool;
+class RenderTargetPool;
+
+/// <summary>
+/// GPU particle system. Particles are emitted from a box, live for a random lifetime and are then
+/// returned to a free list. Emission, death and compaction of the survivors run in compute shaders
+/// with atomic counters, and the dispatches and the draw are indirect, so the cost follows the
+/// amount of live particles and not the capacity. Without compute shaders the same simulation runs on the
+/// CPU and the live particles are streamed into a persistently mapped buffer for drawing.
+/// Before drawing, the live particles can be bitonic sorted by view depth for alpha blending and thinned
+/// out in screen tiles that hold more than a limit, both in shaders/gpu-particles/sort.comp.glsl.
+/// </summary>
 class GPUParticles
 {
     public:
+        /// <summary>
+        /// Where the simulation runs
+        /// </summary>
+        enum Backend
+        {
+            BACKEND_COMPUTE,
+            BACKEND_CPU
+        };
+
+        /// <summary>
+        /// How the particles are blended, alpha blending draws them sorted back to front
+        /// </summary>
+        enum BlendMode
+        {
+            BLEND_ADDITIVE,
+            BLEND_ALPHA
+        };
+
         /// <summary>
         /// Constructor
+        /// <param name="capacity">The maximum amount of live particles</param>
         /// </summary>
-        GPUParticles(unsigned int emitNum);
+        GPUParticles(unsigned int capacity);
 
         /// <summary>
-        /// Initilizes the gpu particles
+        /// Destructor, deletes the buffers
+        /// </summary>
+        ~GPUParticles();
+
+        /// <summary>
+        /// Initilizes the gpu particles. The compute backend falls back to the CPU when compute shaders are missing
         /// </summary>
         void init(GLuint program);
 
         /// <summary>
-        /// Renders the GPU particles
+        /// Sets where the simulation runs, has to be called before init
+        /// <param name="backend">The backend</param>
+        /// </summary>
+        void setBackend(Backend backend);
+
+        /// <summary>
+        /// Returns where the simulation runs
+        /// </summary>
+        Backend getBackend();
+
+        /// <summary>
+        /// Sets the pool the CPU backend spreads the simulation over
+        /// <param name="pool">The pool</param>
+        /// </summary>
+        void setThreadPool(std::shared_ptr<ThreadPool> pool);
+
+        /// <summary>
+        /// Emits, moves and kills particles for one step
+        /// <param name="deltaTime">The step in seconds</param>
+        /// <param name="followPosition">The position the particles should follow</param>
+        /// <param name="computeProgram">The compute program, unused by the CPU backend</param>
+        /// </summary>
+        void update(float deltaTime, glm::vec3 followPosition, GLuint computeProgram);
+
+        /// <summary>
+        /// Draws the live particles
+        /// <param name="cam">The camera</param>
+        /// <param name="program">The program containing vert,frag,geo shaders</param>
+        /// </summary>
+        void draw(std::shared_ptr<Camera> cam, GLuint program);
+
+        /// <summary>
+        /// Updates with the time since the last call and draws the GPU particles
         /// <param name="followPosition">The position the particles should follow</param>
         /// <param name="viewMatrix">The viewmatrix of the camera</param>
         /// <param name="screenSize">The screensize</param>
@@ -35,7 +106,7 @@ class GPUParticles
         void render(glm::vec3 followPosition, std::shared_ptr<Camera> cam, GLuint program, GLuint computeProgram);
 
         /// <summary>
-        /// Sets if the particles should be actively moving or not
+        /// Sets if particles are emitted, the live particles finish their lifetime either way
         /// <param name="flag">Flag</param>
         /// </summary>
         void setActive(bool flag);
@@ -44,10 +115,181 @@ class GPUParticles
         ///  Returns active flag
         /// </summary>
         bool getActive();
+
+        /// <summary>
+        /// Sets the profiler measuring the compute and draw passes
+        /// <param name="profiler">The profiler</param>
+        /// </summary>
+        void setProfiler(std::shared_ptr<GPUProfiler> profiler);
+
+        /// <summary>
+        /// Sets how many particles are emitted per second while active
+        /// <param name="rate">Particles per second</param>
+        /// </summary>
+        void setEmitRate(float rate);
+
+        /// <summary>
+        /// Sets the range the lifetime of a particle is picked from
+        /// <param name="minLifetime">Shortest lifetime in seconds</param>
+        /// <param name="maxLifetime">Longest lifetime in seconds</param>
+        /// </summary>
+        void setLifetime(float minLifetime, float maxLifetime);
+
+        /// <summary>
+        /// Returns the amount of live particles, read back a couple of frames late so the GPU is never waited on
+        /// </summary>
+        unsigned int getAliveCount();
+
+        /// <summary>
+        /// Returns the maximum amount of live particles
+        /// </summary>
+        unsigned int getCapacity();
+
+        /// <summary>
+        /// Sets how the particles are blended
+        /// <param name="mode">The blend mode</param>
+        /// </summary>
+        void setBlendMode(BlendMode mode);
+
+        /// <summary>
+        /// Returns how the particles are blended
+        /// </summary>
+        BlendMode getBlendMode();
+
+        /// <summary>
+        /// Sets if the particles are depth tested against the scene and faded where they get close to it,
+        /// instead of being drawn on top of everything
+        /// <param name="flag">Flag</param>
+        /// <param name="softness">The view distance in front of the scene over which particles fade out</param>
+        /// </summary>
+        void setSoftParticles(bool flag, float softness = 2.0f);
+
+        /// <summary>
+        /// Returns the soft particles flag
+        /// </summary>
+        bool getSoftParticles();
+
+        /// <summary>
+        /// Sets the most particles drawn in one screen tile, crowded tiles drop particles at random. 0 draws every particle
+        /// <param name="limit">Particles per tile</param>
+        /// </summary>
+        void setTileLimit(unsigned int limit);
+
+        /// <summary>
+        /// Returns the most particles drawn in one screen tile
+        /// </summary>
+        unsigned int getTileLimit();
+
+        /// <summary>
+        /// Sets the compute program sorting and binning the particles, without it they are drawn as simulated
+        /// <param name="program">The sort program</param>
+        /// </summary>
+        void setSortProgram(GLuint program);
+
+        /// <summary>
+        /// Sets the pool the copy of the scene depth for soft particles is taken from
+        /// <param name="pool">The pool</param>
+        /// </summary>
+        void setRenderTargetPool(std::shared_ptr<RenderTargetPool> pool);
     private:
+        static const unsigned int READBACK_LATENCY = 2;
+        static const unsigned int STREAM_REGIONS = 3;
+        static const unsigned int EMIT_HISTORY = 8;
+        static const unsigned int SORT_BLOCK = 1024;
+        static const unsigned int TILE_SIZE = 32;
+        static const unsigned int SCENE_DEPTH_SLOT = 1;
+
+        enum Stage
+        {
+            STAGE_ARGS,
+            STAGE_EMIT,
+            STAGE_SIMULATE,
+            STAGE_FINALIZE
+        };
+
+        enum SortStage
+        {
+            SORT_STAGE_KEYS,
+            SORT_STAGE_SORT_LOCAL,
+            SORT_STAGE_MERGE_GLOBAL,
+            SORT_STAGE_MERGE_LOCAL,
+            SORT_STAGE_GATHER
+        };
+
         GLuint m_vao;
         std::shared_ptr<Texture> m_particleTexture;
         bool m_active;
-        unsigned int m_emitNum;
+        unsigned int m_capacity;
+        float m_emitRate;
+        float m_emitAccumulator;
+        glm::vec2 m_lifetime;
+        glm::vec3 m_emitterPosition;
+        glm::vec3 m_emitterSize;
+        unsigned int m_current;
+        unsigned int m_frame;
+        unsigned int m_aliveCount;
+
+        GLuint m_positionBuffer;
+        GLuint m_velocityBuffer;
+        GLuint m_deadBuffer;
+        GLuint m_aliveBuffers[2];
+        GLuint m_counterBuffer;
+        GLuint m_indirectBuffer;
+        GLuint m_drawBuffer;
+        GLuint m_readbackBuffers[READBACK_LATENCY];
+        GLsync m_readbackFences[READBACK_LATENCY];
+        unsigned int m_readbackFrames[READBACK_LATENCY];
+
+        //Emission of the last frames, bounds the live count between readbacks
+        unsigned int m_emitHistory[EMIT_HISTORY];
+        unsigned int m_aliveCountFrame;
+
+        //Sorting and binning
+        BlendMode m_blendMode;
+        bool m_softParticles;
+        float m_softness;
+        unsigned int m_tileLimit;
+        GLuint m_sortProgram;
+        unsigned int m_sortCapacity;
+        GLuint m_keyBuffer;
+        GLuint m_valueBuffer;
+        GLuint m_sortedBuffer;
+        GLuint m_tileBuffer;
+        glm::uvec2 m_tileGrid;
+        std::shared_ptr<RenderTargetPool> m_renderTargetPool;
+
+        //CPU backend, the stream buffer is split in regions written in turn while the GPU draws from the others
+        Backend m_backend;
+        std::shared_ptr<CPUParticles> m_cpuParticles;
+        std::shared_ptr<ThreadPool> m_threadPool;
+        GLuint m_streamBuffer;
+        float* m_streamData;
+        GLsizeiptr m_streamRegionSize;
+        GLuint m_streamIdBuffer;
+        uint32_t* m_streamIds;
+        GLsizeiptr m_streamIdRegionSize;
+        unsigned int m_streamRegion;
+        GLsync m_streamFences[STREAM_REGIONS];
+
+        /// <summary>
+        /// Returns the amount of whole particles to emit this step
+        /// </summary>
+        unsigned int takeEmitCount(float deltaTime);
+
+        void initCompute();
+        void initCPU();
+        void updateCompute(float deltaTime, glm::vec3 followPosition, unsigned int emitCount, GLuint computeProgram);
+        void updateCPU(float deltaTime, glm::vec3 followPosition, unsigned int emitCount);
+
+        /// <summary>
+        /// Returns a count the live particles of the last update can not exceed
+        /// </summary>
+        unsigned int getAliveBound();
+
+        /// <summary>
+        /// Sorts and bins the live particles into the sorted buffer, returns false if nothing was done
+        /// </summary>
+        bool sortAndBin(std::shared_ptr<Camera> cam, const glm::mat4& projection);
         std::chrono::time_point<std::chrono::high_resolution_clock> m_start;
+        std::shared_ptr<GPUProfiler> m_profiler;
 };
\ No newline at end of file
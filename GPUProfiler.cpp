@@ -0,0 +1,230 @@
+#include "GPUProfiler.h"
+#include <vr/DrawText.h>
+
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+
+GPUProfiler::GPUProfiler() : m_frameNumber(0), m_resolvedFrames(0), m_droppedFrames(0), m_overlayEnabled(true)
+{
+}
+
+GPUProfiler::~GPUProfiler()
+{
+    for(auto& frame : m_frames)
+    {
+        if(!frame.queries.empty())
+        {
+            glDeleteQueries((GLsizei)frame.queries.size(), frame.queries.data());
+        }
+    }
+}
+
+GPUProfiler::FrameQueries& GPUProfiler::current()
+{
+    return m_frames[m_frameNumber % FRAME_LATENCY];
+}
+
+void GPUProfiler::beginFrame()
+{
+    FrameQueries& frame = current();
+
+    if(frame.pending && frame.used > 0)
+    {
+        //The last query is the last one the GPU reaches, if it is done the whole frame is
+        GLint available = GL_FALSE;
+        glGetQueryObjectiv(frame.queries[frame.used - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+
+        if(available)
+        {
+            resolve(frame);
+        }
+        else
+        {
+            //Never wait on the GPU, just drop the frame
+            m_droppedFrames++;
+        }
+    }
+
+    frame.used = 0;
+    frame.names.clear();
+    frame.beginQuery.clear();
+    frame.endQuery.clear();
+    frame.frameNumber = m_frameNumber;
+    frame.pending = true;
+
+    m_openPasses.clear();
+    beginPass("frame");
+}
+
+void GPUProfiler::endFrame()
+{
+    while(!m_openPasses.empty())
+    {
+        endPass();
+    }
+
+    m_frameNumber++;
+}
+
+void GPUProfiler::beginPass(const std::string& name)
+{
+    FrameQueries& frame = current();
+
+    frame.names.push_back(name);
+    frame.beginQuery.push_back(timestamp());
+    frame.endQuery.push_back(-1);
+
+    m_openPasses.push_back((int)frame.names.size() - 1);
+}
+
+void GPUProfiler::endPass()
+{
+    if(m_openPasses.empty())
+    {
+        std::cerr << "GPUProfiler::endPass called without a matching beginPass" << std::endl;
+        return;
+    }
+
+    FrameQueries& frame = current();
+    frame.endQuery[m_openPasses.back()] = timestamp();
+    m_openPasses.pop_back();
+}
+
+int GPUProfiler::timestamp()
+{
+    FrameQueries& frame = current();
+
+    if(frame.used == frame.queries.size())
+    {
+        GLuint query;
+        glGenQueries(1, &query);
+        frame.queries.push_back(query);
+    }
+
+    glQueryCounter(frame.queries[frame.used], GL_TIMESTAMP);
+    return (int)frame.used++;
+}
+
+void GPUProfiler::resolve(FrameQueries& frame)
+{
+    std::vector<GLuint64> timestamps(frame.used);
+
+    for(unsigned int i = 0; i < frame.used; i++)
+    {
+        glGetQueryObjectui64v(frame.queries[i], GL_QUERY_RESULT, &timestamps[i]);
+    }
+
+    m_results.clear();
+    m_resolvedFrames++;
+
+    for(size_t i = 0; i < frame.names.size(); i++)
+    {
+        if(frame.endQuery[i] < 0)
+        {
+            continue;
+        }
+
+        PassResult result;
+        result.name = frame.names[i];
+        result.ms = (timestamps[frame.endQuery[i]] - timestamps[frame.beginQuery[i]]) / 1e6;
+        m_results.push_back(result);
+
+        auto smoothed = m_smoothed.find(result.name);
+        if(smoothed == m_smoothed.end())
+        {
+            m_smoothed[result.name] = result.ms;
+        }
+        else
+        {
+            smoothed->second = 0.9 * smoothed->second + 0.1 * result.ms;
+        }
+
+        if(m_log.is_open())
+        {
+            m_log << frame.frameNumber << "," << result.name << "," << result.ms << "\n";
+        }
+    }
+
+    frame.pending = false;
+}
+
+void GPUProfiler::render(GLFWwindow* window)
+{
+    if(!m_overlayEnabled)
+    {
+        return;
+    }
+
+    int width, height;
+    glfwGetWindowSize(window, &width, &height);
+
+    vr::Text::setColor(glm::vec4(0, 1, 1, 0.8));
+    vr::Text::setFontSize(16);
+
+    int y = 20;
+    for(auto& result : m_results)
+    {
+        std::ostringstream str;
+        str << std::fixed << std::setprecision(3);
+
+        if(result.name == "frame")
+        {
+            str << "GPU frame: " << m_smoothed[result.name] << " ms (dropped " << m_droppedFrames << ")" << std::ends;
+        }
+        else
+        {
+            str << "  " << result.name << ": " << m_smoothed[result.name] << " ms" << std::ends;
+        }
+
+        vr::Text::drawText(width, height, width - 360, y, str.str().c_str());
+        y += 18;
+    }
+}
+
+void GPUProfiler::setOverlayEnabled(bool flag)
+{
+    m_overlayEnabled = flag;
+}
+
+void GPUProfiler::setLogging(bool flag, const std::string& filename)
+{
+    if(m_log.is_open())
+    {
+        m_log.close();
+    }
+
+    if(flag)
+    {
+        m_log.open(filename);
+
+        if(!m_log.is_open())
+        {
+            std::cerr << "Could not open GPU profiler log: " << filename << std::endl;
+            return;
+        }
+
+        m_log << "frame,pass,ms\n";
+        std::cout << "Logging GPU pass timings to " << filename << std::endl;
+    }
+}
+
+bool GPUProfiler::isOverlayEnabled()
+{
+    return m_overlayEnabled;
+}
+
+bool GPUProfiler::isLogging()
+{
+    return m_log.is_open();
+}
+
+const std::vector<GPUProfiler::PassResult>& GPUProfiler::getResults()
+{
+    return m_results;
+}
+
+unsigned long long GPUProfiler::getResolvedFrames()
+{
+    return m_resolvedFrames;
+}
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+/// <summary>
+/// GPU profiler measuring named passes with GL_TIMESTAMP queries. The queries are buffered over
+/// FRAME_LATENCY frames so the results are read back a couple of frames late instead of stalling
+/// the pipeline. Results are shown as an on-screen overlay and can be logged per frame.
+/// </summary>
+class GPUProfiler
+{
+    public:
+        /// <summary>
+        /// The measured time of a single pass
+        /// </summary>
+        struct PassResult
+        {
+            std::string name;
+            double ms;
+        };
+
+        /// <summary>
+        /// Constructor
+        /// </summary>
+        GPUProfiler();
+
+        /// <summary>
+        /// Destructor, deletes the queries
+        /// </summary>
+        ~GPUProfiler();
+
+        /// <summary>
+        /// Starts a frame. Resolves the oldest buffered frame if its queries are available
+        /// </summary>
+        void beginFrame();
+
+        /// <summary>
+        /// Ends the frame
+        /// </summary>
+        void endFrame();
+
+        /// <summary>
+        /// Starts measuring a pass, passes may be nested
+        /// </summary>
+        /// <param name="name">The name of the pass</param>
+        void beginPass(const std::string& name);
+
+        /// <summary>
+        /// Stops measuring the innermost pass
+        /// </summary>
+        void endPass();
+
+        /// <summary>
+        /// Renders the overlay with the smoothed pass timings
+        /// </summary>
+        /// <param name="window">The window</param>
+        void render(GLFWwindow* window);
+
+        /// <summary>
+        /// Sets if the overlay should be rendered or not
+        /// </summary>
+        /// <param name="flag">The flag</param>
+        void setOverlayEnabled(bool flag);
+
+        /// <summary>
+        /// Starts or stops logging every resolved frame to a CSV file (frame,pass,ms)
+        /// </summary>
+        /// <param name="flag">The flag</param>
+        /// <param name="filename">The file to log to</param>
+        void setLogging(bool flag, const std::string& filename = "gpu_profile.csv");
+
+        /// <summary>
+        /// Returns the overlay flag
+        /// </summary>
+        bool isOverlayEnabled();
+
+        /// <summary>
+        /// Returns the logging flag
+        /// </summary>
+        bool isLogging();
+
+        /// <summary>
+        /// Returns the results of the most recently resolved frame. The first entry is the whole frame
+        /// </summary>
+        /// <returns>The pass results</returns>
+        const std::vector<PassResult>& getResults();
+
+        /// <summary>
+        /// Returns the amount of frames resolved so far. The results only change when it does, frames between
+        /// return the same results again
+        /// </summary>
+        unsigned long long getResolvedFrames();
+
+    private:
+        static const unsigned int FRAME_LATENCY = 2;
+
+        struct FrameQueries
+        {
+            std::vector<GLuint> queries;
+            std::vector<std::string> names;
+            std::vector<int> beginQuery;
+            std::vector<int> endQuery;
+            unsigned int used = 0;
+            unsigned long long frameNumber = 0;
+            bool pending = false;
+        };
+
+        FrameQueries m_frames[FRAME_LATENCY];
+        std::vector<int> m_openPasses;
+        std::vector<PassResult> m_results;
+        std::map<std::string, double> m_smoothed;
+        unsigned long long m_frameNumber;
+        unsigned long long m_resolvedFrames;
+        unsigned int m_droppedFrames;
+        bool m_overlayEnabled;
+        std::ofstream m_log;
+
+        /// <summary>
+        /// Issues a timestamp query in the current frame and returns its index
+        /// </summary>
+        int timestamp();
+
+        /// <summary>
+        /// Reads back the queries of a frame
+        /// </summary>
+        void resolve(FrameQueries& frame);
+
+        FrameQueries& current();
+};
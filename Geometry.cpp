@@ -10,33 +10,43 @@
 
 #include "NodeVisitor.h"
 #include "Geometry.h"
+#include "RenderStats.h"
 
+size_t Geometry::s_numGLObjects = 0;
 
 Geometry::Geometry(std::shared_ptr<State> state, bool useVAO) : Node(state), m_vbo_vertices(0), m_vbo_normals(0), m_vbo_texCoords(0), m_ibo_elements(0),
-                           m_attribute_v_coord(-1), m_attribute_v_normal(-1), m_attribute_v_texCoords(-1), m_vao(-1), m_useVAO(useVAO), m_hasInitilizedShaders(false), m_hasUploaded(false)
+                           m_attribute_v_coord(-1), m_attribute_v_normal(-1), m_attribute_v_texCoords(-1), m_vao(-1), m_depthVao(0), m_hasLocalBoundingBox(false), m_useVAO(useVAO), m_hasInitilizedShaders(false), m_hasUploaded(false)
 {
 }
 
 Geometry::Geometry(bool useVAO) : Node(), m_vbo_vertices(0), m_vbo_normals(0), m_vbo_texCoords(0), m_ibo_elements(0),
-                           m_attribute_v_coord(-1), m_attribute_v_normal(-1), m_attribute_v_texCoords(-1), m_vao(-1), m_useVAO(useVAO), m_hasInitilizedShaders(false), m_hasUploaded(false)
+                           m_attribute_v_coord(-1), m_attribute_v_normal(-1), m_attribute_v_texCoords(-1), m_vao(-1), m_depthVao(0), m_hasLocalBoundingBox(false), m_useVAO(useVAO), m_hasInitilizedShaders(false), m_hasUploaded(false)
 {
 }
 
 Geometry::~Geometry()
 {
-	if (m_vbo_vertices != 0)
+	//Every buffer and vertex array made by upload or renderDepth, m_vao keeps -1 when it was never made
+	GLuint* buffers[] = { &m_vbo_vertices, &m_vbo_normals, &m_vbo_texCoords, &m_ibo_elements };
+	for (GLuint* buffer : buffers)
 	{
-		glDeleteBuffers(1, &m_vbo_vertices);
+		if (*buffer != 0)
+		{
+			glDeleteBuffers(1, buffer);
+			s_numGLObjects--;
+		}
 	}
 
-	if (m_vbo_normals != 0)
+	if (m_vao != GLuint(-1) && m_vao != 0)
 	{
-		glDeleteBuffers(1, &m_vbo_normals);
+		glDeleteVertexArrays(1, &m_vao);
+		s_numGLObjects--;
 	}
 
-	if (m_ibo_elements != 0)
+	if (m_depthVao != 0)
 	{
-		glDeleteBuffers(1, &m_ibo_elements);
+		glDeleteVertexArrays(1, &m_depthVao);
+		s_numGLObjects--;
 	}
 }
 
@@ -69,6 +79,31 @@ BoundingBox Geometry::calculateBoundingBox()
 	return box;
 }
 
+BoundingBox Geometry::getLocalBoundingBox()
+{
+	if (!m_hasLocalBoundingBox)
+	{
+		m_localBoundingBox = BoundingBox();
+		for (auto& v : m_vertices)
+		{
+			m_localBoundingBox.expand(glm::vec3(v));
+		}
+		m_hasLocalBoundingBox = true;
+	}
+
+	return m_localBoundingBox;
+}
+
+const std::vector<glm::vec4>& Geometry::getVertices()
+{
+	return m_vertices;
+}
+
+const std::vector<GLushort>& Geometry::getElements()
+{
+	return m_elements;
+}
+
 bool Geometry::isInitilized()
 {
 	return m_hasUploaded;
@@ -76,6 +111,7 @@ bool Geometry::isInitilized()
 
 void Geometry::addVertex(float x, float y, float z, float w)
 {
+	m_hasLocalBoundingBox = false;
 	m_vertices.push_back(glm::vec4(x,y,z,w));
 }
 
@@ -96,6 +132,7 @@ void Geometry::addElement(GLushort element1)
 
 void Geometry::setVertices(std::vector<glm::vec4> vertices)
 {
+	m_hasLocalBoundingBox = false;
 	this->m_vertices = vertices;
 }
 
@@ -193,11 +230,13 @@ void Geometry::render()
 
 		GLuint size = GLuint(this->m_elements.size());
 		glDrawElements(GL_TRIANGLES, size, GL_UNSIGNED_SHORT, 0);
+		RenderStats::addDrawCall(size / 3);
 		//CHECK_GL_ERROR_LINE_FILE();
 	}
 	else
 	{
 		glDrawArrays(GL_TRIANGLES, 0, (GLsizei)this->m_vertices.size());
+		RenderStats::addDrawCall(GLuint(this->m_vertices.size() / 3));
 	}
 
 	if (this->m_vbo_normals != 0)
@@ -223,6 +262,51 @@ void Geometry::render()
 	glDisable(GL_BLEND);
 }
 
+void Geometry::renderDepth()
+{
+	if (!isEnabled() || !m_hasUploaded || m_vbo_vertices == 0)
+	{
+		return;
+	}
+
+	// A second vertex array with only the positions, so the depth pass does not depend on the attribute layout of the shaded programs
+	if (m_depthVao == 0)
+	{
+		glGenVertexArrays(1, &m_depthVao);
+		s_numGLObjects++;
+		glBindVertexArray(m_depthVao);
+
+		glBindBuffer(GL_ARRAY_BUFFER, m_vbo_vertices);
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 0, 0);
+
+		if (m_ibo_elements != 0)
+		{
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ibo_elements);
+		}
+
+		glBindVertexArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	}
+
+	glBindVertexArray(m_depthVao);
+
+	if (m_ibo_elements != 0)
+	{
+		GLuint size = GLuint(m_elements.size());
+		glDrawElements(GL_TRIANGLES, size, GL_UNSIGNED_SHORT, 0);
+		RenderStats::addDrawCall(size / 3);
+	}
+	else
+	{
+		glDrawArrays(GL_TRIANGLES, 0, (GLsizei)m_vertices.size());
+		RenderStats::addDrawCall(GLuint(m_vertices.size() / 3));
+	}
+
+	glBindVertexArray(0);
+}
+
 void Geometry::draw_bbox()
 {
 	if (this->m_vertices.size() == 0)
@@ -301,6 +385,9 @@ void Geometry::draw_bbox()
 	glDrawElements(GL_LINE_LOOP, 4, GL_UNSIGNED_SHORT, 0);
 	glDrawElements(GL_LINE_LOOP, 4, GL_UNSIGNED_SHORT, (GLvoid*)(4 * sizeof(GLushort)));
 	glDrawElements(GL_LINES, 8, GL_UNSIGNED_SHORT, (GLvoid*)(8 * sizeof(GLushort)));
+	RenderStats::addDrawCall(0);
+	RenderStats::addDrawCall(0);
+	RenderStats::addDrawCall(0);
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 
 	glDisableVertexAttribArray(m_attribute_v_coord);
@@ -364,6 +451,11 @@ bool Geometry::initShaders(GLint program)
 	return true;
 }
 
+size_t Geometry::getNumGLObjects()
+{
+	return s_numGLObjects;
+}
+
 void Geometry::upload()
 {
 	m_hasUploaded = true;
@@ -372,6 +464,7 @@ void Geometry::upload()
 	{
 		// Create a Vertex Array Object that will handle all VBO:s of this Geometry
 		glGenVertexArrays(1, &m_vao);
+		s_numGLObjects++;
 		//CHECK_GL_ERROR_LINE_FILE();
 		glBindVertexArray(m_vao);
 		//CHECK_GL_ERROR_LINE_FILE();
@@ -380,6 +473,7 @@ void Geometry::upload()
 	if (this->m_vertices.size() > 0)
 	{
 		glGenBuffers(1, &this->m_vbo_vertices);
+		s_numGLObjects++;
 		glBindBuffer(GL_ARRAY_BUFFER, this->m_vbo_vertices);
 		glBufferData(GL_ARRAY_BUFFER, this->m_vertices.size() * sizeof(this->m_vertices[0]),
 			this->m_vertices.data(), GL_STATIC_DRAW);
@@ -389,6 +483,7 @@ void Geometry::upload()
 	if (this->m_normals.size() > 0)
 	{
 		glGenBuffers(1, &this->m_vbo_normals);
+		s_numGLObjects++;
 		glBindBuffer(GL_ARRAY_BUFFER, this->m_vbo_normals);
 		glBufferData(GL_ARRAY_BUFFER, this->m_normals.size() * sizeof(this->m_normals[0]),this->m_normals.data(), GL_STATIC_DRAW);
 		//CHECK_GL_ERROR_LINE_FILE();
@@ -397,6 +492,7 @@ void Geometry::upload()
 	if (this->m_texCoords.size() > 0)
 	{
 		glGenBuffers(1, &this->m_vbo_texCoords);
+		s_numGLObjects++;
 		glBindBuffer(GL_ARRAY_BUFFER, this->m_vbo_texCoords);
 		glBufferData(GL_ARRAY_BUFFER, this->m_texCoords.size() * sizeof(this->m_texCoords[0]),this->m_texCoords.data(), GL_STATIC_DRAW);
 		//CHECK_GL_ERROR_LINE_FILE();
@@ -427,6 +523,7 @@ void Geometry::upload()
 	if (this->m_elements.size() > 0)
 	{
 		glGenBuffers(1, &this->m_ibo_elements);
+		s_numGLObjects++;
 		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->m_ibo_elements);
 		glBufferData(GL_ELEMENT_ARRAY_BUFFER, this->m_elements.size() * sizeof(this->m_elements[0]),this->m_elements.data(), GL_STATIC_DRAW);
 		//CHECK_GL_ERROR_LINE_FILE();
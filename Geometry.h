@@ -62,11 +62,33 @@ class Geometry : public Node
 		/// </summary>
 		void render();
 
+		/// <summary>
+		/// Renders only the positions, bound to attribute location 0, for depth only passes.
+		/// No state or shader attributes are touched
+		/// </summary>
+		void renderDepth();
+
 		/// <summary>
 		/// Draws a bounding box around the object
 		/// </summary>
 		void draw_bbox();
 
+		/// <summary>
+		/// Returns the bounding box of the vertices in object space, calculated once
+		/// </summary>
+		/// <returns>The bounding box</returns>
+		BoundingBox getLocalBoundingBox();
+
+		/// <summary>
+		/// Returns the vertices in object space
+		/// </summary>
+		const std::vector<glm::vec4>& getVertices();
+
+		/// <summary>
+		/// Returns the elements, three per triangle
+		/// </summary>
+		const std::vector<GLushort>& getElements();
+
 		/// <summary>
 		/// Checks if the geometry is initilized
 		/// </summary>
@@ -134,7 +156,14 @@ class Geometry : public Node
 		/// <returns> A flag if the shaders initilized correctly or not </returns>
 		bool initShaders(GLint program);
 
+		/// <summary>
+		/// Returns the amount of buffers and vertex arrays held by all geometries, to check that unloading releases them
+		/// </summary>
+		static size_t getNumGLObjects();
+
 	private:
+		static size_t s_numGLObjects;
+
 		std::vector<glm::vec4> m_vertices;
 		std::vector<glm::vec3> m_normals;
 		std::vector<glm::vec2> m_texCoords;
@@ -145,6 +174,10 @@ class Geometry : public Node
 		GLuint m_vbo_texCoords;
 		GLuint m_ibo_elements;
 		GLuint m_vao;
+		GLuint m_depthVao;
+
+		BoundingBox m_localBoundingBox;
+		bool m_hasLocalBoundingBox;
 
 		GLint m_attribute_v_coord;
 		GLint m_attribute_v_normal;
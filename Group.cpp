@@ -16,7 +16,14 @@ Group::~Group()
 
 void Group::addChild(std::shared_ptr<Node> n)
 {
+	//Children of a dynamic node move with it
+	if(isDynamic())
+	{
+		n->setDynamic(true);
+	}
+
 	m_children.push_back(n);
+	markChanged();
 }
 
 void Group::accept(NodeVisitor &v)
@@ -62,6 +69,7 @@ std::shared_ptr<Node> Group::removeChildAt(int index)
 {
 	std::shared_ptr<Node> child = m_children[index];
 	m_children.erase(m_children.begin() + index);
+	markChanged();
 	return child;
 }
 
@@ -78,4 +86,19 @@ std::shared_ptr<Node> Group::getChild(int i)
 std::vector<std::shared_ptr<Node>> Group::getChildren()
 {
 	return m_children;
-}
\ No newline at end of file
+}
+
+int Group::getNumChildren()
+{
+	return int(m_children.size());
+}
+
+void Group::setDynamic(bool flag)
+{
+	Node::setDynamic(flag);
+
+	for (auto child : m_children)
+	{
+		child->setDynamic(flag);
+	}
+}
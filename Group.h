@@ -59,7 +59,8 @@ class Group : public Node
         std::shared_ptr<Node> removeChildAt(int index);
 
         /// <summary>
-		/// Sets a child at index
+		/// Sets a child at index. Meant for reordering the children, so it does not
+		/// invalidate cached static data
 		/// </summary>
         /// <param name="index">Sets a child at index</param>
         /// <param name="child">The child</param>
@@ -78,6 +79,18 @@ class Group : public Node
         /// <returns>A children vector</returns>
 		std::vector<std::shared_ptr<Node>> getChildren();
 
+        /// <summary>
+		/// Returns the amount of children
+		/// </summary>
+        /// <returns>The amount of children</returns>
+		int getNumChildren();
+
+        /// <summary>
+		/// Sets the node and all of its children as dynamic, given by Node
+		/// </summary>
+        /// <param name="flag">The flag</param>
+        virtual void setDynamic(bool flag) override;
+
     private:
         std::vector<std::shared_ptr<Node>> m_children;
         BoundingBox m_cachedBoundingBox;
@@ -0,0 +1,261 @@
+#include "Impostors.h"
+#include "Camera.h"
+#include "Group.h"
+#include "OrthographicCamera.h"
+#include "Profiler.h"
+#include "RenderStats.h"
+#include "RenderTargetPool.h"
+#include "RenderVisitor.h"
+#include "State.h"
+#include "Texture.h"
+#include "Transform.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+Impostors::Impostors(std::shared_ptr<Camera> camera, std::shared_ptr<RenderTargetPool> pool) :
+    m_camera(camera),
+    m_pool(pool),
+    m_renderVisitor(std::shared_ptr<RenderVisitor>(new RenderVisitor())),
+    m_instanceBuffer(0),
+    m_instanceCapacity(0),
+    m_vao(0)
+{
+    //The atlas is kept for the lifetime of the impostors, like the shadow map
+    m_atlas = m_pool->acquire({ ATLAS_SIZE, ATLAS_SIZE, 1, GL_RGBA8, 0, false }, ATLAS_SLOT);
+
+    glCreateBuffers(1, &m_instanceBuffer);
+
+    //The quads are made in the vertex shader, the vertex array only has to exist
+    glGenVertexArrays(1, &m_vao);
+}
+
+Impostors::~Impostors()
+{
+    if(m_atlas)
+    {
+        m_pool->release(m_atlas);
+    }
+
+    glDeleteBuffers(1, &m_instanceBuffer);
+    glDeleteVertexArrays(1, &m_vao);
+}
+
+bool Impostors::add(std::shared_ptr<Transform> subtree, const std::string& model, float distance, std::shared_ptr<State> bakeState)
+{
+    PROFILE_FUNCTION();
+
+    if(!m_atlas)
+    {
+        return false;
+    }
+
+    auto found = m_modelIndices.find(model);
+    if(found == m_modelIndices.end())
+    {
+        Model baked;
+        if(!bake(subtree, bakeState, baked))
+        {
+            return false;
+        }
+
+        found = m_modelIndices.insert({ model, (unsigned int)m_models.size() }).first;
+        m_models.push_back(baked);
+    }
+
+    m_instances.push_back({ subtree, found->second, distance, false });
+    return true;
+}
+
+void Impostors::clear()
+{
+    for(auto& instance : m_instances)
+    {
+        instance.subtree->setHidden(false);
+    }
+
+    m_instances.clear();
+    m_models.clear();
+    m_modelIndices.clear();
+    m_instanceData.clear();
+}
+
+bool Impostors::bake(std::shared_ptr<Transform> subtree, std::shared_ptr<State> bakeState, Model& model)
+{
+    unsigned int firstTile = (unsigned int)m_models.size() * VIEWS;
+    if(firstTile + VIEWS > TILES_PER_ROW * TILES_PER_ROW)
+    {
+        std::cerr << "The impostor atlas is full, " << subtree->getName() << " is always drawn as geometry" << std::endl;
+        return false;
+    }
+
+    //The children are drawn without the transform of the subtree, so every instance can place the same views
+    std::shared_ptr<Group> root = std::shared_ptr<Group>(new Group(bakeState));
+    BoundingBox bounds;
+    for(auto child : subtree->getChildren())
+    {
+        root->addChild(child);
+        bounds.expand(child->calculateBoundingBox());
+    }
+
+    model.firstTile = firstTile;
+    model.center = bounds.getCenter();
+    model.radius = std::max(bounds.getRadius(), 1e-4f);
+
+    std::shared_ptr<Texture> depth = m_pool->acquire({ ATLAS_SIZE, ATLAS_SIZE, 1, GL_DEPTH_COMPONENT24, 0, false }, BAKE_DEPTH_SLOT);
+    GLuint framebuffer = depth ? m_pool->getFramebuffer(depth, m_atlas) : 0;
+    if(framebuffer == 0)
+    {
+        std::cerr << "Could not create the impostor bake target" << std::endl;
+        if(depth)
+        {
+            m_pool->release(depth);
+        }
+        return false;
+    }
+
+    std::shared_ptr<OrthographicCamera> camera = std::shared_ptr<OrthographicCamera>(new OrthographicCamera());
+    camera->setExtents(-model.radius, model.radius, -model.radius, model.radius);
+    camera->setNearFar(glm::vec2(model.radius, model.radius * 3.0f));
+    camera->setTarget(model.center);
+
+    GLuint program = bakeState->getProgram();
+
+    //Baking runs while loading, before the view enables depth testing and culling, so they are set here and restored after
+    GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+    GLboolean cullFace = glIsEnabled(GL_CULL_FACE);
+    GLboolean depthMask = GL_TRUE;
+    glGetBooleanv(GL_DEPTH_WRITEMASK, &depthMask);
+    glEnable(GL_DEPTH_TEST);
+    glEnable(GL_CULL_FACE);
+    glDepthMask(GL_TRUE);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glEnable(GL_SCISSOR_TEST);
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+
+    for(unsigned int view = 0; view < VIEWS; view++)
+    {
+        unsigned int tile = firstTile + view;
+        GLint x = (tile % TILES_PER_ROW) * TILE_SIZE;
+        GLint y = (tile / TILES_PER_ROW) * TILE_SIZE;
+
+        glViewport(x, y, TILE_SIZE, TILE_SIZE);
+        glScissor(x, y, TILE_SIZE, TILE_SIZE);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        //The same angles the vertex shader picks the views with, measured from the z axis
+        float angle = 6.28318530718f * float(view) / float(VIEWS);
+        camera->setPosition(model.center + glm::vec3(std::sin(angle), 0.0f, std::cos(angle)) * model.radius * 2.0f);
+
+        glUseProgram(program);
+        camera->init(program);
+        camera->apply(program);
+        glUseProgram(0);
+
+        m_renderVisitor->resetState();
+        m_renderVisitor->visit(*root);
+    }
+
+    glDisable(GL_SCISSOR_TEST);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    if(!depthTest)
+    {
+        glDisable(GL_DEPTH_TEST);
+    }
+    if(!cullFace)
+    {
+        glDisable(GL_CULL_FACE);
+    }
+    glDepthMask(depthMask);
+
+    glm::uvec2 screenSize = m_camera->getScreenSize();
+    glViewport(0, 0, screenSize.x, screenSize.y);
+
+    m_pool->release(depth);
+    return true;
+}
+
+void Impostors::update(Node &n)
+{
+    PROFILE_FUNCTION();
+
+    m_instanceData.clear();
+    if(!m_camera || m_instances.empty())
+    {
+        return;
+    }
+
+    glm::vec3 eye = m_camera->getPosition();
+
+    for(auto& instance : m_instances)
+    {
+        const Model& model = m_models[instance.model];
+        glm::mat4 object2world = instance.subtree->getModelMatrix();
+
+        glm::vec3 center = glm::vec3(object2world * glm::vec4(model.center, 1.0f));
+        float distance = glm::distance(eye, center);
+
+        //Once drawn as an impostor the subtree has to come 10% closer before it is drawn as geometry again
+        bool impostor = distance > instance.distance * (instance.impostor ? 0.9f : 1.0f);
+        if(impostor != instance.impostor)
+        {
+            instance.subtree->setHidden(impostor);
+            instance.impostor = impostor;
+        }
+
+        if(impostor)
+        {
+            float scale = std::max(glm::length(glm::vec3(object2world[0])), std::max(glm::length(glm::vec3(object2world[1])), glm::length(glm::vec3(object2world[2]))));
+            float yaw = std::atan2(object2world[2][0], object2world[2][2]);
+
+            m_instanceData.push_back(glm::vec4(center, model.radius * scale));
+            m_instanceData.push_back(glm::vec4(yaw, float(model.firstTile), 0.0f, 0.0f));
+        }
+    }
+
+    if(m_instanceData.empty())
+    {
+        return;
+    }
+
+    size_t size = m_instanceData.size() * sizeof(glm::vec4);
+    if(size > m_instanceCapacity)
+    {
+        m_instanceCapacity = std::max(size, m_instanceCapacity * 2);
+        glNamedBufferData(m_instanceBuffer, m_instanceCapacity, nullptr, GL_DYNAMIC_DRAW);
+    }
+
+    glNamedBufferSubData(m_instanceBuffer, 0, size, m_instanceData.data());
+}
+
+void Impostors::render(GLuint program)
+{
+    if(m_instanceData.empty())
+    {
+        return;
+    }
+
+    glUseProgram(program);
+    glUniform1i(glGetUniformLocation(program, "impostorAtlas"), ATLAS_SLOT);
+    glUniform1i(glGetUniformLocation(program, "impostorTilesPerRow"), TILES_PER_ROW);
+
+    m_atlas->bind();
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, INSTANCE_BINDING, m_instanceBuffer);
+
+    glBindVertexArray(m_vao);
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, GLsizei(m_instanceData.size() / 2));
+    glBindVertexArray(0);
+    RenderStats::addDrawCall(1);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, INSTANCE_BINDING, 0);
+    m_atlas->unbind();
+    glUseProgram(0);
+}
+
+unsigned int Impostors::getNumVisible()
+{
+    return (unsigned int)(m_instanceData.size() / 2);
+}
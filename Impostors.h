@@ -0,0 +1,126 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "UpdateCallback.h"
+
+class Camera;
+class Group;
+class RenderTargetPool;
+class RenderVisitor;
+class State;
+class Texture;
+class Transform;
+
+/// <summary>
+/// Draws distant subtrees as impostors. Every model is rendered once, at load time, from 8 directions around its y axis
+/// into tiles of one shared atlas. Subtrees further from the camera than their distance are hidden from the camera passes
+/// and drawn as a quad turned towards the camera that shows the baked view closest to the direction it is seen from.
+/// All impostors share the atlas, so they are drawn together with one instanced draw of the billboard program. A subtree
+/// only changes back once it is 10% closer than its distance, so objects at the distance do not flicker. Hidden subtrees
+/// still cast their shadows, and swapping them is not a change to the static scene.
+/// </summary>
+class Impostors : public UpdateCallback
+{
+    public:
+        /// <summary>
+        /// Constructor
+        /// </summary>
+        /// <param name="camera">The camera the distances are measured from</param>
+        /// <param name="pool">The pool the atlas and the depth used for baking are taken from</param>
+        Impostors(std::shared_ptr<Camera> camera, std::shared_ptr<RenderTargetPool> pool);
+
+        /// <summary>
+        /// Destructor
+        /// </summary>
+        ~Impostors();
+
+        /// <summary>
+        /// Adds a subtree, baking the views of its model the first time the model is seen. The subtree is drawn in the
+        /// space of its own transform for the bake, so instances of a model can be placed, turned and scaled freely
+        /// </summary>
+        /// <param name="subtree">The subtree, placed by its transform</param>
+        /// <param name="model">The name the views are shared under, usually the file the subtree was loaded from</param>
+        /// <param name="distance">The distance beyond which the impostor is drawn</param>
+        /// <param name="bakeState">The state the views are rendered with, a program and the lights</param>
+        /// <returns>Flag for if the subtree has an impostor, false when the atlas is full</returns>
+        bool add(std::shared_ptr<Transform> subtree, const std::string& model, float distance, std::shared_ptr<State> bakeState);
+
+        /// <summary>
+        /// Removes all subtrees and baked views
+        /// </summary>
+        void clear();
+
+        /// <summary>
+        /// Swaps subtrees for impostors by their distance and uploads the instances, given by UpdateCallback
+        /// </summary>
+        void update(Node &n) override;
+
+        /// <summary>
+        /// Draws every impostor with one instanced draw
+        /// </summary>
+        /// <param name="program">The billboard program compiled with IMPOSTOR, with the camera applied</param>
+        void render(GLuint program);
+
+        /// <summary>
+        /// Returns the amount of impostors drawn in the last update
+        /// </summary>
+        unsigned int getNumVisible();
+
+    private:
+        static const unsigned int VIEWS = 8;
+        static const unsigned int TILE_SIZE = 128;
+        static const unsigned int ATLAS_SIZE = 2048;
+        static const unsigned int TILES_PER_ROW = ATLAS_SIZE / TILE_SIZE;
+        static const unsigned int ATLAS_SLOT = 26;
+        static const unsigned int BAKE_DEPTH_SLOT = 27;
+        static const unsigned int INSTANCE_BINDING = 8;
+
+        /// <summary>
+        /// The baked views of a model, and its bounds in the space of its subtree
+        /// </summary>
+        struct Model
+        {
+            unsigned int firstTile;
+            glm::vec3 center;
+            float radius;
+        };
+
+        /// <summary>
+        /// A subtree that is swapped for an impostor
+        /// </summary>
+        struct Instance
+        {
+            std::shared_ptr<Transform> subtree;
+            unsigned int model;
+            float distance;
+            bool impostor;
+        };
+
+        std::shared_ptr<Camera> m_camera;
+        std::shared_ptr<RenderTargetPool> m_pool;
+        std::shared_ptr<RenderVisitor> m_renderVisitor;
+        std::shared_ptr<Texture> m_atlas;
+
+        std::map<std::string, unsigned int> m_modelIndices;
+        std::vector<Model> m_models;
+        std::vector<Instance> m_instances;
+
+        //Two vec4 per visible impostor, see shaders/billboard-shading.vert.glsl
+        std::vector<glm::vec4> m_instanceData;
+        GLuint m_instanceBuffer;
+        size_t m_instanceCapacity;
+        GLuint m_vao;
+
+        /// <summary>
+        /// Renders the views of a subtree into the next free tiles of the atlas
+        /// </summary>
+        /// <returns>Flag for if the views were baked</returns>
+        bool bake(std::shared_ptr<Transform> subtree, std::shared_ptr<State> bakeState, Model& model);
+};
@@ -1,6 +1,7 @@
 #include "LOD.h"
 #include "Camera.h"
-#include <iostream>
+#include <algorithm>
+#include <cmath>
 #include <glm/glm.hpp>
 
 LOD::LOD() : Transform()
@@ -11,7 +12,7 @@ LOD::LOD(std::shared_ptr<State> state) : Transform(state)
 {
 }
 
-LOD::LOD(std::shared_ptr<Camera> camera) : m_camera(camera), m_radius(0), m_center(glm::vec3(0)), m_distances(), m_levels(0)
+LOD::LOD(std::shared_ptr<Camera> camera) : m_camera(camera)
 {
 }
 
@@ -20,38 +21,97 @@ LOD::~LOD()
 }
 
 void LOD::addChild(std::shared_ptr<Node> child)
+{
+    float error = 0;
+    if(!m_errors.empty())
+    {
+        error = std::max(m_errors.back() * 2.0f, m_localBounds.getRadius() * 0.01f);
+    }
+
+    addChild(child, error);
+}
+
+void LOD::addChild(std::shared_ptr<Node> child, float error)
 {
     Group::addChild(child);
 
-    BoundingBox b = calculateBoundingBox();
-    m_radius = b.getRadius();
-    m_center = b.getCenter();
-    m_levels = m_levels+1;
-    m_distances.push_back(135 - m_levels);
+    //All levels cover the same object, the bounds are only calculated once per child
+    m_localBounds.expand(child->calculateBoundingBox());
+    m_errors.push_back(error);
+
+    //Full detail is shown until the first selection, coarser levels start hidden
+    if(m_errors.size() == 1)
+    {
+        m_level = 0;
+    }
+    child->setEnabled(int(m_errors.size()) - 1 == m_level);
 }
 
 void LOD::update(Node &n)
 {
-    if(getChildren().size() < m_levels)
+    if(!m_camera)
     {
         return;
     }
 
-    glm::vec3 position = m_center;
-    float distance = glm::distance(m_camera->getPosition(), position);
+    glm::uvec2 screenSize = m_camera->getScreenSize();
+    float pixelsPerUnit = float(screenSize.y) * 0.5f / std::tan(glm::radians(m_camera->getFov()) * 0.5f);
 
-    for(int i = m_levels-1; i >= 0; i--)
+    selectLevel(m_camera->getPosition(), pixelsPerUnit, 1.0f, 0.2f);
+}
+
+int LOD::selectLevel(const glm::vec3& eye, float pixelsPerUnit, float threshold, float band)
+{
+    int levels = int(m_errors.size());
+    if(levels == 0 || getNumChildren() < levels)
     {
-        std::cout << distance << ", " << m_distances[i] << std::endl;
-        if(distance < m_distances[i])
-        {
-            for(int j = m_levels-1; j >= 0; j--)
-            {
-                getChild(j)->setEnabled(false);
-            }
+        return m_level;
+    }
 
-            getChild(i)->setEnabled(true);
+    glm::mat4 object2world = getModelMatrix();
+    float scale = std::max(glm::length(glm::vec3(object2world[0])), std::max(glm::length(glm::vec3(object2world[1])), glm::length(glm::vec3(object2world[2]))));
+    glm::vec3 center = glm::vec3(object2world * glm::vec4(m_localBounds.getCenter(), 1.0f));
+
+    //The nearest point of the bounds, inside them every level is seen from up close
+    float distance = glm::distance(eye, center) - m_localBounds.getRadius() * scale;
+    float pixelsPerError = distance > 1e-4f ? scale * pixelsPerUnit / distance : 1e30f;
+
+    //Coarser levels than the current one have to be below the band, finer ones only have to stay inside it
+    int level = 0;
+    for(int i = levels - 1; i > 0; i--)
+    {
+        float limit = threshold * (i > m_level ? 1.0f - band : 1.0f + band);
+        if(m_errors[i] * pixelsPerError <= limit)
+        {
+            level = i;
             break;
         }
     }
-}
\ No newline at end of file
+
+    if(level != m_level)
+    {
+        setLevel(level);
+    }
+
+    return m_level;
+}
+
+void LOD::setLevel(int level)
+{
+    for(int i = 0; i < getNumChildren(); i++)
+    {
+        getChild(i)->setEnabled(i == level);
+    }
+
+    m_level = level;
+}
+
+int LOD::getLevel()
+{
+    return m_level;
+}
+
+int LOD::getNumLevels()
+{
+    return int(m_errors.size());
+}
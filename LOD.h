@@ -2,10 +2,16 @@
 #include "Transform.h"
 #include "UpdateCallback.h"
 
+#include <vector>
+
 class Camera;
 
 /// <summary>
-/// The LevelOfDetail class, handles the detail of objects within the subtree
+/// The LevelOfDetail class, shows one of its children depending on how large the error of each level would be on screen.
+/// Every level has a geometric error in object space, the largest distance between its surface and the full detail one.
+/// The coarsest level whose error projects to fewer pixels than the threshold is shown. Levels only change once the error
+/// is outside a band around the threshold, so an object at the switching distance does not pop back and forth. The camera
+/// position is taken in the space of the parent, transforms of the parents are not included.
 /// </summary>
 class LOD : public Transform, public UpdateCallback
 {
@@ -33,21 +39,56 @@ class LOD : public Transform, public UpdateCallback
         virtual ~LOD() override;
 
         /// <summary>
-        /// The update function for the LOD
+        /// The update function for the LOD, selects the level with the default threshold. Not needed when the LOD is
+        /// added to a LODSelector, which selects the levels of all its LODs at once
         /// </summary>
         /// <param name="n">The node</param>
         void update(Node &n) override;
 
         /// <summary>
-        /// Adds a child to the LOD group, given by Group
+        /// Adds a child to the LOD group, given by Group. The error is estimated as double the error of the previous level,
+        /// starting from a hundredth of the bounding radius for the second level
         /// </summary>
         /// <param name="n">The child</param>
         virtual void addChild(std::shared_ptr<Node> n) override;
 
+        /// <summary>
+        /// Adds a child as the next coarser level
+        /// </summary>
+        /// <param name="n">The child</param>
+        /// <param name="error">The geometric error of the level in object space, 0 for full detail</param>
+        void addChild(std::shared_ptr<Node> n, float error);
+
+        /// <summary>
+        /// Selects and enables the level to show
+        /// </summary>
+        /// <param name="eye">The camera position in the space of the parent</param>
+        /// <param name="pixelsPerUnit">Pixels covered by one unit at a distance of one unit in front of the camera</param>
+        /// <param name="threshold">The largest error in pixels to accept</param>
+        /// <param name="band">Fraction of the threshold the error has to cross before the level changes</param>
+        /// <returns>The level shown</returns>
+        int selectLevel(const glm::vec3& eye, float pixelsPerUnit, float threshold, float band);
+
+        /// <summary>
+        /// Returns the level currently shown, the first level until a selection changes it and -1 without levels
+        /// </summary>
+        int getLevel();
+
+        /// <summary>
+        /// Returns the amount of levels
+        /// </summary>
+        int getNumLevels();
+
     private:
         std::shared_ptr<Camera> m_camera;
-        float m_radius;
-        glm::vec3 m_center;
-        std::vector<float> m_distances;
-        int m_levels;
-};
\ No newline at end of file
+
+        //Bounds of the children, without the transform of the LOD
+        BoundingBox m_localBounds;
+        std::vector<float> m_errors;
+        int m_level = -1;
+
+        /// <summary>
+        /// Enables the level and disables the others
+        /// </summary>
+        void setLevel(int level);
+};
@@ -0,0 +1,66 @@
+#include "LODSelector.h"
+#include "LOD.h"
+#include "Camera.h"
+#include "Profiler.h"
+
+#include <cmath>
+
+LODSelector::LODSelector(std::shared_ptr<Camera> camera) : m_camera(camera)
+{
+}
+
+void LODSelector::add(std::shared_ptr<LOD> lod)
+{
+    m_lods.push_back(lod);
+}
+
+void LODSelector::clear()
+{
+    m_lods.clear();
+}
+
+void LODSelector::update(Node &n)
+{
+    PROFILE_FUNCTION();
+
+    m_lastChanges = 0;
+    if(!m_camera || m_lods.empty())
+    {
+        return;
+    }
+
+    //Pixels covered by one unit at a distance of one unit, the same for every LOD this frame
+    glm::uvec2 screenSize = m_camera->getScreenSize();
+    float pixelsPerUnit = float(screenSize.y) * 0.5f / std::tan(glm::radians(m_camera->getFov()) * 0.5f);
+    float threshold = std::exp2(m_bias);
+    glm::vec3 eye = m_camera->getPosition();
+
+    for(auto& lod : m_lods)
+    {
+        int level = lod->getLevel();
+        if(lod->selectLevel(eye, pixelsPerUnit, threshold, m_band) != level)
+        {
+            m_lastChanges++;
+        }
+    }
+}
+
+void LODSelector::setBias(float bias)
+{
+    m_bias = bias;
+}
+
+float LODSelector::getBias()
+{
+    return m_bias;
+}
+
+void LODSelector::setHysteresis(float band)
+{
+    m_band = band;
+}
+
+unsigned int LODSelector::getLastChanges()
+{
+    return m_lastChanges;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "UpdateCallback.h"
+
+#include <memory>
+#include <vector>
+
+class Camera;
+class LOD;
+
+/// <summary>
+/// Selects the levels of all LOD nodes in one update. The projection of the camera is worked out once per frame, each LOD
+/// then only compares the errors of its levels at its distance. The threshold is one pixel scaled by two to the power of
+/// the bias, so a positive bias switches to coarser levels sooner and a negative one keeps more detail.
+/// </summary>
+class LODSelector : public UpdateCallback
+{
+    public:
+        /// <summary>
+        /// Constructor
+        /// </summary>
+        /// <param name="camera">The camera the errors are projected with</param>
+        LODSelector(std::shared_ptr<Camera> camera);
+
+        /// <summary>
+        /// Adds a LOD to select the levels of
+        /// </summary>
+        /// <param name="lod">The LOD</param>
+        void add(std::shared_ptr<LOD> lod);
+
+        /// <summary>
+        /// Removes all LODs
+        /// </summary>
+        void clear();
+
+        /// <summary>
+        /// Selects the level of every LOD, given by UpdateCallback
+        /// </summary>
+        void update(Node &n) override;
+
+        /// <summary>
+        /// Sets the bias, the threshold in pixels is two to the power of the bias
+        /// </summary>
+        /// <param name="bias">The bias</param>
+        void setBias(float bias);
+
+        /// <summary>
+        /// Returns the bias
+        /// </summary>
+        float getBias();
+
+        /// <summary>
+        /// Sets the fraction of the threshold the error has to cross before a level changes
+        /// </summary>
+        /// <param name="band">The band, 0 switches exactly at the threshold</param>
+        void setHysteresis(float band);
+
+        /// <summary>
+        /// Returns the amount of level changes in the last update
+        /// </summary>
+        unsigned int getLastChanges();
+
+    private:
+        std::shared_ptr<Camera> m_camera;
+        std::vector<std::shared_ptr<LOD>> m_lods;
+        float m_bias = 0;
+        float m_band = 0.2f;
+        unsigned int m_lastChanges = 0;
+};
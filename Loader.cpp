@@ -25,11 +25,13 @@
 
 #include "Loader.h"
 #include "Group.h"
+#include "Profiler.h"
+#include "TextureStreamer.h"
 
 
 //Function declarations
 std::string findTexture(const std::string& texturePath, const std::string& modelPath);
-size_t extractMaterials(const aiScene *scene, std::vector<std::shared_ptr<Material>>& materials, std::vector<std::shared_ptr<Texture>>& texture, const std::string modelPath);
+size_t extractMaterials(const aiScene *scene, std::vector<std::shared_ptr<Material>>& materials, std::vector<std::shared_ptr<Texture>>& texture, const std::string modelPath, bool deferTextureUpload, TextureStreamer* streamer);
 glm::mat4 assimpToGlmMatrix(const aiMatrix4x4 &ai_matrix);
 void parseNodes(aiNode *root_node, std::vector<std::shared_ptr<Material>>& materials, std::vector<std::shared_ptr<Texture>>& texture, std::stack<glm::mat4>& transformStack, std::shared_ptr<Node>& node, const aiScene *aiScene);
 std::string pathToString(std::vector<std::string>& path);
@@ -101,7 +103,7 @@ std::string findTexture(const std::string& texturePath, const std::string& model
 	return ""; // Unable to find
 }
 
-size_t extractMaterials(const aiScene *scene, std::vector<std::shared_ptr<Material>>& materials, std::vector<std::shared_ptr<Texture>>& textures, const std::string modelPath)
+size_t extractMaterials(const aiScene *scene, std::vector<std::shared_ptr<Material>>& materials, std::vector<std::shared_ptr<Texture>>& textures, const std::string modelPath, bool deferTextureUpload, TextureStreamer* streamer)
 {
 	uint32_t num_materials = scene->mNumMaterials;
 	aiMaterial *ai_material;
@@ -144,10 +146,16 @@ size_t extractMaterials(const aiScene *scene, std::vector<std::shared_ptr<Materi
 			{
 				std::cerr << "Unable to find texture: " << path.C_Str() << std::endl;
 			}
+			else if (streamer)
+			{
+				textures.push_back(streamer->add(texturePath, 0));
+				textureFound = true;
+			}
 			else
 			{
 				std::shared_ptr<Texture> texture = std::shared_ptr<Texture>(new Texture());
-				if (!texture->create(texturePath.c_str(), 0))
+				bool created = deferTextureUpload ? texture->load(texturePath.c_str()) : texture->create(texturePath.c_str(), 0);
+				if (!created)
 				{
 					std::cerr << "Error creating texture: " << texturePath << std::endl;
 				}
@@ -299,8 +307,10 @@ void parseNodes(aiNode *root_node, std::vector<std::shared_ptr<Material>>& mater
 	transformStack.pop();
 }
 
-std::shared_ptr<Obj> loadObj(const std::string& filename)
+std::shared_ptr<Obj> loadObj(const std::string& filename, bool deferTextureUpload, TextureStreamer* streamer)
 {
+	PROFILE_FUNCTION();
+
 	std::string filepath = filename;
 	bool exist = vr::FileSystem::exists(filepath);
 
@@ -326,6 +336,7 @@ std::shared_ptr<Obj> loadObj(const std::string& filename)
 	std::vector<std::shared_ptr<Texture>> textures;
 
 	Assimp::Importer importer;
+	PROFILE_SCOPE("Assimp::ReadFile");
 	const aiScene* aiScene = importer.ReadFile(filepath,aiProcess_CalcTangentSpace | aiProcess_GenSmoothNormals |  aiProcess_Triangulate | aiProcess_JoinIdenticalVertices | aiProcess_SortByPType);
 
 	if (!aiScene)
@@ -336,13 +347,17 @@ std::shared_ptr<Obj> loadObj(const std::string& filename)
 
 	aiNode *root_node = aiScene->mRootNode;
 
-	extractMaterials(aiScene, materials, textures, filename);
+	{
+		PROFILE_SCOPE("extractMaterials");
+		extractMaterials(aiScene, materials, textures, filename, deferTextureUpload, streamer);
+	}
 	std::cout << "Found " << materials.size() << " materials" << std::endl;
 
 	std::stack<glm::mat4> transformStack;
 	transformStack.push(glm::mat4());
 
 	std::shared_ptr<Obj> obj = std::shared_ptr<Obj>(new Obj);
+	obj->filename = filename;
 	parseNodes(root_node, materials, textures, transformStack, obj, aiScene);
 	transformStack.pop();
 
@@ -440,8 +455,10 @@ std::string getAttribute(rapidxml::xml_node<> * node, const std::string& attribu
   	return attrib->value();
 }
 
-bool loadXml(const std::string& sceneFile, std::shared_ptr<XmlScene>& scene)
+bool loadXml(const std::string& sceneFile, std::shared_ptr<XmlScene>& scene, TextureStreamer* streamer)
 {
+	PROFILE_FUNCTION();
+
   	std::string filepath = sceneFile;
   	bool exist = vr::FileSystem::exists(filepath);
 
@@ -466,6 +483,7 @@ bool loadXml(const std::string& sceneFile, std::shared_ptr<XmlScene>& scene)
 
 	rapidxml::xml_node<> * root_node=nullptr;
 	std::vector<std::string> xmlpath;
+	std::vector<XmlNode> nodes;
 
 	try
 	{
@@ -481,6 +499,30 @@ bool loadXml(const std::string& sceneFile, std::shared_ptr<XmlScene>& scene)
 		}
 
 		xmlpath.push_back("scene");
+
+		//World partition, <scene partition="cell size" streamRadius="distance" memoryBudget="megabytes">
+		std::string partition = getAttribute(root_node, "partition");
+		if (!partition.empty())
+		{
+			scene->cellSize = readValue<float>(partition);
+			std::string streamRadius = getAttribute(root_node, "streamRadius");
+			std::string memoryBudget = getAttribute(root_node, "memoryBudget");
+			scene->streamRadius = streamRadius.empty() ? 0 : readValue<float>(streamRadius);
+			scene->memoryBudget = memoryBudget.empty() ? scene->memoryBudget : readValue<float>(memoryBudget);
+
+			if (scene->cellSize <= 0 || scene->streamRadius < 0 || scene->memoryBudget <= 0)
+			{
+				throw std::runtime_error("Invalid partition, expected a positive cell size, stream radius and memory budget in: " + pathToString(xmlpath));
+			}
+		}
+
+		//Impostor distance for every node, a node can give its own
+		float sceneImpostorDistance = 0;
+		std::string sceneImpostor = getAttribute(root_node, "impostor");
+		if (!sceneImpostor.empty())
+		{
+			sceneImpostorDistance = readValue<float>(sceneImpostor);
+		}
 		// Iterate over the nodes
 		for (rapidxml::xml_node<> * node_node = root_node->first_node("node"); node_node; node_node = node_node->next_sibling())
 		{
@@ -493,6 +535,32 @@ bool loadXml(const std::string& sceneFile, std::shared_ptr<XmlScene>& scene)
 
 			std::string name = getAttribute(node_node, "name");
 
+			float impostorDistance = sceneImpostorDistance;
+			std::string impostor = getAttribute(node_node, "impostor");
+			if (!impostor.empty())
+			{
+				impostorDistance = readValue<float>(impostor);
+			}
+
+			if (impostorDistance < 0)
+			{
+				throw std::runtime_error("Node (" + name + ") Invalid impostor distance in: " + pathToString(xmlpath));
+			}
+
+			//Optional automatic LOD, the triangle ratios of the levels below full detail
+			std::vector<float> lodRatios;
+			std::vector<std::string> lodTokens;
+			tokenize(getAttribute(node_node, "lod"), lodTokens, " ", true);
+			for (auto token : lodTokens)
+			{
+				float ratio = readValue<float>(token);
+				if (ratio <= 0 || ratio >= 1 || (!lodRatios.empty() && ratio >= lodRatios.back()))
+				{
+					throw std::runtime_error("Node (" + name + ") Invalid lod, expected decreasing ratios between 0 and 1 in: " + pathToString(xmlpath));
+				}
+				lodRatios.push_back(ratio);
+			}
+
 			rapidxml::xml_node<> * file = node_node->first_node("file");
 
 			if (!file)
@@ -537,26 +605,23 @@ bool loadXml(const std::string& sceneFile, std::shared_ptr<XmlScene>& scene)
 					throw std::runtime_error("Node (" + name + ") Invalid scale in: " + pathToString(xmlpath));
 				}
 
-				// Now create the node
-				std::shared_ptr<Obj> loadedObj = loadObj(path);
-				if (!loadedObj)
-				{
-					std::cerr << "Unable to load node \'" << name << "\' path: " << path << std::endl;
-				}
-				else
-				{
-					glm::mat4 mt = glm::translate(glm::mat4(), t_vec);
-					glm::mat4 ms = glm::scale(glm::mat4(), s_vec);
-					glm::mat4 rx = glm::rotate(glm::mat4(), glm::radians(r_vec.x), glm::vec3(1, 0, 0));
-					glm::mat4 ry = glm::rotate(glm::mat4(), glm::radians(r_vec.y), glm::vec3(0, 1, 0));
-					glm::mat4 rz = glm::rotate(glm::mat4(), glm::radians(r_vec.z), glm::vec3(0, 0, 1));
-
-					auto t = mt * rz * ry * rx;
-					t = glm::scale(t, s_vec);
-					loadedObj->initialTransform = t;
-					loadedObj->name = name;
-					scene->objects.push_back(loadedObj);
-				}
+				glm::mat4 mt = glm::translate(glm::mat4(), t_vec);
+				glm::mat4 ms = glm::scale(glm::mat4(), s_vec);
+				glm::mat4 rx = glm::rotate(glm::mat4(), glm::radians(r_vec.x), glm::vec3(1, 0, 0));
+				glm::mat4 ry = glm::rotate(glm::mat4(), glm::radians(r_vec.y), glm::vec3(0, 1, 0));
+				glm::mat4 rz = glm::rotate(glm::mat4(), glm::radians(r_vec.z), glm::vec3(0, 0, 1));
+
+				auto t = mt * rz * ry * rx;
+				t = glm::scale(t, s_vec);
+
+				XmlNode xmlNode;
+				xmlNode.name = name;
+				xmlNode.path = path;
+				xmlNode.initialTransform = t;
+				xmlNode.lodRatios = lodRatios;
+				xmlNode.impostorDistance = impostorDistance;
+				xmlNode.stream = getAttribute(node_node, "stream") != "false";
+				nodes.push_back(xmlNode);
 
 				xmlpath.pop_back(); // transform
 			}
@@ -575,6 +640,30 @@ bool loadXml(const std::string& sceneFile, std::shared_ptr<XmlScene>& scene)
 		return false;
 	}
 
+	// Now create the nodes, a partitioned scene leaves most of them to the world partition
+	for (auto& node : nodes)
+	{
+		if (scene->cellSize > 0 && node.stream)
+		{
+			scene->streamedNodes.push_back(node);
+			continue;
+		}
+
+		std::shared_ptr<Obj> loadedObj = loadObj(node.path, false, streamer);
+		if (!loadedObj)
+		{
+			std::cerr << "Unable to load node \'" << node.name << "\' path: " << node.path << std::endl;
+		}
+		else
+		{
+			loadedObj->initialTransform = node.initialTransform;
+			loadedObj->name = node.name;
+			loadedObj->lodRatios = node.lodRatios;
+			loadedObj->impostorDistance = node.impostorDistance;
+			scene->objects.push_back(loadedObj);
+		}
+	}
+
 	return true;
 }
 
@@ -22,14 +22,46 @@ struct Mesh
 struct Obj
 {
 	std::string name;
+	std::string filename;
 	std::vector<Mesh> meshes;
 	glm::mat4 initialTransform;
+	//Triangle ratios of the levels to generate, empty when the object has no LOD
+	std::vector<float> lodRatios;
+	//Distance beyond which the object is drawn as an impostor, 0 when it is always drawn
+	float impostorDistance = 0;
+};
+
+//A <node> of a scene file, kept for the nodes the world partition streams in later
+struct XmlNode
+{
+	std::string name;
+	std::string path;
+	glm::mat4 initialTransform;
+	std::vector<float> lodRatios;
+	float impostorDistance = 0;
+	//False for nodes that are loaded up front even in a partitioned scene, like a ground spanning every cell
+	bool stream = true;
 };
 
 struct XmlScene
 {
 	std::vector<std::shared_ptr<Obj>> objects;
+	//The nodes not in objects, streamed by the world partition
+	std::vector<XmlNode> streamedNodes;
+	//Size of the grid cells of the world partition, 0 when every node is loaded up front
+	float cellSize = 0;
+	//Cells closer to the camera than this are loaded, 0 uses three cells
+	float streamRadius = 0;
+	//Megabytes of streamed geometry and textures kept before distant cells are evicted
+	float memoryBudget = 512;
 };
 
-std::shared_ptr<Obj> loadObj(const std::string& filename);
-bool loadXml(const std::string& xmlFile, std::shared_ptr<XmlScene>& scene);
+class TextureStreamer;
+
+/// <summary>
+/// Loads a model. With deferTextureUpload the textures are only decoded, so the model can be loaded on a thread without
+/// an OpenGL context, and Texture::upload has to be called for them on the thread owning the context. With a streamer the
+/// textures are decoded and uploaded by it over the following frames instead
+/// </summary>
+std::shared_ptr<Obj> loadObj(const std::string& filename, bool deferTextureUpload = false, TextureStreamer* streamer = nullptr);
+bool loadXml(const std::string& xmlFile, std::shared_ptr<XmlScene>& scene, TextureStreamer* streamer = nullptr);
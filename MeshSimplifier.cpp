@@ -0,0 +1,406 @@
+#include "MeshSimplifier.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <queue>
+#include <tuple>
+
+MeshSimplifier::Quadric::Quadric() : a2(0), ab(0), ac(0), ad(0), b2(0), bc(0), bd(0), c2(0), cd(0), d2(0)
+{
+}
+
+MeshSimplifier::Quadric::Quadric(const glm::dvec3& n, double d) :
+    a2(n.x * n.x), ab(n.x * n.y), ac(n.x * n.z), ad(n.x * d),
+    b2(n.y * n.y), bc(n.y * n.z), bd(n.y * d),
+    c2(n.z * n.z), cd(n.z * d),
+    d2(d * d)
+{
+}
+
+void MeshSimplifier::Quadric::scale(double s)
+{
+    a2 *= s; ab *= s; ac *= s; ad *= s;
+    b2 *= s; bc *= s; bd *= s;
+    c2 *= s; cd *= s;
+    d2 *= s;
+}
+
+void MeshSimplifier::Quadric::add(const Quadric& o)
+{
+    a2 += o.a2; ab += o.ab; ac += o.ac; ad += o.ad;
+    b2 += o.b2; bc += o.bc; bd += o.bd;
+    c2 += o.c2; cd += o.cd;
+    d2 += o.d2;
+}
+
+double MeshSimplifier::Quadric::evaluate(const glm::dvec3& p) const
+{
+    return a2 * p.x * p.x + 2 * ab * p.x * p.y + 2 * ac * p.x * p.z + 2 * ad * p.x
+         + b2 * p.y * p.y + 2 * bc * p.y * p.z + 2 * bd * p.y
+         + c2 * p.z * p.z + 2 * cd * p.z
+         + d2;
+}
+
+MeshSimplifier::MeshSimplifier() : m_conservative(false)
+{
+}
+
+void MeshSimplifier::setConservative(bool flag)
+{
+    m_conservative = flag;
+}
+
+void MeshSimplifier::weld(const Mesh& mesh)
+{
+    size_t count = mesh.vertices.size();
+
+    m_positions.resize(count);
+    m_welded.resize(count);
+    m_locked.assign(count, false);
+
+    //The loader joins identical vertices, so a position used by several vertices is a seam
+    std::map<std::tuple<float, float, float>, uint32_t> positions;
+    std::vector<uint32_t> uses;
+
+    for(size_t i = 0; i < count; i++)
+    {
+        const glm::vec4& v = mesh.vertices[i];
+        m_positions[i] = glm::dvec3(v);
+
+        auto inserted = positions.insert({ std::make_tuple(v.x, v.y, v.z), uint32_t(uses.size()) });
+        if(inserted.second)
+        {
+            uses.push_back(0);
+        }
+
+        m_welded[i] = inserted.first->second;
+        uses[m_welded[i]]++;
+    }
+
+    //Edges between positions with only one triangle are on an open border
+    std::map<std::pair<uint32_t, uint32_t>, uint32_t> edges;
+    for(size_t t = 0; t < m_triangles.size(); t += 3)
+    {
+        for(int e = 0; e < 3; e++)
+        {
+            uint32_t a = m_welded[m_triangles[t + e]];
+            uint32_t b = m_welded[m_triangles[t + (e + 1) % 3]];
+            edges[std::make_pair(std::min(a, b), std::max(a, b))]++;
+        }
+    }
+
+    std::vector<bool> lockedPositions(uses.size(), false);
+    for(auto& edge : edges)
+    {
+        if(edge.second == 1)
+        {
+            lockedPositions[edge.first.first] = true;
+            lockedPositions[edge.first.second] = true;
+        }
+    }
+
+    for(size_t i = 0; i < count; i++)
+    {
+        m_locked[i] = uses[m_welded[i]] > 1 || lockedPositions[m_welded[i]];
+    }
+}
+
+bool MeshSimplifier::isValid(uint32_t from, uint32_t to)
+{
+    const glm::dvec3& target = m_positions[to];
+    std::vector<uint32_t> fromNeighbours;
+    size_t shared = 0;
+
+    for(uint32_t t : m_vertexTriangles[from])
+    {
+        if(m_removedTriangles[t])
+        {
+            continue;
+        }
+
+        uint32_t* triangle = &m_triangles[t * 3];
+        bool hasTo = triangle[0] == to || triangle[1] == to || triangle[2] == to;
+
+        for(int e = 0; e < 3; e++)
+        {
+            if(triangle[e] != from)
+            {
+                fromNeighbours.push_back(m_welded[triangle[e]]);
+            }
+        }
+
+        if(hasTo)
+        {
+            shared++;
+            continue;
+        }
+
+        //The triangles that stay have to keep facing the same way
+        glm::dvec3 p[3];
+        glm::dvec3 q[3];
+        for(int e = 0; e < 3; e++)
+        {
+            p[e] = m_positions[triangle[e]];
+            q[e] = triangle[e] == from ? target : p[e];
+        }
+
+        glm::dvec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+        glm::dvec3 after = glm::cross(q[1] - q[0], q[2] - q[0]);
+        if(glm::dot(before, after) <= 0.0)
+        {
+            return false;
+        }
+
+        //In front of a plane the new triangles would bulge out of the mesh, the tolerance keeps flat areas collapsing
+        glm::dvec3 offset = target - p[0];
+        if(m_conservative && glm::dot(before, offset) > 1e-9 * glm::length(before) * glm::length(offset))
+        {
+            return false;
+        }
+    }
+
+    std::sort(fromNeighbours.begin(), fromNeighbours.end());
+    fromNeighbours.erase(std::unique(fromNeighbours.begin(), fromNeighbours.end()), fromNeighbours.end());
+
+    //Neighbours of both ends that are not on a triangle between them would pinch the surface
+    std::vector<uint32_t> toNeighbours;
+    for(uint32_t t : m_vertexTriangles[to])
+    {
+        if(m_removedTriangles[t])
+        {
+            continue;
+        }
+
+        for(int e = 0; e < 3; e++)
+        {
+            uint32_t v = m_triangles[t * 3 + e];
+            if(v != to && v != from)
+            {
+                toNeighbours.push_back(m_welded[v]);
+            }
+        }
+    }
+
+    std::sort(toNeighbours.begin(), toNeighbours.end());
+    toNeighbours.erase(std::unique(toNeighbours.begin(), toNeighbours.end()), toNeighbours.end());
+
+    size_t common = 0;
+    for(uint32_t v : toNeighbours)
+    {
+        if(v != m_welded[to] && std::binary_search(fromNeighbours.begin(), fromNeighbours.end(), v))
+        {
+            common++;
+        }
+    }
+
+    return shared > 0 && common <= shared;
+}
+
+size_t MeshSimplifier::collapse(uint32_t from, uint32_t to)
+{
+    size_t removed = 0;
+
+    for(uint32_t t : m_vertexTriangles[from])
+    {
+        if(m_removedTriangles[t])
+        {
+            continue;
+        }
+
+        uint32_t* triangle = &m_triangles[t * 3];
+        if(triangle[0] == to || triangle[1] == to || triangle[2] == to)
+        {
+            m_removedTriangles[t] = true;
+            removed++;
+            continue;
+        }
+
+        for(int e = 0; e < 3; e++)
+        {
+            if(triangle[e] == from)
+            {
+                triangle[e] = to;
+            }
+        }
+
+        m_vertexTriangles[to].push_back(t);
+    }
+
+    m_vertexTriangles[from].clear();
+    m_removedVertices[from] = true;
+    m_quadrics[to].add(m_quadrics[from]);
+    m_versions[to]++;
+
+    return removed;
+}
+
+float MeshSimplifier::simplify(const Mesh& mesh, size_t targetTriangles, Mesh& result)
+{
+    PROFILE_FUNCTION();
+
+    size_t count = mesh.vertices.size();
+
+    m_triangles.assign(mesh.elements.begin(), mesh.elements.end());
+    size_t triangles = m_triangles.size() / 3;
+    m_triangles.resize(triangles * 3);
+    m_removedTriangles.assign(triangles, false);
+
+    weld(mesh);
+
+    m_quadrics.assign(count, Quadric());
+    m_removedVertices.assign(count, false);
+    m_versions.assign(count, 0);
+    m_vertexTriangles.assign(count, std::vector<uint32_t>());
+
+    //Every vertex starts with the planes of the triangles around it, weighted by their area. Dividing by the area
+    //around the vertices turns the sum back into an average squared distance, so the cost does not depend on tessellation
+    std::vector<double> areas(count, 0.0);
+
+    for(uint32_t t = 0; t < triangles; t++)
+    {
+        uint32_t* triangle = &m_triangles[t * 3];
+        glm::dvec3 normal = glm::cross(m_positions[triangle[1]] - m_positions[triangle[0]], m_positions[triangle[2]] - m_positions[triangle[0]]);
+        double length = glm::length(normal);
+
+        if(length > 0.0)
+        {
+            normal /= length;
+            Quadric plane(normal, -glm::dot(normal, m_positions[triangle[0]]));
+            plane.scale(length * 0.5);
+
+            for(int e = 0; e < 3; e++)
+            {
+                m_quadrics[triangle[e]].add(plane);
+                areas[triangle[e]] += length * 0.5;
+            }
+        }
+
+        for(int e = 0; e < 3; e++)
+        {
+            m_vertexTriangles[triangle[e]].push_back(t);
+        }
+    }
+
+    std::priority_queue<Collapse> queue;
+    auto push = [&](uint32_t from, uint32_t to)
+    {
+        if(m_locked[from] || from == to)
+        {
+            return;
+        }
+
+        Quadric quadric = m_quadrics[from];
+        quadric.add(m_quadrics[to]);
+        double area = std::max(areas[from] + areas[to], 1e-12);
+        double cost = std::max(quadric.evaluate(m_positions[to]), 0.0) / area;
+
+        queue.push({ cost, from, to, m_versions[from], m_versions[to] });
+    };
+
+    for(uint32_t t = 0; t < triangles; t++)
+    {
+        for(int e = 0; e < 3; e++)
+        {
+            push(m_triangles[t * 3 + e], m_triangles[t * 3 + (e + 1) % 3]);
+            push(m_triangles[t * 3 + (e + 1) % 3], m_triangles[t * 3 + e]);
+        }
+    }
+
+    double maxCost = 0.0;
+    size_t remaining = triangles;
+
+    while(remaining > targetTriangles && !queue.empty())
+    {
+        Collapse c = queue.top();
+        queue.pop();
+
+        //Either end changed since this was calculated, a newer entry is in the queue
+        if(m_removedVertices[c.from] || m_removedVertices[c.to] || m_versions[c.from] != c.fromVersion || m_versions[c.to] != c.toVersion)
+        {
+            continue;
+        }
+
+        if(!isValid(c.from, c.to))
+        {
+            continue;
+        }
+
+        remaining -= collapse(c.from, c.to);
+        areas[c.to] += areas[c.from];
+        maxCost = std::max(maxCost, c.cost);
+
+        //The quadric of the vertex that stayed grew, the edges around it are queued again with its new version
+        for(uint32_t t : m_vertexTriangles[c.to])
+        {
+            if(m_removedTriangles[t])
+            {
+                continue;
+            }
+
+            for(int e = 0; e < 3; e++)
+            {
+                uint32_t v = m_triangles[t * 3 + e];
+                if(v != c.to)
+                {
+                    push(c.to, v);
+                    push(v, c.to);
+                }
+            }
+        }
+    }
+
+    //Only the vertices of the remaining triangles are kept
+    std::vector<int32_t> remap(count, -1);
+    result = Mesh();
+    result.object2world = mesh.object2world;
+    result.material = mesh.material;
+    result.texture = mesh.texture;
+
+    for(uint32_t t = 0; t < triangles; t++)
+    {
+        if(m_removedTriangles[t])
+        {
+            continue;
+        }
+
+        for(int e = 0; e < 3; e++)
+        {
+            uint32_t v = m_triangles[t * 3 + e];
+            if(remap[v] < 0)
+            {
+                remap[v] = int32_t(result.vertices.size());
+                result.vertices.push_back(mesh.vertices[v]);
+                result.normals.push_back(v < mesh.normals.size() ? mesh.normals[v] : glm::vec3(0));
+                result.texCoords.push_back(v < mesh.texCoords.size() ? mesh.texCoords[v] : glm::vec2(0));
+            }
+
+            result.elements.push_back(GLushort(remap[v]));
+        }
+    }
+
+    return float(std::sqrt(maxCost));
+}
+
+void MeshSimplifier::buildChain(const Mesh& mesh, const std::vector<float>& ratios, std::vector<Mesh>& levels, std::vector<float>& errors)
+{
+    PROFILE_FUNCTION();
+
+    size_t triangles = mesh.elements.size() / 3;
+    levels.resize(ratios.size());
+    errors.resize(ratios.size());
+
+    //Each level starts from the previous one, the error of every step adds up
+    const Mesh* previous = &mesh;
+    float error = 0;
+
+    for(size_t i = 0; i < ratios.size(); i++)
+    {
+        size_t target = size_t(std::max(0.0f, ratios[i]) * float(triangles));
+
+        error += simplify(*previous, target, levels[i]);
+        errors[i] = error;
+        previous = &levels[i];
+    }
+}
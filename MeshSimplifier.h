@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Loader.h"
+
+/// <summary>
+/// Reduces the triangles of a mesh with quadric error metric edge collapses. Every vertex gets the sum of the planes of
+/// the triangles around it, and the edge that moves the surface the least is collapsed first. Collapses move one vertex
+/// onto the other, so the positions, normals and texture coordinates that remain are all from the original mesh. Vertices
+/// on a UV or normal seam, where the loader split one position into several vertices, and vertices on an open border are
+/// never moved, so seams and silhouettes of open meshes keep their shape. Collapses that would flip a triangle are skipped.
+/// </summary>
+class MeshSimplifier
+{
+    public:
+        /// <summary>
+        /// Constructor
+        /// </summary>
+        MeshSimplifier();
+
+        /// <summary>
+        /// Sets if only collapses keeping the surface inside the mesh are made, for occluders that must never cover more
+        /// than the mesh does. The vertex a collapse keeps has to be on or behind the plane of every triangle around the
+        /// vertex it removes, seen from their front faces, so every step only takes volume away. Off by default
+        /// </summary>
+        void setConservative(bool flag);
+
+        /// <summary>
+        /// Simplifies a mesh
+        /// </summary>
+        /// <param name="mesh">The mesh to simplify</param>
+        /// <param name="targetTriangles">The amount of triangles to stop at, fewer collapses are possible with many locked vertices</param>
+        /// <param name="result">The simplified mesh, with the material, texture and transform of the input</param>
+        /// <returns>The geometric error, the root of the largest mean squared distance a collapse moved the surface, in the space of the mesh</returns>
+        float simplify(const Mesh& mesh, size_t targetTriangles, Mesh& result);
+
+        /// <summary>
+        /// Builds a chain of levels, each simplified from the previous one
+        /// </summary>
+        /// <param name="mesh">The full detail mesh</param>
+        /// <param name="ratios">The fraction of the triangles of the full detail mesh to keep for every level, decreasing</param>
+        /// <param name="levels">The simplified meshes, one per ratio</param>
+        /// <param name="errors">The geometric error of every level compared to the full detail mesh</param>
+        void buildChain(const Mesh& mesh, const std::vector<float>& ratios, std::vector<Mesh>& levels, std::vector<float>& errors);
+
+    private:
+        /// <summary>
+        /// The sum of the squared distances to a set of planes, as a symmetric 4x4 matrix
+        /// </summary>
+        struct Quadric
+        {
+            double a2, ab, ac, ad, b2, bc, bd, c2, cd, d2;
+
+            Quadric();
+            Quadric(const glm::dvec3& normal, double d);
+            void scale(double s);
+            void add(const Quadric& other);
+            double evaluate(const glm::dvec3& p) const;
+        };
+
+        /// <summary>
+        /// A possible collapse of a vertex onto a neighbour, with the versions of both when it was calculated
+        /// </summary>
+        struct Collapse
+        {
+            double cost;
+            uint32_t from;
+            uint32_t to;
+            uint32_t fromVersion;
+            uint32_t toVersion;
+
+            bool operator<(const Collapse& other) const { return cost > other.cost; }
+        };
+
+        std::vector<glm::dvec3> m_positions;
+        std::vector<uint32_t> m_welded;
+        std::vector<Quadric> m_quadrics;
+        std::vector<bool> m_locked;
+        std::vector<bool> m_removedVertices;
+        std::vector<uint32_t> m_versions;
+        std::vector<std::vector<uint32_t>> m_vertexTriangles;
+        std::vector<uint32_t> m_triangles;
+        std::vector<bool> m_removedTriangles;
+        bool m_conservative;
+
+        /// <summary>
+        /// Finds the vertices sharing a position and locks the seams and borders
+        /// </summary>
+        void weld(const Mesh& mesh);
+
+        /// <summary>
+        /// Checks the collapse keeps the triangles around the vertex facing the same way and the surface manifold, and
+        /// inside the mesh when conservative
+        /// </summary>
+        bool isValid(uint32_t from, uint32_t to);
+
+        /// <summary>
+        /// Moves the vertex onto the neighbour and removes the triangles between them
+        /// </summary>
+        /// <returns>The amount of removed triangles</returns>
+        size_t collapse(uint32_t from, uint32_t to);
+};
@@ -0,0 +1,70 @@
+#include "MipChain.h"
+
+#include <algorithm>
+
+bool MipChain::isCompressed() const
+{
+    return getBlockBytes(format) != 0;
+}
+
+int MipChain::getRowHeight() const
+{
+    return isCompressed() ? 4 : 1;
+}
+
+int MipChain::getRows(int level) const
+{
+    return (levels[level].height + getRowHeight() - 1) / getRowHeight();
+}
+
+size_t MipChain::getRowBytes(int level) const
+{
+    if(isCompressed())
+    {
+        return size_t((levels[level].width + 3) / 4) * getBlockBytes(format);
+    }
+
+    return size_t(levels[level].width) * 4;
+}
+
+size_t MipChain::getSizeInBytes() const
+{
+    size_t bytes = 0;
+    for(auto& level : levels)
+    {
+        bytes += level.data.size();
+    }
+
+    return bytes;
+}
+
+void MipChain::uploadRows(int level, int firstRow, int rows, const void* data) const
+{
+    const Level& l = levels[level];
+    int y = firstRow * getRowHeight();
+    int height = std::min(rows * getRowHeight(), l.height - y);
+
+    if(isCompressed())
+    {
+        glCompressedTexSubImage2D(GL_TEXTURE_2D, level, 0, y, l.width, height, format, GLsizei(rows * getRowBytes(level)), data);
+    }
+    else
+    {
+        glTexSubImage2D(GL_TEXTURE_2D, level, 0, y, l.width, height, GL_RGBA, GL_UNSIGNED_BYTE, data);
+    }
+}
+
+size_t MipChain::getBlockBytes(GLenum format)
+{
+    switch(format)
+    {
+        case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+        case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+            return 8;
+        case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+        case GL_COMPRESSED_RGBA_BPTC_UNORM:
+            return 16;
+        default:
+            return 0;
+    }
+}
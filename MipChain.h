@@ -0,0 +1,67 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstddef>
+#include <vector>
+
+/// <summary>
+/// The levels of a texture in memory, either four channel GL_RGBA8 pixels or 4x4 blocks of a compressed format. Rows are
+/// counted in texels for GL_RGBA8 and in rows of blocks for compressed formats, so a level can be uploaded in bands of rows
+/// either way.
+/// </summary>
+struct MipChain
+{
+    /// <summary>
+    /// One level, its data holds the rows bottom first as they are uploaded
+    /// </summary>
+    struct Level
+    {
+        int width;
+        int height;
+        std::vector<unsigned char> data;
+    };
+
+    GLenum format = GL_RGBA8;
+    std::vector<Level> levels;
+
+    /// <summary>
+    /// Returns if the format is block compressed
+    /// </summary>
+    bool isCompressed() const;
+
+    /// <summary>
+    /// Returns the texels covered by a row, 4 for block compressed formats
+    /// </summary>
+    int getRowHeight() const;
+
+    /// <summary>
+    /// Returns the amount of rows of a level
+    /// </summary>
+    int getRows(int level) const;
+
+    /// <summary>
+    /// Returns the bytes of a row of a level
+    /// </summary>
+    size_t getRowBytes(int level) const;
+
+    /// <summary>
+    /// Returns the bytes of all levels
+    /// </summary>
+    size_t getSizeInBytes() const;
+
+    /// <summary>
+    /// Uploads rows of a level to the texture bound to GL_TEXTURE_2D, from client memory or from the offset into the bound
+    /// pixel unpack buffer
+    /// </summary>
+    /// <param name="level">The level</param>
+    /// <param name="firstRow">The first row to upload</param>
+    /// <param name="rows">The amount of rows</param>
+    /// <param name="data">The data of the rows, or their offset into the unpack buffer</param>
+    void uploadRows(int level, int firstRow, int rows, const void* data) const;
+
+    /// <summary>
+    /// Returns the bytes of a 4x4 block of a compressed format, 0 for formats that are not compressed
+    /// </summary>
+    static size_t getBlockBytes(GLenum format);
+};
@@ -0,0 +1,279 @@
+#include "MipGenerator.h"
+#include "Profiler.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define MIPS_X86
+#include <immintrin.h>
+#endif
+
+std::atomic<MipGenerator::Filter> MipGenerator::s_filter(MipGenerator::FILTER_KAISER);
+std::shared_ptr<ThreadPool> MipGenerator::s_threadPool;
+
+namespace
+{
+    //Linear values are encoded through a table, fine enough that every sRGB value has its own steps
+    const int LINEAR_STEPS = 4096;
+
+    //Taps of the Kaiser filter per direction, the source texels within two destination texels of the center
+    const int KAISER_TAPS = 8;
+
+    //Texels of a level filtered as one band, smaller levels are filtered on the calling thread
+    const size_t TEXELS_PER_TASK = 16384;
+
+    struct Tables
+    {
+        float toLinear[256];
+        unsigned char toSRGB[LINEAR_STEPS];
+        float kaiser[KAISER_TAPS];
+
+        Tables()
+        {
+            for(int i = 0; i < 256; i++)
+            {
+                float c = i / 255.0f;
+                toLinear[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+            }
+
+            for(int i = 0; i < LINEAR_STEPS; i++)
+            {
+                float l = i / float(LINEAR_STEPS - 1);
+                float c = l <= 0.0031308f ? l * 12.92f : 1.055f * std::pow(l, 1.0f / 2.4f) - 0.055f;
+                toSRGB[i] = (unsigned char)std::min(255.0f, c * 255.0f + 0.5f);
+            }
+
+            //A sinc windowed by a Kaiser window with alpha 4 and a support of two destination texels. Destination texel x
+            //is centered between source texels 2x and 2x + 1, so the taps are 0.5, 1.5, 2.5 and 3.5 source texels away
+            const float alpha = 4.0f;
+            const float support = 2.0f;
+            float sum = 0.0f;
+            for(int k = 0; k < KAISER_TAPS; k++)
+            {
+                float t = (k - (KAISER_TAPS - 1) * 0.5f) * 0.5f;
+                float sinc = std::sin(3.14159265f * t) / (3.14159265f * t);
+                float r = t / support;
+                kaiser[k] = sinc * besselI0(alpha * std::sqrt(std::max(0.0f, 1.0f - r * r))) / besselI0(alpha);
+                sum += kaiser[k];
+            }
+
+            for(int k = 0; k < KAISER_TAPS; k++)
+            {
+                kaiser[k] /= sum;
+            }
+        }
+
+        static float besselI0(float x)
+        {
+            //The power series converges quickly for the small arguments of the window
+            float sum = 1.0f;
+            float term = 1.0f;
+            for(int k = 1; k < 20; k++)
+            {
+                term *= (x * 0.5f / k) * (x * 0.5f / k);
+                sum += term;
+            }
+
+            return sum;
+        }
+    };
+
+    const Tables& tables()
+    {
+        static Tables t;
+        return t;
+    }
+
+#ifdef MIPS_X86
+    typedef __m128 Texel;
+
+    inline Texel zero() { return _mm_setzero_ps(); }
+    inline Texel load(const float* p) { return _mm_loadu_ps(p); }
+    inline void store(float* p, Texel t) { _mm_storeu_ps(p, t); }
+    inline Texel add(Texel a, Texel b) { return _mm_add_ps(a, b); }
+    inline Texel scale(Texel t, float s) { return _mm_mul_ps(t, _mm_set1_ps(s)); }
+    inline Texel madd(Texel sum, Texel t, float w) { return _mm_add_ps(sum, _mm_mul_ps(t, _mm_set1_ps(w))); }
+#else
+    struct Texel
+    {
+        float c[4];
+    };
+
+    inline Texel zero() { return Texel{ { 0.0f, 0.0f, 0.0f, 0.0f } }; }
+    inline Texel load(const float* p) { return Texel{ { p[0], p[1], p[2], p[3] } }; }
+    inline void store(float* p, Texel t) { std::copy(t.c, t.c + 4, p); }
+    inline Texel add(Texel a, Texel b) { return Texel{ { a.c[0] + b.c[0], a.c[1] + b.c[1], a.c[2] + b.c[2], a.c[3] + b.c[3] } }; }
+    inline Texel scale(Texel t, float s) { return Texel{ { t.c[0] * s, t.c[1] * s, t.c[2] * s, t.c[3] * s } }; }
+    inline Texel madd(Texel sum, Texel t, float w) { return add(sum, scale(t, w)); }
+#endif
+
+    //A row of a level as linear floats, four per texel
+    void decodeRow(const MipChain::Level& level, int y, bool srgb, float* row)
+    {
+        const float* toLinear = tables().toLinear;
+        const unsigned char* texel = level.data.data() + size_t(y) * level.width * 4;
+        for(int x = 0; x < level.width * 4; x += 4)
+        {
+            row[x + 0] = srgb ? toLinear[texel[x + 0]] : texel[x + 0] / 255.0f;
+            row[x + 1] = srgb ? toLinear[texel[x + 1]] : texel[x + 1] / 255.0f;
+            row[x + 2] = srgb ? toLinear[texel[x + 2]] : texel[x + 2] / 255.0f;
+            row[x + 3] = texel[x + 3] / 255.0f;
+        }
+    }
+
+    //The negative lobes of the Kaiser filter can overshoot, the result is clamped before it is encoded
+    void encodeTexel(Texel t, bool srgb, unsigned char* texel)
+    {
+        float c[4];
+        store(c, t);
+
+        for(int i = 0; i < 4; i++)
+        {
+            float v = std::min(std::max(c[i], 0.0f), 1.0f);
+            texel[i] = (unsigned char)(srgb && i < 3 ? tables().toSRGB[int(v * (LINEAR_STEPS - 1) + 0.5f)] : int(v * 255.0f + 0.5f));
+        }
+    }
+}
+
+void MipGenerator::setFilter(Filter filter)
+{
+    s_filter = filter;
+}
+
+MipGenerator::Filter MipGenerator::getFilter()
+{
+    return s_filter;
+}
+
+void MipGenerator::setThreadPool(std::shared_ptr<ThreadPool> threadPool)
+{
+    s_threadPool = threadPool;
+}
+
+void MipGenerator::generate(MipChain& chain, bool srgb)
+{
+    generate(chain, s_filter, srgb);
+}
+
+void MipGenerator::generate(MipChain& chain, Filter filter, bool srgb)
+{
+    PROFILE_FUNCTION();
+
+    if(chain.levels.empty() || chain.isCompressed())
+    {
+        return;
+    }
+
+    //Built once before any level is split over the pool
+    tables();
+
+    chain.levels.resize(1);
+    while(chain.levels.back().width > 1 || chain.levels.back().height > 1)
+    {
+        MipChain::Level level;
+        level.width = std::max(chain.levels.back().width / 2, 1);
+        level.height = std::max(chain.levels.back().height / 2, 1);
+        level.data.resize(size_t(level.width) * level.height * 4);
+
+        const MipChain::Level& source = chain.levels.back();
+        auto rows = [&](size_t begin, size_t end)
+        {
+            if(filter == FILTER_BOX)
+            {
+                downsampleBox(source, level, srgb, int(begin), int(end));
+            }
+            else
+            {
+                downsampleKaiser(source, level, srgb, int(begin), int(end));
+            }
+        };
+
+        //Bands of rows keep the horizontally filtered rows of the Kaiser filter small, on the pool or one after another
+        size_t grain = std::max<size_t>(1, TEXELS_PER_TASK / size_t(level.width));
+        if(s_threadPool && size_t(level.height) > grain)
+        {
+            s_threadPool->parallelFor(size_t(level.height), grain, rows);
+        }
+        else
+        {
+            for(size_t begin = 0; begin < size_t(level.height); begin += grain)
+            {
+                rows(begin, std::min(begin + grain, size_t(level.height)));
+            }
+        }
+
+        chain.levels.push_back(std::move(level));
+    }
+}
+
+void MipGenerator::downsampleBox(const MipChain::Level& source, MipChain::Level& level, bool srgb, int begin, int end)
+{
+    std::vector<float> row0(size_t(source.width) * 4);
+    std::vector<float> row1(size_t(source.width) * 4);
+
+    //The last row or column repeats on odd sizes
+    for(int y = begin; y < end; y++)
+    {
+        decodeRow(source, std::min(y * 2, source.height - 1), srgb, row0.data());
+        decodeRow(source, std::min(y * 2 + 1, source.height - 1), srgb, row1.data());
+        unsigned char* destination = level.data.data() + size_t(y) * level.width * 4;
+
+        for(int x = 0; x < level.width; x++)
+        {
+            int x0 = std::min(x * 2, source.width - 1) * 4;
+            int x1 = std::min(x * 2 + 1, source.width - 1) * 4;
+
+            Texel sum = add(add(load(&row0[x0]), load(&row0[x1])), add(load(&row1[x0]), load(&row1[x1])));
+            encodeTexel(scale(sum, 0.25f), srgb, destination + x * 4);
+        }
+    }
+}
+
+void MipGenerator::downsampleKaiser(const MipChain::Level& source, MipChain::Level& level, bool srgb, int begin, int end)
+{
+    const float* weights = tables().kaiser;
+    const int reach = KAISER_TAPS / 2 - 1;
+
+    //The source rows the destination rows reach, filtered horizontally once each. Texels over the edges are clamped
+    int first = begin * 2 - reach;
+    int last = (end - 1) * 2 + 1 + reach;
+    std::vector<float> row(size_t(source.width) * 4);
+    std::vector<float> filtered(size_t(last - first + 1) * level.width * 4);
+
+    for(int y = first; y <= last; y++)
+    {
+        decodeRow(source, std::min(std::max(y, 0), source.height - 1), srgb, row.data());
+        float* destination = filtered.data() + size_t(y - first) * level.width * 4;
+
+        for(int x = 0; x < level.width; x++)
+        {
+            Texel sum = zero();
+            for(int k = 0; k < KAISER_TAPS; k++)
+            {
+                int sx = std::min(std::max(x * 2 - reach + k, 0), source.width - 1);
+                sum = madd(sum, load(&row[size_t(sx) * 4]), weights[k]);
+            }
+            store(destination + x * 4, sum);
+        }
+    }
+
+    for(int y = begin; y < end; y++)
+    {
+        unsigned char* destination = level.data.data() + size_t(y) * level.width * 4;
+
+        for(int x = 0; x < level.width; x++)
+        {
+            Texel sum = zero();
+            for(int k = 0; k < KAISER_TAPS; k++)
+            {
+                //Rows past the edge of the source were clamped when filtered, so the buffer holds every row reached
+                int sy = y * 2 - reach + k;
+                sum = madd(sum, load(&filtered[(size_t(sy - first) * level.width + x) * 4]), weights[k]);
+            }
+            encodeTexel(sum, srgb, destination + x * 4);
+        }
+    }
+}
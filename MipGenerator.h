@@ -0,0 +1,73 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+
+#include "MipChain.h"
+
+class ThreadPool;
+
+/// <summary>
+/// Builds the mip chains of GL_RGBA8 images on the CPU, so mipmaps are made where an image is decoded instead of with
+/// glGenerateMipmap on the thread owning the context. The color channels hold sRGB encoded values, they are filtered in
+/// linear light and encoded again, so dark and bright texels average the way they look instead of darkening the smaller
+/// levels. Alpha is filtered as it is. Each level is made from the one above it, either with a box filter over 2x2 texels
+/// or with a separable Kaiser windowed sinc over 8x8 texels, which keeps smaller levels sharper. A texel is filtered as one
+/// SSE vector of its four channels on x86. With a thread pool set, the rows of large levels are split over the pool, which
+/// is safe from a task running on the pool too.
+/// </summary>
+class MipGenerator
+{
+    public:
+        enum Filter
+        {
+            FILTER_BOX,
+            FILTER_KAISER
+        };
+
+        /// <summary>
+        /// Sets the filter used when none is given, FILTER_KAISER by default
+        /// </summary>
+        static void setFilter(Filter filter);
+
+        /// <summary>
+        /// Returns the filter used when none is given
+        /// </summary>
+        static Filter getFilter();
+
+        /// <summary>
+        /// Sets the pool the rows of large levels are split over, has to be set before images are loaded. Null filters on
+        /// the calling thread only
+        /// </summary>
+        static void setThreadPool(std::shared_ptr<ThreadPool> threadPool);
+
+        /// <summary>
+        /// Fills in the levels below the first of a GL_RGBA8 chain with the filter set, down to 1x1. Chains of other formats
+        /// are left as they are
+        /// </summary>
+        /// <param name="chain">The chain holding the first level</param>
+        /// <param name="srgb">Filters the color channels in linear light, false for data that is not a color</param>
+        static void generate(MipChain& chain, bool srgb = true);
+
+        /// <summary>
+        /// Fills in the levels below the first of a GL_RGBA8 chain, down to 1x1
+        /// </summary>
+        /// <param name="chain">The chain holding the first level</param>
+        /// <param name="filter">The filter</param>
+        /// <param name="srgb">Filters the color channels in linear light, false for data that is not a color</param>
+        static void generate(MipChain& chain, Filter filter, bool srgb);
+
+    private:
+        static std::atomic<Filter> s_filter;
+        static std::shared_ptr<ThreadPool> s_threadPool;
+
+        /// <summary>
+        /// Filters rows [begin, end) of a level from the level above it with the box filter
+        /// </summary>
+        static void downsampleBox(const MipChain::Level& source, MipChain::Level& level, bool srgb, int begin, int end);
+
+        /// <summary>
+        /// Filters rows [begin, end) of a level from the level above it with the Kaiser filter
+        /// </summary>
+        static void downsampleKaiser(const MipChain::Level& source, MipChain::Level& level, bool srgb, int begin, int end);
+};
@@ -1,12 +1,15 @@
 #include "Node.h"
+#include "Profiler.h"
 
-Node::Node(std::shared_ptr<State> state) : m_state(state), m_enabled(true)
+unsigned long long Node::s_staticVersion = 0;
+
+Node::Node(std::shared_ptr<State> state) : m_state(state), m_enabled(true), m_hidden(false), m_dynamic(false)
 {
 	m_name = "DefaultNodeWithState_Name";
 	m_state = state;
 }
 
-Node::Node() : m_enabled(true)
+Node::Node() : m_enabled(true), m_hidden(false), m_dynamic(false)
 {
 	m_name = "DefaultNode_Name";
 	m_state = nullptr;
@@ -23,6 +26,13 @@ void Node::addUpdateCallback(std::shared_ptr<UpdateCallback> callback)
 
 void Node::invokeUpdateCallbacks()
 {
+	if(m_updateCallbacks.empty())
+	{
+		return;
+	}
+
+	PROFILE_SCOPE("UpdateCallbacks");
+
 	for(auto callback : m_updateCallbacks)
 	{
 		callback->update(*this);
@@ -41,7 +51,11 @@ void Node::setState(std::shared_ptr<State> state)
 
 void Node::setEnabled(bool flag)
 {
-	m_enabled = flag;
+	if(m_enabled != flag)
+	{
+		m_enabled = flag;
+		markChanged();
+	}
 }
 
 std::string Node::getName()
@@ -62,4 +76,44 @@ bool Node::hasState()
 bool Node::isEnabled()
 {
 	return m_enabled;
-}
\ No newline at end of file
+}
+
+void Node::setHidden(bool flag)
+{
+	//Only the camera passes read the flag, nothing cached depends on it
+	m_hidden = flag;
+}
+
+bool Node::isHidden()
+{
+	return m_hidden;
+}
+
+void Node::setDynamic(bool flag)
+{
+	//A node turning static or dynamic moves between the cached and the per frame casters
+	if(m_dynamic != flag)
+	{
+		s_staticVersion++;
+	}
+
+	m_dynamic = flag;
+}
+
+bool Node::isDynamic()
+{
+	return m_dynamic;
+}
+
+unsigned long long Node::getStaticVersion()
+{
+	return s_staticVersion;
+}
+
+void Node::markChanged()
+{
+	if(!m_dynamic)
+	{
+		s_staticVersion++;
+	}
+}
@@ -97,9 +97,51 @@ class Node
 		/// <returns>The flag</returns>
 		bool isEnabled();
 
+		/// <summary>
+		/// Hides the node from the camera passes only. Unlike disabling it this is not a change to the scene: the node
+		/// keeps casting shadows and stays in the cached data, used to swap a subtree for its impostor
+		/// </summary>
+		/// <param name="flag">The flag</param>
+		void setHidden(bool flag);
+
+		/// <summary>
+		/// Checks if the node is hidden from the camera passes
+		/// </summary>
+		/// <returns>The flag</returns>
+		bool isHidden();
+
+		/// <summary>
+		/// Marks the node as dynamic, dynamic nodes are expected to change every frame and are
+		/// left out of cached data such as the static shadow casters
+		/// </summary>
+		/// <param name="flag">The flag</param>
+		virtual void setDynamic(bool flag);
+
+		/// <summary>
+		/// Checks if the node is dynamic
+		/// </summary>
+		/// <returns>The flag</returns>
+		bool isDynamic();
+
+		/// <summary>
+		/// Returns a counter that is increased every time a static node changes
+		/// </summary>
+		/// <returns>The version</returns>
+		static unsigned long long getStaticVersion();
+
+	protected:
+		/// <summary>
+		/// Increases the static version, unless the node is dynamic
+		/// </summary>
+		void markChanged();
+
 	private:
 		std::string m_name;
 		std::shared_ptr<State> m_state;
 		std::vector<std::shared_ptr<UpdateCallback>> m_updateCallbacks;
 		bool m_enabled;
+		bool m_hidden;
+		bool m_dynamic;
+
+		static unsigned long long s_staticVersion;
 };
@@ -0,0 +1,373 @@
+#include "OcclusionCuller.h"
+#include "Transform.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define OCCLUSION_X86
+#include <immintrin.h>
+#endif
+
+namespace
+{
+    //Vertices closer than this in clip space are treated as crossing the near plane
+    const float NEAR_W = 1e-4f;
+}
+
+OcclusionCuller::OcclusionCuller(unsigned int width, unsigned int height) :
+    m_width((std::max(width, 4u) + 3) & ~3u),
+    m_height(std::max(height, 1u)),
+    m_viewProjection(1.0f),
+    m_tested(0),
+    m_culled(0),
+    m_rasterized(0),
+    m_counting(false)
+{
+#if defined(OCCLUSION_X86)
+    m_kernel = KERNEL_SSE;
+#else
+    m_kernel = KERNEL_SCALAR;
+#endif
+
+    glm::uvec2 size(m_width, m_height);
+    while(true)
+    {
+        m_levelSizes.push_back(size);
+        m_minLevels.push_back(std::vector<float>(size.x * size.y, 1.0f));
+        m_maxLevels.push_back(std::vector<float>(size.x * size.y, 1.0f));
+
+        if(size.x == 1 && size.y == 1)
+        {
+            break;
+        }
+
+        size = glm::max((size + 1u) / 2u, glm::uvec2(1));
+    }
+}
+
+void OcclusionCuller::addOccluder(std::shared_ptr<Transform> node, const std::vector<glm::vec3>& triangles)
+{
+    m_occluders.push_back({ node, triangles });
+}
+
+void OcclusionCuller::clear()
+{
+    m_occluders.clear();
+}
+
+void OcclusionCuller::render(const glm::mat4& viewProjection)
+{
+    PROFILE_FUNCTION();
+
+    m_viewProjection = viewProjection;
+    m_tested = 0;
+    m_culled = 0;
+    m_rasterized = 0;
+    m_counting = true;
+
+    std::fill(m_minLevels[0].begin(), m_minLevels[0].end(), 1.0f);
+
+    for(auto& occluder : m_occluders)
+    {
+        if(!occluder.node->isEnabled())
+        {
+            continue;
+        }
+
+        glm::mat4 toClip = viewProjection * occluder.node->getModelMatrix();
+        size_t count = occluder.triangles.size();
+        m_screenVertices.resize(count);
+
+        for(size_t i = 0; i < count; i++)
+        {
+            glm::vec4 clip = toClip * glm::vec4(occluder.triangles[i], 1.0f);
+            if(clip.w < NEAR_W)
+            {
+                m_screenVertices[i] = glm::vec4(0.0f, 0.0f, 0.0f, -1.0f);
+                continue;
+            }
+
+            glm::vec3 ndc = glm::vec3(clip) / clip.w;
+            m_screenVertices[i] = glm::vec4((ndc.x * 0.5f + 0.5f) * m_width, (ndc.y * 0.5f + 0.5f) * m_height, ndc.z * 0.5f + 0.5f, 1.0f);
+        }
+
+        //Triangles crossing the near plane are left out, an occluder missing only hides less
+        for(size_t i = 0; i + 2 < count; i += 3)
+        {
+            const glm::vec4& a = m_screenVertices[i];
+            const glm::vec4& b = m_screenVertices[i + 1];
+            const glm::vec4& c = m_screenVertices[i + 2];
+
+            if(a.w > 0.0f && b.w > 0.0f && c.w > 0.0f)
+            {
+                rasterize(glm::vec3(a), glm::vec3(b), glm::vec3(c));
+            }
+        }
+    }
+
+    //Level 0 has a single depth, the nearest and the farthest are the same
+    m_maxLevels[0] = m_minLevels[0];
+    buildMips();
+}
+
+void OcclusionCuller::rasterize(const glm::vec3& v0, const glm::vec3& in1, const glm::vec3& in2)
+{
+    //Both windings are drawn, the occluders do not have to be closed
+    float area = (in1.x - v0.x) * (in2.y - v0.y) - (in1.y - v0.y) * (in2.x - v0.x);
+    glm::vec3 v1 = area < 0.0f ? in2 : in1;
+    glm::vec3 v2 = area < 0.0f ? in1 : in2;
+    area = std::abs(area);
+
+    if(area < 1e-8f)
+    {
+        return;
+    }
+
+    int minX = std::max(int(std::floor(std::min(v0.x, std::min(v1.x, v2.x)))), 0);
+    int maxX = std::min(int(std::ceil(std::max(v0.x, std::max(v1.x, v2.x)))), int(m_width) - 1);
+    int minY = std::max(int(std::floor(std::min(v0.y, std::min(v1.y, v2.y)))), 0);
+    int maxY = std::min(int(std::ceil(std::max(v0.y, std::max(v1.y, v2.y)))), int(m_height) - 1);
+
+    if(minX > maxX || minY > maxY)
+    {
+        return;
+    }
+
+    m_rasterized++;
+
+    //Edge functions and depth as planes over the pixel centers, e = a * x + b * y + c
+    glm::vec3 ea = glm::vec3(v1.y - v2.y, v2.y - v0.y, v0.y - v1.y);
+    glm::vec3 eb = glm::vec3(v2.x - v1.x, v0.x - v2.x, v1.x - v0.x);
+    glm::vec3 ec = glm::vec3(v1.x * v2.y - v2.x * v1.y, v2.x * v0.y - v0.x * v2.y, v0.x * v1.y - v1.x * v0.y);
+
+    float za = (ea.x * v0.z + ea.y * v1.z + ea.z * v2.z) / area;
+    float zb = (eb.x * v0.z + eb.y * v1.z + eb.z * v2.z) / area;
+    float zc = (ec.x * v0.z + ec.y * v1.z + ec.z * v2.z) / area;
+
+    float* depth = m_minLevels[0].data();
+
+#if defined(OCCLUSION_X86)
+    if(m_kernel == KERNEL_SSE)
+    {
+        //Rows are a multiple of 4 wide, so whole groups of 4 pixels can always be written
+        minX &= ~3;
+
+        __m128 offsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+        __m128 zero = _mm_setzero_ps();
+
+        for(int y = minY; y <= maxY; y++)
+        {
+            float py = float(y) + 0.5f;
+            __m128 row0 = _mm_set1_ps(eb.x * py + ec.x);
+            __m128 row1 = _mm_set1_ps(eb.y * py + ec.y);
+            __m128 row2 = _mm_set1_ps(eb.z * py + ec.z);
+            __m128 rowZ = _mm_set1_ps(zb * py + zc);
+            float* line = depth + size_t(y) * m_width;
+
+            for(int x = minX; x <= maxX; x += 4)
+            {
+                __m128 px = _mm_add_ps(_mm_set1_ps(float(x)), offsets);
+
+                __m128 e0 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(ea.x), px), row0);
+                __m128 e1 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(ea.y), px), row1);
+                __m128 e2 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(ea.z), px), row2);
+                __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_cmpge_ps(e1, zero)), _mm_cmpge_ps(e2, zero));
+
+                if(_mm_movemask_ps(inside) == 0)
+                {
+                    continue;
+                }
+
+                __m128 z = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(za), px), rowZ);
+                __m128 previous = _mm_loadu_ps(line + x);
+                __m128 nearest = _mm_min_ps(previous, z);
+
+                _mm_storeu_ps(line + x, _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, previous)));
+            }
+        }
+
+        return;
+    }
+#endif
+
+    //Evaluated in the same order as the SSE kernel, so both give the same coverage
+    for(int y = minY; y <= maxY; y++)
+    {
+        float py = float(y) + 0.5f;
+        glm::vec3 row = eb * py + ec;
+        float rowZ = zb * py + zc;
+        float* line = depth + size_t(y) * m_width;
+
+        for(int x = minX; x <= maxX; x++)
+        {
+            float px = float(x) + 0.5f;
+            glm::vec3 e = ea * px + row;
+
+            if(e.x >= 0.0f && e.y >= 0.0f && e.z >= 0.0f)
+            {
+                line[x] = std::min(line[x], za * px + rowZ);
+            }
+        }
+    }
+}
+
+void OcclusionCuller::buildMips()
+{
+    PROFILE_FUNCTION();
+
+    for(size_t level = 1; level < m_levelSizes.size(); level++)
+    {
+        glm::uvec2 source = m_levelSizes[level - 1];
+        glm::uvec2 size = m_levelSizes[level];
+        const std::vector<float>& sourceMin = m_minLevels[level - 1];
+        const std::vector<float>& sourceMax = m_maxLevels[level - 1];
+        std::vector<float>& levelMin = m_minLevels[level];
+        std::vector<float>& levelMax = m_maxLevels[level];
+
+        for(unsigned int y = 0; y < size.y; y++)
+        {
+            unsigned int y0 = y * 2;
+            unsigned int y1 = std::min(y0 + 1, source.y - 1);
+
+            for(unsigned int x = 0; x < size.x; x++)
+            {
+                unsigned int x0 = x * 2;
+                unsigned int x1 = std::min(x0 + 1, source.x - 1);
+
+                size_t i00 = y0 * source.x + x0;
+                size_t i01 = y0 * source.x + x1;
+                size_t i10 = y1 * source.x + x0;
+                size_t i11 = y1 * source.x + x1;
+
+                levelMin[y * size.x + x] = std::min(std::min(sourceMin[i00], sourceMin[i01]), std::min(sourceMin[i10], sourceMin[i11]));
+                levelMax[y * size.x + x] = std::max(std::max(sourceMax[i00], sourceMax[i01]), std::max(sourceMax[i10], sourceMax[i11]));
+            }
+        }
+    }
+}
+
+bool OcclusionCuller::isVisible(const BoundingBox& box, const glm::mat4& model)
+{
+    bool visible = test(box, model);
+
+    if(m_counting)
+    {
+        m_tested++;
+        m_culled += visible ? 0 : 1;
+    }
+
+    return visible;
+}
+
+void OcclusionCuller::endCounting()
+{
+    m_counting = false;
+}
+
+bool OcclusionCuller::test(const BoundingBox& box, const glm::mat4& model)
+{
+    glm::mat4 toClip = m_viewProjection * model;
+    glm::vec3 min = box.min();
+    glm::vec3 max = box.max();
+
+    glm::vec3 ndcMin = glm::vec3(1e30f);
+    glm::vec3 ndcMax = glm::vec3(-1e30f);
+
+    for(int i = 0; i < 8; i++)
+    {
+        glm::vec4 corner = toClip * glm::vec4((i & 1) ? max.x : min.x, (i & 2) ? max.y : min.y, (i & 4) ? max.z : min.z, 1.0f);
+
+        //A box reaching the camera can not be hidden
+        if(corner.w < NEAR_W)
+        {
+            return true;
+        }
+
+        glm::vec3 ndc = glm::vec3(corner) / corner.w;
+        ndcMin = glm::min(ndcMin, ndc);
+        ndcMax = glm::max(ndcMax, ndc);
+    }
+
+    if(ndcMax.x < -1.0f || ndcMin.x > 1.0f || ndcMax.y < -1.0f || ndcMin.y > 1.0f || ndcMin.z > 1.0f)
+    {
+        return false;
+    }
+
+    float nearest = ndcMin.z * 0.5f + 0.5f;
+
+    int x0 = std::max(int((ndcMin.x * 0.5f + 0.5f) * m_width), 0);
+    int x1 = std::min(int((ndcMax.x * 0.5f + 0.5f) * m_width), int(m_width) - 1);
+    int y0 = std::max(int((ndcMin.y * 0.5f + 0.5f) * m_height), 0);
+    int y1 = std::min(int((ndcMax.y * 0.5f + 0.5f) * m_height), int(m_height) - 1);
+
+    //The level where the box covers at most 2x2 texels
+    size_t level = 0;
+    while(level + 1 < m_levelSizes.size() && ((x1 >> level) - (x0 >> level) > 1 || (y1 >> level) - (y0 >> level) > 1))
+    {
+        level++;
+    }
+
+    glm::uvec2 size = m_levelSizes[level];
+    const std::vector<float>& levelMin = m_minLevels[level];
+    const std::vector<float>& levelMax = m_maxLevels[level];
+
+    float farthest = 0.0f;
+    for(int y = y0 >> level; y <= (y1 >> level); y++)
+    {
+        for(int x = x0 >> level; x <= (x1 >> level); x++)
+        {
+            size_t i = size_t(y) * size.x + x;
+
+            //In front of everything drawn in this texel, nothing further needs to be read
+            if(nearest <= levelMin[i])
+            {
+                return true;
+            }
+
+            farthest = std::max(farthest, levelMax[i]);
+        }
+    }
+
+    if(nearest > farthest)
+    {
+        return false;
+    }
+
+    return true;
+}
+
+void OcclusionCuller::setKernel(Kernel kernel)
+{
+#if defined(OCCLUSION_X86)
+    m_kernel = kernel;
+#else
+    m_kernel = KERNEL_SCALAR;
+#endif
+}
+
+OcclusionCuller::Kernel OcclusionCuller::getKernel()
+{
+    return m_kernel;
+}
+
+unsigned int OcclusionCuller::getTested()
+{
+    return m_tested;
+}
+
+unsigned int OcclusionCuller::getCulled()
+{
+    return m_culled;
+}
+
+unsigned int OcclusionCuller::getRasterizedTriangles()
+{
+    return m_rasterized;
+}
+
+const std::vector<float>& OcclusionCuller::getDepth()
+{
+    return m_minLevels[0];
+}
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <memory>
+#include <vector>
+
+#include "BoundingBox.h"
+
+class Transform;
+
+/// <summary>
+/// CPU occlusion culling. A few large occluders are rasterized into a small depth buffer every frame, four pixels at a
+/// time with SSE, and a mip chain keeping the nearest and the farthest depth of every 2x2 block is built from it. A box
+/// is hidden when its nearest point is behind the farthest occluder depth in the texels it covers, on the level where it
+/// covers at most 2x2 texels. Boxes entirely outside the view are hidden as well. Everything runs on the CPU, the
+/// results do not wait on the GPU and can be checked without a window.
+/// </summary>
+class OcclusionCuller
+{
+    public:
+        /// <summary>
+        /// The rasterizer in use
+        /// </summary>
+        enum Kernel
+        {
+            KERNEL_SCALAR,
+            KERNEL_SSE
+        };
+
+        /// <summary>
+        /// Constructor
+        /// </summary>
+        /// <param name="width">The width of the depth buffer, rounded up to a multiple of 4</param>
+        /// <param name="height">The height of the depth buffer</param>
+        OcclusionCuller(unsigned int width = 256, unsigned int height = 144);
+
+        /// <summary>
+        /// Adds an occluder
+        /// </summary>
+        /// <param name="node">The node placing the occluder, its transform is read every frame</param>
+        /// <param name="triangles">Three positions per triangle in the space of the node</param>
+        void addOccluder(std::shared_ptr<Transform> node, const std::vector<glm::vec3>& triangles);
+
+        /// <summary>
+        /// Removes all occluders
+        /// </summary>
+        void clear();
+
+        /// <summary>
+        /// Rasterizes the occluders and builds the mip chain
+        /// </summary>
+        /// <param name="viewProjection">The projection times the view of the camera</param>
+        void render(const glm::mat4& viewProjection);
+
+        /// <summary>
+        /// Tests a box against the occluders of the last render
+        /// </summary>
+        /// <param name="box">The box in object space</param>
+        /// <param name="model">The object to world matrix</param>
+        /// <returns>Flag for if the box can be seen</returns>
+        bool isVisible(const BoundingBox& box, const glm::mat4& model);
+
+        /// <summary>
+        /// Stops counting tests until the next render, so the counts cover the first pass after a render and not the
+        /// passes testing the same boxes again
+        /// </summary>
+        void endCounting();
+
+        /// <summary>
+        /// Sets the rasterizer, the best one supported is used by default
+        /// </summary>
+        void setKernel(Kernel kernel);
+
+        /// <summary>
+        /// Returns the rasterizer in use
+        /// </summary>
+        Kernel getKernel();
+
+        /// <summary>
+        /// Returns the amount of boxes tested in the first pass after the last render
+        /// </summary>
+        unsigned int getTested();
+
+        /// <summary>
+        /// Returns the amount of boxes hidden in the first pass after the last render
+        /// </summary>
+        unsigned int getCulled();
+
+        /// <summary>
+        /// Returns the amount of occluder triangles rasterized in the last render
+        /// </summary>
+        unsigned int getRasterizedTriangles();
+
+        /// <summary>
+        /// Returns the depth buffer of the last render, width times height values from the bottom row up
+        /// </summary>
+        const std::vector<float>& getDepth();
+
+    private:
+        /// <summary>
+        /// The triangles of an occluder and the node placing them
+        /// </summary>
+        struct Occluder
+        {
+            std::shared_ptr<Transform> node;
+            std::vector<glm::vec3> triangles;
+        };
+
+        unsigned int m_width;
+        unsigned int m_height;
+        Kernel m_kernel;
+        glm::mat4 m_viewProjection;
+        std::vector<Occluder> m_occluders;
+
+        //Level 0 is the depth buffer, every level after it halves the size
+        std::vector<std::vector<float>> m_minLevels;
+        std::vector<std::vector<float>> m_maxLevels;
+        std::vector<glm::uvec2> m_levelSizes;
+
+        std::vector<glm::vec4> m_screenVertices;
+        unsigned int m_tested;
+        unsigned int m_culled;
+        unsigned int m_rasterized;
+        bool m_counting;
+
+        /// <summary>
+        /// Tests a box against the depth levels without counting it
+        /// </summary>
+        bool test(const BoundingBox& box, const glm::mat4& model);
+
+        /// <summary>
+        /// Rasterizes one triangle in screen space, keeping the nearest depth
+        /// </summary>
+        void rasterize(const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2);
+
+        /// <summary>
+        /// Builds the levels after level 0
+        /// </summary>
+        void buildMips();
+};
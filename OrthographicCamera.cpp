@@ -15,32 +15,38 @@ OrthographicCamera::OrthographicCamera() :
     Camera(),
     m_top(25.0f),
     m_oblscale(0.0f),
-    m_oblrad(3.14567f/4.0f)
+    m_oblrad(3.14567f/4.0f),
+    m_hasExtents(false),
+    m_target(0.0f),
+    m_snapResolution(0)
 {
 }
 
-void OrthographicCamera::apply(GLuint program)
+void OrthographicCamera::update()
 {
     glm::vec3 position = getPosition();
     glm::uvec2 screenSize = getScreenSize();
-    glm::vec3 direction = getDirection();
-    glm::vec3 up = getUp();
     glm::vec2 nearFar = getNearFar();
 
-	GLint uniform_v = getViewUniform();
-	GLint uniform_p = getProjectionUniform();
-    GLint uniform_v_inv = getViewInverseUniform();
-
     float aspect = float(screenSize[0])/float(screenSize[1]);
     float bottom = -m_top;
+    float top = m_top;
     float right = m_top * aspect;
     float left = -right;
 
+    if(m_hasExtents)
+    {
+        left = m_extents.x;
+        right = m_extents.y;
+        bottom = m_extents.z;
+        top = m_extents.w;
+    }
+
 	glm::mat4 projection = glm::mat4(1.0f);
     glm::mat4 view = glm::mat4(1.0f);
 
-    projection = glm::ortho(left, right, bottom, m_top, nearFar[0], nearFar[1]);
-	view = glm::lookAt(position, glm::vec3(0.0f,0.0f,0.0f), glm::vec3(0.00001f, 1.0f, 0.00001f));
+    projection = glm::ortho(left, right, bottom, top, nearFar[0], nearFar[1]);
+	view = glm::lookAt(position, m_target, glm::vec3(0.00001f, 1.0f, 0.00001f));
 
     glm::mat4 H = glm::mat4(1.0f);
 
@@ -49,16 +55,59 @@ void OrthographicCamera::apply(GLuint program)
 
     projection *= H;
 
+    //Move the projection so the world origin lands on a texel corner, this keeps the
+    //rasterized shadow edges from crawling when the camera moves less than a texel
+    if(m_snapResolution > 0)
+    {
+        glm::vec4 origin = projection * view * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+        glm::vec2 texels = glm::vec2(origin) * (m_snapResolution / 2.0f);
+        glm::vec2 offset = (glm::round(texels) - texels) * (2.0f / m_snapResolution);
+
+        projection[3][0] += offset.x;
+        projection[3][1] += offset.y;
+    }
+
+    setLightSpaceMatrix(projection * view);
+    setProjection(projection);
+    setView(view);
+}
+
+void OrthographicCamera::apply(GLuint program)
+{
+	GLint uniform_v = getViewUniform();
+	GLint uniform_p = getProjectionUniform();
+    GLint uniform_v_inv = getViewInverseUniform();
+
+    update();
+
+    glm::mat4 view = getView();
+    glm::mat4 projection = getProjection();
+
     glUniformMatrix4fv(uniform_v, 1, GL_FALSE, glm::value_ptr(view));
 	glUniformMatrix4fv(uniform_p, 1, GL_FALSE, glm::value_ptr(projection));
 
 	glm::mat4 v_inv = glm::inverse(view);
 	glUniformMatrix4fv(uniform_v_inv, 1, GL_FALSE, glm::value_ptr(v_inv));
-
-    setLightSpaceMatrix(projection * view);
 }
 
 void OrthographicCamera::setTop(float top)
 {
     m_top = top;
+    m_hasExtents = false;
+}
+
+void OrthographicCamera::setExtents(float left, float right, float bottom, float top)
+{
+    m_extents = glm::vec4(left, right, bottom, top);
+    m_hasExtents = true;
+}
+
+void OrthographicCamera::setTarget(glm::vec3 target)
+{
+    m_target = target;
+}
+
+void OrthographicCamera::setSnapResolution(unsigned int resolution)
+{
+    m_snapResolution = resolution;
 }
\ No newline at end of file
@@ -8,9 +8,17 @@ class OrthographicCamera : public Camera
         OrthographicCamera();
 
         virtual void apply(GLuint program) override;
+        void update();
         void setTop(float top);
+        void setExtents(float left, float right, float bottom, float top);
+        void setTarget(glm::vec3 target);
+        void setSnapResolution(unsigned int resolution);
     private:
         float m_top;
+        glm::vec4 m_extents;
+        bool m_hasExtents;
+        glm::vec3 m_target;
+        unsigned int m_snapResolution;
         float m_oblscale;
         float m_oblrad;
 };
\ No newline at end of file
@@ -0,0 +1,183 @@
+#include "ParticleBenchmark.h"
+#include "Application.h"
+#include "CPUParticles.h"
+#include "GPUParticles.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <thread>
+
+namespace
+{
+    //A fixed step and a follow position away from the emitter, the same for every configuration
+    const float STEP = 1.0f / 60.0f;
+    const glm::vec3 FOLLOW_POSITION = glm::vec3(0.0f, 3000.0f, 0.0f);
+    const float NEVER_DIE = 1e9f;
+}
+
+ParticleBenchmark::ParticleBenchmark(std::shared_ptr<Application> application) :
+    m_application(application),
+    m_particles(1 << 20),
+    m_warmupSteps(10),
+    m_measuredSteps(100)
+{
+}
+
+void ParticleBenchmark::setSize(unsigned int particles, unsigned int warmup, unsigned int measured)
+{
+    m_particles = std::max(particles, 1u);
+    m_warmupSteps = warmup;
+    m_measuredSteps = std::max(measured, 1u);
+}
+
+bool ParticleBenchmark::run(const std::string& outFilename)
+{
+    m_results.clear();
+
+    std::cout << "Benchmarking " << m_particles << " particles: " << m_warmupSteps << " warm-up steps, " << m_measuredSteps << " measured steps" << std::endl;
+
+    if(!runCompute())
+    {
+        std::cout << "Compute shaders are not available, only the CPU is measured" << std::endl;
+    }
+
+    unsigned int allThreads = m_application->getThreadPool()->getThreadCount() + 1;
+
+    for(int kernel = CPUParticles::KERNEL_SCALAR; kernel <= CPUParticles::bestKernel(); kernel++)
+    {
+        runCPU(kernel, 1);
+
+        if(allThreads > 1)
+        {
+            runCPU(kernel, allThreads);
+        }
+    }
+
+    for(auto& result : m_results)
+    {
+        std::cout << result.backend << " on " << result.threads << " thread(s): " << result.msPerStep << " ms per step, "
+                  << (m_particles / (result.msPerStep / 1000.0)) / result.threads << " particles per second per thread" << std::endl;
+    }
+
+    std::ofstream out(outFilename);
+    if(!out.is_open())
+    {
+        std::cerr << "Could not write particle benchmark report: " << outFilename << std::endl;
+        return false;
+    }
+
+    writeReport(out);
+    std::cout << "Particle benchmark report written to " << outFilename << std::endl;
+
+    return true;
+}
+
+bool ParticleBenchmark::runCompute()
+{
+    GLuint computeProgram = m_application->getParticleComputeProgram();
+    GLint linked = GL_FALSE;
+
+    if(computeProgram == 0 || !glIsProgram(computeProgram))
+    {
+        return false;
+    }
+
+    glGetProgramiv(computeProgram, GL_LINK_STATUS, &linked);
+    if(!linked)
+    {
+        return false;
+    }
+
+    std::shared_ptr<GPUParticles> particles = std::shared_ptr<GPUParticles>(new GPUParticles(m_particles));
+    particles->setBackend(GPUParticles::BACKEND_COMPUTE);
+    particles->setLifetime(NEVER_DIE, NEVER_DIE);
+    particles->init(m_application->getParticleProgram());
+
+    //Fill the whole capacity in the first step and emit nothing after that
+    particles->setEmitRate(m_particles / STEP);
+    particles->update(STEP, FOLLOW_POSITION, computeProgram);
+    particles->setEmitRate(0.0f);
+
+    GLuint query;
+    glGenQueries(1, &query);
+
+    double totalMs = 0.0;
+    for(unsigned int step = 0; step < m_warmupSteps + m_measuredSteps; step++)
+    {
+        glBeginQuery(GL_TIME_ELAPSED, query);
+        particles->update(STEP, FOLLOW_POSITION, computeProgram);
+        glEndQuery(GL_TIME_ELAPSED);
+
+        //Waiting is fine here, only the GPU time is measured
+        GLuint64 elapsed = 0;
+        glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed);
+
+        if(step >= m_warmupSteps)
+        {
+            totalMs += elapsed / 1e6;
+        }
+    }
+
+    glDeleteQueries(1, &query);
+
+    m_results.push_back({ "compute", 1, totalMs / m_measuredSteps });
+    return true;
+}
+
+void ParticleBenchmark::runCPU(int kernel, unsigned int threads)
+{
+    CPUParticles particles(m_particles);
+    particles.setKernel((CPUParticles::Kernel)kernel);
+    particles.setThreadPool(m_application->getThreadPool(), threads);
+
+    //The output stands in for the mapped buffer the renderer streams into
+    std::vector<float> output(size_t(m_particles) * 4);
+    CPUParticles::Emitter emitter = { glm::vec3(-36.0f, 89.0f, -36.0f), glm::vec3(64.0f), glm::vec2(NEVER_DIE) };
+
+    particles.simulate(STEP, FOLLOW_POSITION, m_particles, emitter, output.data());
+
+    double totalMs = 0.0;
+    for(unsigned int step = 0; step < m_warmupSteps + m_measuredSteps; step++)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        particles.simulate(STEP, FOLLOW_POSITION, 0, emitter, output.data());
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+        if(step >= m_warmupSteps)
+        {
+            totalMs += ms;
+        }
+    }
+
+    m_results.push_back({ std::string("cpu ") + CPUParticles::kernelName(particles.getKernel()), threads, totalMs / m_measuredSteps });
+}
+
+void ParticleBenchmark::writeReport(std::ostream& out)
+{
+    out << "{" << std::endl;
+    out << "  \"renderer\": \"" << (const char*)glGetString(GL_RENDERER) << "\"," << std::endl;
+    out << "  \"particles\": " << m_particles << "," << std::endl;
+    out << "  \"warmupSteps\": " << m_warmupSteps << "," << std::endl;
+    out << "  \"measuredSteps\": " << m_measuredSteps << "," << std::endl;
+    out << "  \"hardwareThreads\": " << std::thread::hardware_concurrency() << "," << std::endl;
+    out << "  \"results\": [" << std::endl;
+
+    for(size_t i = 0; i < m_results.size(); i++)
+    {
+        const Result& result = m_results[i];
+        double perSecond = m_particles / (result.msPerStep / 1000.0);
+
+        out << "    { \"backend\": \"" << result.backend << "\", "
+            << "\"threads\": " << result.threads << ", "
+            << "\"msPerStep\": " << result.msPerStep << ", "
+            << "\"particlesPerSecond\": " << perSecond << ", "
+            << "\"particlesPerSecondPerThread\": " << perSecond / result.threads << " }"
+            << (i + 1 == m_results.size() ? "" : ",") << std::endl;
+    }
+
+    out << "  ]" << std::endl;
+    out << "}" << std::endl;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+class Application;
+
+/// <summary>
+/// Measures how many particles per second the simulation steps, on the GPU with the compute shader and
+/// on the CPU with every supported kernel on one thread and on all threads. The particles never die
+/// during the measurement, so every step moves the full capacity.
+/// </summary>
+class ParticleBenchmark
+{
+    public:
+        /// <summary>
+        /// Constructor
+        /// </summary>
+        /// <param name="application">The application, with resources already initilized</param>
+        ParticleBenchmark(std::shared_ptr<Application> application);
+
+        /// <summary>
+        /// Sets the amount of particles and steps
+        /// </summary>
+        /// <param name="particles">The amount of live particles</param>
+        /// <param name="warmup">Steps run before measuring starts</param>
+        /// <param name="measured">Steps measured</param>
+        void setSize(unsigned int particles, unsigned int warmup, unsigned int measured);
+
+        /// <summary>
+        /// Runs the benchmark and writes the report
+        /// </summary>
+        /// <param name="outFilename">The file to write the JSON report to</param>
+        /// <returns>Flag for if the benchmark completed or not</returns>
+        bool run(const std::string& outFilename);
+
+    private:
+        /// <summary>
+        /// The result of one configuration
+        /// </summary>
+        struct Result
+        {
+            std::string backend;
+            unsigned int threads;
+            double msPerStep;
+        };
+
+        std::shared_ptr<Application> m_application;
+        unsigned int m_particles;
+        unsigned int m_warmupSteps;
+        unsigned int m_measuredSteps;
+        std::vector<Result> m_results;
+
+        /// <summary>
+        /// Measures the compute shader, returns false if it is not available
+        /// </summary>
+        bool runCompute();
+
+        /// <summary>
+        /// Measures one CPU kernel on a number of threads
+        /// </summary>
+        void runCPU(int kernel, unsigned int threads);
+
+        /// <summary>
+        /// Writes the report
+        /// </summary>
+        void writeReport(std::ostream& out);
+};
@@ -0,0 +1,123 @@
+#include "Profiler.h"
+
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+std::mutex Profiler::s_mutex;
+std::vector<std::shared_ptr<Profiler::ThreadBuffer>> Profiler::s_buffers;
+
+static const std::chrono::steady_clock::time_point s_epoch = std::chrono::steady_clock::now();
+
+uint64_t Profiler::now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - s_epoch).count();
+}
+
+Profiler::ThreadBuffer& Profiler::threadBuffer()
+{
+    //The registry keeps the buffer alive after the thread exits so its zones still end up in the trace
+    thread_local ThreadBuffer* buffer = nullptr;
+
+    if(!buffer)
+    {
+        std::shared_ptr<ThreadBuffer> created = std::make_shared<ThreadBuffer>();
+        created->events.resize(BUFFER_SIZE);
+        created->head = 0;
+
+        std::lock_guard<std::mutex> lock(s_mutex);
+        created->threadId = (unsigned int)s_buffers.size();
+        created->threadName = created->threadId == 0 ? "main" : "thread " + std::to_string(created->threadId);
+        s_buffers.push_back(created);
+        buffer = created.get();
+    }
+
+    return *buffer;
+}
+
+void Profiler::record(const char* name, uint64_t start, uint64_t end)
+{
+    ThreadBuffer& buffer = threadBuffer();
+
+    //Single writer per buffer, publishing the head makes the event visible to writeTrace
+    uint64_t head = buffer.head.load(std::memory_order_relaxed);
+    buffer.events[head % BUFFER_SIZE] = { name, start, end };
+    buffer.head.store(head + 1, std::memory_order_release);
+}
+
+void Profiler::setThreadName(const std::string& name)
+{
+    ThreadBuffer& buffer = threadBuffer();
+
+    std::lock_guard<std::mutex> lock(s_mutex);
+    buffer.threadName = name;
+}
+
+bool Profiler::isEnabled()
+{
+#ifdef ENABLE_PROFILING
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool Profiler::writeTrace(const std::string& filename)
+{
+    if(!isEnabled())
+    {
+        std::cerr << "Profiling is compiled out, configure with -DENABLE_PROFILING=ON to record a trace" << std::endl;
+        return false;
+    }
+
+    std::ofstream file(filename);
+
+    if(!file.is_open())
+    {
+        std::cerr << "Could not write trace: " << filename << std::endl;
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(s_mutex);
+
+    file << std::fixed << std::setprecision(3);
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[" << std::endl;
+
+    bool first = true;
+    size_t written = 0;
+
+    for(auto& buffer : s_buffers)
+    {
+        file << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->threadId
+             << ",\"args\":{\"name\":\"" << buffer->threadName << "\"}}";
+        first = false;
+
+        uint64_t head = buffer->head.load(std::memory_order_acquire);
+        uint64_t tail = head > BUFFER_SIZE ? head - BUFFER_SIZE : 0;
+
+        std::vector<Event> events;
+        events.reserve(size_t(head - tail));
+        for(uint64_t i = tail; i < head; i++)
+        {
+            events.push_back(buffer->events[i % BUFFER_SIZE]);
+        }
+
+        //The owning thread keeps recording, drop the slots it overwrote while they were copied
+        uint64_t overwritten = buffer->head.load(std::memory_order_acquire);
+        size_t skip = overwritten > tail + BUFFER_SIZE ? size_t(overwritten - tail - BUFFER_SIZE) : 0;
+
+        for(size_t i = skip; i < events.size(); i++)
+        {
+            const Event& event = events[i];
+            file << ",\n{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->threadId
+                 << ",\"ts\":" << event.start / 1000.0 << ",\"dur\":" << (event.end - event.start) / 1000.0 << "}";
+            written++;
+        }
+    }
+
+    file << std::endl << "]}" << std::endl;
+
+    std::cout << "Wrote " << written << " zones to " << filename << std::endl;
+    return true;
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#ifdef ENABLE_PROFILING
+/// Measures the enclosing scope, the name must be a string literal
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+#define PROFILE_FUNCTION() PROFILE_SCOPE(__FUNCTION__)
+#define PROFILE_THREAD_NAME(name) Profiler::setThreadName(name)
+#else
+#define PROFILE_SCOPE(name) do {} while(0)
+#define PROFILE_FUNCTION() do {} while(0)
+#define PROFILE_THREAD_NAME(name) do {} while(0)
+#endif
+
+/// <summary>
+/// CPU profiler recording scoped zones. Every thread writes into its own ring buffer without
+/// locking, the buffers are only locked when a thread registers and when a trace is written.
+/// The trace is written in the Chrome trace event format, open it in chrome://tracing or Perfetto.
+/// Zones are only recorded when compiled with ENABLE_PROFILING.
+/// </summary>
+class Profiler
+{
+    public:
+        /// <summary>
+        /// Records a zone on the calling thread
+        /// </summary>
+        /// <param name="name">The name of the zone, must outlive the profiler (string literal)</param>
+        /// <param name="start">Start time in nanoseconds</param>
+        /// <param name="end">End time in nanoseconds</param>
+        static void record(const char* name, uint64_t start, uint64_t end);
+
+        /// <summary>
+        /// Returns the time since the profiler started in nanoseconds
+        /// </summary>
+        static uint64_t now();
+
+        /// <summary>
+        /// Names the calling thread in the trace
+        /// </summary>
+        /// <param name="name">The thread name</param>
+        static void setThreadName(const std::string& name);
+
+        /// <summary>
+        /// Writes the zones currently held by the ring buffers as a Chrome trace
+        /// </summary>
+        /// <param name="filename">The JSON file to write</param>
+        /// <returns>Flag for if the trace was written or not</returns>
+        static bool writeTrace(const std::string& filename = "cpu_trace.json");
+
+        /// <summary>
+        /// Returns if zones are compiled in or not
+        /// </summary>
+        static bool isEnabled();
+
+    private:
+        static const unsigned int BUFFER_SIZE = 1 << 16;
+
+        struct Event
+        {
+            const char* name;
+            uint64_t start;
+            uint64_t end;
+        };
+
+        struct ThreadBuffer
+        {
+            std::vector<Event> events;
+            std::atomic<uint64_t> head;
+            unsigned int threadId;
+            std::string threadName;
+        };
+
+        static std::mutex s_mutex;
+        static std::vector<std::shared_ptr<ThreadBuffer>> s_buffers;
+
+        /// <summary>
+        /// Returns the buffer of the calling thread, registering it on first use
+        /// </summary>
+        static ThreadBuffer& threadBuffer();
+};
+
+/// <summary>
+/// Records the lifetime of the object as a zone, use through PROFILE_SCOPE
+/// </summary>
+class ProfileScope
+{
+    public:
+        ProfileScope(const char* name) : m_name(name), m_start(Profiler::now())
+        {
+        }
+
+        ~ProfileScope()
+        {
+            Profiler::record(m_name, m_start, Profiler::now());
+        }
+
+    private:
+        const char* m_name;
+        uint64_t m_start;
+};
@@ -0,0 +1,203 @@
+#include "ProgramCache.h"
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+namespace
+{
+    const uint32_t BINARY_MAGIC = 0x42505256; //"VRPB"
+    const uint32_t BINARY_VERSION = 1;
+
+    //FNV-1a, only used to tell sources apart so it does not need to be cryptographic
+    void hash(uint64_t& h, const void* data, size_t size)
+    {
+        const unsigned char* bytes = (const unsigned char*)data;
+        for(size_t i = 0; i < size; i++)
+        {
+            h ^= bytes[i];
+            h *= 1099511628211ull;
+        }
+    }
+
+    void hash(uint64_t& h, const std::string& string)
+    {
+        hash(h, string.data(), string.size());
+        hash(h, "\0", 1);
+    }
+
+    std::string glString(GLenum name)
+    {
+        const GLubyte* string = glGetString(name);
+        return string ? (const char*)string : "";
+    }
+}
+
+ProgramCache::ProgramCache(const std::string& directory) : m_directory(directory), m_enabled(true), m_hits(0), m_misses(0)
+{
+}
+
+uint64_t ProgramCache::key(const std::vector<Stage>& stages, const std::string& defines)
+{
+    uint64_t h = 14695981039346656037ull;
+
+    hash(h, glString(GL_VENDOR));
+    hash(h, glString(GL_RENDERER));
+    hash(h, glString(GL_VERSION));
+    hash(h, defines);
+
+    for(auto& stage : stages)
+    {
+        std::ifstream file(stage.filename, std::ios::binary);
+        std::stringstream source;
+        source << file.rdbuf();
+
+        hash(h, &stage.type, sizeof(stage.type));
+        hash(h, stage.filename);
+        hash(h, source.str());
+    }
+
+    return h;
+}
+
+std::string ProgramCache::filename(uint64_t key)
+{
+    std::ostringstream str;
+    str << m_directory << "/" << std::hex << std::setw(16) << std::setfill('0') << key << ".bin";
+    return str.str();
+}
+
+bool ProgramCache::load(GLuint program, uint64_t key)
+{
+    if(!isEnabled())
+    {
+        m_misses++;
+        return false;
+    }
+
+    std::ifstream file(filename(key), std::ios::binary);
+
+    uint32_t magic = 0, version = 0, length = 0;
+    uint64_t storedKey = 0;
+    GLenum format = 0;
+
+    file.read((char*)&magic, sizeof(magic));
+    file.read((char*)&version, sizeof(version));
+    file.read((char*)&storedKey, sizeof(storedKey));
+    file.read((char*)&format, sizeof(format));
+    file.read((char*)&length, sizeof(length));
+
+    if(!file || magic != BINARY_MAGIC || version != BINARY_VERSION || storedKey != key)
+    {
+        m_misses++;
+        return false;
+    }
+
+    std::vector<char> binary(length);
+    file.read(binary.data(), length);
+
+    if(!file)
+    {
+        m_misses++;
+        return false;
+    }
+
+    glProgramBinary(program, format, binary.data(), (GLsizei)length);
+
+    //The driver may still reject the binary, for example after an update that kept the version string
+    GLint link_ok = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &link_ok);
+
+    if(!link_ok)
+    {
+        std::cerr << "Cached program binary rejected by the driver, recompiling: " << filename(key) << std::endl;
+        m_misses++;
+        return false;
+    }
+
+    m_hits++;
+    return true;
+}
+
+void ProgramCache::store(GLuint program, uint64_t key)
+{
+    if(!isEnabled())
+    {
+        return;
+    }
+
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+
+    if(length <= 0)
+    {
+        return;
+    }
+
+    std::vector<char> binary(length);
+    GLenum format = 0;
+    glGetProgramBinary(program, length, nullptr, &format, binary.data());
+
+#ifdef _WIN32
+    _mkdir(m_directory.c_str());
+#else
+    mkdir(m_directory.c_str(), 0755);
+#endif
+
+    std::ofstream file(filename(key), std::ios::binary);
+
+    if(!file.is_open())
+    {
+        std::cerr << "Could not write program binary: " << filename(key) << std::endl;
+        return;
+    }
+
+    uint32_t size = (uint32_t)length;
+
+    file.write((const char*)&BINARY_MAGIC, sizeof(BINARY_MAGIC));
+    file.write((const char*)&BINARY_VERSION, sizeof(BINARY_VERSION));
+    file.write((const char*)&key, sizeof(key));
+    file.write((const char*)&format, sizeof(format));
+    file.write((const char*)&size, sizeof(size));
+    file.write(binary.data(), length);
+}
+
+void ProgramCache::setEnabled(bool flag)
+{
+    m_enabled = flag;
+}
+
+bool ProgramCache::isEnabled()
+{
+    if(!m_enabled)
+    {
+        return false;
+    }
+
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    return formats > 0;
+}
+
+void ProgramCache::resetStatistics()
+{
+    m_hits = 0;
+    m_misses = 0;
+}
+
+unsigned int ProgramCache::getHits()
+{
+    return m_hits;
+}
+
+unsigned int ProgramCache::getMisses()
+{
+    return m_misses;
+}
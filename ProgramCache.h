@@ -0,0 +1,92 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/// <summary>
+/// On-disk cache of linked program binaries (glGetProgramBinary/glProgramBinary). A program is keyed
+/// by a hash of its shader sources, defines and the GL driver strings, so editing a shader or
+/// updating the driver misses the cache and the program is compiled from source again.
+/// </summary>
+class ProgramCache
+{
+    public:
+        /// <summary>
+        /// A shader stage of a program
+        /// </summary>
+        struct Stage
+        {
+            GLenum type;
+            std::string filename;
+        };
+
+        /// <summary>
+        /// Constructor
+        /// </summary>
+        /// <param name="directory">The directory the binaries are stored in</param>
+        ProgramCache(const std::string& directory = "shadercache");
+
+        /// <summary>
+        /// Calculates the cache key of a program
+        /// </summary>
+        /// <param name="stages">The shader stages of the program</param>
+        /// <param name="defines">Preprocessor defines the sources are compiled with</param>
+        /// <returns>The key</returns>
+        uint64_t key(const std::vector<Stage>& stages, const std::string& defines = "");
+
+        /// <summary>
+        /// Loads a cached binary into the program
+        /// </summary>
+        /// <param name="program">The program to load into</param>
+        /// <param name="key">The key of the program</param>
+        /// <returns>Flag for if the binary was found and accepted by the driver</returns>
+        bool load(GLuint program, uint64_t key);
+
+        /// <summary>
+        /// Stores the binary of a linked program. The program should be linked with
+        /// GL_PROGRAM_BINARY_RETRIEVABLE_HINT set
+        /// </summary>
+        /// <param name="program">The linked program</param>
+        /// <param name="key">The key of the program</param>
+        void store(GLuint program, uint64_t key);
+
+        /// <summary>
+        /// Sets if the cache should be used or not, when disabled every program is compiled from source
+        /// </summary>
+        /// <param name="flag">The flag</param>
+        void setEnabled(bool flag);
+
+        /// <summary>
+        /// Returns if the cache is used, false if disabled or if the driver has no binary formats
+        /// </summary>
+        bool isEnabled();
+
+        /// <summary>
+        /// Resets the hit and miss counters
+        /// </summary>
+        void resetStatistics();
+
+        /// <summary>
+        /// Returns the amount of programs loaded from the cache since the last reset
+        /// </summary>
+        unsigned int getHits();
+
+        /// <summary>
+        /// Returns the amount of programs compiled from source since the last reset
+        /// </summary>
+        unsigned int getMisses();
+
+    private:
+        std::string m_directory;
+        bool m_enabled;
+        unsigned int m_hits;
+        unsigned int m_misses;
+
+        /// <summary>
+        /// Returns the file a key is stored in
+        /// </summary>
+        std::string filename(uint64_t key);
+};
@@ -0,0 +1,50 @@
+#include "RenderStats.h"
+
+unsigned int RenderStats::s_drawCalls = 0;
+unsigned long long RenderStats::s_triangles = 0;
+unsigned int RenderStats::s_stateChanges = 0;
+unsigned int RenderStats::s_textureBinds = 0;
+
+void RenderStats::reset()
+{
+    s_drawCalls = 0;
+    s_triangles = 0;
+    s_stateChanges = 0;
+    s_textureBinds = 0;
+}
+
+void RenderStats::addDrawCall(GLuint triangles)
+{
+    s_drawCalls++;
+    s_triangles += triangles;
+}
+
+void RenderStats::addStateChange()
+{
+    s_stateChanges++;
+}
+
+void RenderStats::addTextureBind()
+{
+    s_textureBinds++;
+}
+
+unsigned int RenderStats::getDrawCalls()
+{
+    return s_drawCalls;
+}
+
+unsigned long long RenderStats::getTriangles()
+{
+    return s_triangles;
+}
+
+unsigned int RenderStats::getStateChanges()
+{
+    return s_stateChanges;
+}
+
+unsigned int RenderStats::getTextureBinds()
+{
+    return s_textureBinds;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <GL/glew.h>
+
+/// <summary>
+/// Global per-frame counters for the work submitted to the GPU. Reset once per frame and
+/// read back by the benchmark driver and the overlays.
+/// </summary>
+class RenderStats
+{
+    public:
+        /// <summary>
+        /// Resets all the counters, called at the start of a frame
+        /// </summary>
+        static void reset();
+
+        /// <summary>
+        /// Records a draw call
+        /// </summary>
+        /// <param name="triangles">The amount of triangles submitted by the draw</param>
+        static void addDrawCall(GLuint triangles);
+
+        /// <summary>
+        /// Records a state change (a State being applied)
+        /// </summary>
+        static void addStateChange();
+
+        /// <summary>
+        /// Records a texture bound for a draw
+        /// </summary>
+        static void addTextureBind();
+
+        /// <summary>
+        /// Returns the amount of draw calls this frame
+        /// </summary>
+        /// <returns>The draw calls</returns>
+        static unsigned int getDrawCalls();
+
+        /// <summary>
+        /// Returns the amount of triangles this frame
+        /// </summary>
+        /// <returns>The triangles</returns>
+        static unsigned long long getTriangles();
+
+        /// <summary>
+        /// Returns the amount of state changes this frame
+        /// </summary>
+        /// <returns>The state changes</returns>
+        static unsigned int getStateChanges();
+
+        /// <summary>
+        /// Returns the amount of textures bound for draws this frame
+        /// </summary>
+        /// <returns>The texture binds</returns>
+        static unsigned int getTextureBinds();
+
+    private:
+        static unsigned int s_drawCalls;
+        static unsigned long long s_triangles;
+        static unsigned int s_stateChanges;
+        static unsigned int s_textureBinds;
+};
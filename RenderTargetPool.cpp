@@ -0,0 +1,237 @@
+#include "RenderTargetPool.h"
+#include "Texture.h"
+
+#include <algorithm>
+#include <iostream>
+
+bool RenderTargetPool::Description::operator==(const Description& other) const
+{
+    return width == other.width && height == other.height && layers == other.layers &&
+           format == other.format && samples == other.samples && array == other.array;
+}
+
+RenderTargetPool::RenderTargetPool(unsigned int maxUnusedFrames) :
+    m_maxUnusedFrames(maxUnusedFrames),
+    m_frame(0)
+{
+}
+
+RenderTargetPool::~RenderTargetPool()
+{
+    for(auto& framebuffer : m_framebuffers)
+    {
+        glDeleteFramebuffers(1, &framebuffer.second);
+    }
+}
+
+std::shared_ptr<Texture> RenderTargetPool::acquire(const Description& description, unsigned int slot)
+{
+    for(auto& target : m_targets)
+    {
+        if(!target.inUse && target.description == description)
+        {
+            target.inUse = true;
+            target.lastUsed = m_frame;
+            target.texture->setSlot(slot);
+            return target.texture;
+        }
+    }
+
+    std::shared_ptr<Texture> texture = std::shared_ptr<Texture>(new Texture());
+
+    if(!texture->createTarget(slot, description.width, description.height, description.layers, description.format, description.samples, description.array))
+    {
+        std::cerr << "Could not create a " << description.width << "x" << description.height << " render target" << std::endl;
+        return nullptr;
+    }
+
+    m_targets.push_back({ description, texture, true, m_frame });
+    return texture;
+}
+
+void RenderTargetPool::release(std::shared_ptr<Texture> texture)
+{
+    for(auto& target : m_targets)
+    {
+        if(target.texture == texture)
+        {
+            target.inUse = false;
+            target.lastUsed = m_frame;
+            return;
+        }
+    }
+}
+
+GLuint RenderTargetPool::getFramebuffer(std::shared_ptr<Texture> depth, std::shared_ptr<Texture> color)
+{
+    std::vector<std::shared_ptr<Texture>> colors;
+    if(color)
+    {
+        colors.push_back(color);
+    }
+
+    return getFramebuffer(depth, colors);
+}
+
+GLuint RenderTargetPool::getFramebuffer(std::shared_ptr<Texture> depth, const std::vector<std::shared_ptr<Texture>>& colors)
+{
+    std::vector<GLuint> key = { depth ? depth->getId() : 0 };
+    for(auto& color : colors)
+    {
+        key.push_back(color->getId());
+    }
+
+    auto found = m_framebuffers.find(key);
+    if(found != m_framebuffers.end())
+    {
+        return found->second;
+    }
+
+    GLuint fbo = 0;
+    glGenFramebuffers(1, &fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+
+    auto attach = [](GLenum attachment, std::shared_ptr<Texture> texture)
+    {
+        GLenum type = texture->getType();
+        if(type == GL_TEXTURE_2D_ARRAY || type == GL_TEXTURE_2D_MULTISAMPLE_ARRAY)
+        {
+            glFramebufferTextureLayer(GL_FRAMEBUFFER, attachment, texture->getId(), 0, 0);
+        }
+        else
+        {
+            glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, type, texture->getId(), 0);
+        }
+    };
+
+    if(depth)
+    {
+        attach(GL_DEPTH_ATTACHMENT, depth);
+    }
+
+    if(!colors.empty())
+    {
+        std::vector<GLenum> drawBuffers;
+        for(size_t i = 0; i < colors.size(); i++)
+        {
+            attach(GLenum(GL_COLOR_ATTACHMENT0 + i), colors[i]);
+            drawBuffers.push_back(GLenum(GL_COLOR_ATTACHMENT0 + i));
+        }
+
+        glDrawBuffers((GLsizei)drawBuffers.size(), drawBuffers.data());
+        glReadBuffer(GL_COLOR_ATTACHMENT0);
+    }
+    else
+    {
+        glDrawBuffer(GL_NONE);
+        glReadBuffer(GL_NONE);
+    }
+
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    if(status != GL_FRAMEBUFFER_COMPLETE)
+    {
+        std::cerr << "Render target framebuffer is not complete: 0x" << std::hex << status << std::dec << std::endl;
+        glDeleteFramebuffers(1, &fbo);
+        return 0;
+    }
+
+    m_framebuffers[key] = fbo;
+    return fbo;
+}
+
+void RenderTargetPool::endFrame()
+{
+    m_frame++;
+
+    for(auto target = m_targets.begin(); target != m_targets.end();)
+    {
+        if(!target->inUse && m_frame - target->lastUsed > m_maxUnusedFrames)
+        {
+            deleteFramebuffers(target->texture->getId());
+            target = m_targets.erase(target);
+        }
+        else
+        {
+            ++target;
+        }
+    }
+}
+
+unsigned int RenderTargetPool::getTargetCount()
+{
+    return (unsigned int)m_targets.size();
+}
+
+size_t RenderTargetPool::getMemoryUsage()
+{
+    size_t bytes = 0;
+
+    for(auto& target : m_targets)
+    {
+        const Description& d = target.description;
+        bytes += size_t(d.width) * d.height * d.layers * std::max(d.samples, 1u) * bytesPerTexel(d.format);
+    }
+
+    return bytes;
+}
+
+bool RenderTargetPool::isDepthFormat(GLenum format)
+{
+    return format == GL_DEPTH_COMPONENT16 || format == GL_DEPTH_COMPONENT24 || format == GL_DEPTH_COMPONENT32 ||
+           format == GL_DEPTH_COMPONENT32F || format == GL_DEPTH24_STENCIL8 || format == GL_DEPTH32F_STENCIL8;
+}
+
+GLenum RenderTargetPool::depthFormat(unsigned int bits)
+{
+    switch(bits)
+    {
+        case 16:
+            return GL_DEPTH_COMPONENT16;
+        case 24:
+            return GL_DEPTH_COMPONENT24;
+        default:
+            return GL_DEPTH_COMPONENT32;
+    }
+}
+
+void RenderTargetPool::deleteFramebuffers(GLuint texture)
+{
+    for(auto framebuffer = m_framebuffers.begin(); framebuffer != m_framebuffers.end();)
+    {
+        const std::vector<GLuint>& attached = framebuffer->first;
+        if(std::find(attached.begin(), attached.end(), texture) != attached.end())
+        {
+            glDeleteFramebuffers(1, &framebuffer->second);
+            framebuffer = m_framebuffers.erase(framebuffer);
+        }
+        else
+        {
+            ++framebuffer;
+        }
+    }
+}
+
+size_t RenderTargetPool::bytesPerTexel(GLenum format)
+{
+    switch(format)
+    {
+        case GL_R8:
+        case GL_STENCIL_INDEX8:
+            return 1;
+        case GL_DEPTH_COMPONENT16:
+        case GL_R16F:
+        case GL_RG8:
+            return 2;
+        case GL_RGBA16F:
+        case GL_RG32F:
+        case GL_DEPTH32F_STENCIL8:
+            return 8;
+        case GL_RGBA32F:
+            return 16;
+        default:
+            //24 bit depth is padded to 32 bits by the drivers
+            return 4;
+    }
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <map>
+#include <memory>
+#include <utility>
+#include <vector>
+
+class Texture;
+
+/// <summary>
+/// Pool of render target textures and the framebuffers rendering into them. Targets are handed out
+/// by size, format, layers, samples and if they are arrays, and a released target is given to the next pass asking for
+/// the same description instead of allocating a new one. Targets that stay unused for a few frames are deleted.
+/// </summary>
+class RenderTargetPool
+{
+    public:
+        /// <summary>
+        /// What a render target has to look like to be reused
+        /// </summary>
+        struct Description
+        {
+            unsigned int width;
+            unsigned int height;
+            unsigned int layers;
+            GLenum format;
+            unsigned int samples;
+            //Gives an array texture even with a single layer, for shaders sampling it as an array
+            bool array;
+
+            bool operator==(const Description& other) const;
+        };
+
+        /// <summary>
+        /// Constructor
+        /// </summary>
+        /// <param name="maxUnusedFrames">How many frames a released target is kept before it is deleted</param>
+        RenderTargetPool(unsigned int maxUnusedFrames = 3);
+
+        /// <summary>
+        /// Destructor, deletes the framebuffers. The textures are deleted with their last owner
+        /// </summary>
+        ~RenderTargetPool();
+
+        /// <summary>
+        /// Returns a target matching the description, reusing a released one when possible
+        /// </summary>
+        /// <param name="description">The description</param>
+        /// <param name="slot">The texture slot the target is bound to</param>
+        /// <returns>The target, or nullptr if it could not be created</returns>
+        std::shared_ptr<Texture> acquire(const Description& description, unsigned int slot);
+
+        /// <summary>
+        /// Gives a target back to the pool
+        /// </summary>
+        /// <param name="texture">The target</param>
+        void release(std::shared_ptr<Texture> texture);
+
+        /// <summary>
+        /// Returns a framebuffer with the targets attached, layer 0 of array targets is attached.
+        /// The framebuffer is created the first time a combination is asked for
+        /// </summary>
+        /// <param name="depth">The depth attachment, may be nullptr</param>
+        /// <param name="color">The color attachment, may be nullptr</param>
+        /// <returns>The framebuffer, 0 if it is not complete</returns>
+        GLuint getFramebuffer(std::shared_ptr<Texture> depth, std::shared_ptr<Texture> color = nullptr);
+
+        /// <summary>
+        /// Returns a framebuffer with several color targets, attached in order from GL_COLOR_ATTACHMENT0
+        /// and all enabled as draw buffers
+        /// </summary>
+        /// <param name="depth">The depth attachment, may be nullptr</param>
+        /// <param name="colors">The color attachments</param>
+        /// <returns>The framebuffer, 0 if it is not complete</returns>
+        GLuint getFramebuffer(std::shared_ptr<Texture> depth, const std::vector<std::shared_ptr<Texture>>& colors);
+
+        /// <summary>
+        /// Ends the frame and deletes targets that have been unused for too long
+        /// </summary>
+        void endFrame();
+
+        /// <summary>
+        /// Returns the amount of targets owned by the pool
+        /// </summary>
+        unsigned int getTargetCount();
+
+        /// <summary>
+        /// Returns the estimated video memory used by the targets in bytes
+        /// </summary>
+        size_t getMemoryUsage();
+
+        /// <summary>
+        /// Returns if the sized format is a depth format
+        /// </summary>
+        static bool isDepthFormat(GLenum format);
+
+        /// <summary>
+        /// Returns the depth format for a bit depth of 16, 24 or 32, anything else gives 32
+        /// </summary>
+        static GLenum depthFormat(unsigned int bits);
+
+    private:
+        struct Target
+        {
+            Description description;
+            std::shared_ptr<Texture> texture;
+            bool inUse;
+            unsigned long long lastUsed;
+        };
+
+        std::vector<Target> m_targets;
+        //Keyed by the depth texture followed by the color textures
+        std::map<std::vector<GLuint>, GLuint> m_framebuffers;
+        unsigned int m_maxUnusedFrames;
+        unsigned long long m_frame;
+
+        /// <summary>
+        /// Deletes the framebuffers a texture is attached to
+        /// </summary>
+        void deleteFramebuffers(GLuint texture);
+
+        /// <summary>
+        /// Returns the estimated size of a texel
+        /// </summary>
+        static size_t bytesPerTexel(GLenum format);
+};
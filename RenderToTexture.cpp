@@ -2,31 +2,42 @@
 #include "Group.h"
 #include "RenderVisitor.h"
 #include "Texture.h"
+#include "RenderTargetPool.h"
 
 #include <glm/vec3.hpp>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
-RenderToTexture::RenderToTexture(unsigned int textureSlot) : m_renderVisitor(std::shared_ptr<RenderVisitor>(new RenderVisitor()))
+RenderToTexture::RenderToTexture(std::shared_ptr<RenderTargetPool> pool, unsigned int textureSlot, unsigned int size, unsigned int layers, GLenum depthFormat) :
+    m_pool(pool),
+    m_renderVisitor(std::shared_ptr<RenderVisitor>(new RenderVisitor())),
+    m_size(size),
+    m_layers(layers)
 {
-    m_exportTexture = std::shared_ptr<Texture>(new Texture());
-    m_exportTexture->create(textureSlot);
+    //Depth target and framebuffer come from the pool, array layers are attached one at a time in prepare. The target is an
+    //array even with one layer, the shaders sample the cascades as a sampler2DArray
+    m_exportTexture = m_pool->acquire({ m_size, m_size, m_layers, depthFormat, 0, true }, textureSlot);
+    m_fbo = m_exportTexture ? m_pool->getFramebuffer(m_exportTexture) : 0;
+}
 
-    //Framebuffer
-    glGenFramebuffers(1, &m_fbo);
-    glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, m_exportTexture->getId(), 0);
-    glDrawBuffer(GL_NONE);
-    glReadBuffer(GL_NONE);
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+RenderToTexture::~RenderToTexture()
+{
+    m_pool->release(m_exportTexture);
 }
 
-void RenderToTexture::prepare()
+void RenderToTexture::prepare(unsigned int layer, bool clearDepth)
 {
     glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
-    glViewport(0, 0, 1024, 1024);
-    glClear(GL_DEPTH_BUFFER_BIT);
+
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, m_exportTexture->getId(), 0, layer);
+
+    glViewport(0, 0, m_size, m_size);
+
+    if(clearDepth)
+    {
+        glClear(GL_DEPTH_BUFFER_BIT);
+    }
 }
 
 void RenderToTexture::unprepare(glm::uvec2 screensize)
@@ -39,9 +50,11 @@ void RenderToTexture::unprepare(glm::uvec2 screensize)
 void RenderToTexture::render(GLuint program, std::shared_ptr<Camera> camera, std::shared_ptr<Group> node)
 {
     GLuint prevProgram = 0;
+    std::shared_ptr<ShaderPermutations> prevPermutations;
     if(node->hasState())
     {
         prevProgram = node->getState()->getProgram();
+        prevPermutations = node->getState()->getPermutations();
         node->getState()->setCullFace(GL_FRONT);
 	    node->getState()->setProgram(program);
     }
@@ -58,6 +71,7 @@ void RenderToTexture::render(GLuint program, std::shared_ptr<Camera> camera, std
     {
         node->getState()->setCullFace(GL_BACK);
         node->getState()->setProgram(prevProgram);
+        node->getState()->setPermutations(prevPermutations);
     }
 }
 
@@ -65,10 +79,27 @@ void RenderToTexture::clear()
 {
     glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
     glClearColor(0.45f, 0.45f, 0.45f, 1.0f);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    for(unsigned int layer = 0; layer < m_layers; layer++)
+    {
+        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, m_exportTexture->getId(), 0, layer);
+
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    }
+
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
+void RenderToTexture::copyLayer(std::shared_ptr<RenderToTexture> source, unsigned int layer, int sourceX, int sourceY)
+{
+    //Both textures have the same format, so the copy stays on the GPU without a blit. The source may be larger,
+    //the square at the offset is copied
+    std::shared_ptr<Texture> from = source->getTexture();
+    glCopyImageSubData(from->getId(), from->getType(), 0, sourceX, sourceY, layer,
+                       m_exportTexture->getId(), m_exportTexture->getType(), 0, 0, 0, layer,
+                       m_size, m_size, 1);
+}
+
 std::shared_ptr<Texture> RenderToTexture::getTexture()
 {
     return m_exportTexture;
@@ -6,19 +6,25 @@
 class Group;
 class RenderVisitor;
 class Texture;
+class RenderTargetPool;
 
 class RenderToTexture
 {
     public:
-        RenderToTexture(unsigned int textureSlot);
+        RenderToTexture(std::shared_ptr<RenderTargetPool> pool, unsigned int textureSlot, unsigned int size = 1024, unsigned int layers = 1, GLenum depthFormat = GL_DEPTH_COMPONENT32);
+        ~RenderToTexture();
         void render(GLuint program, std::shared_ptr<Camera> camera, std::shared_ptr<Group> node);
-        void prepare();
+        void prepare(unsigned int layer = 0, bool clearDepth = true);
         void unprepare(glm::uvec2 screensize);
         void clear();
+        void copyLayer(std::shared_ptr<RenderToTexture> source, unsigned int layer, int sourceX = 0, int sourceY = 0);
         std::shared_ptr<Texture> getTexture();
 
     private:
+        std::shared_ptr<RenderTargetPool> m_pool;
         unsigned int m_fbo;
+        unsigned int m_size;
+        unsigned int m_layers;
         std::shared_ptr<RenderVisitor> m_renderVisitor;
         std::shared_ptr<Texture> m_exportTexture;
 };
\ No newline at end of file
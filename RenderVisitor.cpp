@@ -2,7 +2,10 @@
 #include "Group.h"
 #include "Transform.h"
 #include "Geometry.h"
+#include "OcclusionCuller.h"
+#include "SceneBVH.h"
 #include <iostream>
+#include <algorithm>
 #include <vr/shaderUtils.h>
 
 RenderVisitor::RenderVisitor()
@@ -15,11 +18,74 @@ void RenderVisitor::resetState()
 {
 	m_stateStack = {};
 	m_stateStack.push(std::shared_ptr<State>(new State()));
+	m_transparentDraws.clear();
 	noMore++;
 }
 
+void RenderVisitor::setFilter(Filter filter)
+{
+	m_filter = filter;
+}
+
+RenderVisitor::Filter RenderVisitor::getFilter()
+{
+	return m_filter;
+}
+
+void RenderVisitor::setOcclusionCuller(std::shared_ptr<OcclusionCuller> culler)
+{
+	m_occlusionCuller = culler;
+}
+
+void RenderVisitor::setSceneBVH(std::shared_ptr<SceneBVH> bvh)
+{
+	m_sceneBVH = bvh;
+}
+
+bool RenderVisitor::isOrderIndependent(std::shared_ptr<State> state)
+{
+	//Without permutations there is no variant writing the transparency targets
+	return state->isTransparent() && state->getPermutations() != nullptr;
+}
+
+void RenderVisitor::drawTransparent()
+{
+	std::stable_sort(m_transparentDraws.begin(), m_transparentDraws.end(), [](const TransparentDraw& a, const TransparentDraw& b)
+	{
+		if(a.program != b.program)
+		{
+			return a.program < b.program;
+		}
+
+		//Textures packed into one array have its id, their draws end up next to each other
+		std::shared_ptr<Texture> textureA = a.state->getTexture(0);
+		std::shared_ptr<Texture> textureB = b.state->getTexture(0);
+		return (textureA ? textureA->getId() : 0) < (textureB ? textureB->getId() : 0);
+	});
+
+	for(auto& draw : m_transparentDraws)
+	{
+		draw.geometry->initShaders(draw.program);
+		draw.state->apply();
+
+		if(draw.hasTransform)
+		{
+			draw.geometry->apply(draw.transform);
+		}
+
+		draw.geometry->render();
+	}
+
+	m_transparentDraws.clear();
+}
+
 void RenderVisitor::visit(Group& g)
 {
+	if(g.isHidden())
+	{
+		return;
+	}
+
 	bool pop = false;
 
 	if(g.hasState())
@@ -41,6 +107,11 @@ void RenderVisitor::visit(Group& g)
 
 void RenderVisitor::visit(Transform& g)
 {
+	if(g.isHidden())
+	{
+		return;
+	}
+
 	if(m_transformationStack.empty())
 	{
 		m_transformationStack.push(g.getModelMatrix());
@@ -73,6 +144,16 @@ void RenderVisitor::visit(Transform& g)
 
 void RenderVisitor::visit(Geometry &g)
 {
+	if(m_sceneBVH && !m_sceneBVH->isVisible(&g))
+	{
+		return;
+	}
+
+	if(m_occlusionCuller && !m_occlusionCuller->isVisible(g.getLocalBoundingBox(), m_transformationStack.empty() ? glm::mat4(1.0f) : m_transformationStack.top()))
+	{
+		return;
+	}
+
 	bool pop = false;
 
 	if(g.hasState())
@@ -84,18 +165,30 @@ void RenderVisitor::visit(Geometry &g)
 		pop = true;
 	}
 
-	g.initShaders(m_stateStack.top()->getProgram());
+	std::shared_ptr<State> state = m_stateStack.top();
+	bool orderIndependent = m_filter != FILTER_ALL && isOrderIndependent(state);
 
-	m_stateStack.top()->apply();
-
-	if(!m_transformationStack.empty())
+	if(m_filter == FILTER_TRANSPARENT && orderIndependent)
 	{
-		glm::mat4 transform = m_transformationStack.top();
-
-		g.apply(transform);
+		state->setOrderIndependent(true);
+		m_transparentDraws.push_back({ &g, state, state->resolveProgram(), !m_transformationStack.empty(),
+		                               m_transformationStack.empty() ? glm::mat4(1.0f) : m_transformationStack.top() });
 	}
+	else if(m_filter == FILTER_ALL || (m_filter == FILTER_OPAQUE && !orderIndependent))
+	{
+		g.initShaders(state->resolveProgram());
+
+		state->apply();
+
+		if(!m_transformationStack.empty())
+		{
+			glm::mat4 transform = m_transformationStack.top();
 
-	g.render();
+			g.apply(transform);
+		}
+
+		g.render();
+	}
 
 	if(pop)
 	{
@@ -12,6 +12,8 @@
 class Group;
 class Transform;
 class Geometry;
+class OcclusionCuller;
+class SceneBVH;
 
 
 /// <summary>
@@ -20,6 +22,16 @@ class Geometry;
 class RenderVisitor : public NodeVisitor
 {
     public:
+        /// <summary>
+        /// Which geometry a traversal draws. Transparent geometry with shader permutations can be drawn by the
+        /// order independent transparency pass, other transparent geometry is drawn with the opaque geometry
+        /// </summary>
+        enum Filter
+        {
+            FILTER_ALL,
+            FILTER_OPAQUE,
+            FILTER_TRANSPARENT
+        };
 
         /// <summary>
         /// The constructor
@@ -31,6 +43,35 @@ class RenderVisitor : public NodeVisitor
         /// </summary>
         void resetState();
 
+        /// <summary>
+        /// Sets which geometry is drawn. Transparent geometry is queued instead of drawn, see drawTransparent
+        /// </summary>
+        /// <param name="filter">The filter</param>
+        void setFilter(Filter filter);
+
+        /// <summary>
+        /// Returns which geometry is drawn
+        /// </summary>
+        Filter getFilter();
+
+        /// <summary>
+        /// Sets the culler geometry is tested against before it is drawn, nullptr draws everything
+        /// </summary>
+        /// <param name="culler">The culler, rendered for the camera of the traversal</param>
+        void setOcclusionCuller(std::shared_ptr<OcclusionCuller> culler);
+
+        /// <summary>
+        /// Sets the hierarchy whose last frustum cull decides which geometry is drawn, nullptr draws everything
+        /// </summary>
+        /// <param name="bvh">The hierarchy, culled for the camera of the traversal</param>
+        void setSceneBVH(std::shared_ptr<SceneBVH> bvh);
+
+        /// <summary>
+        /// Draws the transparent geometry queued by the last traversal with the order independent variants
+        /// of its programs. The order does not matter, so the draws are sorted by program and texture
+        /// </summary>
+        void drawTransparent();
+
         /// <summary>
         /// Visits the group node
         /// </summary>
@@ -50,6 +91,27 @@ class RenderVisitor : public NodeVisitor
         virtual void visit(Geometry &g) override;
 
 	private:
+        /// <summary>
+        /// A transparent draw waiting for drawTransparent
+        /// </summary>
+        struct TransparentDraw
+        {
+            Geometry* geometry;
+            std::shared_ptr<State> state;
+            GLuint program;
+            bool hasTransform;
+            glm::mat4 transform;
+        };
+
 		std::stack<glm::mat4> m_transformationStack;
         std::stack<std::shared_ptr<State>> m_stateStack;
+        Filter m_filter = FILTER_ALL;
+        std::vector<TransparentDraw> m_transparentDraws;
+        std::shared_ptr<OcclusionCuller> m_occlusionCuller;
+        std::shared_ptr<SceneBVH> m_sceneBVH;
+
+        /// <summary>
+        /// Returns if the order independent transparency pass can draw geometry with the state
+        /// </summary>
+        static bool isOrderIndependent(std::shared_ptr<State> state);
 };
\ No newline at end of file
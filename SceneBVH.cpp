@@ -0,0 +1,816 @@
+#include "SceneBVH.h"
+#include "Geometry.h"
+#include "Group.h"
+#include "Profiler.h"
+#include "Transform.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <functional>
+#include <numeric>
+
+namespace
+{
+    const uint32_t NONE = 0xffffffffu;
+
+    bool isEmpty(const BoundingBox& box)
+    {
+        return box.min().x > box.max().x;
+    }
+
+    //Half the surface area, the factor does not matter for comparing splits
+    float area(const BoundingBox& box)
+    {
+        if(isEmpty(box))
+        {
+            return 0.0f;
+        }
+
+        glm::vec3 size = box.max() - box.min();
+        return size.x * size.y + size.y * size.z + size.z * size.x;
+    }
+
+    bool overlaps(const BoundingBox& a, const BoundingBox& b)
+    {
+        return a.min().x <= b.max().x && a.max().x >= b.min().x &&
+               a.min().y <= b.max().y && a.max().y >= b.min().y &&
+               a.min().z <= b.max().z && a.max().z >= b.min().z;
+    }
+
+    bool overlaps(const BoundingBox& box, const glm::vec3& center, float radius)
+    {
+        glm::vec3 closest = glm::clamp(center, box.min(), box.max());
+        glm::vec3 offset = closest - center;
+        return glm::dot(offset, offset) <= radius * radius;
+    }
+
+    //The distance along the ray to where it enters the box, negative when it misses
+    float intersect(const BoundingBox& box, const glm::vec3& origin, const glm::vec3& inverseDirection)
+    {
+        glm::vec3 t0 = (box.min() - origin) * inverseDirection;
+        glm::vec3 t1 = (box.max() - origin) * inverseDirection;
+        glm::vec3 near = glm::min(t0, t1);
+        glm::vec3 far = glm::max(t0, t1);
+
+        float enter = std::max(std::max(near.x, near.y), std::max(near.z, 0.0f));
+        float exit = std::min(std::min(far.x, far.y), far.z);
+
+        return enter <= exit ? enter : -1.0f;
+    }
+
+    //Walks the tree into every node the test accepts and hands the leaves to the visit
+    template<typename TreeNode, typename Test, typename Visit>
+    void traverse(const std::vector<TreeNode>& nodes, std::vector<uint32_t>& stack, Test test, Visit visit)
+    {
+        if(nodes.empty())
+        {
+            return;
+        }
+
+        stack.clear();
+        stack.push_back(0);
+
+        while(!stack.empty())
+        {
+            const TreeNode& node = nodes[stack.back()];
+            stack.pop_back();
+
+            if(!test(node.bounds))
+            {
+                continue;
+            }
+
+            if(node.count > 0)
+            {
+                visit(node.first, node.count);
+            }
+            else
+            {
+                stack.push_back(node.first);
+                stack.push_back(node.first + 1);
+            }
+        }
+    }
+}
+
+SceneBVH::SceneBVH() :
+    m_frame(0),
+    m_staticVersion(0),
+    m_lastMoved(0)
+{
+}
+
+void SceneBVH::build(std::shared_ptr<Group> root)
+{
+    PROFILE_FUNCTION();
+
+    m_paths.clear();
+    m_dynamicPaths.clear();
+    m_entries.clear();
+    m_nodes.clear();
+    m_order.clear();
+    m_centroids.clear();
+    m_geometryIds.clear();
+    m_visible.clear();
+    m_lastMoved = 0;
+
+    collect(root, -1);
+
+    for(uint32_t i = 0; i < (uint32_t)m_paths.size(); i++)
+    {
+        if(m_paths[i].transform && m_paths[i].node->isDynamic())
+        {
+            m_dynamicPaths.push_back(i);
+        }
+    }
+
+    //Geometry without vertices has no bounds and can not be found
+    m_centroids.resize(m_entries.size());
+    for(uint32_t i = 0; i < (uint32_t)m_entries.size(); i++)
+    {
+        const BoundingBox& bounds = m_entries[i].worldBounds;
+        if(!isEmpty(bounds))
+        {
+            m_centroids[i] = (bounds.min() + bounds.max()) * 0.5f;
+            m_order.push_back(i);
+        }
+    }
+
+    m_nodes.reserve(std::max<size_t>(1, 2 * m_order.size() / MAX_LEAF_SIZE));
+
+    if(!m_order.empty())
+    {
+        BoundingBox bounds;
+        for(uint32_t entry : m_order)
+        {
+            bounds.expand(m_entries[entry].worldBounds);
+        }
+        m_nodes.push_back({ bounds, 0, (uint32_t)m_order.size(), NONE });
+
+        //Split with an explicit stack, a scene of identical positions would otherwise recurse once per entry
+        std::vector<uint32_t> pending(1, 0);
+        while(!pending.empty())
+        {
+            uint32_t index = pending.back();
+            pending.pop_back();
+
+            split(index);
+
+            if(m_nodes[index].count == 0)
+            {
+                pending.push_back(m_nodes[index].first);
+                pending.push_back(m_nodes[index].first + 1);
+            }
+        }
+    }
+
+    for(uint32_t i = 0; i < (uint32_t)m_nodes.size(); i++)
+    {
+        const TreeNode& node = m_nodes[i];
+        for(uint32_t k = 0; k < node.count; k++)
+        {
+            m_entries[m_order[node.first + k]].leaf = i;
+        }
+    }
+
+    m_visibleFrames.assign(m_geometryIds.size(), m_frame);
+    m_dirtyFlags.assign(m_nodes.size(), false);
+    m_staticVersion = Node::getStaticVersion();
+}
+
+void SceneBVH::collect(std::shared_ptr<Node> node, int32_t parent)
+{
+    if(Geometry* geometry = dynamic_cast<Geometry*>(node.get()))
+    {
+        if(parent < 0)
+        {
+            return;
+        }
+
+        auto id = m_geometryIds.insert({ geometry, (uint32_t)m_geometryIds.size() }).first;
+
+        Entry entry;
+        entry.geometry = geometry;
+        entry.geometryId = id->second;
+        entry.path = (uint32_t)parent;
+        entry.leaf = NONE;
+        entry.localBounds = geometry->getLocalBoundingBox();
+        entry.worldBounds = isEmpty(entry.localBounds) ? BoundingBox() : transform(entry.localBounds, m_paths[parent].world);
+        m_entries.push_back(entry);
+        return;
+    }
+
+    std::shared_ptr<Group> group = std::dynamic_pointer_cast<Group>(node);
+    if(!group)
+    {
+        return;
+    }
+
+    //Disabled children are collected too, they are only skipped by the queries
+    PathNode path;
+    path.node = group.get();
+    path.transform = dynamic_cast<Transform*>(group.get());
+    path.parent = parent;
+    path.world = parent < 0 ? glm::mat4(1.0f) : m_paths[parent].world;
+    path.version = 0;
+
+    if(path.transform)
+    {
+        path.world = path.world * path.transform->getModelMatrix();
+        path.version = path.transform->getVersion();
+    }
+
+    path.firstEntry = (uint32_t)m_entries.size();
+
+    uint32_t index = (uint32_t)m_paths.size();
+    m_paths.push_back(path);
+
+    for(auto& child : group->getChildren())
+    {
+        collect(child, (int32_t)index);
+    }
+
+    m_paths[index].endEntry = (uint32_t)m_entries.size();
+    m_paths[index].endPath = (uint32_t)m_paths.size();
+}
+
+void SceneBVH::split(uint32_t index)
+{
+    TreeNode node = m_nodes[index];
+    if(node.count <= MAX_LEAF_SIZE)
+    {
+        return;
+    }
+
+    uint32_t* begin = m_order.data() + node.first;
+    uint32_t* end = begin + node.count;
+
+    BoundingBox centroidBounds;
+    for(uint32_t* it = begin; it != end; it++)
+    {
+        centroidBounds.expand(m_centroids[*it]);
+    }
+
+    glm::vec3 extent = centroidBounds.max() - centroidBounds.min();
+    int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+
+    uint32_t* middle = begin;
+    BoundingBox leftBounds;
+    BoundingBox rightBounds;
+
+    if(extent[axis] > 0.0f)
+    {
+        //Binned SAH, the entries are sorted into bins by centroid and the best boundary between two bins is taken
+        uint32_t counts[BINS] = {};
+        BoundingBox bins[BINS];
+        float scale = float(BINS) / extent[axis];
+        float offset = centroidBounds.min()[axis];
+
+        auto binOf = [&](uint32_t entry)
+        {
+            return std::min(BINS - 1, uint32_t((m_centroids[entry][axis] - offset) * scale));
+        };
+
+        for(uint32_t* it = begin; it != end; it++)
+        {
+            uint32_t bin = binOf(*it);
+            counts[bin]++;
+            bins[bin].expand(m_entries[*it].worldBounds);
+        }
+
+        float rightCosts[BINS];
+        BoundingBox sweep;
+        uint32_t count = 0;
+        for(uint32_t b = BINS - 1; b > 0; b--)
+        {
+            sweep.expand(bins[b]);
+            count += counts[b];
+            rightCosts[b] = area(sweep) * float(count);
+        }
+
+        float bestCost = FLT_MAX;
+        uint32_t best = 1;
+        sweep = BoundingBox();
+        count = 0;
+        for(uint32_t b = 1; b < BINS; b++)
+        {
+            sweep.expand(bins[b - 1]);
+            count += counts[b - 1];
+
+            if(count == 0 || count == node.count)
+            {
+                continue;
+            }
+
+            float cost = area(sweep) * float(count) + rightCosts[b];
+            if(cost < bestCost)
+            {
+                bestCost = cost;
+                best = b;
+            }
+        }
+
+        middle = std::partition(begin, end, [&](uint32_t entry) { return binOf(entry) < best; });
+    }
+
+    if(middle == begin || middle == end)
+    {
+        //Every centroid is in the same place, any split is as good as another
+        middle = begin + node.count / 2;
+    }
+
+    for(uint32_t* it = begin; it != middle; it++)
+    {
+        leftBounds.expand(m_entries[*it].worldBounds);
+    }
+    for(uint32_t* it = middle; it != end; it++)
+    {
+        rightBounds.expand(m_entries[*it].worldBounds);
+    }
+
+    uint32_t left = (uint32_t)m_nodes.size();
+    uint32_t leftCount = uint32_t(middle - begin);
+    m_nodes.push_back({ leftBounds, node.first, leftCount, index });
+    m_nodes.push_back({ rightBounds, node.first + leftCount, node.count - leftCount, index });
+
+    m_nodes[index].first = left;
+    m_nodes[index].count = 0;
+}
+
+void SceneBVH::refit()
+{
+    PROFILE_FUNCTION();
+
+    m_lastMoved = 0;
+
+    auto changed = [this](uint32_t path)
+    {
+        return m_paths[path].transform && m_paths[path].transform->getVersion() != m_paths[path].version;
+    };
+
+    unsigned long long staticVersion = Node::getStaticVersion();
+    if(staticVersion != m_staticVersion)
+    {
+        //A static node changed, or a node became dynamic, so every transform is checked once
+        m_staticVersion = staticVersion;
+        m_dynamicPaths.clear();
+
+        for(uint32_t i = 0; i < (uint32_t)m_paths.size(); i++)
+        {
+            if(m_paths[i].transform && m_paths[i].node->isDynamic())
+            {
+                m_dynamicPaths.push_back(i);
+            }
+        }
+
+        for(uint32_t i = 0; i < (uint32_t)m_paths.size();)
+        {
+            if(changed(i))
+            {
+                updatePath(i);
+                i = m_paths[i].endPath;
+            }
+            else
+            {
+                i++;
+            }
+        }
+    }
+    else
+    {
+        for(uint32_t path : m_dynamicPaths)
+        {
+            if(changed(path))
+            {
+                updatePath(path);
+            }
+        }
+    }
+
+    if(m_dirty.empty())
+    {
+        return;
+    }
+
+    //Children come after their parent, so going backwards refits every child before its parent
+    std::sort(m_dirty.begin(), m_dirty.end(), std::greater<uint32_t>());
+
+    for(uint32_t index : m_dirty)
+    {
+        TreeNode& node = m_nodes[index];
+        BoundingBox bounds;
+
+        if(node.count > 0)
+        {
+            for(uint32_t k = 0; k < node.count; k++)
+            {
+                bounds.expand(m_entries[m_order[node.first + k]].worldBounds);
+            }
+        }
+        else
+        {
+            bounds.expand(m_nodes[node.first].bounds);
+            bounds.expand(m_nodes[node.first + 1].bounds);
+        }
+
+        node.bounds = bounds;
+        m_dirtyFlags[index] = false;
+    }
+
+    m_dirty.clear();
+}
+
+void SceneBVH::updatePath(uint32_t path)
+{
+    for(uint32_t i = path; i < m_paths[path].endPath; i++)
+    {
+        PathNode& node = m_paths[i];
+        node.world = node.parent < 0 ? glm::mat4(1.0f) : m_paths[node.parent].world;
+
+        if(node.transform)
+        {
+            node.world = node.world * node.transform->getModelMatrix();
+            node.version = node.transform->getVersion();
+        }
+    }
+
+    for(uint32_t i = m_paths[path].firstEntry; i < m_paths[path].endEntry; i++)
+    {
+        Entry& entry = m_entries[i];
+        if(entry.leaf == NONE)
+        {
+            continue;
+        }
+
+        entry.worldBounds = transform(entry.localBounds, m_paths[entry.path].world);
+        m_lastMoved++;
+
+        for(uint32_t index = entry.leaf; index != NONE && !m_dirtyFlags[index]; index = m_nodes[index].parent)
+        {
+            m_dirtyFlags[index] = true;
+            m_dirty.push_back(index);
+        }
+    }
+}
+
+bool SceneBVH::isEnabled(uint32_t entry)
+{
+    for(int32_t path = (int32_t)m_entries[entry].path; path >= 0; path = m_paths[path].parent)
+    {
+        if(!m_paths[path].node->isEnabled())
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void SceneBVH::queryFrustum(const glm::mat4& viewProjection, std::vector<uint32_t>& result)
+{
+    PROFILE_FUNCTION();
+
+    if(m_nodes.empty())
+    {
+        return;
+    }
+
+    glm::vec4 planes[6];
+    extractPlanes(viewProjection, planes);
+
+    //The low bits are the node, the high bits the planes the node is not yet known to be inside of
+    const uint32_t ALL_PLANES = 63u << 26;
+    const uint32_t INDEX_MASK = (1u << 26) - 1;
+
+    m_stack.clear();
+    m_stack.push_back(ALL_PLANES);
+
+    while(!m_stack.empty())
+    {
+        uint32_t item = m_stack.back();
+        m_stack.pop_back();
+
+        const TreeNode& node = m_nodes[item & INDEX_MASK];
+        uint32_t mask = item >> 26;
+        bool outside = false;
+
+        for(int i = 0; i < 6 && mask != 0; i++)
+        {
+            if(!(mask & (1u << i)))
+            {
+                continue;
+            }
+
+            glm::vec3 normal = glm::vec3(planes[i]);
+            glm::vec3 positive = glm::vec3(normal.x > 0.0f ? node.bounds.max().x : node.bounds.min().x,
+                                           normal.y > 0.0f ? node.bounds.max().y : node.bounds.min().y,
+                                           normal.z > 0.0f ? node.bounds.max().z : node.bounds.min().z);
+            glm::vec3 negative = node.bounds.min() + node.bounds.max() - positive;
+
+            if(glm::dot(normal, positive) + planes[i].w < 0.0f)
+            {
+                outside = true;
+                break;
+            }
+
+            if(glm::dot(normal, negative) + planes[i].w >= 0.0f)
+            {
+                mask &= ~(1u << i);
+            }
+        }
+
+        if(outside)
+        {
+            continue;
+        }
+
+        if(node.count > 0)
+        {
+            for(uint32_t k = 0; k < node.count; k++)
+            {
+                uint32_t entry = m_order[node.first + k];
+                if((mask == 0 || intersects(planes, m_entries[entry].worldBounds)) && isEnabled(entry))
+                {
+                    result.push_back(entry);
+                }
+            }
+        }
+        else
+        {
+            m_stack.push_back(node.first | (mask << 26));
+            m_stack.push_back((node.first + 1) | (mask << 26));
+        }
+    }
+}
+
+void SceneBVH::queryBox(const BoundingBox& box, std::vector<uint32_t>& result)
+{
+    traverse(m_nodes, m_stack, [&](const BoundingBox& bounds) { return overlaps(bounds, box); },
+        [&](uint32_t first, uint32_t count)
+        {
+            for(uint32_t k = 0; k < count; k++)
+            {
+                uint32_t entry = m_order[first + k];
+                if(overlaps(m_entries[entry].worldBounds, box) && isEnabled(entry))
+                {
+                    result.push_back(entry);
+                }
+            }
+        });
+}
+
+void SceneBVH::querySphere(const glm::vec3& center, float radius, std::vector<uint32_t>& result)
+{
+    traverse(m_nodes, m_stack, [&](const BoundingBox& bounds) { return overlaps(bounds, center, radius); },
+        [&](uint32_t first, uint32_t count)
+        {
+            for(uint32_t k = 0; k < count; k++)
+            {
+                uint32_t entry = m_order[first + k];
+                if(overlaps(m_entries[entry].worldBounds, center, radius) && isEnabled(entry))
+                {
+                    result.push_back(entry);
+                }
+            }
+        });
+}
+
+bool SceneBVH::pick(const glm::vec3& origin, const glm::vec3& direction, Hit& hit)
+{
+    PROFILE_FUNCTION();
+
+    if(m_nodes.empty())
+    {
+        return false;
+    }
+
+    glm::vec3 inverseDirection = 1.0f / direction;
+    float nearest = FLT_MAX;
+    bool found = false;
+
+    m_stack.clear();
+    m_stack.push_back(0);
+
+    while(!m_stack.empty())
+    {
+        const TreeNode& node = m_nodes[m_stack.back()];
+        m_stack.pop_back();
+
+        float distance = ::intersect(node.bounds, origin, inverseDirection);
+        if(distance < 0.0f || distance >= nearest)
+        {
+            continue;
+        }
+
+        if(node.count > 0)
+        {
+            for(uint32_t k = 0; k < node.count; k++)
+            {
+                uint32_t entry = m_order[node.first + k];
+                float entryDistance = ::intersect(m_entries[entry].worldBounds, origin, inverseDirection);
+                if(entryDistance < 0.0f || entryDistance >= nearest || !isEnabled(entry))
+                {
+                    continue;
+                }
+
+                float t = intersect(entry, origin, direction, nearest);
+                if(t >= 0.0f)
+                {
+                    nearest = t;
+                    hit.entry = entry;
+                    found = true;
+                }
+            }
+        }
+        else
+        {
+            //The nearer child is visited first, so the far one can often be skipped
+            uint32_t first = node.first;
+            uint32_t second = node.first + 1;
+            float firstDistance = ::intersect(m_nodes[first].bounds, origin, inverseDirection);
+            float secondDistance = ::intersect(m_nodes[second].bounds, origin, inverseDirection);
+
+            if(secondDistance >= 0.0f && (firstDistance < 0.0f || secondDistance < firstDistance))
+            {
+                std::swap(first, second);
+            }
+
+            m_stack.push_back(second);
+            m_stack.push_back(first);
+        }
+    }
+
+    if(found)
+    {
+        hit.distance = nearest;
+        hit.position = origin + direction * nearest;
+    }
+
+    return found;
+}
+
+float SceneBVH::intersect(uint32_t entry, const glm::vec3& origin, const glm::vec3& direction, float maxDistance)
+{
+    //The ray is moved into object space instead of every vertex into world space, distances along it stay the same
+    glm::mat4 toObject = glm::inverse(m_paths[m_entries[entry].path].world);
+    glm::vec3 o = glm::vec3(toObject * glm::vec4(origin, 1.0f));
+    glm::vec3 d = glm::vec3(toObject * glm::vec4(direction, 0.0f));
+
+    Geometry* geometry = m_entries[entry].geometry;
+    const std::vector<glm::vec4>& vertices = geometry->getVertices();
+    const std::vector<GLushort>& elements = geometry->getElements();
+    size_t count = elements.empty() ? vertices.size() : elements.size();
+
+    float nearest = -1.0f;
+
+    for(size_t i = 0; i + 2 < count; i += 3)
+    {
+        glm::vec3 v0 = glm::vec3(vertices[elements.empty() ? i : elements[i]]);
+        glm::vec3 v1 = glm::vec3(vertices[elements.empty() ? i + 1 : elements[i + 1]]);
+        glm::vec3 v2 = glm::vec3(vertices[elements.empty() ? i + 2 : elements[i + 2]]);
+
+        //Moller-Trumbore, both sides of the triangle are hit
+        glm::vec3 e1 = v1 - v0;
+        glm::vec3 e2 = v2 - v0;
+        glm::vec3 p = glm::cross(d, e2);
+        float determinant = glm::dot(e1, p);
+        if(std::abs(determinant) < 1e-12f)
+        {
+            continue;
+        }
+
+        float inverse = 1.0f / determinant;
+        glm::vec3 s = o - v0;
+        float u = glm::dot(s, p) * inverse;
+        if(u < 0.0f || u > 1.0f)
+        {
+            continue;
+        }
+
+        glm::vec3 q = glm::cross(s, e1);
+        float v = glm::dot(d, q) * inverse;
+        if(v < 0.0f || u + v > 1.0f)
+        {
+            continue;
+        }
+
+        float t = glm::dot(e2, q) * inverse;
+        if(t >= 0.0f && t < maxDistance)
+        {
+            maxDistance = t;
+            nearest = t;
+        }
+    }
+
+    return nearest;
+}
+
+void SceneBVH::cull(const glm::mat4& viewProjection)
+{
+    m_frame++;
+
+    m_visible.clear();
+    queryFrustum(viewProjection, m_visible);
+
+    for(uint32_t entry : m_visible)
+    {
+        m_visibleFrames[m_entries[entry].geometryId] = m_frame;
+    }
+}
+
+bool SceneBVH::isVisible(const Geometry* geometry)
+{
+    auto found = m_geometryIds.find(geometry);
+    return found == m_geometryIds.end() || m_visibleFrames[found->second] == m_frame;
+}
+
+const std::vector<uint32_t>& SceneBVH::getVisibleEntries()
+{
+    return m_visible;
+}
+
+uint32_t SceneBVH::getNumEntries()
+{
+    return (uint32_t)m_entries.size();
+}
+
+Geometry* SceneBVH::getGeometry(uint32_t entry)
+{
+    return m_entries[entry].geometry;
+}
+
+const glm::mat4& SceneBVH::getModelMatrix(uint32_t entry)
+{
+    return m_paths[m_entries[entry].path].world;
+}
+
+const BoundingBox& SceneBVH::getWorldBoundingBox(uint32_t entry)
+{
+    return m_entries[entry].worldBounds;
+}
+
+std::string SceneBVH::getPath(uint32_t entry)
+{
+    std::string path = m_entries[entry].geometry->getName();
+
+    for(int32_t i = (int32_t)m_entries[entry].path; i >= 0; i = m_paths[i].parent)
+    {
+        path = m_paths[i].node->getName() + "/" + path;
+    }
+
+    return path;
+}
+
+uint32_t SceneBVH::getNumNodes()
+{
+    return (uint32_t)m_nodes.size();
+}
+
+uint32_t SceneBVH::getLastMoved()
+{
+    return m_lastMoved;
+}
+
+void SceneBVH::extractPlanes(const glm::mat4& viewProjection, glm::vec4 planes[6])
+{
+    glm::vec4 row0 = glm::vec4(viewProjection[0][0], viewProjection[1][0], viewProjection[2][0], viewProjection[3][0]);
+    glm::vec4 row1 = glm::vec4(viewProjection[0][1], viewProjection[1][1], viewProjection[2][1], viewProjection[3][1]);
+    glm::vec4 row2 = glm::vec4(viewProjection[0][2], viewProjection[1][2], viewProjection[2][2], viewProjection[3][2]);
+    glm::vec4 row3 = glm::vec4(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]);
+
+    planes[0] = row3 + row0;
+    planes[1] = row3 - row0;
+    planes[2] = row3 + row1;
+    planes[3] = row3 - row1;
+    planes[4] = row3 + row2;
+    planes[5] = row3 - row2;
+}
+
+bool SceneBVH::intersects(const glm::vec4 planes[6], const BoundingBox& box)
+{
+    for(int i = 0; i < 6; i++)
+    {
+        glm::vec3 positive = glm::vec3(planes[i].x > 0.0f ? box.max().x : box.min().x,
+                                       planes[i].y > 0.0f ? box.max().y : box.min().y,
+                                       planes[i].z > 0.0f ? box.max().z : box.min().z);
+
+        if(glm::dot(glm::vec3(planes[i]), positive) + planes[i].w < 0.0f)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+BoundingBox SceneBVH::transform(const BoundingBox& box, const glm::mat4& matrix)
+{
+    glm::vec3 center = glm::vec3(matrix * glm::vec4((box.min() + box.max()) * 0.5f, 1.0f));
+    glm::vec3 halfSize = (box.max() - box.min()) * 0.5f;
+
+    glm::vec3 extent = glm::abs(glm::vec3(matrix[0])) * halfSize.x +
+                       glm::abs(glm::vec3(matrix[1])) * halfSize.y +
+                       glm::abs(glm::vec3(matrix[2])) * halfSize.z;
+
+    return BoundingBox(center - extent, center + extent);
+}
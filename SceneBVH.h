@@ -0,0 +1,240 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "BoundingBox.h"
+
+class Node;
+class Group;
+class Transform;
+class Geometry;
+
+/// <summary>
+/// Bounding volume hierarchy over the world bounds of every geometry in a scene. Every place a geometry is reached from
+/// the root is an entry of its own, so instances are found separately. The tree is built with the surface area heuristic
+/// and refit when transforms move: only the entries below a moved transform get new bounds, and only the tree nodes above
+/// them are refit, so the cost follows the amount of moved entries instead of the size of the scene. Entries in disabled
+/// subtrees stay in the tree and are skipped by the queries, so LOD levels and impostors do not require a rebuild.
+/// </summary>
+class SceneBVH
+{
+    public:
+        /// <summary>
+        /// A ray hit
+        /// </summary>
+        struct Hit
+        {
+            uint32_t entry;
+            float distance;
+            glm::vec3 position;
+        };
+
+        /// <summary>
+        /// Constructor
+        /// </summary>
+        SceneBVH();
+
+        /// <summary>
+        /// Collects the geometries below the root and builds the tree
+        /// </summary>
+        /// <param name="root">The root of the scene</param>
+        void build(std::shared_ptr<Group> root);
+
+        /// <summary>
+        /// Updates the bounds of the entries below transforms that changed since the last build or refit. Transforms marked
+        /// as dynamic are checked every time, the others only when the static version of the scene changed
+        /// </summary>
+        void refit();
+
+        /// <summary>
+        /// Finds the entries overlapping a frustum
+        /// </summary>
+        /// <param name="viewProjection">The projection times the view of the camera</param>
+        /// <param name="result">The entries, appended</param>
+        void queryFrustum(const glm::mat4& viewProjection, std::vector<uint32_t>& result);
+
+        /// <summary>
+        /// Finds the entries overlapping a box
+        /// </summary>
+        /// <param name="box">The box in world space</param>
+        /// <param name="result">The entries, appended</param>
+        void queryBox(const BoundingBox& box, std::vector<uint32_t>& result);
+
+        /// <summary>
+        /// Finds the entries overlapping a sphere
+        /// </summary>
+        /// <param name="center">The center in world space</param>
+        /// <param name="radius">The radius</param>
+        /// <param name="result">The entries, appended</param>
+        void querySphere(const glm::vec3& center, float radius, std::vector<uint32_t>& result);
+
+        /// <summary>
+        /// Finds the nearest triangle a ray hits
+        /// </summary>
+        /// <param name="origin">The origin in world space</param>
+        /// <param name="direction">The direction in world space, the distance is measured in its length</param>
+        /// <param name="hit">The hit</param>
+        /// <returns>Flag for if a triangle was hit</returns>
+        bool pick(const glm::vec3& origin, const glm::vec3& direction, Hit& hit);
+
+        /// <summary>
+        /// Marks the geometries in a frustum as visible, see isVisible
+        /// </summary>
+        /// <param name="viewProjection">The projection times the view of the camera</param>
+        void cull(const glm::mat4& viewProjection);
+
+        /// <summary>
+        /// Returns if an instance of a geometry was in the frustum of the last cull. Geometry that was not in the scene at
+        /// the last build is always visible
+        /// </summary>
+        bool isVisible(const Geometry* geometry);
+
+        /// <summary>
+        /// Returns the entries in the frustum of the last cull
+        /// </summary>
+        const std::vector<uint32_t>& getVisibleEntries();
+
+        /// <summary>
+        /// Returns the amount of entries
+        /// </summary>
+        uint32_t getNumEntries();
+
+        /// <summary>
+        /// Returns the geometry of an entry
+        /// </summary>
+        Geometry* getGeometry(uint32_t entry);
+
+        /// <summary>
+        /// Returns the object to world matrix of an entry
+        /// </summary>
+        const glm::mat4& getModelMatrix(uint32_t entry);
+
+        /// <summary>
+        /// Returns the bounds of an entry in world space
+        /// </summary>
+        const BoundingBox& getWorldBoundingBox(uint32_t entry);
+
+        /// <summary>
+        /// Returns the names of the nodes from the root to an entry, separated by slashes
+        /// </summary>
+        std::string getPath(uint32_t entry);
+
+        /// <summary>
+        /// Returns the amount of tree nodes
+        /// </summary>
+        uint32_t getNumNodes();
+
+        /// <summary>
+        /// Returns the amount of entries that got new bounds in the last refit
+        /// </summary>
+        uint32_t getLastMoved();
+
+        /// <summary>
+        /// Extracts the planes of a frustum, pointing inwards
+        /// </summary>
+        /// <param name="viewProjection">The projection times the view of the camera</param>
+        /// <param name="planes">The left, right, bottom, top, near and far planes</param>
+        static void extractPlanes(const glm::mat4& viewProjection, glm::vec4 planes[6]);
+
+        /// <summary>
+        /// Returns if a box is not entirely outside one of the planes of a frustum
+        /// </summary>
+        static bool intersects(const glm::vec4 planes[6], const BoundingBox& box);
+
+        /// <summary>
+        /// Returns the bounds of a box after a transformation
+        /// </summary>
+        static BoundingBox transform(const BoundingBox& box, const glm::mat4& matrix);
+
+    private:
+        static const uint32_t MAX_LEAF_SIZE = 4;
+        static const uint32_t BINS = 16;
+
+        /// <summary>
+        /// A group or transform on the way to the entries, in depth first order so a subtree is one range
+        /// </summary>
+        struct PathNode
+        {
+            Node* node;
+            Transform* transform;
+            int32_t parent;
+            glm::mat4 world;
+            unsigned long long version;
+            uint32_t firstEntry;
+            uint32_t endEntry;
+            uint32_t endPath;
+        };
+
+        /// <summary>
+        /// A geometry reached through a path
+        /// </summary>
+        struct Entry
+        {
+            Geometry* geometry;
+            uint32_t geometryId;
+            uint32_t path;
+            uint32_t leaf;
+            BoundingBox localBounds;
+            BoundingBox worldBounds;
+        };
+
+        /// <summary>
+        /// A tree node, a leaf when count is not 0. The children of an inner node are next to each other, after their parent
+        /// </summary>
+        struct TreeNode
+        {
+            BoundingBox bounds;
+            uint32_t first;
+            uint32_t count;
+            uint32_t parent;
+        };
+
+        std::vector<PathNode> m_paths;
+        std::vector<uint32_t> m_dynamicPaths;
+        std::vector<Entry> m_entries;
+        std::vector<TreeNode> m_nodes;
+        std::vector<uint32_t> m_order;
+        std::vector<glm::vec3> m_centroids;
+
+        std::unordered_map<const Geometry*, uint32_t> m_geometryIds;
+        std::vector<uint32_t> m_visibleFrames;
+        std::vector<uint32_t> m_visible;
+        uint32_t m_frame;
+
+        unsigned long long m_staticVersion;
+        uint32_t m_lastMoved;
+        std::vector<uint32_t> m_dirty;
+        std::vector<bool> m_dirtyFlags;
+        std::vector<uint32_t> m_stack;
+
+        /// <summary>
+        /// Adds the path nodes and entries below a node
+        /// </summary>
+        void collect(std::shared_ptr<Node> node, int32_t parent);
+
+        /// <summary>
+        /// Splits the entries of a tree node with the surface area heuristic
+        /// </summary>
+        void split(uint32_t index);
+
+        /// <summary>
+        /// Recalculates the world matrices and entry bounds below a path node and marks their leaves
+        /// </summary>
+        void updatePath(uint32_t path);
+
+        /// <summary>
+        /// Returns if the entry is reached by the visitors, no node on its path is disabled
+        /// </summary>
+        bool isEnabled(uint32_t entry);
+
+        /// <summary>
+        /// Returns the distance along a ray to a triangle of the entry, or a negative value
+        /// </summary>
+        float intersect(uint32_t entry, const glm::vec3& origin, const glm::vec3& direction, float maxDistance);
+};
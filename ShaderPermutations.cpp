@@ -0,0 +1,224 @@
+#include "ShaderPermutations.h"
+#include "ProgramCache.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+ShaderPermutations::ShaderPermutations(GLuint baseProgram, const std::string& vshader_filename, const std::string& fshader_filename, std::shared_ptr<ProgramCache> cache) :
+    m_baseProgram(baseProgram),
+    m_vshaderFilename(vshader_filename),
+    m_fshaderFilename(fshader_filename),
+    m_cache(cache),
+    m_shadowsEnabled(true)
+{
+}
+
+ShaderPermutations::~ShaderPermutations()
+{
+    for(auto& variant : m_variants)
+    {
+        if(variant.second != m_baseProgram)
+        {
+            glDeleteProgram(variant.second);
+        }
+    }
+}
+
+GLuint ShaderPermutations::get(Features features)
+{
+    features.shadows = features.shadows && m_shadowsEnabled;
+    features.numLights = std::min(features.numLights, MAX_LIGHTS);
+
+    //Without textures the output alpha is always 1, so blending does not need its own variant
+    features.alphaBlend = features.alphaBlend && features.textured;
+    features.bindless = features.bindless && features.textured;
+
+    unsigned int key = (features.shadows ? 1 : 0) | (features.textured ? 2 : 0) | (features.alphaBlend ? 4 : 0) | (features.oit ? 8 : 0) | (features.impostor ? 16 : 0) | (features.bindless ? 32 : 0) | (features.numLights << 6);
+
+    auto variant = m_variants.find(key);
+    if(variant != m_variants.end())
+    {
+        return variant->second;
+    }
+
+    GLuint program = compile(defines(features));
+
+    if(program == 0)
+    {
+        std::cerr << "Could not compile shader variant, using the base program:\n" << defines(features) << std::endl;
+        program = m_baseProgram;
+    }
+    else if(m_programCreatedCallback)
+    {
+        m_programCreatedCallback(program);
+    }
+
+    m_variants[key] = program;
+    return program;
+}
+
+std::vector<GLuint> ShaderPermutations::getPrograms()
+{
+    std::vector<GLuint> programs = { m_baseProgram };
+
+    for(auto& variant : m_variants)
+    {
+        if(variant.second != m_baseProgram)
+        {
+            programs.push_back(variant.second);
+        }
+    }
+
+    return programs;
+}
+
+void ShaderPermutations::setShadowsEnabled(bool flag)
+{
+    m_shadowsEnabled = flag;
+}
+
+void ShaderPermutations::setProgramCreatedCallback(std::function<void(GLuint)> callback)
+{
+    m_programCreatedCallback = callback;
+}
+
+std::string ShaderPermutations::defines(const Features& features)
+{
+    std::ostringstream str;
+    str << "#define SHADOWS " << (features.shadows ? 1 : 0) << "\n";
+    str << "#define NUM_LIGHTS " << features.numLights << "\n";
+    str << "#define TEXTURED " << (features.textured ? 1 : 0) << "\n";
+    str << "#define ALPHA_BLEND " << (features.alphaBlend ? 1 : 0) << "\n";
+    str << "#define OIT " << (features.oit ? 1 : 0) << "\n";
+    str << "#define IMPOSTOR " << (features.impostor ? 1 : 0) << "\n";
+    str << "#define BINDLESS " << (features.bindless ? 1 : 0) << "\n";
+    return str.str();
+}
+
+GLuint ShaderPermutations::compile(const std::string& defines)
+{
+    GLuint program = glCreateProgram();
+
+    uint64_t key = 0;
+    if(m_cache)
+    {
+        key = m_cache->key({ { GL_VERTEX_SHADER, m_vshaderFilename }, { GL_FRAGMENT_SHADER, m_fshaderFilename } }, defines);
+
+        if(m_cache->load(program, key))
+        {
+            return program;
+        }
+    }
+
+    GLuint vs = compileShader(GL_VERTEX_SHADER, m_vshaderFilename, defines);
+    GLuint fs = compileShader(GL_FRAGMENT_SHADER, m_fshaderFilename, defines);
+
+    if(vs == 0 || fs == 0)
+    {
+        glDeleteShader(vs);
+        glDeleteShader(fs);
+        glDeleteProgram(program);
+        return 0;
+    }
+
+    glAttachShader(program, vs);
+    glAttachShader(program, fs);
+
+    //Match the attribute locations of the base program, the vertex arrays are set up with those
+    GLint attributes = 0;
+    GLint maxLength = 0;
+    glGetProgramiv(m_baseProgram, GL_ACTIVE_ATTRIBUTES, &attributes);
+    glGetProgramiv(m_baseProgram, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &maxLength);
+
+    std::vector<GLchar> name(std::max(maxLength, 1));
+    for(GLint i = 0; i < attributes; i++)
+    {
+        GLint size;
+        GLenum type;
+        glGetActiveAttrib(m_baseProgram, i, (GLsizei)name.size(), nullptr, &size, &type, name.data());
+
+        GLint location = glGetAttribLocation(m_baseProgram, name.data());
+        if(location >= 0)
+        {
+            glBindAttribLocation(program, location, name.data());
+        }
+    }
+
+    glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glLinkProgram(program);
+
+    //The program keeps the compiled stages alive
+    glDeleteShader(vs);
+    glDeleteShader(fs);
+
+    GLint link_ok = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &link_ok);
+
+    if(!link_ok)
+    {
+        GLint length = 0;
+        glGetProgramiv(program, GL_INFO_LOG_LENGTH, &length);
+        std::vector<GLchar> log(std::max(length, 1));
+        glGetProgramInfoLog(program, (GLsizei)log.size(), nullptr, log.data());
+        std::cerr << "Could not link shader variant: " << log.data() << std::endl;
+
+        glDeleteProgram(program);
+        return 0;
+    }
+
+    if(m_cache)
+    {
+        m_cache->store(program, key);
+    }
+
+    return program;
+}
+
+GLuint ShaderPermutations::compileShader(GLenum type, const std::string& filename, const std::string& defines)
+{
+    std::ifstream file(filename);
+
+    if(!file.is_open())
+    {
+        std::cerr << "Could not open shader: " << filename << std::endl;
+        return 0;
+    }
+
+    std::stringstream str;
+    str << file.rdbuf();
+    std::string source = str.str();
+
+    //#version has to stay the first statement, so the defines go right after it
+    size_t insertAt = 0;
+    size_t version = source.find("#version");
+    if(version != std::string::npos)
+    {
+        size_t lineEnd = source.find('\n', version);
+        insertAt = lineEnd == std::string::npos ? source.size() : lineEnd + 1;
+    }
+    source.insert(insertAt, defines + "#line 2\n");
+
+    GLuint shader = glCreateShader(type);
+    const GLchar* sources[] = { source.c_str() };
+    glShaderSource(shader, 1, sources, nullptr);
+    glCompileShader(shader);
+
+    GLint compile_ok = GL_FALSE;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &compile_ok);
+
+    if(!compile_ok)
+    {
+        GLint length = 0;
+        glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &length);
+        std::vector<GLchar> log(std::max(length, 1));
+        glGetShaderInfoLog(shader, (GLsizei)log.size(), nullptr, log.data());
+        std::cerr << filename << ": " << log.data() << std::endl;
+
+        glDeleteShader(shader);
+        return 0;
+    }
+
+    return shader;
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+class ProgramCache;
+
+/// <summary>
+/// Compiles variants of a program with feature defines (SHADOWS, NUM_LIGHTS, TEXTURED, ALPHA_BLEND, OIT, IMPOSTOR,
+/// BINDLESS) inserted after the #version line. Variants are compiled the first time they are requested and
+/// kept for the lifetime of the set. The base program, compiled without defines, is the full
+/// featured fallback and the attribute locations of every variant are bound to match it so
+/// geometry uploaded with the base program can be drawn with any variant.
+/// </summary>
+class ShaderPermutations
+{
+    public:
+        /// <summary>
+        /// The features a variant is compiled with
+        /// </summary>
+        struct Features
+        {
+            bool shadows = true;
+            unsigned int numLights = MAX_LIGHTS;
+            bool textured = true;
+            bool alphaBlend = true;
+            bool oit = false;
+            bool impostor = false;
+            bool bindless = false;
+        };
+
+        static const unsigned int MAX_LIGHTS = 10;
+
+        /// <summary>
+        /// Constructor
+        /// </summary>
+        /// <param name="baseProgram">The linked program compiled from the sources without defines</param>
+        /// <param name="vshader_filename">The vertex shader</param>
+        /// <param name="fshader_filename">The fragment shader</param>
+        /// <param name="cache">The program binary cache, may be null</param>
+        ShaderPermutations(GLuint baseProgram, const std::string& vshader_filename, const std::string& fshader_filename, std::shared_ptr<ProgramCache> cache);
+
+        /// <summary>
+        /// Destructor, deletes the variants
+        /// </summary>
+        ~ShaderPermutations();
+
+        /// <summary>
+        /// Returns the variant for the features, compiling it if needed. Falls back to the base program if it fails to compile
+        /// </summary>
+        /// <param name="features">The features in use</param>
+        /// <returns>The program</returns>
+        GLuint get(Features features);
+
+        /// <summary>
+        /// Returns the base program followed by every compiled variant
+        /// </summary>
+        std::vector<GLuint> getPrograms();
+
+        /// <summary>
+        /// Sets if shadows are rendered this frame, variants without shadows are selected when disabled
+        /// </summary>
+        /// <param name="flag">The flag</param>
+        void setShadowsEnabled(bool flag);
+
+        /// <summary>
+        /// Sets a callback called with every newly compiled variant, used to give it the per frame uniforms
+        /// that were applied to the other programs before it existed
+        /// </summary>
+        /// <param name="callback">The callback</param>
+        void setProgramCreatedCallback(std::function<void(GLuint)> callback);
+
+    private:
+        GLuint m_baseProgram;
+        std::string m_vshaderFilename;
+        std::string m_fshaderFilename;
+        std::shared_ptr<ProgramCache> m_cache;
+        std::map<unsigned int, GLuint> m_variants;
+        bool m_shadowsEnabled;
+        std::function<void(GLuint)> m_programCreatedCallback;
+
+        /// <summary>
+        /// Returns the defines of a feature set as GLSL source
+        /// </summary>
+        std::string defines(const Features& features);
+
+        /// <summary>
+        /// Compiles and links a variant
+        /// </summary>
+        GLuint compile(const std::string& defines);
+
+        /// <summary>
+        /// Compiles a shader stage with the defines inserted after the #version line
+        /// </summary>
+        GLuint compileShader(GLenum type, const std::string& filename, const std::string& defines);
+};
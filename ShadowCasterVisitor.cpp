@@ -0,0 +1,145 @@
+#include "ShadowCasterVisitor.h"
+#include "Group.h"
+#include "Transform.h"
+#include "Geometry.h"
+
+#include <algorithm>
+#include <glm/gtc/type_ptr.hpp>
+
+ShadowCasterVisitor::ShadowCasterVisitor() :
+    m_program(0),
+    m_uniform_m(-1),
+    m_lightSpaceMatrix(1.0f),
+    m_filter(ALL_CASTERS),
+    m_drawn(0),
+    m_culled(0)
+{
+}
+
+void ShadowCasterVisitor::setProgram(GLuint program)
+{
+    m_program = program;
+    m_uniform_m = glGetUniformLocation(program, "m");
+}
+
+void ShadowCasterVisitor::setLightSpaceMatrix(const glm::mat4& lightSpaceMatrix)
+{
+    m_lightSpaceMatrix = lightSpaceMatrix;
+}
+
+void ShadowCasterVisitor::ignoreProgram(GLuint program)
+{
+    m_ignoredPrograms.push_back(program);
+}
+
+void ShadowCasterVisitor::setFilter(Filter filter)
+{
+    m_filter = filter;
+}
+
+void ShadowCasterVisitor::resetStatistics()
+{
+    m_drawn = 0;
+    m_culled = 0;
+}
+
+unsigned int ShadowCasterVisitor::getDrawn()
+{
+    return m_drawn;
+}
+
+unsigned int ShadowCasterVisitor::getCulled()
+{
+    return m_culled;
+}
+
+bool ShadowCasterVisitor::isIgnored(GLuint program)
+{
+    return program != 0 && std::find(m_ignoredPrograms.begin(), m_ignoredPrograms.end(), program) != m_ignoredPrograms.end();
+}
+
+bool ShadowCasterVisitor::isVisible(BoundingBox box, const glm::mat4& model)
+{
+    glm::mat4 toLight = m_lightSpaceMatrix * model;
+    glm::vec3 min = box.min();
+    glm::vec3 max = box.max();
+
+    glm::vec3 lightMin = glm::vec3(1e30f);
+    glm::vec3 lightMax = glm::vec3(-1e30f);
+
+    for(int i = 0; i < 8; i++)
+    {
+        glm::vec4 corner = toLight * glm::vec4((i & 1) ? max.x : min.x, (i & 2) ? max.y : min.y, (i & 4) ? max.z : min.z, 1.0f);
+        glm::vec3 ndc = glm::vec3(corner) / corner.w;
+
+        lightMin = glm::min(lightMin, ndc);
+        lightMax = glm::max(lightMax, ndc);
+    }
+
+    //The near plane is left open, casters between the light and the frustum still throw shadows into it
+    return lightMax.x >= -1.0f && lightMin.x <= 1.0f &&
+           lightMax.y >= -1.0f && lightMin.y <= 1.0f &&
+           lightMin.z <= 1.0f;
+}
+
+void ShadowCasterVisitor::visit(Group& g)
+{
+    if(g.hasState() && isIgnored(g.getState()->getProgram()))
+    {
+        return;
+    }
+
+    g.accept(*this);
+}
+
+void ShadowCasterVisitor::visit(Transform& t)
+{
+    if(t.hasState() && isIgnored(t.getState()->getProgram()))
+    {
+        return;
+    }
+
+    //Everything below a dynamic node is dynamic as well
+    if(m_filter == STATIC_CASTERS && t.isDynamic())
+    {
+        return;
+    }
+
+    if(m_transformationStack.empty())
+    {
+        m_transformationStack.push(t.getModelMatrix());
+    }
+    else
+    {
+        m_transformationStack.push(m_transformationStack.top() * t.getModelMatrix());
+    }
+
+    t.acceptChildren(*this);
+
+    m_transformationStack.pop();
+}
+
+void ShadowCasterVisitor::visit(Geometry& g)
+{
+    if(g.hasState() && isIgnored(g.getState()->getProgram()))
+    {
+        return;
+    }
+
+    if((m_filter == STATIC_CASTERS && g.isDynamic()) || (m_filter == DYNAMIC_CASTERS && !g.isDynamic()))
+    {
+        return;
+    }
+
+    glm::mat4 model = m_transformationStack.empty() ? glm::mat4(1.0f) : m_transformationStack.top();
+
+    if(!isVisible(g.getLocalBoundingBox(), model))
+    {
+        m_culled++;
+        return;
+    }
+
+    glUniformMatrix4fv(m_uniform_m, 1, GL_FALSE, glm::value_ptr(model));
+    g.renderDepth();
+    m_drawn++;
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include "NodeVisitor.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <stack>
+#include <vector>
+
+#include "BoundingBox.h"
+
+class Group;
+class Transform;
+class Geometry;
+
+/// <summary>
+/// Depth only visitor for the shadow pass. Geometry outside the light frustum is culled, and the
+/// rest is drawn with only its positions. Materials, textures and lights are never applied
+/// </summary>
+class ShadowCasterVisitor : public NodeVisitor
+{
+    public:
+        /// <summary>
+        /// Which casters are drawn, static and dynamic casters are kept apart so the static ones can be cached
+        /// </summary>
+        enum Filter
+        {
+            ALL_CASTERS,
+            STATIC_CASTERS,
+            DYNAMIC_CASTERS
+        };
+
+        /// <summary>
+        /// The constructor
+        /// </summary>
+        ShadowCasterVisitor();
+
+        /// <summary>
+        /// Sets the depth program, it has to be bound while visiting
+        /// </summary>
+        /// <param name="program">The depth program</param>
+        void setProgram(GLuint program);
+
+        /// <summary>
+        /// Sets the light space matrix casters are culled against
+        /// </summary>
+        /// <param name="lightSpaceMatrix">The matrix</param>
+        void setLightSpaceMatrix(const glm::mat4& lightSpaceMatrix);
+
+        /// <summary>
+        /// Subtrees whose state sets this program do not cast shadows
+        /// </summary>
+        /// <param name="program">The program</param>
+        void ignoreProgram(GLuint program);
+
+        /// <summary>
+        /// Sets which casters are drawn
+        /// </summary>
+        /// <param name="filter">The filter</param>
+        void setFilter(Filter filter);
+
+        /// <summary>
+        /// Resets the drawn and culled counters
+        /// </summary>
+        void resetStatistics();
+
+        /// <summary>
+        /// Returns the amount of geometries drawn since the last reset
+        /// </summary>
+        unsigned int getDrawn();
+
+        /// <summary>
+        /// Returns the amount of geometries culled since the last reset
+        /// </summary>
+        unsigned int getCulled();
+
+        /// <summary>
+        /// Visits the group node
+        /// </summary>
+        /// <param name="g">group node</param>
+        virtual void visit(Group& g) override;
+
+        /// <summary>
+        /// Visits the Transform node
+        /// </summary>
+        /// <param name="t">Transform node</param>
+        virtual void visit(Transform& t) override;
+
+        /// <summary>
+        /// Visits the Geometry node
+        /// </summary>
+        /// <param name="g">Geometry node</param>
+        virtual void visit(Geometry& g) override;
+
+    private:
+        GLuint m_program;
+        GLint m_uniform_m;
+        glm::mat4 m_lightSpaceMatrix;
+        Filter m_filter;
+        std::vector<GLuint> m_ignoredPrograms;
+        std::stack<glm::mat4> m_transformationStack;
+        unsigned int m_drawn;
+        unsigned int m_culled;
+
+        /// <summary>
+        /// Returns if a box in object space overlaps the light frustum, extended towards the light
+        /// </summary>
+        bool isVisible(BoundingBox box, const glm::mat4& model);
+
+        /// <summary>
+        /// Returns if a node sets one of the ignored programs
+        /// </summary>
+        bool isIgnored(GLuint program);
+};
@@ -6,25 +6,57 @@
 #include "OrthographicCamera.h"
 #include "Group.h"
 #include "Texture.h"
+#include "ShadowCasterVisitor.h"
+#include "Node.h"
+#include "RenderTargetPool.h"
 
+#include <algorithm>
 #include <iostream>
+#include <string>
 
-Shadowmap::Shadowmap(GLuint depthProgram) :
+Shadowmap::Shadowmap(GLuint depthProgram, std::shared_ptr<RenderTargetPool> pool, unsigned int cascades, unsigned int resolution, GLenum depthFormat) :
     m_renderToTextureId(30),
+    m_staticTextureId(31),
     m_depthProgram(depthProgram),
+    m_cascades(std::max(1u, std::min(cascades, MAX_CASCADES))),
+    m_resolution(resolution),
+    m_depthFormat(depthFormat),
+    m_pool(pool),
+    m_shadowDistance(0.0f),
+    m_splitLambda(0.75f),
+    m_lightView(1.0f),
+    m_depthRange(0.0f),
+    m_staticSize(0),
+    m_staticLightDirection(0.0f),
+    m_staticDepthRange(0.0f),
+    m_staticVersion(0),
+    m_staticCascadesRendered(0),
     m_enabled(false)
 {
 }
 
 void Shadowmap::init(glm::uvec2 screenSize)
 {
-    m_renderToTexture = std::shared_ptr<RenderToTexture>(new RenderToTexture(m_renderToTextureId));
+    createTargets();
+    m_casterVisitor = std::shared_ptr<ShadowCasterVisitor>(new ShadowCasterVisitor());
+    m_casterVisitor->setProgram(m_depthProgram);
     m_depthCamera = std::shared_ptr<OrthographicCamera>(new OrthographicCamera());
 
     glUseProgram(m_depthProgram);
     m_depthCamera->init(m_depthProgram);
     m_depthCamera->setScreenSize(screenSize);
     glUseProgram(0);
+
+    m_lightSpaceMatrices.assign(m_cascades, glm::mat4(1.0f));
+    m_splits.assign(m_cascades, 0.0f);
+    m_cascadeOrigins.assign(m_cascades, glm::ivec2(0));
+    m_cascadeTexels.assign(m_cascades, 0.0f);
+    m_cascadeReach.assign(m_cascades, 0);
+    m_staticOrigins.assign(m_cascades, glm::ivec2(0));
+    m_staticTexels.assign(m_cascades, 0.0f);
+    m_copiedOrigins.assign(m_cascades, glm::ivec2(0));
+    m_dynamicDrawn.assign(m_cascades, 0);
+    invalidate();
 }
 
 std::shared_ptr<Texture> Shadowmap::render(GLuint program, std::shared_ptr<Camera> camera, std::shared_ptr<Group> subtree)
@@ -36,28 +68,126 @@ std::shared_ptr<Texture> Shadowmap::render(GLuint program, std::shared_ptr<Camer
 
     BoundingBox b = subtree->getCachedBoundingBox();
 
-    m_depthCamera->setTop(b.getRadius());
-    m_depthCamera->setNearFar(glm::uvec2(1.0f, b.getRadius() * 3.0f));
+    //The depth camera follows the light and looks at the origin, the cascades share its direction
+    glm::vec3 lightDirection = -m_depthCamera->getPosition();
+    lightDirection = glm::length(lightDirection) > 0.0f ? glm::normalize(lightDirection) : glm::vec3(0.0f, -1.0f, 0.0f);
+    m_lightView = glm::lookAt(glm::vec3(0.0f), lightDirection, glm::vec3(0.00001f, 1.0f, 0.00001f));
 
-    //Calculate the light space matrix
-    glUseProgram(m_depthProgram);
-    m_depthCamera->init(m_depthProgram);
-    m_depthCamera->apply(m_depthProgram);
-    glUseProgram(0);
+    //Every cascade and static region covers the depth of the whole scene, so their depths match texel for texel
+    float sceneDepth = glm::vec3(m_lightView * glm::vec4(b.getCenter(), 1.0f)).z;
+    float sceneRadius = std::max(b.getRadius(), 1e-3f);
+    m_depthRange = glm::vec2(-(sceneDepth + sceneRadius), -(sceneDepth - sceneRadius));
 
-	m_renderToTexture->prepare();
-	m_renderToTexture->render(m_depthProgram, m_depthCamera, subtree);
+    glm::vec2 nearFar = camera->getNearFar();
+    float shadowFar = m_shadowDistance > 0.0f ? std::min(m_shadowDistance, nearFar[1]) : nearFar[1];
 
+    //Front faces are culled so the depth stored is the back side of the casters, which hides most acne
     glUseProgram(m_depthProgram);
-    glUniformMatrix4fv(glGetUniformLocation(m_depthProgram, "u_lightSpaceMatrix"), 1, false, glm::value_ptr(m_depthCamera->getLightSpaceMatrix()));
+    glCullFace(GL_FRONT);
+    m_casterVisitor->resetStatistics();
+    m_staticCascadesRendered = 0;
+
+    //Any change to a static node can move its shadow into every region, as can the light turning
+    if(m_staticVersion != Node::getStaticVersion() || m_staticLightDirection != lightDirection || m_staticDepthRange != m_depthRange)
+    {
+        invalidate();
+        m_staticVersion = Node::getStaticVersion();
+        m_staticLightDirection = lightDirection;
+        m_staticDepthRange = m_depthRange;
+    }
+
+    float splitNear = nearFar[0];
+    for(unsigned int i = 0; i < m_cascades; i++)
+    {
+        //Practical split scheme, blend of logarithmic and uniform splits
+        float p = float(i + 1) / float(m_cascades);
+        float logSplit = nearFar[0] * std::pow(shadowFar / nearFar[0], p);
+        float uniformSplit = nearFar[0] + (shadowFar - nearFar[0]) * p;
+        float splitFar = m_splitLambda * logSplit + (1.0f - m_splitLambda) * uniformSplit;
+
+        fitCascade(i, camera, splitNear, splitFar);
+        splitNear = splitFar;
+    }
+
+    //One size for every region, enough for the cascade reaching furthest. It only changes with the projection
+    unsigned int staticSize = m_resolution;
+    for(unsigned int i = 0; i < m_cascades; i++)
+    {
+        staticSize = std::max(staticSize, (unsigned int)(2 * m_cascadeReach[i]));
+    }
+    staticSize = std::min((staticSize + 15) & ~15u, std::max(m_resolution, MAX_STATIC_SIZE));
+
+    if(!m_staticTexture || staticSize != m_staticSize)
+    {
+        m_staticTexture = nullptr;
+        m_staticTexture = std::shared_ptr<RenderToTexture>(new RenderToTexture(m_pool, m_staticTextureId, staticSize, m_cascades, m_depthFormat));
+        m_staticSize = staticSize;
+        invalidate();
+    }
+
+    glm::vec2 eye = glm::vec2(m_lightView * glm::vec4(camera->getPosition(), 1.0f));
+    for(unsigned int i = 0; i < m_cascades; i++)
+    {
+        glm::ivec2 origin = m_cascadeOrigins[i];
+        float texel = m_cascadeTexels[i];
+        int size = int(m_staticSize);
+        auto contains = [&](glm::ivec2 region)
+        {
+            return origin.x >= region.x && origin.y >= region.y && origin.x + int(m_resolution) <= region.x + size && origin.y + int(m_resolution) <= region.y + size;
+        };
+
+        bool staticRendered = false;
+        if(!m_staticValid[i] || m_staticTexels[i] != texel || !contains(m_staticOrigins[i]))
+        {
+            //Centered on the camera the region holds the cascade however the camera turns, when it is too small for
+            //that it is centered on the cascade instead
+            glm::ivec2 region = glm::ivec2(glm::floor(eye / texel)) - glm::ivec2(size / 2);
+            if(!contains(region))
+            {
+                region = origin + glm::ivec2(int(m_resolution) / 2) - glm::ivec2(size / 2);
+            }
+
+            glm::mat4 regionMatrix = lightSpaceMatrix(region, m_staticSize, texel);
+            glUniformMatrix4fv(glGetUniformLocation(m_depthProgram, "u_lightSpaceMatrix"), 1, false, glm::value_ptr(regionMatrix));
+            m_casterVisitor->setLightSpaceMatrix(regionMatrix);
+
+            m_staticTexture->prepare(i);
+            m_casterVisitor->setFilter(ShadowCasterVisitor::STATIC_CASTERS);
+            m_casterVisitor->visit(*subtree);
+
+            m_staticOrigins[i] = region;
+            m_staticTexels[i] = texel;
+            m_staticValid[i] = true;
+            m_staticCascadesRendered++;
+            staticRendered = true;
+        }
+
+        //The layer only differs from its region when the region was redrawn, the cascade moved or dynamic casters were drawn over it
+        if(staticRendered || m_copiedOrigins[i] != origin || m_dynamicDrawn[i] > 0)
+        {
+            glm::ivec2 offset = origin - m_staticOrigins[i];
+            m_renderToTexture->copyLayer(m_staticTexture, i, offset.x, offset.y);
+            m_copiedOrigins[i] = origin;
+        }
+
+        glUniformMatrix4fv(glGetUniformLocation(m_depthProgram, "u_lightSpaceMatrix"), 1, false, glm::value_ptr(m_lightSpaceMatrices[i]));
+        m_casterVisitor->setLightSpaceMatrix(m_lightSpaceMatrices[i]);
+
+        unsigned int drawn = m_casterVisitor->getDrawn();
+        m_renderToTexture->prepare(i, false);
+        m_casterVisitor->setFilter(ShadowCasterVisitor::DYNAMIC_CASTERS);
+        m_casterVisitor->visit(*subtree);
+        m_dynamicDrawn[i] = m_casterVisitor->getDrawn() - drawn;
+    }
+
+    glCullFace(GL_BACK);
     glUseProgram(0);
 
 	m_renderToTexture->unprepare(camera->getScreenSize());
 
-	glUseProgram(program);
-	glUniform1i(glGetUniformLocation(program, "u_depthTexture"), m_renderToTextureId);
-	glUniformMatrix4fv(glGetUniformLocation(program, "u_lightSpaceMatrix"), 1, false, glm::value_ptr(m_depthCamera->getLightSpaceMatrix()));
+    apply(program);
 
+	glUseProgram(program);
     camera->init(program);
     camera->apply(program);
     glUseProgram(0);
@@ -65,16 +195,136 @@ std::shared_ptr<Texture> Shadowmap::render(GLuint program, std::shared_ptr<Camer
     return m_renderToTexture->getTexture();
 }
 
+void Shadowmap::createTargets()
+{
+    //Release the old targets first, so the pool can hand them out again when the quality is unchanged
+    m_renderToTexture = nullptr;
+    m_staticTexture = nullptr;
+    m_staticSize = 0;
+
+    m_renderToTexture = std::shared_ptr<RenderToTexture>(new RenderToTexture(m_pool, m_renderToTextureId, m_resolution, m_cascades, m_depthFormat));
+}
+
+void Shadowmap::fitCascade(unsigned int cascade, std::shared_ptr<Camera> camera, float splitNear, float splitFar)
+{
+    glm::uvec2 screenSize = camera->getScreenSize();
+    float aspect = float(screenSize[0]) / float(screenSize[1]);
+
+    glm::mat4 projection = glm::perspective(glm::radians(camera->getFov()), aspect, splitNear, splitFar);
+    glm::mat4 inverse = glm::inverse(projection * camera->getView());
+
+    glm::vec3 corners[8];
+    glm::vec3 center = glm::vec3(0.0f);
+    for(int i = 0; i < 8; i++)
+    {
+        glm::vec4 corner = inverse * glm::vec4((i & 1) ? 1.0f : -1.0f, (i & 2) ? 1.0f : -1.0f, (i & 4) ? 1.0f : -1.0f, 1.0f);
+        corners[i] = glm::vec3(corner) / corner.w;
+        center += corners[i] / 8.0f;
+    }
+
+    //A bounding sphere keeps the cascade the same size however the camera is rotated, rounding
+    //the radius keeps it from changing with floating point noise
+    float radius = 0.0f;
+    for(int i = 0; i < 8; i++)
+    {
+        radius = std::max(radius, glm::length(corners[i] - center));
+    }
+    radius = std::ceil(radius * 16.0f) / 16.0f;
+
+    //Snap the cascade to whole texels in light space, so it only moves in texel steps and can be copied out of its region
+    float texel = 2.0f * radius / float(m_resolution);
+    glm::ivec2 cell = glm::ivec2(glm::floor(glm::vec2(m_lightView * glm::vec4(center, 1.0f)) / texel));
+
+    m_cascadeOrigins[cascade] = cell - glm::ivec2(int(m_resolution) / 2);
+    m_cascadeTexels[cascade] = texel;
+
+    //The sphere stays at the same distance from the camera however it turns, plus a margin so moving does not redraw at once
+    float reach = glm::length(center - camera->getPosition()) + radius;
+    m_cascadeReach[cascade] = int(std::ceil(reach / texel)) + int(m_resolution) / 8;
+
+    m_lightSpaceMatrices[cascade] = lightSpaceMatrix(m_cascadeOrigins[cascade], m_resolution, texel);
+    m_splits[cascade] = splitFar;
+}
+
+glm::mat4 Shadowmap::lightSpaceMatrix(glm::ivec2 origin, unsigned int size, float texel)
+{
+    glm::vec2 low = glm::vec2(origin) * texel;
+    glm::vec2 high = glm::vec2(origin + glm::ivec2(int(size))) * texel;
+    return glm::ortho(low.x, high.x, low.y, high.y, m_depthRange.x, m_depthRange.y) * m_lightView;
+}
+
+void Shadowmap::apply(GLuint program)
+{
+    glUseProgram(program);
+    glUniform1i(glGetUniformLocation(program, "u_depthTexture"), m_renderToTextureId);
+    glUniform1i(glGetUniformLocation(program, "u_cascadeCount"), (GLint)m_cascades);
+    glUniform1fv(glGetUniformLocation(program, "u_cascadeSplits"), (GLsizei)m_splits.size(), m_splits.data());
+    glUniformMatrix4fv(glGetUniformLocation(program, "u_lightSpaceMatrices"), (GLsizei)m_lightSpaceMatrices.size(), false, glm::value_ptr(m_lightSpaceMatrices[0]));
+    glUseProgram(0);
+}
+
 void Shadowmap::setEnabled(bool flag)
 {
     m_enabled = flag;
     if(flag == false)
     {
         m_renderToTexture->clear();
+        invalidate();
+    }
+}
+
+void Shadowmap::setShadowDistance(float distance)
+{
+    m_shadowDistance = distance;
+}
+
+void Shadowmap::setSplitLambda(float lambda)
+{
+    m_splitLambda = glm::clamp(lambda, 0.0f, 1.0f);
+}
+
+void Shadowmap::setQuality(unsigned int resolution, GLenum depthFormat)
+{
+    if(resolution == m_resolution && depthFormat == m_depthFormat)
+    {
+        return;
     }
+
+    m_resolution = resolution;
+    m_depthFormat = depthFormat;
+
+    //Before init the targets are created with the new quality
+    if(!m_renderToTexture)
+    {
+        return;
+    }
+
+    createTargets();
+    invalidate();
+}
+
+unsigned int Shadowmap::getResolution()
+{
+    return m_resolution;
+}
+
+void Shadowmap::ignoreProgram(GLuint program)
+{
+    m_casterVisitor->ignoreProgram(program);
+    invalidate();
+}
+
+void Shadowmap::invalidate()
+{
+    m_staticValid.assign(m_cascades, false);
+}
+
+unsigned int Shadowmap::getStaticCascadesRendered()
+{
+    return m_staticCascadesRendered;
 }
 
 std::shared_ptr<OrthographicCamera> Shadowmap::getDepthCamera()
 {
     return m_depthCamera;
-}
\ No newline at end of file
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <memory>
+#include <vector>
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
@@ -11,20 +12,139 @@ class Camera;
 class OrthographicCamera;
 class Group;
 class Texture;
+class ShadowCasterVisitor;
+class RenderTargetPool;
 
+/// <summary>
+/// Cascaded shadow map. The view frustum is split along its depth and every split gets its own
+/// orthographic depth map, fitted around the split and stored as a layer of a texture array.
+/// Static casters are rendered into a separate, larger array: every layer holds a region of light space around the
+/// camera with the texel size of its cascade, wide enough for the cascade however the camera turns. The cascades only
+/// move in whole texels and every matrix shares one depth range fixed by the scene, so each frame the cascade is copied
+/// out of its region at a texel offset and the dynamic casters are drawn on top. A region is only redrawn when the light
+/// moves, a static node changes or the camera leaves it.
+/// </summary>
 class Shadowmap
 {
     public:
-        Shadowmap(GLuint depthProgram);
+        static const unsigned int MAX_CASCADES = 4;
+
+        /// <summary>
+        /// Constructor
+        /// </summary>
+        /// <param name="depthProgram">The program rendering the depth maps</param>
+        /// <param name="pool">The pool the depth targets are taken from</param>
+        /// <param name="cascades">The amount of cascades, at most MAX_CASCADES</param>
+        /// <param name="resolution">The width and height of every cascade</param>
+        /// <param name="depthFormat">The depth format of the cascades</param>
+        Shadowmap(GLuint depthProgram, std::shared_ptr<RenderTargetPool> pool, unsigned int cascades = MAX_CASCADES, unsigned int resolution = 1024, GLenum depthFormat = GL_DEPTH_COMPONENT32);
         void init(glm::uvec2 screenSize);
         std::shared_ptr<Texture> render(GLuint program, std::shared_ptr<Camera> camera, std::shared_ptr<Group> subtree);
+
+        /// <summary>
+        /// Applies the shadow uniforms (depth texture, light space matrices and splits) to a program
+        /// </summary>
+        /// <param name="program">The program</param>
+        void apply(GLuint program);
         void setEnabled(bool flag);
+
+        /// <summary>
+        /// Sets how far from the camera shadows are rendered, 0 uses the far plane of the camera
+        /// </summary>
+        /// <param name="distance">The distance</param>
+        void setShadowDistance(float distance);
+
+        /// <summary>
+        /// Sets the blend between logarithmic (1) and uniform (0) split distances
+        /// </summary>
+        /// <param name="lambda">The blend</param>
+        void setSplitLambda(float lambda);
+
+        /// <summary>
+        /// Changes the resolution and depth format of the cascades, the old targets go back to the pool
+        /// </summary>
+        /// <param name="resolution">The width and height of every cascade</param>
+        /// <param name="depthFormat">The depth format, for example GL_DEPTH_COMPONENT16</param>
+        void setQuality(unsigned int resolution, GLenum depthFormat);
+
+        /// <summary>
+        /// Returns the width and height of every cascade
+        /// </summary>
+        unsigned int getResolution();
+
+        /// <summary>
+        /// Geometry under a state with this program does not cast shadows
+        /// </summary>
+        /// <param name="program">The program</param>
+        void ignoreProgram(GLuint program);
+
+        /// <summary>
+        /// Forces the static casters to be rendered again next frame
+        /// </summary>
+        void invalidate();
+
+        /// <summary>
+        /// Returns how many cascades had their static casters rendered during the last frame
+        /// </summary>
+        unsigned int getStaticCascadesRendered();
+
+        /// <summary>
+        /// Returns the camera following the light, the cascades look along its direction
+        /// </summary>
         std::shared_ptr<OrthographicCamera> getDepthCamera();
 
     private:
+        //The static regions are at most this wide, or as wide as the cascades when those are wider
+        static const unsigned int MAX_STATIC_SIZE = 4096;
+
         GLuint m_depthProgram;
         unsigned int m_renderToTextureId;
+        unsigned int m_staticTextureId;
+        unsigned int m_cascades;
+        unsigned int m_resolution;
+        GLenum m_depthFormat;
+        std::shared_ptr<RenderTargetPool> m_pool;
+        float m_shadowDistance;
+        float m_splitLambda;
         std::shared_ptr<RenderToTexture> m_renderToTexture;
+        std::shared_ptr<RenderToTexture> m_staticTexture;
+        std::shared_ptr<ShadowCasterVisitor> m_casterVisitor;
         std::shared_ptr<OrthographicCamera> m_depthCamera;
+        std::vector<glm::mat4> m_lightSpaceMatrices;
+        std::vector<float> m_splits;
+        glm::mat4 m_lightView;
+        glm::vec2 m_depthRange;
+
+        //Per cascade, the lower left texel in light space, the texel size and the texels needed around the camera
+        std::vector<glm::ivec2> m_cascadeOrigins;
+        std::vector<float> m_cascadeTexels;
+        std::vector<int> m_cascadeReach;
+
+        //Per static region, the lower left texel and texel size it was drawn with, and the origin last copied from it
+        unsigned int m_staticSize;
+        std::vector<glm::ivec2> m_staticOrigins;
+        std::vector<float> m_staticTexels;
+        std::vector<glm::ivec2> m_copiedOrigins;
+        std::vector<bool> m_staticValid;
+        std::vector<unsigned int> m_dynamicDrawn;
+        glm::vec3 m_staticLightDirection;
+        glm::vec2 m_staticDepthRange;
+        unsigned long long m_staticVersion;
+        unsigned int m_staticCascadesRendered;
         bool m_enabled;
-};
\ No newline at end of file
+
+        /// <summary>
+        /// Takes the cascade targets from the pool, the static regions are taken once their size is known
+        /// </summary>
+        void createTargets();
+
+        /// <summary>
+        /// Fits a cascade around a slice of the view frustum, snapped to whole texels in light space
+        /// </summary>
+        void fitCascade(unsigned int cascade, std::shared_ptr<Camera> camera, float splitNear, float splitFar);
+
+        /// <summary>
+        /// Returns the matrix of a square of light space, in texels from the light space origin, over the depth range
+        /// </summary>
+        glm::mat4 lightSpaceMatrix(glm::ivec2 origin, unsigned int size, float texel);
+};
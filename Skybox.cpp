@@ -10,9 +10,13 @@
 #include <iostream>
 #include <memory>
 #include "Camera.h"
-#include <stb_image.h>
+#include "MipGenerator.h"
+#include "RenderStats.h"
+#include "Texture.h"
+#include "ThreadPool.h"
 
-Skybox::Skybox()
+Skybox::Skybox(std::shared_ptr<ThreadPool> threadPool) :
+    m_threadPool(threadPool)
 {
     std::vector<std::string> faces
     {
@@ -103,6 +107,7 @@ void Skybox::render(GLuint program, std::shared_ptr<Camera> camera)
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_CUBE_MAP, m_CubemapTexture);
     glDrawArrays(GL_TRIANGLES, 0, 36);
+    RenderStats::addDrawCall(12);
     glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
     glBindVertexArray(0);
 
@@ -113,32 +118,78 @@ void Skybox::render(GLuint program, std::shared_ptr<Camera> camera)
 
 unsigned int Skybox::loadTexture(std::vector<std::string> faces)
 {
+    //The faces are decoded and their mip chains filtered on the pool, only the uploads run here
+    std::vector<MipChain> chains(faces.size());
+    auto load = [&](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; i++)
+        {
+            int width, height, nrChannels;
+            unsigned char *data = Texture::decode(faces[i], false, width, height, nrChannels, 4);
+            if (!data)
+            {
+                continue;
+            }
+
+            chains[i].levels.push_back({ width, height, std::vector<unsigned char>(data, data + size_t(width) * height * 4) });
+            Texture::freeDecoded(data);
+            MipGenerator::generate(chains[i]);
+        }
+    };
+
+    if (m_threadPool)
+    {
+        m_threadPool->parallelFor(faces.size(), 1, load);
+    }
+    else
+    {
+        load(0, faces.size());
+    }
+
     unsigned int textureId;
     glGenTextures(1, &textureId);
     glBindTexture(GL_TEXTURE_CUBE_MAP, textureId);
-    stbi_set_flip_vertically_on_load(false);
 
-    int width, height, nrChannels;
-    for (unsigned int i = 0; i < faces.size(); i++)
+    //Every face of the storage has the size of the first face loaded
+    const MipChain* first = nullptr;
+    for (const MipChain& chain : chains)
     {
-        unsigned char *data = stbi_load(faces[i].c_str(), &width, &height, &nrChannels, 0);
-        if (data)
+        if (!chain.levels.empty())
         {
-            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-            stbi_image_free(data);
+            first = &chain;
+            break;
         }
-        else
+    }
+
+    if (first)
+    {
+        glTexStorage2D(GL_TEXTURE_CUBE_MAP, (GLsizei)first->levels.size(), GL_RGBA8, first->levels[0].width, first->levels[0].height);
+    }
+
+    for (unsigned int i = 0; i < faces.size(); i++)
+    {
+        const MipChain& chain = chains[i];
+        if (chain.levels.empty() || chain.levels[0].width != first->levels[0].width || chain.levels[0].height != first->levels[0].height)
         {
             std::cout << "Cubemap could not load: " << faces[i] << std::endl;
-            stbi_image_free(data);
+            continue;
+        }
+
+        for (unsigned int level = 0; level < chain.levels.size(); level++)
+        {
+            const MipChain::Level& l = chain.levels[level];
+            glTexSubImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, level, 0, 0, l.width, l.height, GL_RGBA, GL_UNSIGNED_BYTE, l.data.data());
         }
     }
 
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    //The levels keep the sky from shimmering where it is minified, seamless filtering blends them across the face edges
+    glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
 
     return textureId;
 }
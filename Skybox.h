@@ -6,11 +6,12 @@
 #include "Geometry.h"
 
 class Camera;
+class ThreadPool;
 
 class Skybox
 {
     public:
-        Skybox();
+        Skybox(std::shared_ptr<ThreadPool> threadPool);
         ~Skybox();
         void render(GLuint program, std::shared_ptr<Camera> camera);
         unsigned int getCubemapTexture();
@@ -20,6 +21,7 @@ class Skybox
         unsigned int m_CubemapTexture;
         unsigned int m_SkyboxVAO;
         unsigned int m_SkyboxVBO;
+        std::shared_ptr<ThreadPool> m_threadPool;
 
         void prepare();
         unsigned int loadTexture(std::vector<std::string> faces);
@@ -0,0 +1,193 @@
+#include "SortBenchmark.h"
+#include "SortedGroup.h"
+#include "PerspectiveCamera.h"
+#include "Geometry.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+#include <random>
+
+namespace
+{
+    //The quads fill a cube, the camera orbits it a little every update and always looks at the middle
+    const float EXTENT = 100.0f;
+    const float ORBIT_RADIUS = 300.0f;
+    const float ORBIT_STEP = 0.002f;
+
+    void placeCamera(std::shared_ptr<Camera> camera, float angle)
+    {
+        glm::vec3 eye = glm::vec3(std::cos(angle), 0.3f, std::sin(angle)) * ORBIT_RADIUS;
+        camera->set(eye, glm::normalize(-eye), glm::vec3(0.0f, 1.0f, 0.0f));
+    }
+}
+
+SortBenchmark::SortBenchmark() :
+    m_quads(100000),
+    m_warmupUpdates(10),
+    m_measuredUpdates(300)
+{
+}
+
+void SortBenchmark::setSize(unsigned int quads, unsigned int warmup, unsigned int measured)
+{
+    m_quads = std::max(quads, 2u);
+    m_warmupUpdates = warmup;
+    m_measuredUpdates = std::max(measured, 1u);
+}
+
+bool SortBenchmark::run(const std::string& outFilename)
+{
+    m_results.clear();
+
+    std::cout << "Benchmarking the sorting of " << m_quads << " transparent quads: " << m_warmupUpdates << " warm-up updates, " << m_measuredUpdates << " measured updates" << std::endl;
+
+    //Every quad shares the geometry, only the bounds are needed so nothing is uploaded
+    std::shared_ptr<Geometry> quad = std::shared_ptr<Geometry>(new Geometry());
+    quad->addVertex(0.5f, -0.5f, 0.0f, 1.0f);
+    quad->addVertex(0.5f,  0.5f, 0.0f, 1.0f);
+    quad->addVertex(-0.5f,  0.5f, 0.0f, 1.0f);
+    quad->addVertex(-0.5f, -0.5f, 0.0f, 1.0f);
+
+    std::shared_ptr<Camera> camera = std::shared_ptr<Camera>(new PerspectiveCamera());
+    placeCamera(camera, 0.0f);
+
+    std::shared_ptr<SortedGroup> group = std::shared_ptr<SortedGroup>(new SortedGroup(camera));
+
+    std::mt19937 random(1);
+    std::uniform_real_distribution<float> position(-EXTENT, EXTENT);
+
+    for(unsigned int i = 0; i < m_quads; i++)
+    {
+        std::shared_ptr<Transform> transform = std::shared_ptr<Transform>(new Transform());
+        transform->translate(glm::vec3(position(random), position(random), position(random)));
+        transform->addChild(quad);
+        group->addChild(transform);
+    }
+
+    //The first update calculates every bound and sorts from the order the quads were added in
+    auto start = std::chrono::high_resolution_clock::now();
+    group->update(*group);
+    double firstMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    SortedGroup::SortResult first = group->getLastSort();
+    m_results.push_back({ "first", firstMs, first == SortedGroup::SORT_NONE, first == SortedGroup::SORT_INSERTION, first == SortedGroup::SORT_RADIX });
+
+    measure("orbit", group, camera, [](unsigned int update) { return update * ORBIT_STEP; });
+    measure("still", group, camera, [](unsigned int update) { return 0.0f; });
+    measure("jump", group, camera, [](unsigned int update) { return (update % 2) * 3.14159265f; });
+    measureBaseline(group, camera);
+
+    for(auto& result : m_results)
+    {
+        std::cout << result.name << ": " << result.msPerUpdate << " ms per update (" << result.unchanged << " unchanged, "
+                  << result.insertion << " insertion, " << result.radix << " radix)" << std::endl;
+    }
+
+    std::ofstream out(outFilename);
+    if(!out.is_open())
+    {
+        std::cerr << "Could not write sort benchmark report: " << outFilename << std::endl;
+        return false;
+    }
+
+    writeReport(out);
+    std::cout << "Sort benchmark report written to " << outFilename << std::endl;
+
+    return true;
+}
+
+template<typename F>
+void SortBenchmark::measure(const std::string& name, std::shared_ptr<SortedGroup> group, std::shared_ptr<Camera> camera, F cameraAngle)
+{
+    Result result = { name, 0.0, 0, 0, 0 };
+
+    for(unsigned int update = 0; update < m_warmupUpdates + m_measuredUpdates; update++)
+    {
+        placeCamera(camera, cameraAngle(update));
+
+        auto start = std::chrono::high_resolution_clock::now();
+        group->update(*group);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+        if(update < m_warmupUpdates)
+        {
+            continue;
+        }
+
+        result.msPerUpdate += ms;
+
+        switch(group->getLastSort())
+        {
+            case SortedGroup::SORT_NONE: result.unchanged++; break;
+            case SortedGroup::SORT_INSERTION: result.insertion++; break;
+            case SortedGroup::SORT_RADIX: result.radix++; break;
+        }
+    }
+
+    result.msPerUpdate /= m_measuredUpdates;
+    m_results.push_back(result);
+}
+
+void SortBenchmark::measureBaseline(std::shared_ptr<SortedGroup> group, std::shared_ptr<Camera> camera)
+{
+    std::vector<glm::vec3> centers;
+    for(auto& child : group->getChildren())
+    {
+        centers.push_back(child->calculateBoundingBox().getCenter());
+    }
+
+    std::vector<float> depths(centers.size());
+    std::vector<unsigned int> order(centers.size());
+    std::iota(order.begin(), order.end(), 0u);
+
+    Result result = { "std::stable_sort orbit", 0.0, 0, 0, 0 };
+
+    for(unsigned int update = 0; update < m_warmupUpdates + m_measuredUpdates; update++)
+    {
+        placeCamera(camera, update * ORBIT_STEP);
+
+        //The depths and the sort, like the group, starting from the order of the last update
+        auto start = std::chrono::high_resolution_clock::now();
+        for(size_t i = 0; i < centers.size(); i++)
+        {
+            depths[i] = glm::dot(centers[i] - camera->getPosition(), camera->getDirection());
+        }
+        std::stable_sort(order.begin(), order.end(), [&depths](unsigned int a, unsigned int b) { return depths[a] > depths[b]; });
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+        if(update >= m_warmupUpdates)
+        {
+            result.msPerUpdate += ms;
+        }
+    }
+
+    result.msPerUpdate /= m_measuredUpdates;
+    m_results.push_back(result);
+}
+
+void SortBenchmark::writeReport(std::ostream& out)
+{
+    out << "{" << std::endl;
+    out << "  \"quads\": " << m_quads << "," << std::endl;
+    out << "  \"warmupUpdates\": " << m_warmupUpdates << "," << std::endl;
+    out << "  \"measuredUpdates\": " << m_measuredUpdates << "," << std::endl;
+    out << "  \"results\": [" << std::endl;
+
+    for(size_t i = 0; i < m_results.size(); i++)
+    {
+        const Result& result = m_results[i];
+
+        out << "    { \"case\": \"" << result.name << "\", "
+            << "\"msPerUpdate\": " << result.msPerUpdate << ", "
+            << "\"unchanged\": " << result.unchanged << ", "
+            << "\"insertion\": " << result.insertion << ", "
+            << "\"radix\": " << result.radix << " }"
+            << (i + 1 == m_results.size() ? "" : ",") << std::endl;
+    }
+
+    out << "  ]" << std::endl;
+    out << "}" << std::endl;
+}
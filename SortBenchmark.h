@@ -0,0 +1,73 @@
+#pragma once
+
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+class SortedGroup;
+class Camera;
+
+/// <summary>
+/// Measures how long SortedGroup takes to order a large amount of transparent quads back to front.
+/// The camera orbits slowly, stands still and jumps to the opposite side, so the coherent, already
+/// sorted and worst cases are each measured. A stable sort of the same depths with std::stable_sort
+/// is measured on the orbit for comparison.
+/// </summary>
+class SortBenchmark
+{
+    public:
+        /// <summary>
+        /// Constructor
+        /// </summary>
+        SortBenchmark();
+
+        /// <summary>
+        /// Sets the amount of quads and updates
+        /// </summary>
+        /// <param name="quads">The amount of quads</param>
+        /// <param name="warmup">Updates run before measuring starts</param>
+        /// <param name="measured">Updates measured per case</param>
+        void setSize(unsigned int quads, unsigned int warmup, unsigned int measured);
+
+        /// <summary>
+        /// Runs the benchmark and writes the report
+        /// </summary>
+        /// <param name="outFilename">The file to write the JSON report to</param>
+        /// <returns>Flag for if the benchmark completed or not</returns>
+        bool run(const std::string& outFilename);
+
+    private:
+        /// <summary>
+        /// The result of one case
+        /// </summary>
+        struct Result
+        {
+            std::string name;
+            double msPerUpdate;
+            unsigned int unchanged;
+            unsigned int insertion;
+            unsigned int radix;
+        };
+
+        unsigned int m_quads;
+        unsigned int m_warmupUpdates;
+        unsigned int m_measuredUpdates;
+        std::vector<Result> m_results;
+
+        /// <summary>
+        /// Measures updates of the group with the camera placed on the orbit at an angle given by a function of the update index
+        /// </summary>
+        template<typename F>
+        void measure(const std::string& name, std::shared_ptr<SortedGroup> group, std::shared_ptr<Camera> camera, F cameraAngle);
+
+        /// <summary>
+        /// Measures std::stable_sort on the depths of the same quads along the orbit
+        /// </summary>
+        void measureBaseline(std::shared_ptr<SortedGroup> group, std::shared_ptr<Camera> camera);
+
+        /// <summary>
+        /// Writes the report
+        /// </summary>
+        void writeReport(std::ostream& out);
+};
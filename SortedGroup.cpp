@@ -1,6 +1,7 @@
 #include "SortedGroup.h"
 #include "Camera.h"
 #include "Transform.h"
+#include "Profiler.h"
 #include <iostream>
 #include <algorithm>
 
@@ -23,50 +24,181 @@ SortedGroup::~SortedGroup()
 void SortedGroup::addChild(std::shared_ptr<Node> child)
 {
     Group::addChild(child);
+    m_hasBounds = false;
+}
+
+void SortedGroup::updateBounds()
+{
+    size_t count = getNumChildren();
+    bool all = !m_hasBounds || m_centers.size() != count || m_boundsVersion != Node::getStaticVersion();
+
+    m_centers.resize(count);
+
+    for(size_t i = 0; i < count; i++)
+    {
+        std::shared_ptr<Node> child = getChild(int(i));
+        if(all || child->isDynamic())
+        {
+            m_centers[i] = child->calculateBoundingBox().getCenter();
+        }
+    }
 
-    BoundingBox b = calculateBoundingBox();
-    m_center = b.getCenter();
+    m_hasBounds = true;
+    m_boundsVersion = Node::getStaticVersion();
 }
 
 void SortedGroup::update(Node &n)
 {
-    //FIXME: This sorting algorithm isn't.... Optimal. It only checks the direction of the camera and will only work in cases where the objects are nicely
-    //sorted in a specific way. Ideally you'd want to check the distance between the object and the camera and sort from the object furthest away to the object closest to the camera.
-    //But for some reason it didn't want to work and had really weird artifacts. There is however a better way to calculate the distance which I have yet to understand
-    //which is taking the dot product of the camera's Z-axis. This might be need to be revisisted in the future
+    PROFILE_FUNCTION();
+
+    if(!m_camera || !m_sortingEnabled)
+    {
+        m_lastSort = SORT_NONE;
+        return;
+    }
+
+    updateBounds();
+
+    size_t count = m_centers.size();
+    if(count < 2)
+    {
+        m_lastSort = SORT_NONE;
+        return;
+    }
 
+    //The camera in the space the children are placed in
+    glm::mat4 world2object = glm::inverse(getModelMatrix());
+    glm::vec3 eye = glm::vec3(world2object * glm::vec4(m_camera->getPosition(), 1.0f));
+    glm::vec3 direction = glm::mat3(world2object) * m_camera->getDirection();
+
+    m_keys.resize(count);
+    m_order.resize(count);
+
+    float minDepth = 1e30f;
+    float maxDepth = -1e30f;
+    for(size_t i = 0; i < count; i++)
+    {
+        float depth = glm::dot(m_centers[i] - eye, direction);
+        minDepth = std::min(minDepth, depth);
+        maxDepth = std::max(maxDepth, depth);
+    }
+
+    //Quantized over the depth range of this update, the farthest child gets the smallest key
+    float scale = maxDepth > minDepth ? 65535.0f / (maxDepth - minDepth) : 0.0f;
+    bool sorted = true;
+
+    for(size_t i = 0; i < count; i++)
+    {
+        float depth = glm::dot(m_centers[i] - eye, direction);
+        m_keys[i] = uint16_t(65535.0f - (depth - minDepth) * scale + 0.5f);
+        m_order[i] = uint32_t(i);
+
+        sorted = sorted && (i == 0 || m_keys[i - 1] <= m_keys[i]);
+    }
+
+    if(sorted)
+    {
+        m_lastSort = SORT_NONE;
+        return;
+    }
+
+    //A moving camera usually only swaps a few neighbours, the radix sort takes over if it turns out to be more
+    if(insertionSort(count))
+    {
+        m_lastSort = SORT_INSERTION;
+    }
+    else
+    {
+        radixSort();
+        m_lastSort = SORT_RADIX;
+    }
+
+    //Only the children that changed place are written, reordering does not invalidate cached static data
     std::vector<std::shared_ptr<Node>> children = getChildren();
+    std::vector<glm::vec3> centers = m_centers;
+
+    for(size_t i = 0; i < count; i++)
+    {
+        if(m_order[i] != i)
+        {
+            setChildAt(int(i), children[m_order[i]]);
+            m_centers[i] = centers[m_order[i]];
+        }
+    }
+}
 
-    if(m_camera->getDirection().x < 0 && m_rightOrder)
+bool SortedGroup::insertionSort(size_t budget)
+{
+    size_t moved = 0;
+
+    for(size_t i = 1; i < m_keys.size(); i++)
     {
-        int start = children.size()-1;
-        int end = 0;
+        uint16_t key = m_keys[i];
+        uint32_t order = m_order[i];
+        size_t j = i;
 
-        while (end < start)
+        //Strictly greater keeps equal keys in the previous order, so they do not flicker
+        while(j > 0 && m_keys[j - 1] > key)
         {
-            auto temp = getChild(end);
-            setChildAt(end, getChild(start));
-            setChildAt(start, temp);
-            end++;
-            start--;
+            m_keys[j] = m_keys[j - 1];
+            m_order[j] = m_order[j - 1];
+            j--;
         }
 
-        m_rightOrder = false;
+        m_keys[j] = key;
+        m_order[j] = order;
+
+        moved += i - j;
+        if(moved > budget)
+        {
+            return false;
+        }
     }
-    else if(m_camera->getDirection().x > 0 && !m_rightOrder)
+
+    return true;
+}
+
+void SortedGroup::radixSort()
+{
+    size_t count = m_keys.size();
+    m_keyScratch.resize(count);
+    m_orderScratch.resize(count);
+
+    for(unsigned int shift = 0; shift < 16; shift += RADIX_BITS)
     {
-        int start = 0;
-        int end = children.size()-1;
+        size_t offsets[RADIX_SIZE] = {};
+
+        for(size_t i = 0; i < count; i++)
+        {
+            offsets[(m_keys[i] >> shift) & (RADIX_SIZE - 1)]++;
+        }
+
+        size_t sum = 0;
+        for(unsigned int digit = 0; digit < RADIX_SIZE; digit++)
+        {
+            size_t digitCount = offsets[digit];
+            offsets[digit] = sum;
+            sum += digitCount;
+        }
 
-        while (start < end)
+        for(size_t i = 0; i < count; i++)
         {
-            auto temp = getChild(start);
-            setChildAt(start, getChild(end));
-            setChildAt(end, temp);
-            start++;
-            end--;
+            size_t destination = offsets[(m_keys[i] >> shift) & (RADIX_SIZE - 1)]++;
+            m_keyScratch[destination] = m_keys[i];
+            m_orderScratch[destination] = m_order[i];
         }
 
-        m_rightOrder = true;
+        m_keys.swap(m_keyScratch);
+        m_order.swap(m_orderScratch);
     }
-}
\ No newline at end of file
+}
+
+SortedGroup::SortResult SortedGroup::getLastSort()
+{
+    return m_lastSort;
+}
+
+void SortedGroup::setSortingEnabled(bool flag)
+{
+    m_sortingEnabled = flag;
+}
@@ -3,15 +3,34 @@
 #include "Transform.h"
 #include "UpdateCallback.h"
 
+#include <cstdint>
+#include <vector>
+
 class Camera;
 class Node;
 
 /// <summary>
-/// The SortedGroup class, this sorts a group of nodes depending on the angle of the camera
+/// The SortedGroup class, this orders its children back to front from the camera every update so
+/// transparent children blend correctly. Children are sorted by the view depth of their bounding box
+/// centers, quantized to 16 bit keys. The previous order is the starting point, so an order that is
+/// still right costs one pass over the keys, a nearly sorted one an insertion sort, and anything else
+/// a stable radix sort. The bounds are cached and only recalculated when a static node changed or
+/// for dynamic children. The camera is taken into the space of this group with its own transform,
+/// transforms of the parents are not included.
 /// </summary>
 class SortedGroup : public Transform, public UpdateCallback
 {
     public:
+        /// <summary>
+        /// How the last update put the children in order
+        /// </summary>
+        enum SortResult
+        {
+            SORT_NONE,
+            SORT_INSERTION,
+            SORT_RADIX
+        };
+
         /// <summary>
         /// The constructor for state, given by Node
         /// </summary>
@@ -31,7 +50,7 @@ class SortedGroup : public Transform, public UpdateCallback
 
         /// <summary>
         /// The destructor given by node
-        /// </summary>        
+        /// </summary>
         virtual ~SortedGroup() override;
 
         /// <summary>
@@ -43,8 +62,49 @@ class SortedGroup : public Transform, public UpdateCallback
         /// Updates the node given by UpdateCallback
         /// </summary>
         void update(Node &n) override;
+
+        /// <summary>
+        /// Returns how the last update put the children in order
+        /// </summary>
+        SortResult getLastSort();
+
+        /// <summary>
+        /// Sets if the children are sorted, not needed when transparency is order independent
+        /// </summary>
+        /// <param name="flag">The flag</param>
+        void setSortingEnabled(bool flag);
     private:
+        static const unsigned int RADIX_BITS = 8;
+        static const unsigned int RADIX_SIZE = 1 << RADIX_BITS;
+
         std::shared_ptr<Camera> m_camera;
-        glm::vec3 m_center;
-        bool m_rightOrder = false;
-};
\ No newline at end of file
+
+        //Bounding box centers in the order the children are drawn
+        std::vector<glm::vec3> m_centers;
+        bool m_hasBounds = false;
+        unsigned long long m_boundsVersion = 0;
+
+        //Sort keys and the child each came from, with scratch space for the radix passes
+        std::vector<uint16_t> m_keys;
+        std::vector<uint32_t> m_order;
+        std::vector<uint16_t> m_keyScratch;
+        std::vector<uint32_t> m_orderScratch;
+        SortResult m_lastSort = SORT_NONE;
+        bool m_sortingEnabled = true;
+
+        /// <summary>
+        /// Recalculates the centers of the children that could have moved
+        /// </summary>
+        void updateBounds();
+
+        /// <summary>
+        /// Insertion sort of the keys, gives up once more than budget elements have been moved
+        /// </summary>
+        /// <returns>Flag for if the keys are sorted</returns>
+        bool insertionSort(size_t budget);
+
+        /// <summary>
+        /// Stable least significant digit radix sort of the keys
+        /// </summary>
+        void radixSort();
+};
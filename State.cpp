@@ -1,5 +1,9 @@
 #include "State.h"
 #include "Light.h"
+#include "BindlessTextures.h"
+#include "ShaderPermutations.h"
+#include "RenderStats.h"
+#include "Profiler.h"
 #include <iostream>
 #include <vr/glErrorUtil.h>
 
@@ -8,13 +12,13 @@ State::State(GLuint program) : m_uniform_numberOfLights(-1)
 	m_program = program;
 	m_material = std::shared_ptr<Material>(new Material());
 
-	m_textures.resize(2);
+	m_textures.resize(MAX_TEXTURES);
 }
 
 State::State() : m_uniform_numberOfLights(-1)
 {
 	m_material = std::shared_ptr<Material>(new Material());
-	m_textures.resize(2);
+	m_textures.resize(MAX_TEXTURES);
 }
 
 State::~State()
@@ -23,31 +27,37 @@ State::~State()
 
 void State::apply()
 {
+	PROFILE_FUNCTION();
+
 	if(m_program == 0)
 	{
 		std::cout << "Program is undefined. We cannot apply state" << std::endl;
 		return;
 	}
 
-	glUseProgram(m_program);
+	GLuint program = resolveProgram();
+
+	glUseProgram(program);
+	RenderStats::addStateChange();
 
 	if(m_material)
 	{
-		m_material->apply(m_program);
+		m_material->apply(program);
 	}
 
 	if(m_textures.size() > 0)
 	{
-		applyTextures();
+		applyTextures(program);
 	}
 
 	if(m_lights.size() > 0)
 	{
 		// Update number of lights
-		if (m_uniform_numberOfLights == -1)
+		if (m_uniform_numberOfLights == -1 || m_uniformProgram != program)
 		{
 			const char *uniform_name = "numberOfLights";
-			m_uniform_numberOfLights = glGetUniformLocation(m_program, uniform_name);
+			m_uniform_numberOfLights = glGetUniformLocation(program, uniform_name);
+			m_uniformProgram = program;
 
 			if (m_uniform_numberOfLights == -1)
 			{
@@ -55,17 +65,17 @@ void State::apply()
 			}
 		}
 
-		glUniform1i(m_uniform_numberOfLights, (GLint)m_lights.size());
-
-		// Apply lightsources
+		// Apply lightsources, the enabled ones are packed to the front
 		size_t i = 0;
 		for (auto l : m_lights)
 		{
-			if(m_lights[i]->isEnabled())
+			if(l->isEnabled())
 			{
-				l->apply(m_program, i++);
+				l->apply(program, i++);
 			}
 		}
+
+		glUniform1i(m_uniform_numberOfLights, (GLint)i);
 	}
 
 	if(m_polygonMode != -1)
@@ -86,37 +96,69 @@ void State::apply()
 		glCullFace(GL_BACK);
 	}
 
-	if(m_alphaBlendingSrc != -1 && m_alphaBlendingDst != -1)
+	//The order independent transparency pass sets the blending of its targets itself
+	if(m_alphaBlendingSrc != -1 && m_alphaBlendingDst != -1 && !m_orderIndependent)
 	{
 		glEnable(GL_BLEND);
 		glBlendFunc(m_alphaBlendingSrc, m_alphaBlendingDst);
 	}
 }
 
-void State::applyTextures()
+void State::applyTextures(GLuint program)
 {
 	GLint loc = 0;
 	std::vector<int> slotActive;
 	std::vector<int> slots;
+	std::vector<int> layers;
+	std::vector<int> bindlessIndices;
 	slotActive.resize(m_textures.size());
 	slots.resize(m_textures.size());
+	layers.resize(m_textures.size());
+	bindlessIndices.resize(m_textures.size());
+
+	//Only the bindless variants have the indices, the other programs sample bound textures
+	GLint bindlessLoc = BindlessTextures::isEnabled() ? glGetUniformLocation(program, "material.bindlessIndices") : -1;
 
 	for (int i = 0; i < m_textures.size(); i++)
 	{
 		slots[i] = i;
 		slotActive[i] = m_textures[i] != nullptr;
+		layers[i] = -1;
+		bindlessIndices[i] = -1;
+
+		if (!slotActive[i])
+		{
+			continue;
+		}
+
+		//Textures without a handle yet, like those still streaming, are bound as usual
+		if (bindlessLoc != -1)
+		{
+			bindlessIndices[i] = m_textures[i]->getBindlessIndex();
+		}
 
-		if (slotActive[i])
+		if (bindlessIndices[i] < 0)
 		{
 			m_textures[i]->bind();
+			layers[i] = m_textures[i]->getLayer();
+			RenderStats::addTextureBind();
 		}
 	}
 
-	loc = glGetUniformLocation(m_program, "material.textures");
+	if (bindlessLoc != -1)
+	{
+		glUniform1iv(bindlessLoc, (GLsizei)bindlessIndices.size(), bindlessIndices.data());
+	}
+
+	loc = glGetUniformLocation(program, "material.textures");
 	glUniform1iv(loc, (GLsizei)slots.size(), slots.data());
 
-	loc = glGetUniformLocation(m_program, "material.activeTextures");
+	loc = glGetUniformLocation(program, "material.activeTextures");
 	glUniform1iv(loc, (GLsizei)slotActive.size(), slotActive.data());
+
+	//Packed textures are sampled from the layer of their array, the arrays are bound to units of their own
+	loc = glGetUniformLocation(program, "material.layers");
+	glUniform1iv(loc, (GLsizei)layers.size(), layers.data());
 }
 
 void State::merge(std::shared_ptr<State> state)
@@ -124,6 +166,7 @@ void State::merge(std::shared_ptr<State> state)
 	if(state->getProgram() != 0)
 	{
 		m_program = state->getProgram();
+		m_permutations = state->getPermutations();
 	}
 
 	if(state->getAlphaBlendingSrc() != -1 && state->getAlphaBlendingDst() != -1)
@@ -234,7 +277,9 @@ std::shared_ptr<Material> State::getMaterial()
 
 void State::setProgram(GLuint program)
 {
+	//Permutations are variants of one program, they do not apply to another
 	m_program = program;
+	m_permutations = nullptr;
 }
 
 GLuint State::getProgram()
@@ -242,6 +287,66 @@ GLuint State::getProgram()
 	return m_program;
 }
 
+void State::setPermutations(std::shared_ptr<ShaderPermutations> permutations)
+{
+	m_permutations = permutations;
+}
+
+std::shared_ptr<ShaderPermutations> State::getPermutations()
+{
+	return m_permutations;
+}
+
+void State::setOrderIndependent(bool flag)
+{
+	m_orderIndependent = flag;
+}
+
+bool State::isOrderIndependent()
+{
+	return m_orderIndependent;
+}
+
+bool State::isTransparent()
+{
+	return m_alphaBlendingSrc != -1 && m_alphaBlendingDst != -1;
+}
+
+GLuint State::resolveProgram()
+{
+	if(!m_permutations)
+	{
+		return m_program;
+	}
+
+	//Pick the cheapest variant covering what this state actually uses
+	ShaderPermutations::Features features;
+	features.numLights = 0;
+	for(auto& light : m_lights)
+	{
+		if(light->isEnabled())
+		{
+			features.numLights++;
+		}
+	}
+
+	features.textured = false;
+	for(auto& texture : m_textures)
+	{
+		if(texture != nullptr)
+		{
+			features.textured = true;
+		}
+	}
+
+	features.alphaBlend = m_alphaBlendingSrc != -1 && m_alphaBlendingDst != -1;
+	features.bindless = features.textured && BindlessTextures::isEnabled();
+	features.oit = m_orderIndependent;
+	features.shadows = true;
+
+	return m_permutations->get(features);
+}
+
 bool State::getLightEnabled()
 {
 	return true;
@@ -5,16 +5,20 @@
 #include <memory>
 
 class Light;
+class ShaderPermutations;
 
 class State
 {
 	public:
+		// Texture slots of a state, units 0 to MAX_TEXTURES - 1 hold the plain textures and the next ones the texture arrays
+		static const unsigned int MAX_TEXTURES = 2;
+
 		State(GLuint program);
 		State();
 		~State();
 
 		void apply();
-		void applyTextures();
+		void applyTextures(GLuint program);
 		void merge(std::shared_ptr<State> state);
 		void add(std::shared_ptr<Light>& light);
 		void enableAlphaBlending(GLenum sfactor, GLenum dfactor);
@@ -26,7 +30,13 @@ class State
 		void setTexture(std::shared_ptr<Texture> texture, unsigned int unit);
 
 		void setProgram(GLuint program);
+		void setPermutations(std::shared_ptr<ShaderPermutations> permutations);
+		void setOrderIndependent(bool flag);
+		bool isOrderIndependent();
+		bool isTransparent();
 		GLuint getProgram();
+		GLuint resolveProgram();
+		std::shared_ptr<ShaderPermutations> getPermutations();
 		GLenum getCullFace();
 		GLenum getPolygonMode();
 		bool getLightEnabled();
@@ -40,13 +50,16 @@ class State
 	private:
 		std::shared_ptr<Material> m_material;
 		GLuint m_program = 0;
+		std::shared_ptr<ShaderPermutations> m_permutations;
 		std::vector<std::shared_ptr<Light>> m_lights;
 		GLint m_uniform_numberOfLights;
+		GLuint m_uniformProgram = 0;
 
 		GLenum m_polygonMode = -1;
 		GLenum m_cullFace = -1;
 		GLenum m_alphaBlendingSrc = -1;
 		GLenum m_alphaBlendingDst = -1;
+		bool m_orderIndependent = false;
 
 		std::vector<std::shared_ptr<Texture>> m_textures;
 };
\ No newline at end of file
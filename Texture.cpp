@@ -1,64 +1,160 @@
 #include "Texture.h"
+#include "BindlessTextures.h"
+#include "Profiler.h"
+#include "MipGenerator.h"
+#include "TextureBaker.h"
 #include <stb_image.h>
 #include <iostream>
 #include <vr/FileSystem.h>
 #include <vr/glErrorUtil.h>
 
-Texture::Texture() : m_id(0), m_type(0), m_valid(false), m_textureSlot(0)
+std::mutex Texture::s_decodeMutex;
+
+Texture::Texture() : m_id(0), m_type(0), m_valid(false), m_textureSlot(0), m_width(0), m_height(0), m_channels(0), m_chainBytes(0), m_layer(-1), m_handle(0), m_bindlessIndex(-1), m_streaming(false)
 {
 }
 
 Texture::~Texture()
 {
 	cleanup();
+	releasePixels();
 }
 
 bool Texture::create(const char* image, unsigned int slot, bool flipVertical, GLenum texType, GLenum pixelType, GLenum texFormat, GLint internalFormat, bool doDefault)
 {
-	if (m_valid)
+	if (!load(image, flipVertical))
 	{
-		cleanup();
+		return false;
 	}
 
-	std::string filepath = image;
+	return upload(slot, texType, pixelType, texFormat, internalFormat, doDefault);
+}
+
+bool Texture::load(const char* image, bool flipVertical)
+{
+	releasePixels();
+	m_chainBytes = 0;
+
+	//A current block compressed cache skips decoding, the caches hold the images flipped
+	if (flipVertical && TextureBaker::loadCache(image, m_chain))
+	{
+		m_width = m_chain.levels[0].width;
+		m_height = m_chain.levels[0].height;
+		m_channels = 4;
+		return true;
+	}
 
-	bool exist = vr::FileSystem::exists(filepath);
+	unsigned char* pixels = decode(image, flipVertical, m_width, m_height, m_channels, 4);
+	if (!pixels)
+	{
+		return false;
+	}
+
+	MipChain source;
+	source.levels.push_back({ m_width, m_height, std::vector<unsigned char>(pixels, pixels + size_t(m_width) * m_height * 4) });
+	freeDecoded(pixels);
+
+	//The levels are filtered here, on the thread loading the image, instead of with glGenerateMipmap on upload
+	MipGenerator::generate(source);
+
+	bool bake = flipVertical && TextureBaker::isEnabled() && TextureBaker::isSupported();
+	if (!bake || !TextureBaker::bake(image, source, m_chain))
+	{
+		m_chain = std::move(source);
+	}
+
+	return true;
+}
+
+std::string Texture::resolve(const std::string& image)
+{
+	if (vr::FileSystem::exists(image))
+	{
+		return image;
+	}
 
 	std::string vrPath = vr::FileSystem::getEnv("VR_PATH");
 
 	if (vrPath.empty())
 	{
 		std::cerr << "The environment variable VR_PATH is not set. It should point to the directory where the vr library is (just above models)" << std::endl;
+		return "";
 	}
 
-	if (!exist && !vrPath.empty())
+	std::string filepath = std::string(vrPath) + "/" + image;
+	return vr::FileSystem::exists(filepath) ? filepath : "";
+}
+
+unsigned char* Texture::decode(const std::string& image, bool flipVertical, int& width, int& height, int& channels, int desiredChannels)
+{
+	std::string filepath = resolve(image);
+
+	if (filepath.empty())
 	{
-		filepath = std::string(vrPath) + "/" + filepath;
-		exist = vr::FileSystem::exists(filepath);
+		std::cerr << "Unable to locate image: " << image << std::endl;
+		return nullptr;
 	}
 
-	if (!exist)
+	unsigned char* pixels = nullptr;
 	{
-		std::cerr << "Unable to locate image: " << image << std::endl;
-		return false;
+		PROFILE_SCOPE("stbi_load");
+
+		//The flip is global to stb_image, images decoded on other threads must not see it change halfway
+		std::lock_guard<std::mutex> lock(s_decodeMutex);
+		stbi_set_flip_vertically_on_load(flipVertical);
+		pixels = stbi_load(filepath.c_str(), &width, &height, &channels, desiredChannels);
 	}
 
-	m_textureSlot = slot;
+	if (!pixels) {
+		std::cerr << "Error reading image: " << image << std::endl;
+		return nullptr;
+	}
 
-	m_type = texType;
+	if (desiredChannels != 0)
+	{
+		channels = desiredChannels;
+	}
 
-	int widthImg, heightImg, numColCh;
+	return pixels;
+}
 
-	stbi_set_flip_vertically_on_load(flipVertical);
+void Texture::freeDecoded(unsigned char* pixels)
+{
+	stbi_image_free(pixels);
+}
 
-	unsigned char* bytes = stbi_load(filepath.c_str(), &widthImg, &heightImg, &numColCh, 0);
-	if (!bytes) {
-		std::cerr << "Error reading image: " << image << std::endl;
+bool Texture::upload(unsigned int slot, GLenum texType, GLenum pixelType, GLenum texFormat, GLint internalFormat, bool doDefault)
+{
+	if (m_chain.levels.empty())
+	{
 		return false;
 	}
 
-	if (numColCh == 3)
-		texFormat = GL_RGB;
+	//The chain has its levels already, nothing is generated
+	if (m_chain.isCompressed() || (doDefault && texType == GL_TEXTURE_2D && internalFormat == GL_RGBA))
+	{
+		glActiveTexture(GL_TEXTURE0 + slot);
+		createMipmapped(slot, m_width, m_height, (unsigned int)m_chain.levels.size(), m_chain.format);
+
+		glBindTexture(m_type, m_id);
+		for (int level = 0; level < (int)m_chain.levels.size(); level++)
+		{
+			m_chain.uploadRows(level, 0, m_chain.getRows(level), m_chain.levels[level].data.data());
+		}
+		glBindTexture(m_type, 0);
+
+		releasePixels();
+		return true;
+	}
+
+	if (m_valid)
+	{
+		cleanup();
+	}
+
+	m_textureSlot = slot;
+
+	m_type = texType;
 
 	glGenTextures(1, &m_id);
 
@@ -75,35 +171,212 @@ bool Texture::create(const char* image, unsigned int slot, bool flipVertical, GL
 		setParameteri(GL_TEXTURE_WRAP_T, GL_REPEAT);
 	}
 
-	glTexImage2D(texType, 0, internalFormat, widthImg, heightImg, 0, texFormat, pixelType, bytes);
-
-	if(doDefault)
+	//Textures of another format or type keep their own storage, with the whole chain only when defaults are asked for
+	int levels = doDefault ? (int)m_chain.levels.size() : 1;
+	for (int level = 0; level < levels; level++)
 	{
-		glGenerateMipmap(texType);
+		const MipChain::Level& l = m_chain.levels[level];
+		glTexImage2D(texType, level, internalFormat, l.width, l.height, 0, GL_RGBA, pixelType, l.data.data());
 	}
+	setParameteri(GL_TEXTURE_MAX_LEVEL, levels - 1);
 
-	stbi_image_free(bytes);
+	releasePixels();
 	glBindTexture(texType, 0);
 
 	m_valid = true;
 	return true;
 }
 
+bool Texture::isLoaded()
+{
+	return !m_chain.levels.empty();
+}
+
+size_t Texture::getSizeInBytes()
+{
+	if (m_chainBytes > 0)
+	{
+		return m_chainBytes;
+	}
+
+	//Uploaded images are expanded to four channels and get a full mip chain, a third more
+	return size_t(m_width) * size_t(m_height) * 4 * 4 / 3;
+}
+
+void Texture::releasePixels()
+{
+	if (!m_chain.levels.empty())
+	{
+		m_chainBytes = m_chain.getSizeInBytes();
+		m_chain.levels.clear();
+	}
+}
+
 bool Texture::create(unsigned int slot)
 {
+	return createTarget(slot, 1024, 1024, 1, GL_DEPTH_COMPONENT32);
+}
+
+bool Texture::createDepthArray(unsigned int slot, unsigned int size, unsigned int layers)
+{
+	return createTarget(slot, size, size, layers, GL_DEPTH_COMPONENT32, 0, true);
+}
+
+bool Texture::createTarget(unsigned int slot, unsigned int width, unsigned int height, unsigned int layers, GLenum internalFormat, unsigned int samples, bool array)
+{
+	if (m_valid)
+	{
+		cleanup();
+	}
+
+	m_valid = true;
+	m_textureSlot = slot;
+
+	if (samples > 1)
+	{
+		m_type = layers > 1 || array ? GL_TEXTURE_2D_MULTISAMPLE_ARRAY : GL_TEXTURE_2D_MULTISAMPLE;
+	}
+	else
+	{
+		m_type = layers > 1 || array ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D;
+	}
+
+	glGenTextures(1, &m_id);
+	glBindTexture(m_type, m_id);
+
+	//Immutable storage, the format is fixed for as long as the target lives in the pool
+	switch (m_type)
+	{
+		case GL_TEXTURE_2D_MULTISAMPLE:
+			glTexStorage2DMultisample(m_type, samples, internalFormat, width, height, GL_TRUE);
+			break;
+		case GL_TEXTURE_2D_MULTISAMPLE_ARRAY:
+			glTexStorage3DMultisample(m_type, samples, internalFormat, width, height, layers, GL_TRUE);
+			break;
+		case GL_TEXTURE_2D_ARRAY:
+			glTexStorage3D(m_type, 1, internalFormat, width, height, layers);
+			break;
+		default:
+			glTexStorage2D(m_type, 1, internalFormat, width, height);
+			break;
+	}
+
+	//Multisampled textures have no sampler state
+	if (samples <= 1)
+	{
+		glTexParameteri(m_type, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(m_type, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+		glTexParameteri(m_type, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(m_type, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	}
+
+	glBindTexture(m_type, 0);
+
+	return true;
+}
+
+bool Texture::createMipmapped(unsigned int slot, unsigned int width, unsigned int height, unsigned int levels, GLenum internalFormat)
+{
+	if (m_valid)
+	{
+		cleanup();
+	}
+
 	m_valid = true;
 	m_textureSlot = slot;
 	m_type = GL_TEXTURE_2D;
+	m_width = width;
+	m_height = height;
+
+	glGenTextures(1, &m_id);
+	glBindTexture(m_type, m_id);
+
+	//Immutable storage for the whole chain, the levels are filled in later with glTexSubImage2D
+	glTexStorage2D(m_type, levels, internalFormat, width, height);
 
-    glGenTextures(1, &m_id);
-    glBindTexture(GL_TEXTURE_2D, m_id);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT32, 1024, 1024, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+	glTexParameteri(m_type, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(m_type, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(m_type, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(m_type, GL_TEXTURE_WRAP_T, GL_REPEAT);
 
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glBindTexture(m_type, 0);
 
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	return true;
+}
+
+bool Texture::createMipmappedArray(unsigned int slot, unsigned int width, unsigned int height, unsigned int levels, unsigned int layers, GLenum internalFormat)
+{
+	if (m_valid)
+	{
+		cleanup();
+	}
+
+	m_valid = true;
+	m_textureSlot = slot;
+	m_type = GL_TEXTURE_2D_ARRAY;
+	m_width = width;
+	m_height = height;
+
+	glGenTextures(1, &m_id);
+	glBindTexture(m_type, m_id);
+
+	glTexStorage3D(m_type, levels, internalFormat, width, height, layers);
+
+	glTexParameteri(m_type, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(m_type, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(m_type, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(m_type, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+	glBindTexture(m_type, 0);
+
+	return true;
+}
+
+void Texture::setLayer(std::shared_ptr<Texture> array, int layer)
+{
+	cleanup();
+
+	m_array = array;
+	m_layer = layer;
+}
+
+int Texture::getLayer()
+{
+	return m_layer;
+}
+
+int Texture::getBindlessIndex()
+{
+	if (m_bindlessIndex >= 0 || m_streaming)
+	{
+		return m_bindlessIndex;
+	}
+
+	//A view samples the handle of its array at its layer
+	GLuint64 handle = m_array ? m_array->getHandle() : getHandle();
+	if (handle != 0)
+	{
+		m_bindlessIndex = BindlessTextures::add(handle, m_layer);
+	}
+
+	return m_bindlessIndex;
+}
+
+void Texture::setStreaming(bool flag)
+{
+	m_streaming = flag;
+}
+
+GLuint64 Texture::getHandle()
+{
+	if (m_handle == 0 && m_valid)
+	{
+		m_handle = glGetTextureHandleARB(m_id);
+		glMakeTextureHandleResidentARB(m_handle);
+	}
+
+	return m_handle;
 }
 
 void Texture::setParameteri(GLenum pname, GLint param)
@@ -113,7 +386,7 @@ void Texture::setParameteri(GLenum pname, GLint param)
 
 bool Texture::isValid()
 {
-	return m_valid;
+	return m_valid || m_array != nullptr;
 }
 
 void Texture::texUnit(GLuint program, const char* uniform, unsigned int unit)
@@ -124,6 +397,12 @@ void Texture::texUnit(GLuint program, const char* uniform, unsigned int unit)
 
 void Texture::bind()
 {
+	if (m_array)
+	{
+		m_array->bind();
+		return;
+	}
+
 	glActiveTextureARB(GL_TEXTURE0 + m_textureSlot);
 	glEnable(GL_TEXTURE_2D);
 
@@ -135,7 +414,11 @@ void Texture::bind()
 
 void Texture::unbind()
 {
-	if (m_valid)
+	if (m_array)
+	{
+		m_array->unbind();
+	}
+	else if (m_valid)
 	{
 		glBindTexture(m_type, 0);
 	}
@@ -143,11 +426,26 @@ void Texture::unbind()
 
 void Texture::cleanup()
 {
+	if (m_bindlessIndex >= 0)
+	{
+		BindlessTextures::remove(m_bindlessIndex);
+		m_bindlessIndex = -1;
+	}
+
+	if (m_handle != 0)
+	{
+		glMakeTextureHandleNonResidentARB(m_handle);
+		m_handle = 0;
+	}
+
 	if (m_valid)
 	{
 		glDeleteTextures(1, &m_id);
 	}
 
+	//A view only lets go of its array, the array goes when its last view does
+	m_array = nullptr;
+	m_layer = -1;
 	m_valid = false;
 }
 
@@ -158,5 +456,20 @@ void Texture::apply(GLuint program, int i, bool flag)
 
 unsigned int Texture::getId()
 {
-	return m_id;
+	return m_array ? m_array->getId() : m_id;
+}
+
+GLenum Texture::getType()
+{
+	return m_array ? m_array->getType() : m_type;
+}
+
+unsigned int Texture::getSlot()
+{
+	return m_textureSlot;
+}
+
+void Texture::setSlot(unsigned int slot)
+{
+	m_textureSlot = slot;
 }
\ No newline at end of file
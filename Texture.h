@@ -1,7 +1,11 @@
 #pragma once
 
 #include <GL/glew.h>
+#include <memory>
+#include <mutex>
 #include <string>
+
+#include "MipChain.h"
 class Texture
 {
 public:
@@ -18,6 +22,119 @@ public:
     bool create(const char* image, unsigned int slot=0, bool flipVertical=true, GLenum texType=GL_TEXTURE_2D, GLenum pixelType=GL_UNSIGNED_BYTE, GLenum texFormat=GL_RGBA, GLint internalFormat=GL_RGBA, bool doDefault=true);
     bool create(unsigned int slot);
 
+    /// <summary>
+    /// Decodes an image into memory without touching OpenGL, so it can run on any thread. upload creates the texture
+    /// from it later on the thread owning the context. The mip chain is filtered here too, see MipGenerator. A current block
+    /// compressed cache of the image is read instead, see TextureBaker
+    /// </summary>
+    /// <param name="image">path to an image on disk</param>
+    /// <param name="flipVertical">flips the rows so the first row is the bottom of the image</param>
+    bool load(const char* image, bool flipVertical=true);
+
+    /// <summary>
+    /// Creates the texture from the image decoded by load and frees the decoded image. A compressed chain is uploaded
+    /// as it is and the remaining arguments do not apply. Other formats or types only get the chain with doDefault
+    /// </summary>
+    bool upload(unsigned int slot=0, GLenum texType=GL_TEXTURE_2D, GLenum pixelType=GL_UNSIGNED_BYTE, GLenum texFormat=GL_RGBA, GLint internalFormat=GL_RGBA, bool doDefault=true);
+
+    /// <summary>
+    /// Returns if a decoded image is waiting for upload
+    /// </summary>
+    bool isLoaded();
+
+    /// <summary>
+    /// Returns the approximate memory of the image once uploaded, with its mip chain
+    /// </summary>
+    size_t getSizeInBytes();
+
+    /// <summary>
+    /// Returns the path an image is found at, relative to the working directory or to VR_PATH, or an empty string
+    /// </summary>
+    static std::string resolve(const std::string& image);
+
+    /// <summary>
+    /// Decodes an image without touching OpenGL, safe to call from any thread. The pixels are freed with freeDecoded
+    /// </summary>
+    /// <param name="image">path to an image on disk, looked up under VR_PATH too</param>
+    /// <param name="flipVertical">flips the rows so the first row is the bottom of the image</param>
+    /// <param name="desiredChannels">channels to expand or reduce to, 0 keeps those of the image</param>
+    /// <returns>The pixels, or null when the image could not be read</returns>
+    static unsigned char* decode(const std::string& image, bool flipVertical, int& width, int& height, int& channels, int desiredChannels=0);
+
+    /// <summary>
+    /// Frees pixels returned by decode
+    /// </summary>
+    static void freeDecoded(unsigned char* pixels);
+
+    /// <summary>
+    /// Creates a depth texture array, one layer per shadow cascade
+    /// </summary>
+    /// <param name="slot">texture slot</param>
+    /// <param name="size">width and height of every layer</param>
+    /// <param name="layers">amount of layers</param>
+    bool createDepthArray(unsigned int slot, unsigned int size, unsigned int layers);
+
+    /// <summary>
+    /// Creates an empty render target. More than one layer or array gives an array texture and more
+    /// than one sample a multisampled texture
+    /// </summary>
+    /// <param name="slot">texture slot</param>
+    /// <param name="width">width of every layer</param>
+    /// <param name="height">height of every layer</param>
+    /// <param name="layers">amount of layers</param>
+    /// <param name="internalFormat">sized format, for example GL_DEPTH_COMPONENT24 or GL_RGBA16F</param>
+    /// <param name="samples">amount of samples, 0 or 1 for a regular texture</param>
+    /// <param name="array">gives an array texture even with a single layer</param>
+    bool createTarget(unsigned int slot, unsigned int width, unsigned int height, unsigned int layers, GLenum internalFormat, unsigned int samples = 0, bool array = false);
+
+    /// <summary>
+    /// Creates an empty texture with room for a mip chain, sampled with trilinear filtering and repeated
+    /// </summary>
+    /// <param name="slot">texture slot</param>
+    /// <param name="width">width of the first level</param>
+    /// <param name="height">height of the first level</param>
+    /// <param name="levels">amount of levels</param>
+    /// <param name="internalFormat">sized format, for example GL_RGBA8</param>
+    bool createMipmapped(unsigned int slot, unsigned int width, unsigned int height, unsigned int levels, GLenum internalFormat);
+
+    /// <summary>
+    /// Creates an empty texture array with room for a mip chain in every layer, sampled with trilinear filtering and repeated
+    /// </summary>
+    /// <param name="slot">texture slot</param>
+    /// <param name="width">width of the first level</param>
+    /// <param name="height">height of the first level</param>
+    /// <param name="levels">amount of levels</param>
+    /// <param name="layers">amount of layers</param>
+    /// <param name="internalFormat">sized format, for example GL_RGBA8</param>
+    bool createMipmappedArray(unsigned int slot, unsigned int width, unsigned int height, unsigned int levels, unsigned int layers, GLenum internalFormat);
+
+    /// <summary>
+    /// Makes the texture a view of a layer in an array holding a copy of it, see TextureArrayPacker. Its own storage is
+    /// deleted and binding it binds the array. Creating the texture again makes it a texture of its own again
+    /// </summary>
+    /// <param name="array">the array</param>
+    /// <param name="layer">the layer holding the copy</param>
+    void setLayer(std::shared_ptr<Texture> array, int layer);
+
+    /// <summary>
+    /// Returns the layer of the array the texture is a view of, -1 for a texture of its own
+    /// </summary>
+    int getLayer();
+
+    /// <summary>
+    /// Returns the entry of the texture in the bindless table, see BindlessTextures. Its handle is created and made
+    /// resident the first time, after that the texture parameters can not change anymore. -1 while the texture is
+    /// streaming or has no storage
+    /// </summary>
+    int getBindlessIndex();
+
+    /// <summary>
+    /// Sets if the storage or base level of the texture still changes, which keeps it from getting a bindless handle
+    /// </summary>
+    void setStreaming(bool flag);
+
+    void setSlot(unsigned int slot);
+
     void setParameteri(GLenum pname, GLint param);
 
     bool isValid();
@@ -38,8 +155,13 @@ public:
 
     void apply(GLuint program, int i, bool flag);
 
+    /// Returns the id of the texture, or of its array for a view of a layer
     unsigned int getId();
 
+    GLenum getType();
+
+    unsigned int getSlot();
+
 private:
     GLuint m_id;
     GLenum m_type;
@@ -47,4 +169,24 @@ private:
     GLuint m_textureSlot;
     int m_slot;
     int m_activeSlot;
+
+    int m_width;
+    int m_height;
+    int m_channels;
+    MipChain m_chain;
+    size_t m_chainBytes;
+    std::shared_ptr<Texture> m_array;
+    int m_layer;
+    GLuint64 m_handle;
+    int m_bindlessIndex;
+    bool m_streaming;
+
+    static std::mutex s_decodeMutex;
+
+    void releasePixels();
+
+    /// <summary>
+    /// Returns the resident bindless handle of the texture, creating it the first time
+    /// </summary>
+    GLuint64 getHandle();
 };
\ No newline at end of file
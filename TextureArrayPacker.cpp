@@ -0,0 +1,173 @@
+#include "TextureArrayPacker.h"
+#include "Geometry.h"
+#include "Profiler.h"
+#include "SceneBVH.h"
+#include "State.h"
+#include "Texture.h"
+
+#include <algorithm>
+#include <map>
+#include <set>
+#include <tuple>
+
+bool TextureArrayPacker::Key::operator<(const Key& other) const
+{
+    return std::tie(slot, format, width, height, levels, minFilter, magFilter, wrapS, wrapT) <
+           std::tie(other.slot, other.format, other.width, other.height, other.levels, other.minFilter, other.magFilter, other.wrapS, other.wrapT);
+}
+
+TextureArrayPacker::TextureArrayPacker() :
+    m_numArrays(0),
+    m_numPacked(0)
+{
+}
+
+size_t TextureArrayPacker::pack(SceneBVH& bvh)
+{
+    PROFILE_FUNCTION();
+
+    //Textures are shared between the meshes of a model, each one is looked at once
+    std::set<Texture*> seen;
+    std::map<Key, std::vector<std::shared_ptr<Texture>>> kinds;
+
+    for(uint32_t entry = 0; entry < bvh.getNumEntries(); entry++)
+    {
+        std::shared_ptr<State> state = bvh.getGeometry(entry)->getState();
+        if(!state)
+        {
+            continue;
+        }
+
+        for(auto& texture : state->getTextures())
+        {
+            Key key;
+            if(texture && seen.insert(texture.get()).second && describe(*texture, key))
+            {
+                kinds[key].push_back(texture);
+            }
+        }
+    }
+
+    GLint maxLayers = 256;
+    glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+
+    size_t packed = 0;
+    for(auto& kind : kinds)
+    {
+        std::vector<std::shared_ptr<Texture>>& textures = kind.second;
+        for(size_t first = 0; first + 1 < textures.size(); first += size_t(maxLayers))
+        {
+            std::vector<std::shared_ptr<Texture>> layers(textures.begin() + first, textures.begin() + std::min(textures.size(), first + size_t(maxLayers)));
+            if(layers.size() > 1)
+            {
+                createArray(kind.first, layers);
+                packed += layers.size();
+            }
+        }
+    }
+
+    m_numPacked += packed;
+    return packed;
+}
+
+unsigned int TextureArrayPacker::getNumArrays()
+{
+    return m_numArrays;
+}
+
+size_t TextureArrayPacker::getNumPacked()
+{
+    return m_numPacked;
+}
+
+bool TextureArrayPacker::describe(Texture& texture, Key& key)
+{
+    if(!texture.isValid() || texture.getLayer() >= 0 || texture.getType() != GL_TEXTURE_2D)
+    {
+        return false;
+    }
+
+    key.slot = texture.getSlot();
+
+    glBindTexture(GL_TEXTURE_2D, texture.getId());
+
+    GLint baseLevel = 0;
+    GLint immutable = 0;
+    glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, &baseLevel);
+    glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_IMMUTABLE_FORMAT, &immutable);
+    glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, &key.minFilter);
+    glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, &key.magFilter);
+    glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, &key.wrapS);
+    glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, &key.wrapT);
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_INTERNAL_FORMAT, &key.format);
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &key.width);
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &key.height);
+
+    if(immutable)
+    {
+        glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_IMMUTABLE_LEVELS, &key.levels);
+    }
+    else
+    {
+        //Textures uploaded with glTexImage2D have every level of their chain, or only the first
+        key.levels = 1;
+        GLint width = 0;
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, 1, GL_TEXTURE_WIDTH, &width);
+        while(width > 0 && key.levels < 32)
+        {
+            key.levels++;
+            glGetTexLevelParameteriv(GL_TEXTURE_2D, key.levels, GL_TEXTURE_WIDTH, &width);
+        }
+    }
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    //A base level above 0 is a texture still streaming its larger levels in
+    if(baseLevel != 0 || key.width <= 0 || key.height <= 0)
+    {
+        return false;
+    }
+
+    //Storage for the array needs a sized format, the unsized ones are only left by drivers keeping them as given
+    switch(key.format)
+    {
+        case GL_RED:
+        case GL_RG:
+        case GL_RGB:
+        case GL_RGBA:
+            return false;
+        default:
+            return true;
+    }
+}
+
+void TextureArrayPacker::createArray(const Key& key, const std::vector<std::shared_ptr<Texture>>& textures)
+{
+    PROFILE_FUNCTION();
+
+    //Arrays have units of their own after the plain textures, a program samples both kinds and they can not share a unit
+    std::shared_ptr<Texture> array = std::shared_ptr<Texture>(new Texture());
+    array->createMipmappedArray(State::MAX_TEXTURES + key.slot, key.width, key.height, key.levels, (unsigned int)textures.size(), key.format);
+
+    glBindTexture(GL_TEXTURE_2D_ARRAY, array->getId());
+    array->setParameteri(GL_TEXTURE_MIN_FILTER, key.minFilter);
+    array->setParameteri(GL_TEXTURE_MAG_FILTER, key.magFilter);
+    array->setParameteri(GL_TEXTURE_WRAP_S, key.wrapS);
+    array->setParameteri(GL_TEXTURE_WRAP_T, key.wrapT);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    for(size_t layer = 0; layer < textures.size(); layer++)
+    {
+        for(GLint level = 0; level < key.levels; level++)
+        {
+            GLsizei width = std::max(key.width >> level, 1);
+            GLsizei height = std::max(key.height >> level, 1);
+            glCopyImageSubData(textures[layer]->getId(), GL_TEXTURE_2D, level, 0, 0, 0,
+                               array->getId(), GL_TEXTURE_2D_ARRAY, level, 0, 0, GLint(layer), width, height, 1);
+        }
+
+        textures[layer]->setLayer(array, int(layer));
+    }
+
+    m_numArrays++;
+}
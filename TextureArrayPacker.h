@@ -0,0 +1,76 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <memory>
+#include <vector>
+
+class SceneBVH;
+class Texture;
+
+/// <summary>
+/// Packs the uploaded textures of a scene into texture arrays. Textures in the same slot with the same format, size,
+/// amount of levels and sampling are copied into the layers of one GL_TEXTURE_2D_ARRAY and become views of their layer.
+/// Every material using one of them then binds the same array and only the layer index differs between their draws, so
+/// the draws can be sorted and merged by binding. The layers are copied on the GPU with glCopyImageSubData, block
+/// compressed textures stay compressed. Textures still streaming in are left as they are, so a streamed scene is flushed
+/// before packing.
+/// </summary>
+class TextureArrayPacker
+{
+    public:
+        /// <summary>
+        /// Constructor
+        /// </summary>
+        TextureArrayPacker();
+
+        /// <summary>
+        /// Packs the textures used by the geometry in a hierarchy. A texture without another of its kind stays as it is
+        /// </summary>
+        /// <param name="bvh">The hierarchy over the scene</param>
+        /// <returns>The amount of textures packed</returns>
+        size_t pack(SceneBVH& bvh);
+
+        /// <summary>
+        /// Returns the amount of arrays created
+        /// </summary>
+        unsigned int getNumArrays();
+
+        /// <summary>
+        /// Returns the amount of textures that became a layer of an array
+        /// </summary>
+        size_t getNumPacked();
+
+    private:
+        /// <summary>
+        /// What textures need in common to share an array
+        /// </summary>
+        struct Key
+        {
+            GLuint slot;
+            GLint format;
+            GLint width;
+            GLint height;
+            GLint levels;
+            GLint minFilter;
+            GLint magFilter;
+            GLint wrapS;
+            GLint wrapT;
+
+            bool operator<(const Key& other) const;
+        };
+
+        unsigned int m_numArrays;
+        size_t m_numPacked;
+
+        /// <summary>
+        /// Reads the storage and sampling of a texture
+        /// </summary>
+        /// <returns>Flag for if the texture can be packed, a complete 2D texture with sized storage</returns>
+        static bool describe(Texture& texture, Key& key);
+
+        /// <summary>
+        /// Creates an array for textures of one kind and turns them into views of its layers
+        /// </summary>
+        void createArray(const Key& key, const std::vector<std::shared_ptr<Texture>>& textures);
+};
@@ -0,0 +1,107 @@
+#include "TextureBaker.h"
+#include "BlockCompressor.h"
+#include "DDSFile.h"
+#include "Profiler.h"
+#include "Texture.h"
+
+#include <iostream>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+std::atomic<bool> TextureBaker::s_enabled(false);
+std::atomic<unsigned int> TextureBaker::s_baked(0);
+std::atomic<unsigned long long> TextureBaker::s_sourceBytes(0);
+std::atomic<unsigned long long> TextureBaker::s_bakedBytes(0);
+
+void TextureBaker::setEnabled(bool flag)
+{
+    s_enabled = flag;
+}
+
+bool TextureBaker::isEnabled()
+{
+    return s_enabled;
+}
+
+bool TextureBaker::isSupported()
+{
+    return GLEW_EXT_texture_compression_s3tc;
+}
+
+bool TextureBaker::loadCache(const std::string& image, MipChain& chain)
+{
+    PROFILE_FUNCTION();
+
+    if(!isSupported())
+    {
+        return false;
+    }
+
+    std::string cache = Texture::resolve(image + ".dds");
+    if(cache.empty())
+    {
+        return false;
+    }
+
+    //An image edited after baking is decoded again, a cache shipped without its image is always current
+    std::string source = Texture::resolve(image);
+    if(!source.empty() && modificationTime(cache) < modificationTime(source))
+    {
+        return false;
+    }
+
+    if(!DDSFile::load(cache, chain))
+    {
+        return false;
+    }
+
+    if(chain.format == GL_COMPRESSED_RGBA_BPTC_UNORM && !GLEW_ARB_texture_compression_bptc)
+    {
+        std::cerr << "BC7 is not supported by the driver, decoding the image instead: " << cache << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+bool TextureBaker::bake(const std::string& image, const MipChain& source, MipChain& chain)
+{
+    PROFILE_FUNCTION();
+
+    if(!BlockCompressor::encode(source, chain))
+    {
+        return false;
+    }
+
+    std::string filepath = Texture::resolve(image);
+    if(!filepath.empty() && DDSFile::save(filepath + ".dds", chain))
+    {
+        s_baked++;
+        s_sourceBytes += source.getSizeInBytes();
+        s_bakedBytes += chain.getSizeInBytes();
+    }
+
+    return true;
+}
+
+void TextureBaker::printSummary()
+{
+    std::cout << "Baked " << s_baked << " textures, " << (s_sourceBytes >> 10) << " KB of mip chains compressed to " << (s_bakedBytes >> 10) << " KB";
+    if(s_bakedBytes > 0)
+    {
+        std::cout << " (" << double(s_sourceBytes) / double(s_bakedBytes) << "x smaller)";
+    }
+    std::cout << std::endl;
+}
+
+long long TextureBaker::modificationTime(const std::string& filename)
+{
+    struct stat info;
+    if(stat(filename.c_str(), &info) != 0)
+    {
+        return 0;
+    }
+
+    return (long long)info.st_mtime;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+
+#include "MipChain.h"
+
+/// <summary>
+/// Block compressed caches of texture images. The cache of an image is a DDS file next to it with the same name plus
+/// ".dds", holding its whole mip chain. Loading prefers a cache that is newer than its image. With baking enabled, an image
+/// without a current cache is encoded on the thread decoding it and the cache is written, so running a scene once with
+/// --bake-textures prepares all its textures. Only images flipped on load are cached, the cache stores them flipped.
+/// </summary>
+class TextureBaker
+{
+    public:
+        /// <summary>
+        /// Sets if missing or outdated caches are written while loading
+        /// </summary>
+        static void setEnabled(bool flag);
+
+        /// <summary>
+        /// Returns if missing or outdated caches are written while loading
+        /// </summary>
+        static bool isEnabled();
+
+        /// <summary>
+        /// Returns if the driver can sample the formats the caches hold
+        /// </summary>
+        static bool isSupported();
+
+        /// <summary>
+        /// Loads the cache of an image when it is at least as new as the image, or the image is not there at all
+        /// </summary>
+        /// <param name="image">path to the image</param>
+        /// <param name="chain">The compressed chain</param>
+        /// <returns>Flag for if a current cache was found</returns>
+        static bool loadCache(const std::string& image, MipChain& chain);
+
+        /// <summary>
+        /// Encodes a decoded chain and writes it as the cache of an image
+        /// </summary>
+        /// <param name="image">path to the image</param>
+        /// <param name="source">The decoded chain, GL_RGBA8</param>
+        /// <param name="chain">The compressed chain</param>
+        /// <returns>Flag for if the chain was encoded, writing the cache may still have failed</returns>
+        static bool bake(const std::string& image, const MipChain& source, MipChain& chain);
+
+        /// <summary>
+        /// Prints how many images were baked and the bytes saved
+        /// </summary>
+        static void printSummary();
+
+    private:
+        static std::atomic<bool> s_enabled;
+        static std::atomic<unsigned int> s_baked;
+        static std::atomic<unsigned long long> s_sourceBytes;
+        static std::atomic<unsigned long long> s_bakedBytes;
+
+        /// <summary>
+        /// Returns the modification time of a file, 0 when it does not exist
+        /// </summary>
+        static long long modificationTime(const std::string& filename);
+};
@@ -0,0 +1,460 @@
+#include "TextureStreamer.h"
+#include "Camera.h"
+#include "Geometry.h"
+#include "MipGenerator.h"
+#include "Profiler.h"
+#include "SceneBVH.h"
+#include "State.h"
+#include "Texture.h"
+#include "TextureBaker.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+TextureStreamer::TextureStreamer(std::shared_ptr<ThreadPool> threadPool) :
+    m_threadPool(threadPool),
+    m_uploadBudget(size_t(4) << 20),
+    m_tailSize(64),
+    m_nextBuffer(0),
+    m_decoding(0),
+    m_streaming(0),
+    m_lastUploadedBytes(0)
+{
+    for(unsigned int i = 0; i < RING_SIZE; i++)
+    {
+        m_buffers[i] = 0;
+        m_fences[i] = 0;
+    }
+}
+
+TextureStreamer::~TextureStreamer()
+{
+    //The workers write to the streams, they have to be done before the streams go away
+    for(auto& stream : m_streams)
+    {
+        if(stream->decoding.valid())
+        {
+            stream->decoding.wait();
+        }
+    }
+
+    for(unsigned int i = 0; i < RING_SIZE; i++)
+    {
+        if(m_fences[i])
+        {
+            glDeleteSync(m_fences[i]);
+        }
+
+        if(m_buffers[i])
+        {
+            glDeleteBuffers(1, &m_buffers[i]);
+        }
+    }
+}
+
+void TextureStreamer::setUploadBudget(size_t bytes)
+{
+    m_uploadBudget = bytes;
+}
+
+void TextureStreamer::setTailSize(unsigned int size)
+{
+    m_tailSize = std::max(size, 1u);
+}
+
+std::shared_ptr<Texture> TextureStreamer::add(const std::string& image, unsigned int slot, bool flipVertical)
+{
+    std::shared_ptr<Stream> stream = std::shared_ptr<Stream>(new Stream());
+    stream->texture = std::shared_ptr<Texture>(new Texture());
+    stream->image = image;
+    stream->slot = slot;
+    stream->flipVertical = flipVertical;
+
+    //A grey pixel until the image is decoded, so the geometry using it can be drawn from the first frame on
+    const unsigned char grey[4] = { 128, 128, 128, 255 };
+    stream->texture->createMipmapped(slot, 1, 1, 1, GL_RGBA8);
+    stream->texture->setStreaming(true);
+    glBindTexture(GL_TEXTURE_2D, stream->texture->getId());
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, grey);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    Stream* decoding = stream.get();
+    stream->decoding = m_threadPool->submit([decoding]() { decode(*decoding); });
+
+    m_streams.push_back(stream);
+    m_byTexture[stream->texture.get()] = stream;
+    m_decoding++;
+
+    return stream->texture;
+}
+
+void TextureStreamer::update(std::shared_ptr<Camera> camera, SceneBVH& bvh)
+{
+    PROFILE_FUNCTION();
+
+    m_lastUploadedBytes = 0;
+    if(m_streams.empty())
+    {
+        return;
+    }
+
+    gatherDemand(camera, bvh);
+
+    //Decoded images get their tails first, they are small and a texture without them shows the grey pixel
+    size_t budget = m_uploadBudget;
+    for(auto& stream : m_streams)
+    {
+        if(stream->status != DECODING || stream->decoding.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+        {
+            continue;
+        }
+
+        //At least one image per update, even when its tail is larger than the budget
+        if(budget == 0 && m_lastUploadedBytes > 0)
+        {
+            break;
+        }
+
+        stream->decoding.get();
+        m_decoding--;
+
+        size_t bytes = finish(*stream);
+        m_lastUploadedBytes += bytes;
+        budget -= std::min(budget, bytes);
+    }
+
+    //Textures that need larger levels than they have, the most pixels on screen first
+    std::vector<Stream*> streams;
+    for(auto& stream : m_streams)
+    {
+        if(stream->status == STREAMING && wantedLevel(*stream) < stream->baseLevel)
+        {
+            streams.push_back(stream.get());
+        }
+    }
+
+    m_streaming = (unsigned int)streams.size();
+    if(!streams.empty() && budget > 0)
+    {
+        std::sort(streams.begin(), streams.end(), [](const Stream* a, const Stream* b) { return a->demand > b->demand; });
+        m_lastUploadedBytes += uploadLevels(streams, budget);
+    }
+}
+
+void TextureStreamer::flush()
+{
+    PROFILE_FUNCTION();
+
+    for(auto& stream : m_streams)
+    {
+        if(stream->status == DECODING)
+        {
+            stream->decoding.get();
+            m_decoding--;
+            finish(*stream);
+        }
+
+        if(stream->status != STREAMING)
+        {
+            continue;
+        }
+
+        glBindTexture(GL_TEXTURE_2D, stream->texture->getId());
+        for(int level = stream->baseLevel - 1; level >= 0; level--)
+        {
+            stream->chain.uploadRows(level, 0, stream->chain.getRows(level), stream->chain.levels[level].data.data());
+        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        stream->baseLevel = 0;
+        stream->uploadedRows = 0;
+        stream->status = RESIDENT;
+        stream->texture->setStreaming(false);
+        stream->chain.levels.clear();
+        stream->chain.levels.shrink_to_fit();
+    }
+
+    m_streaming = 0;
+}
+
+unsigned int TextureStreamer::getNumDecoding()
+{
+    return m_decoding;
+}
+
+unsigned int TextureStreamer::getNumStreaming()
+{
+    return m_streaming;
+}
+
+size_t TextureStreamer::getLastUploadedBytes()
+{
+    return m_lastUploadedBytes;
+}
+
+void TextureStreamer::gatherDemand(std::shared_ptr<Camera> camera, SceneBVH& bvh)
+{
+    PROFILE_FUNCTION();
+
+    for(auto& stream : m_streams)
+    {
+        stream->demand = 0;
+    }
+
+    //Pixels covered by one unit at a distance of one unit, as in LODSelector
+    glm::uvec2 screenSize = camera->getScreenSize();
+    float pixelsPerUnit = float(screenSize.y) * 0.5f / std::tan(glm::radians(camera->getFov()) * 0.5f);
+    glm::vec3 eye = camera->getPosition();
+
+    for(uint32_t entry : bvh.getVisibleEntries())
+    {
+        std::shared_ptr<State> state = bvh.getGeometry(entry)->getState();
+        if(!state)
+        {
+            continue;
+        }
+
+        //The texture is assumed to span the geometry once, so its coverage is the projected diameter of the bounds
+        BoundingBox box = bvh.getWorldBoundingBox(entry);
+        float radius = box.getRadius();
+        float distance = std::max(glm::length(box.getCenter() - eye), radius);
+        float pixels = 2.0f * radius / distance * pixelsPerUnit;
+
+        for(auto& texture : state->getTextures())
+        {
+            auto found = texture ? m_byTexture.find(texture.get()) : m_byTexture.end();
+            if(found != m_byTexture.end())
+            {
+                found->second->demand = std::max(found->second->demand, pixels);
+            }
+        }
+    }
+}
+
+size_t TextureStreamer::finish(Stream& stream)
+{
+    PROFILE_FUNCTION();
+
+    MipChain& chain = stream.chain;
+    if(chain.levels.empty())
+    {
+        std::cerr << "Unable to stream texture: " << stream.image << std::endl;
+        stream.status = FAILED;
+        stream.texture->setStreaming(false);
+        return 0;
+    }
+
+    int levels = (int)chain.levels.size();
+    stream.texture->createMipmapped(stream.slot, chain.levels[0].width, chain.levels[0].height, levels, chain.format);
+
+    //The tail is a few kilobytes, uploading it directly costs less than staging it in the ring
+    stream.baseLevel = levels - 1;
+    while(stream.baseLevel > 0 && (unsigned int)std::max(chain.levels[stream.baseLevel - 1].width, chain.levels[stream.baseLevel - 1].height) <= m_tailSize)
+    {
+        stream.baseLevel--;
+    }
+
+    size_t bytes = 0;
+    glBindTexture(GL_TEXTURE_2D, stream.texture->getId());
+    for(int level = stream.baseLevel; level < levels; level++)
+    {
+        chain.uploadRows(level, 0, chain.getRows(level), chain.levels[level].data.data());
+        bytes += chain.levels[level].data.size();
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, stream.baseLevel);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    stream.uploadedRows = 0;
+    stream.status = stream.baseLevel == 0 ? RESIDENT : STREAMING;
+    if(stream.status == RESIDENT)
+    {
+        stream.texture->setStreaming(false);
+        chain.levels.clear();
+        chain.levels.shrink_to_fit();
+    }
+
+    return bytes;
+}
+
+size_t TextureStreamer::uploadLevels(std::vector<Stream*>& streams, size_t budget)
+{
+    PROFILE_FUNCTION();
+
+    budget = std::min(budget, m_uploadBudget);
+
+    if(m_buffers[0] == 0)
+    {
+        glGenBuffers(RING_SIZE, m_buffers);
+        for(unsigned int i = 0; i < RING_SIZE; i++)
+        {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_buffers[i]);
+            glBufferData(GL_PIXEL_UNPACK_BUFFER, m_uploadBudget, nullptr, GL_STREAM_DRAW);
+        }
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+
+    //The buffer was last used RING_SIZE frames ago, if the GPU has still not read it this frame uploads nothing rather than wait
+    GLsync& fence = m_fences[m_nextBuffer];
+    if(fence)
+    {
+        if(glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+        {
+            return 0;
+        }
+
+        glDeleteSync(fence);
+        fence = 0;
+    }
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_buffers[m_nextBuffer]);
+    unsigned char* mapped = (unsigned char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, m_uploadBudget, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    if(!mapped)
+    {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        return 0;
+    }
+
+    //A band of rows copied into the buffer
+    struct Copy
+    {
+        Stream* stream;
+        int level;
+        int firstRow;
+        int rows;
+        size_t offset;
+        bool completes;
+    };
+
+    std::vector<Copy> copies;
+    size_t used = 0;
+
+    for(Stream* stream : streams)
+    {
+        int wanted = wantedLevel(*stream);
+        while(stream->baseLevel > wanted)
+        {
+            int level = stream->baseLevel - 1;
+            const MipChain& chain = stream->chain;
+
+            //Rows are four bytes per pixel or whole blocks, so every band starts aligned for the default unpack alignment
+            size_t rowBytes = chain.getRowBytes(level);
+            int rows = std::min(chain.getRows(level) - stream->uploadedRows, int((budget - used) / rowBytes));
+            if(rows <= 0)
+            {
+                break;
+            }
+
+            std::memcpy(mapped + used, chain.levels[level].data.data() + stream->uploadedRows * rowBytes, rows * rowBytes);
+
+            Copy copy = { stream, level, stream->uploadedRows, rows, used, stream->uploadedRows + rows == chain.getRows(level) };
+            copies.push_back(copy);
+            used += rows * rowBytes;
+
+            stream->uploadedRows += rows;
+            if(copy.completes)
+            {
+                stream->baseLevel = level;
+                stream->uploadedRows = 0;
+            }
+        }
+
+        if(budget - used < 4)
+        {
+            break;
+        }
+    }
+
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+    for(const Copy& copy : copies)
+    {
+        glBindTexture(GL_TEXTURE_2D, copy.stream->texture->getId());
+        copy.stream->chain.uploadRows(copy.level, copy.firstRow, copy.rows, (const void*)copy.offset);
+
+        //Sampling moves to the new level only once all its rows are in
+        if(copy.completes)
+        {
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, copy.level);
+        }
+    }
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    if(!copies.empty())
+    {
+        fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        m_nextBuffer = (m_nextBuffer + 1) % RING_SIZE;
+    }
+
+    //The decoded chain is kept until every level is uploaded, in case the demand grows again
+    for(Stream* stream : streams)
+    {
+        if(stream->baseLevel == 0)
+        {
+            stream->status = RESIDENT;
+            stream->texture->setStreaming(false);
+            stream->chain.levels.clear();
+            stream->chain.levels.shrink_to_fit();
+        }
+    }
+
+    return used;
+}
+
+int TextureStreamer::wantedLevel(const Stream& stream)
+{
+    int levels = (int)stream.chain.levels.size();
+    if(levels == 0 || stream.demand <= 0)
+    {
+        return levels - 1;
+    }
+
+    //Every level halves the size, so the level with about one texel per covered pixel is the log of their ratio
+    float size = float(std::max(stream.chain.levels[0].width, stream.chain.levels[0].height));
+    int level = int(std::floor(std::log2(size / stream.demand)));
+
+    return std::max(0, std::min(level, levels - 1));
+}
+
+void TextureStreamer::decode(Stream& stream)
+{
+    PROFILE_FUNCTION();
+
+    //The caches hold the images flipped
+    if(stream.flipVertical && TextureBaker::loadCache(stream.image, stream.chain))
+    {
+        return;
+    }
+
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    unsigned char* pixels = Texture::decode(stream.image, stream.flipVertical, width, height, channels, 4);
+    if(!pixels)
+    {
+        return;
+    }
+
+    MipChain chain;
+    chain.levels.push_back({ width, height, std::vector<unsigned char>(pixels, pixels + size_t(width) * height * 4) });
+    Texture::freeDecoded(pixels);
+    MipGenerator::generate(chain);
+
+    if(stream.flipVertical && TextureBaker::isEnabled() && TextureBaker::isSupported())
+    {
+        MipChain compressed;
+        if(TextureBaker::bake(stream.image, chain, compressed))
+        {
+            chain = std::move(compressed);
+        }
+    }
+
+    stream.chain = std::move(chain);
+}
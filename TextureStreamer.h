@@ -0,0 +1,162 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <future>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "MipChain.h"
+
+class Camera;
+class SceneBVH;
+class Texture;
+class ThreadPool;
+
+/// <summary>
+/// Loads textures without stalling the frame. Images are decoded and their mip chains built on the thread pool. Once
+/// decoded, a texture gets storage for the whole chain and only the small levels at the end, the mip tail, are uploaded, so
+/// every texture is sampled from its first frame on. The larger levels follow by demand: every frame the visible geometry
+/// estimates how many pixels its textures cover, and the levels that coverage needs are copied into a ring of pixel buffer
+/// objects, the largest on screen first. At most the upload budget is copied per frame, large levels are split by rows
+/// over several frames. The base level of a texture is lowered once a level is complete, so sampling never reaches a
+/// level that is not there yet. Images with a block compressed cache, see TextureBaker, stream their compressed levels
+/// the same way, in rows of blocks.
+/// </summary>
+class TextureStreamer
+{
+    public:
+        /// <summary>
+        /// Constructor
+        /// </summary>
+        /// <param name="threadPool">The pool the images are decoded on</param>
+        TextureStreamer(std::shared_ptr<ThreadPool> threadPool);
+
+        /// <summary>
+        /// Destructor, waits for the images still decoding
+        /// </summary>
+        ~TextureStreamer();
+
+        /// <summary>
+        /// Sets the bytes copied to the GPU per frame, has to be called before the first update
+        /// </summary>
+        void setUploadBudget(size_t bytes);
+
+        /// <summary>
+        /// Sets the size up to which levels are uploaded as soon as an image is decoded
+        /// </summary>
+        void setTailSize(unsigned int size);
+
+        /// <summary>
+        /// Creates a texture that streams an image in. It holds a grey pixel until the image is decoded. Has to be called on
+        /// the thread owning the OpenGL context
+        /// </summary>
+        /// <param name="image">path to an image on disk</param>
+        /// <param name="slot">texture slot</param>
+        /// <param name="flipVertical">flips the rows so the first row is the bottom of the image</param>
+        std::shared_ptr<Texture> add(const std::string& image, unsigned int slot = 0, bool flipVertical = true);
+
+        /// <summary>
+        /// Gathers the demand of the geometry visible in the last cull, finishes decoded images and uploads levels within
+        /// the budget
+        /// </summary>
+        /// <param name="camera">The camera the coverage is estimated for</param>
+        /// <param name="bvh">The scene hierarchy holding the visible geometry</param>
+        void update(std::shared_ptr<Camera> camera, SceneBVH& bvh);
+
+        /// <summary>
+        /// Waits for every image and uploads its whole chain, for work that needs the final textures, like baking
+        /// </summary>
+        void flush();
+
+        /// <summary>
+        /// Returns the amount of images still decoding
+        /// </summary>
+        unsigned int getNumDecoding();
+
+        /// <summary>
+        /// Returns the amount of textures with levels that are needed but not uploaded yet
+        /// </summary>
+        unsigned int getNumStreaming();
+
+        /// <summary>
+        /// Returns the bytes copied to the GPU in the last update
+        /// </summary>
+        size_t getLastUploadedBytes();
+
+    private:
+        static const unsigned int RING_SIZE = 3;
+
+        enum Status
+        {
+            DECODING,
+            STREAMING,
+            RESIDENT,
+            FAILED
+        };
+
+        /// <summary>
+        /// A texture being streamed
+        /// </summary>
+        struct Stream
+        {
+            std::shared_ptr<Texture> texture;
+            std::string image;
+            unsigned int slot;
+            bool flipVertical;
+            Status status = DECODING;
+            std::future<void> decoding;
+            MipChain chain;
+            //The largest level uploaded completely, sampling starts here
+            int baseLevel = 0;
+            //Rows of the level above baseLevel already uploaded, in blocks for compressed chains
+            int uploadedRows = 0;
+            //Pixels covered on screen by the largest visible geometry using the texture this frame
+            float demand = 0;
+        };
+
+        std::shared_ptr<ThreadPool> m_threadPool;
+        std::vector<std::shared_ptr<Stream>> m_streams;
+        std::unordered_map<const Texture*, std::shared_ptr<Stream>> m_byTexture;
+
+        size_t m_uploadBudget;
+        unsigned int m_tailSize;
+
+        GLuint m_buffers[RING_SIZE];
+        GLsync m_fences[RING_SIZE];
+        unsigned int m_nextBuffer;
+
+        unsigned int m_decoding;
+        unsigned int m_streaming;
+        size_t m_lastUploadedBytes;
+
+        /// <summary>
+        /// Estimates the pixels covered by the textures of the visible geometry
+        /// </summary>
+        void gatherDemand(std::shared_ptr<Camera> camera, SceneBVH& bvh);
+
+        /// <summary>
+        /// Creates the storage of a decoded image and uploads its mip tail directly
+        /// </summary>
+        /// <returns>The bytes uploaded</returns>
+        size_t finish(Stream& stream);
+
+        /// <summary>
+        /// Copies the wanted levels into the next buffer of the ring and uploads them from there
+        /// </summary>
+        /// <returns>The bytes uploaded</returns>
+        size_t uploadLevels(std::vector<Stream*>& streams, size_t budget);
+
+        /// <summary>
+        /// Returns the level whose size matches a coverage in pixels
+        /// </summary>
+        static int wantedLevel(const Stream& stream);
+
+        /// <summary>
+        /// Loads the compressed cache of an image, or decodes it and builds its mip chain, runs on the pool
+        /// </summary>
+        static void decode(Stream& stream);
+};
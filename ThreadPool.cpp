@@ -0,0 +1,136 @@
+#include "ThreadPool.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <string>
+
+ThreadPool::ThreadPool(unsigned int threads) :
+    m_stopping(false)
+{
+    if(threads == 0)
+    {
+        unsigned int hardware = std::thread::hardware_concurrency();
+        threads = hardware > 1 ? hardware - 1 : 1;
+    }
+
+    for(unsigned int i = 0; i < threads; i++)
+    {
+        m_workers.emplace_back(&ThreadPool::work, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+
+    m_condition.notify_all();
+
+    for(auto& worker : m_workers)
+    {
+        worker.join();
+    }
+}
+
+std::future<void> ThreadPool::submit(std::function<void()> task)
+{
+    std::packaged_task<void()> packaged(task);
+    std::future<void> future = packaged.get_future();
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_tasks.push_back(std::move(packaged));
+    }
+
+    m_condition.notify_one();
+    return future;
+}
+
+void ThreadPool::parallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& function, unsigned int maxThreads)
+{
+    if(count == 0)
+    {
+        return;
+    }
+
+    grain = std::max(grain, size_t(1));
+    size_t chunks = (count + grain - 1) / grain;
+
+    unsigned int threads = maxThreads == 0 ? getThreadCount() + 1 : maxThreads;
+    threads = (unsigned int)std::min(size_t(threads), chunks);
+
+    //Workers and the caller take chunks from a shared counter, so an uneven chunk does not hold up the rest.
+    //The caller only waits for the chunks, a helper that starts late finds nothing left and returns
+    struct Range
+    {
+        std::function<void(size_t, size_t)> function;
+        std::atomic<size_t> next;
+        std::atomic<size_t> done;
+        std::mutex mutex;
+        std::condition_variable finished;
+    };
+
+    std::shared_ptr<Range> range = std::make_shared<Range>();
+    range->function = function;
+    range->next = 0;
+    range->done = 0;
+
+    auto run = [range, chunks, grain, count]()
+    {
+        for(size_t chunk = range->next++; chunk < chunks; chunk = range->next++)
+        {
+            size_t begin = chunk * grain;
+            range->function(begin, std::min(begin + grain, count));
+
+            if(++range->done == chunks)
+            {
+                std::lock_guard<std::mutex> lock(range->mutex);
+                range->finished.notify_all();
+            }
+        }
+    };
+
+    for(unsigned int i = 1; i < threads; i++)
+    {
+        submit(run);
+    }
+
+    run();
+
+    std::unique_lock<std::mutex> lock(range->mutex);
+    range->finished.wait(lock, [&range, chunks]() { return range->done == chunks; });
+}
+
+unsigned int ThreadPool::getThreadCount()
+{
+    return (unsigned int)m_workers.size();
+}
+
+void ThreadPool::work(unsigned int index)
+{
+    PROFILE_THREAD_NAME("Worker " + std::to_string(index));
+
+    while(true)
+    {
+        std::packaged_task<void()> task;
+
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_condition.wait(lock, [this]() { return m_stopping || !m_tasks.empty(); });
+
+            if(m_stopping && m_tasks.empty())
+            {
+                return;
+            }
+
+            task = std::move(m_tasks.front());
+            m_tasks.pop_front();
+        }
+
+        task();
+    }
+}
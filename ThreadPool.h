@@ -0,0 +1,62 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// <summary>
+/// Fixed pool of worker threads. Tasks are taken from a shared queue in the order they were submitted.
+/// parallelFor splits a range into chunks and the calling thread works on chunks as well, so it can be
+/// called from a task without deadlocking the pool.
+/// </summary>
+class ThreadPool
+{
+    public:
+        /// <summary>
+        /// Constructor, starts the workers
+        /// </summary>
+        /// <param name="threads">The amount of workers, 0 uses one per hardware thread minus the calling thread</param>
+        ThreadPool(unsigned int threads = 0);
+
+        /// <summary>
+        /// Destructor, finishes the queued tasks and joins the workers
+        /// </summary>
+        ~ThreadPool();
+
+        /// <summary>
+        /// Queues a task
+        /// </summary>
+        /// <param name="task">The task</param>
+        /// <returns>A future that is ready when the task has run</returns>
+        std::future<void> submit(std::function<void()> task);
+
+        /// <summary>
+        /// Runs a function over [0, count) in chunks of grain elements and returns when every chunk is done
+        /// </summary>
+        /// <param name="count">The amount of elements</param>
+        /// <param name="grain">The amount of elements per chunk</param>
+        /// <param name="function">Called with the begin and end of every chunk</param>
+        /// <param name="maxThreads">Limits the threads working on the range including the caller, 0 uses all</param>
+        void parallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& function, unsigned int maxThreads = 0);
+
+        /// <summary>
+        /// Returns the amount of workers
+        /// </summary>
+        unsigned int getThreadCount();
+
+    private:
+        std::vector<std::thread> m_workers;
+        std::deque<std::packaged_task<void()>> m_tasks;
+        std::mutex m_mutex;
+        std::condition_variable m_condition;
+        bool m_stopping;
+
+        /// <summary>
+        /// The loop of a worker
+        /// </summary>
+        void work(unsigned int index);
+};
@@ -5,11 +5,11 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
-Transform::Transform(std::shared_ptr<State> state) : Group(state)
+Transform::Transform(std::shared_ptr<State> state) : Group(state), m_version(0)
 {
 }
 
-Transform::Transform() : Group()
+Transform::Transform() : Group(), m_version(0)
 {
 }
 
@@ -21,16 +21,22 @@ void Transform::translate(glm::vec3 translation)
 {
     m_object2world = glm::translate(m_object2world, translation);
     m_translation += translation;
+    m_version++;
+    markChanged();
 }
 
 void Transform::rotate(float rad, glm::vec3 axis)
 {
     m_object2world = glm::rotate(m_object2world, rad, axis);
+    m_version++;
+    markChanged();
 }
 
 void Transform::scale(glm::vec3 scaling)
 {
     m_object2world = glm::scale(m_object2world, scaling);
+    m_version++;
+    markChanged();
 }
 
 void Transform::accept(NodeVisitor &v)
@@ -58,11 +64,15 @@ BoundingBox Transform::calculateBoundingBox()
 void Transform::setInitialTransform(const glm::mat4& m)
 {
     m_object2world = m_initialTransform = m;
+    m_version++;
+    markChanged();
 }
 
 void Transform::resetTransform()
 {
     m_object2world = m_initialTransform;
+    m_version++;
+    markChanged();
 }
 
 glm::mat4 Transform::getModelMatrix()
@@ -74,3 +84,8 @@ glm::vec3 Transform::getTranslation()
 {
     return this->m_translation;
 }
+
+unsigned long long Transform::getVersion()
+{
+    return this->m_version;
+}
@@ -24,8 +24,14 @@ class Transform : public Group
         glm::mat4 getModelMatrix();
 
         glm::vec3 getTranslation();
+
+        /// <summary>
+        /// Returns a counter that is increased every time the model matrix changes
+        /// </summary>
+        unsigned long long getVersion();
     private:
         glm::vec3 m_translation;
         glm::mat4 m_initialTransform;
         glm::mat4 m_object2world;
+        unsigned long long m_version;
 };
\ No newline at end of file
@@ -0,0 +1,123 @@
+#include "TransparencyPass.h"
+#include "RenderTargetPool.h"
+#include "RenderStats.h"
+#include "Texture.h"
+
+#include <iostream>
+
+TransparencyPass::TransparencyPass(std::shared_ptr<RenderTargetPool> pool, GLuint compositeProgram) :
+    m_pool(pool),
+    m_compositeProgram(compositeProgram),
+    m_vao(0),
+    m_screenSize(0)
+{
+    //The composite triangle is made in the vertex shader, the vertex array only has to exist
+    glGenVertexArrays(1, &m_vao);
+}
+
+TransparencyPass::~TransparencyPass()
+{
+    release();
+    glDeleteVertexArrays(1, &m_vao);
+}
+
+bool TransparencyPass::begin(glm::uvec2 screenSize)
+{
+    m_screenSize = screenSize;
+
+    m_depth = m_pool->acquire({ screenSize.x, screenSize.y, 1, GL_DEPTH_COMPONENT24, 0, false }, DEPTH_SLOT);
+    m_accumulation = m_pool->acquire({ screenSize.x, screenSize.y, 1, GL_RGBA16F, 0, false }, ACCUMULATION_SLOT);
+    m_revealage = m_pool->acquire({ screenSize.x, screenSize.y, 1, GL_R16F, 0, false }, REVEALAGE_SLOT);
+
+    GLuint framebuffer = 0;
+    if(m_depth && m_accumulation && m_revealage)
+    {
+        framebuffer = m_pool->getFramebuffer(m_depth, { m_accumulation, m_revealage });
+    }
+
+    if(framebuffer == 0)
+    {
+        std::cerr << "Could not create the transparency targets" << std::endl;
+        release();
+        return false;
+    }
+
+    //The opaque depth, read from the default framebuffer
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+    glCopyTextureSubImage2D(m_depth->getId(), 0, 0, 0, 0, 0, screenSize.x, screenSize.y);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glViewport(0, 0, screenSize.x, screenSize.y);
+
+    const GLfloat nothing[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    const GLfloat revealed[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+    glClearBufferfv(GL_COLOR, 0, nothing);
+    glClearBufferfv(GL_COLOR, 1, revealed);
+
+    //Accumulation adds up, revealage multiplies by one minus the alpha of every layer
+    glEnable(GL_DEPTH_TEST);
+    glDepthMask(GL_FALSE);
+    glEnable(GL_BLEND);
+    glBlendFunci(0, GL_ONE, GL_ONE);
+    glBlendFunci(1, GL_ZERO, GL_ONE_MINUS_SRC_COLOR);
+
+    return true;
+}
+
+void TransparencyPass::composite()
+{
+    if(!m_accumulation)
+    {
+        return;
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, m_screenSize.x, m_screenSize.y);
+
+    glDisable(GL_DEPTH_TEST);
+    glBlendFunc(GL_ONE_MINUS_SRC_ALPHA, GL_SRC_ALPHA);
+
+    m_accumulation->bind();
+    m_revealage->bind();
+
+    glUseProgram(m_compositeProgram);
+    glUniform1i(glGetUniformLocation(m_compositeProgram, "accumulation"), ACCUMULATION_SLOT);
+    glUniform1i(glGetUniformLocation(m_compositeProgram, "revealage"), REVEALAGE_SLOT);
+
+    glBindVertexArray(m_vao);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+    RenderStats::addDrawCall(1);
+
+    glUseProgram(0);
+    m_accumulation->unbind();
+    m_revealage->unbind();
+
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glDepthMask(GL_TRUE);
+    glEnable(GL_DEPTH_TEST);
+
+    release();
+}
+
+void TransparencyPass::release()
+{
+    if(m_depth)
+    {
+        m_pool->release(m_depth);
+    }
+
+    if(m_accumulation)
+    {
+        m_pool->release(m_accumulation);
+    }
+
+    if(m_revealage)
+    {
+        m_pool->release(m_revealage);
+    }
+
+    m_depth = nullptr;
+    m_accumulation = nullptr;
+    m_revealage = nullptr;
+}
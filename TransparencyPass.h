@@ -0,0 +1,64 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <memory>
+
+class RenderTargetPool;
+class Texture;
+
+/// <summary>
+/// Weighted blended order independent transparency. Transparent geometry is drawn in any order into an
+/// accumulation target (premultiplied color and alpha, weighted by depth, added up) and a revealage target
+/// (the product of one minus every alpha). The composite then blends the weighted average color over the
+/// opaque scene by how much of it is still revealed. The targets come from the render target pool, and the
+/// opaque depth is copied in so transparent geometry behind opaque geometry is rejected.
+/// </summary>
+class TransparencyPass
+{
+    public:
+        /// <summary>
+        /// Constructor
+        /// </summary>
+        /// <param name="pool">The pool the targets are taken from</param>
+        /// <param name="compositeProgram">The program in shaders/oit-composite.*.glsl</param>
+        TransparencyPass(std::shared_ptr<RenderTargetPool> pool, GLuint compositeProgram);
+
+        /// <summary>
+        /// Destructor
+        /// </summary>
+        ~TransparencyPass();
+
+        /// <summary>
+        /// Clears the targets and binds them with the blending of the accumulation. The depth of the default
+        /// framebuffer is copied and tested against, without writing
+        /// </summary>
+        /// <param name="screenSize">The size of the default framebuffer</param>
+        /// <returns>Flag for if the targets could be created</returns>
+        bool begin(glm::uvec2 screenSize);
+
+        /// <summary>
+        /// Blends the accumulated transparency over the default framebuffer and gives the targets back to the pool
+        /// </summary>
+        void composite();
+
+    private:
+        static const unsigned int DEPTH_SLOT = 27;
+        static const unsigned int ACCUMULATION_SLOT = 28;
+        static const unsigned int REVEALAGE_SLOT = 29;
+
+        std::shared_ptr<RenderTargetPool> m_pool;
+        GLuint m_compositeProgram;
+        GLuint m_vao;
+        glm::uvec2 m_screenSize;
+
+        std::shared_ptr<Texture> m_depth;
+        std::shared_ptr<Texture> m_accumulation;
+        std::shared_ptr<Texture> m_revealage;
+
+        /// <summary>
+        /// Gives the targets back to the pool
+        /// </summary>
+        void release();
+};
@@ -0,0 +1,321 @@
+#include "WorldPartition.h"
+#include "Camera.h"
+#include "Geometry.h"
+#include "Group.h"
+#include "Profiler.h"
+#include "Texture.h"
+#include "ThreadPool.h"
+#include "Transform.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <set>
+
+WorldPartition::WorldPartition(std::shared_ptr<Camera> camera, std::shared_ptr<ThreadPool> threadPool, std::shared_ptr<Group> root, ModelBuilder builder) :
+    m_camera(camera),
+    m_threadPool(threadPool),
+    m_root(root),
+    m_builder(builder),
+    m_cellSize(100.0f),
+    m_streamRadius(300.0f),
+    m_memoryBudget(size_t(512) << 20),
+    m_residentBytes(0),
+    m_loadedCells(0),
+    m_version(0),
+    m_overBudget(false)
+{
+}
+
+WorldPartition::~WorldPartition()
+{
+    //The workers write to the models, they have to be done before the models go away
+    for(auto& model : m_models)
+    {
+        if(model.second->loading.valid())
+        {
+            model.second->loading.wait();
+        }
+    }
+}
+
+void WorldPartition::setGrid(float cellSize, float streamRadius, size_t memoryBudget)
+{
+    m_cellSize = cellSize;
+    m_streamRadius = streamRadius > 0 ? streamRadius : cellSize * 3.0f;
+    m_memoryBudget = memoryBudget;
+}
+
+void WorldPartition::add(const XmlNode& node)
+{
+    const glm::vec4& translation = node.initialTransform[3];
+    std::pair<int, int> key(int(std::floor(translation.x / m_cellSize)), int(std::floor(translation.z / m_cellSize)));
+
+    Cell& cell = m_cells[key];
+    cell.nodes.push_back(node);
+
+    std::shared_ptr<Model>& model = m_models[node.path];
+    if(!model)
+    {
+        model = std::shared_ptr<Model>(new Model());
+        model->path = node.path;
+    }
+
+    if(std::find(cell.models.begin(), cell.models.end(), model) == cell.models.end())
+    {
+        cell.models.push_back(model);
+    }
+}
+
+void WorldPartition::update(Node &n)
+{
+    PROFILE_FUNCTION();
+
+    if(!m_camera || m_cells.empty())
+    {
+        return;
+    }
+
+    glm::vec3 eye = m_camera->getPosition();
+
+    //Request the cells in the radius nearest first, so the pool loads what is in front of the camera before the rest
+    std::vector<std::pair<float, Cell*>> requests;
+    for(auto& cell : m_cells)
+    {
+        float d = distance(cell.first, eye);
+        if(cell.second.status == UNLOADED && d <= m_streamRadius)
+        {
+            requests.push_back(std::make_pair(d, &cell.second));
+        }
+    }
+
+    std::sort(requests.begin(), requests.end(), [](const std::pair<float, Cell*>& a, const std::pair<float, Cell*>& b) { return a.first < b.first; });
+    for(auto& cell : requests)
+    {
+        request(*cell.second);
+    }
+
+    //Uploads and node creation need the context, a few models per frame keep the frame time even
+    unsigned int uploads = 0;
+    for(auto& entry : m_models)
+    {
+        Model& model = *entry.second;
+        if(uploads >= MAX_UPLOADS_PER_FRAME)
+        {
+            break;
+        }
+
+        if(model.status == LOADING && model.loading.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+        {
+            finish(model);
+            uploads++;
+        }
+    }
+
+    for(auto& cell : m_cells)
+    {
+        if(cell.second.status != LOADING)
+        {
+            continue;
+        }
+
+        bool ready = true;
+        for(auto& model : cell.second.models)
+        {
+            ready = ready && model->status == LOADED;
+        }
+
+        if(ready)
+        {
+            attach(cell.first, cell.second);
+        }
+    }
+
+    if(m_residentBytes <= m_memoryBudget)
+    {
+        m_overBudget = false;
+        return;
+    }
+
+    //Over budget, evict the loaded cells outside the radius farthest first
+    std::vector<std::pair<float, std::pair<int, int>>> evictions;
+    for(auto& cell : m_cells)
+    {
+        float d = distance(cell.first, eye);
+        if(cell.second.status == LOADED && d > m_streamRadius)
+        {
+            evictions.push_back(std::make_pair(d, cell.first));
+        }
+    }
+
+    std::sort(evictions.begin(), evictions.end(), [](const std::pair<float, std::pair<int, int>>& a, const std::pair<float, std::pair<int, int>>& b) { return a.first > b.first; });
+    for(auto& cell : evictions)
+    {
+        if(m_residentBytes <= m_memoryBudget)
+        {
+            break;
+        }
+
+        evict(m_cells[cell.second]);
+    }
+
+    if(m_residentBytes > m_memoryBudget && !m_overBudget)
+    {
+        std::cerr << "The cells in the stream radius need " << (m_residentBytes >> 20) << " MB, more than the memory budget of " << (m_memoryBudget >> 20) << " MB" << std::endl;
+        m_overBudget = true;
+    }
+}
+
+unsigned long long WorldPartition::getVersion()
+{
+    return m_version;
+}
+
+unsigned int WorldPartition::getNumLoadedCells()
+{
+    return m_loadedCells;
+}
+
+size_t WorldPartition::getResidentBytes()
+{
+    return m_residentBytes;
+}
+
+float WorldPartition::distance(const std::pair<int, int>& cell, const glm::vec3& position)
+{
+    glm::vec2 min = glm::vec2(cell.first * m_cellSize, cell.second * m_cellSize);
+    glm::vec2 max = min + glm::vec2(m_cellSize, m_cellSize);
+    glm::vec2 point = glm::vec2(position.x, position.z);
+
+    return glm::length(glm::clamp(point, min, max) - point);
+}
+
+void WorldPartition::request(Cell& cell)
+{
+    for(auto& model : cell.models)
+    {
+        model->users++;
+
+        if(model->status == UNLOADED)
+        {
+            std::shared_ptr<Model> loading = model;
+            model->status = LOADING;
+            model->loading = m_threadPool->submit([loading]()
+            {
+                PROFILE_SCOPE("WorldPartition::load");
+                loading->obj = loadObj(loading->path, true);
+            });
+        }
+    }
+
+    cell.status = LOADING;
+}
+
+void WorldPartition::finish(Model& model)
+{
+    PROFILE_FUNCTION();
+
+    model.loading.get();
+    model.status = LOADED;
+
+    if(!model.obj)
+    {
+        std::cerr << "Unable to stream model: " << model.path << std::endl;
+        return;
+    }
+
+    std::set<Texture*> textures;
+    size_t bytes = 0;
+    for(auto& mesh : model.obj->meshes)
+    {
+        bytes += mesh.vertices.size() * sizeof(glm::vec4) + mesh.normals.size() * sizeof(glm::vec3) + mesh.texCoords.size() * sizeof(glm::vec2) + mesh.elements.size() * sizeof(GLushort);
+
+        if(mesh.texture && textures.insert(mesh.texture.get()).second)
+        {
+            if(mesh.texture->isLoaded() && !mesh.texture->upload(0))
+            {
+                std::cerr << "Error uploading texture of: " << model.path << std::endl;
+            }
+            bytes += mesh.texture->getSizeInBytes();
+        }
+    }
+
+    size_t glObjects = Geometry::getNumGLObjects();
+    model.nodes = m_builder(model.obj);
+    model.glObjects = Geometry::getNumGLObjects() - glObjects;
+    model.bytes = bytes;
+    m_residentBytes += bytes;
+
+    //The geometry and textures are on the GPU now, the nodes keep what they need
+    model.obj.reset();
+}
+
+void WorldPartition::attach(const std::pair<int, int>& key, Cell& cell)
+{
+    cell.group = std::shared_ptr<Group>(new Group());
+    cell.group->setName("Cell_" + std::to_string(key.first) + "_" + std::to_string(key.second));
+
+    for(auto& node : cell.nodes)
+    {
+        std::shared_ptr<Model> model = m_models[node.path];
+        if(!model->nodes)
+        {
+            continue;
+        }
+
+        //An instance of the model, the geometry below it is shared with every other node using the same file
+        std::shared_ptr<Transform> instance = std::shared_ptr<Transform>(new Transform());
+        instance->setName("Transform_" + node.name);
+        instance->setInitialTransform(node.initialTransform * model->nodes->getModelMatrix());
+        for(auto& child : model->nodes->getChildren())
+        {
+            instance->addChild(child);
+        }
+
+        cell.group->addChild(instance);
+    }
+
+    m_root->addChild(cell.group);
+    cell.status = LOADED;
+    m_loadedCells++;
+    m_version++;
+}
+
+void WorldPartition::evict(Cell& cell)
+{
+    for(int i = 0; i < m_root->getNumChildren(); i++)
+    {
+        if(m_root->getChild(i) == cell.group)
+        {
+            m_root->removeChildAt(i);
+            break;
+        }
+    }
+
+    cell.group.reset();
+    cell.status = UNLOADED;
+    m_loadedCells--;
+    m_version++;
+
+    for(auto& model : cell.models)
+    {
+        if(--model->users == 0)
+        {
+            m_residentBytes -= model->bytes;
+            model->bytes = 0;
+
+            //The cell held the last instance, so the geometry has to be gone with its buffers once the nodes are dropped.
+            //Rendering shadows may have added depth vertex arrays since the upload, those are released too
+            size_t glObjects = Geometry::getNumGLObjects();
+            model->nodes.reset();
+            size_t released = glObjects - Geometry::getNumGLObjects();
+            if(released < model->glObjects)
+            {
+                std::cerr << "Evicting " << model->path << " released " << released << " of its " << model->glObjects << " GL objects" << std::endl;
+            }
+            model->glObjects = 0;
+            model->status = UNLOADED;
+        }
+    }
+}
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Loader.h"
+#include "UpdateCallback.h"
+
+class Camera;
+class Group;
+class ThreadPool;
+class Transform;
+
+/// <summary>
+/// Streams the nodes of a large scene by a uniform grid on the ground plane. Every node goes into the cell its translation
+/// falls in. Cells within the stream radius of the camera are requested nearest first. Their models are loaded on the thread
+/// pool, and at most a few are uploaded per frame, so the frame rate holds while the camera moves. A model is loaded once
+/// and shared by every node and cell using it. Cells outside the radius are kept until the streamed memory goes over the
+/// budget, and are then evicted farthest first. A model is freed when its last cell is evicted.
+/// </summary>
+class WorldPartition : public UpdateCallback
+{
+    public:
+        /// <summary>
+        /// Creates the nodes of a model on the thread owning the OpenGL context, the textures are uploaded already
+        /// </summary>
+        typedef std::function<std::shared_ptr<Transform>(std::shared_ptr<Obj>)> ModelBuilder;
+
+        /// <summary>
+        /// Constructor
+        /// </summary>
+        /// <param name="camera">The camera the cells are streamed around</param>
+        /// <param name="threadPool">The pool the models are loaded on</param>
+        /// <param name="root">The group the loaded cells are added to</param>
+        /// <param name="builder">Creates the nodes of a loaded model</param>
+        WorldPartition(std::shared_ptr<Camera> camera, std::shared_ptr<ThreadPool> threadPool, std::shared_ptr<Group> root, ModelBuilder builder);
+
+        /// <summary>
+        /// Destructor, waits for the models still loading
+        /// </summary>
+        ~WorldPartition();
+
+        /// <summary>
+        /// Sets the grid
+        /// </summary>
+        /// <param name="cellSize">The size of a cell on the x and z axes</param>
+        /// <param name="streamRadius">Cells closer to the camera than this are loaded</param>
+        /// <param name="memoryBudget">The bytes of streamed models kept before distant cells are evicted</param>
+        void setGrid(float cellSize, float streamRadius, size_t memoryBudget);
+
+        /// <summary>
+        /// Adds a node to the cell its translation falls in
+        /// </summary>
+        void add(const XmlNode& node);
+
+        /// <summary>
+        /// Requests, finishes and evicts cells around the camera, given by UpdateCallback
+        /// </summary>
+        void update(Node &n) override;
+
+        /// <summary>
+        /// Returns a counter that is increased every time cells are added to or removed from the scene
+        /// </summary>
+        unsigned long long getVersion();
+
+        /// <summary>
+        /// Returns the amount of cells in the scene
+        /// </summary>
+        unsigned int getNumLoadedCells();
+
+        /// <summary>
+        /// Returns the bytes of the models in memory
+        /// </summary>
+        size_t getResidentBytes();
+
+    private:
+        static const unsigned int MAX_UPLOADS_PER_FRAME = 2;
+
+        enum Status
+        {
+            UNLOADED,
+            LOADING,
+            LOADED
+        };
+
+        /// <summary>
+        /// A model file, loaded once for every node using it
+        /// </summary>
+        struct Model
+        {
+            std::string path;
+            Status status = UNLOADED;
+            std::future<void> loading;
+            std::shared_ptr<Obj> obj;
+            std::shared_ptr<Transform> nodes;
+            size_t bytes = 0;
+            size_t glObjects = 0;
+            unsigned int users = 0;
+        };
+
+        /// <summary>
+        /// The nodes of one grid cell
+        /// </summary>
+        struct Cell
+        {
+            std::vector<XmlNode> nodes;
+            std::vector<std::shared_ptr<Model>> models;
+            Status status = UNLOADED;
+            std::shared_ptr<Group> group;
+        };
+
+        std::shared_ptr<Camera> m_camera;
+        std::shared_ptr<ThreadPool> m_threadPool;
+        std::shared_ptr<Group> m_root;
+        ModelBuilder m_builder;
+
+        float m_cellSize;
+        float m_streamRadius;
+        size_t m_memoryBudget;
+
+        std::map<std::pair<int, int>, Cell> m_cells;
+        std::map<std::string, std::shared_ptr<Model>> m_models;
+        size_t m_residentBytes;
+        unsigned int m_loadedCells;
+        unsigned long long m_version;
+        bool m_overBudget;
+
+        /// <summary>
+        /// Returns the distance from a point to the closest point of a cell on the ground plane
+        /// </summary>
+        float distance(const std::pair<int, int>& cell, const glm::vec3& position);
+
+        /// <summary>
+        /// Starts loading the models of a cell that are not loaded or loading yet
+        /// </summary>
+        void request(Cell& cell);
+
+        /// <summary>
+        /// Uploads a loaded model and creates its nodes
+        /// </summary>
+        void finish(Model& model);
+
+        /// <summary>
+        /// Adds the nodes of a cell whose models are all loaded to the scene
+        /// </summary>
+        void attach(const std::pair<int, int>& key, Cell& cell);
+
+        /// <summary>
+        /// Removes a cell from the scene and frees the models no other cell uses
+        /// </summary>
+        void evict(Cell& cell);
+};
@@ -22,6 +22,14 @@ void junk() {
 #include <sstream>
 
 #include "Application.h"
+#include "Benchmark.h"
+#include "ParticleBenchmark.h"
+#include "SortBenchmark.h"
+#include "BVHBenchmark.h"
+#include "TextureBaker.h"
+#include "TextureStreamer.h"
+#include "CameraPath.h"
+#include "MipGenerator.h"
 
 #include <glm/vec2.hpp>
 
@@ -110,14 +118,119 @@ int main(int argc, char** argv)
   if (argc > 1)
     model_filename = argv[1];
 
+  // Benchmark options: <model-file> --benchmark [--camera-path file] [--warmup N] [--frames N] [--out file]
+  // --no-shader-cache compiles every program from source, to measure a cold start
+  // --shadow-resolution N and --shadow-depth 16|24|32 set the size and format of the shadow cascades
+  // --cpu-particles simulates the particles on the CPU instead of in the compute shader
+  // --no-texture-streaming uploads every texture while loading, to compare the first frame and the frame spikes
+  // --texture-arrays packs textures of the same format and size into texture arrays once the scene is loaded
+  // --bindless-textures samples the textures through bindless handles where GL_ARB_bindless_texture is supported
+  // --mip-filter box|kaiser sets the filter the mip chains of the textures are built with, kaiser by default
+  // Particle benchmark: <model-file> --particle-benchmark [--particles N] [--warmup N] [--frames N] [--out file]
+  // Sort benchmark: <model-file> --sort-benchmark [--quads N] [--warmup N] [--frames N] [--out file]
+  // BVH benchmark: <model-file> --bvh-benchmark [--objects N] [--warmup N] [--frames N] [--out file]
+  // Texture baking: <model-file> --bake-textures writes block compressed caches next to the textures of the scene and exits
+  bool benchmark = false;
+  bool particleBenchmark = false;
+  bool sortBenchmark = false;
+  bool bvhBenchmark = false;
+  std::string cameraPathFilename;
+  std::string benchmarkOutFilename;
+  int warmupFrames = -1;
+  int measuredFrames = -1;
+  unsigned int particles = 1 << 20;
+  unsigned int quads = 100000;
+  unsigned int objects = 100000;
+  bool cpuParticles = false;
+  bool shaderCache = true;
+  bool textureStreaming = true;
+  bool textureArrays = false;
+  bool bindlessTextures = false;
+  bool bakeTextures = false;
+  MipGenerator::Filter mipFilter = MipGenerator::FILTER_KAISER;
+  unsigned int shadowResolution = 1024;
+  unsigned int shadowDepthBits = 32;
+
+  for (int i = 2; i < argc; i++)
+  {
+    std::string arg = argv[i];
+    bool hasValue = i + 1 < argc;
+
+    if (arg == "--benchmark")
+      benchmark = true;
+    else if (arg == "--particle-benchmark")
+      particleBenchmark = true;
+    else if (arg == "--particles" && hasValue)
+      particles = std::stoi(argv[++i]);
+    else if (arg == "--sort-benchmark")
+      sortBenchmark = true;
+    else if (arg == "--quads" && hasValue)
+      quads = std::stoi(argv[++i]);
+    else if (arg == "--bvh-benchmark")
+      bvhBenchmark = true;
+    else if (arg == "--objects" && hasValue)
+      objects = std::stoi(argv[++i]);
+    else if (arg == "--cpu-particles")
+      cpuParticles = true;
+    else if (arg == "--camera-path" && hasValue)
+      cameraPathFilename = argv[++i];
+    else if (arg == "--warmup" && hasValue)
+      warmupFrames = std::stoi(argv[++i]);
+    else if (arg == "--frames" && hasValue)
+      measuredFrames = std::stoi(argv[++i]);
+    else if (arg == "--out" && hasValue)
+      benchmarkOutFilename = argv[++i];
+    else if (arg == "--no-shader-cache")
+      shaderCache = false;
+    else if (arg == "--no-texture-streaming")
+      textureStreaming = false;
+    else if (arg == "--texture-arrays")
+      textureArrays = true;
+    else if (arg == "--bindless-textures")
+      bindlessTextures = true;
+    else if (arg == "--bake-textures")
+      bakeTextures = true;
+    else if (arg == "--mip-filter" && hasValue)
+    {
+      std::string filter = argv[++i];
+      if (filter == "box")
+        mipFilter = MipGenerator::FILTER_BOX;
+      else if (filter == "kaiser")
+        mipFilter = MipGenerator::FILTER_KAISER;
+      else
+        std::cerr << "Unknown mip filter: " << filter << std::endl;
+    }
+    else if (arg == "--shadow-resolution" && hasValue)
+      shadowResolution = std::stoi(argv[++i]);
+    else if (arg == "--shadow-depth" && hasValue)
+      shadowDepthBits = std::stoi(argv[++i]);
+    else
+      std::cerr << "Unknown argument: " << arg << std::endl;
+  }
+
   std::string v_shader_filename = "shaders/phong-shading.vert.glsl";
   std::string  f_shader_filename = "shaders/phong-shading.frag.glsl";
 
   if (argc < 2 ) {
     std::cerr << "Loading default model: " << model_filename << std::endl;
-    std::cerr << "\n\nUsage: " << argv[0] << " <model-file>" << std::endl;
+    std::cerr << "\n\nUsage: " << argv[0] << " <model-file> [--benchmark [--camera-path file] [--warmup N] [--frames N] [--out file]] [--no-shader-cache] [--shadow-resolution N] [--shadow-depth 16|24|32] [--cpu-particles] [--no-texture-streaming] [--texture-arrays] [--bindless-textures] [--mip-filter box|kaiser]" << std::endl;
+    std::cerr << "       " << argv[0] << " <model-file> --particle-benchmark [--particles N] [--warmup N] [--frames N] [--out file]" << std::endl;
+    std::cerr << "       " << argv[0] << " <model-file> --sort-benchmark [--quads N] [--warmup N] [--frames N] [--out file]" << std::endl;
+    std::cerr << "       " << argv[0] << " <model-file> --bvh-benchmark [--objects N] [--warmup N] [--frames N] [--out file]" << std::endl;
+    std::cerr << "       " << argv[0] << " <model-file> --bake-textures" << std::endl;
   }
 
+  application->getProgramCache()->setEnabled(shaderCache);
+  application->setShadowQuality(shadowResolution, shadowDepthBits);
+  application->setTextureStreaming(textureStreaming);
+  application->setTextureArrays(textureArrays);
+  application->setBindlessTextures(bindlessTextures);
+  TextureBaker::setEnabled(bakeTextures);
+  MipGenerator::setFilter(mipFilter);
+
+  if (cpuParticles)
+    application->setParticleBackend(GPUParticles::BACKEND_CPU);
+
   if (!application->initResources(model_filename, v_shader_filename, f_shader_filename))
   {
     cleanupWindows(window);
@@ -126,6 +239,76 @@ int main(int argc, char** argv)
 
   glEnable(GL_DEPTH_TEST);
 
+  if (particleBenchmark)
+  {
+    ParticleBenchmark bench(application);
+    bench.setSize(particles, warmupFrames < 0 ? 10 : warmupFrames, measuredFrames < 0 ? 100 : measuredFrames);
+    bool ok = bench.run(benchmarkOutFilename.empty() ? "particle_benchmark.json" : benchmarkOutFilename);
+
+    cleanupWindows(window);
+    return ok ? 0 : 1;
+  }
+
+  if (sortBenchmark)
+  {
+    SortBenchmark bench;
+    bench.setSize(quads, warmupFrames < 0 ? 10 : warmupFrames, measuredFrames < 0 ? 300 : measuredFrames);
+    bool ok = bench.run(benchmarkOutFilename.empty() ? "sort_benchmark.json" : benchmarkOutFilename);
+
+    cleanupWindows(window);
+    return ok ? 0 : 1;
+  }
+
+  if (bakeTextures)
+  {
+    //Loading baked every texture that had no current cache, the streamed ones once their decoding is done
+    if (application->getTextureStreamer())
+      application->getTextureStreamer()->flush();
+
+    TextureBaker::printSummary();
+
+    cleanupWindows(window);
+    return 0;
+  }
+
+  if (bvhBenchmark)
+  {
+    BVHBenchmark bench;
+    bench.setSize(objects, warmupFrames < 0 ? 10 : warmupFrames, measuredFrames < 0 ? 100 : measuredFrames);
+    bool ok = bench.run(benchmarkOutFilename.empty() ? "bvh_benchmark.json" : benchmarkOutFilename);
+
+    cleanupWindows(window);
+    return ok ? 0 : 1;
+  }
+
+  if (benchmark)
+  {
+    // Do not let vsync hide the frame cost
+    glfwSwapInterval(0);
+
+    std::shared_ptr<CameraPath> path;
+    if (cameraPathFilename.empty())
+    {
+      path = CameraPath::createOrbit(application->getSceneBoundingBox());
+    }
+    else
+    {
+      path = std::make_shared<CameraPath>();
+      if (!path->load(cameraPathFilename))
+      {
+        cleanupWindows(window);
+        return 1;
+      }
+    }
+
+    Benchmark bench(application, path);
+    bench.setFrames(warmupFrames < 0 ? 100 : warmupFrames, measuredFrames < 0 ? 1000 : measuredFrames);
+    bool ok = bench.run(window, model_filename, benchmarkOutFilename.empty() ? "benchmark.json" : benchmarkOutFilename);
+
+    cleanupWindows(window);
+    return ok ? 0 : 1;
+  }
+
   while (!glfwWindowShouldClose(window))
   {
     application->update(window);
@@ -3,7 +3,7 @@ import random
 import math
 
 if len(sys.argv) < 2:
-    print("Usage: " + sys.argv[0] + " <outfile> <numHouses>")
+    print("Usage: " + sys.argv[0] + " <outfile> <numHouses> [extent] [cellSize]")
     sys.exit(1)
 
 filename = sys.argv[1]
@@ -12,11 +12,26 @@ numHouses = 1
 if len(sys.argv) > 1:
     numHouses = int(sys.argv[2])
 
+# Houses are placed within extent of the origin, a cell size streams them with the world partition
+extent = 500
+cellSize = 0
+
+if len(sys.argv) > 3:
+    extent = float(sys.argv[3])
+
+if len(sys.argv) > 4:
+    cellSize = float(sys.argv[4])
+
 print(numHouses)
 
 file = open(filename, "w")
 
-file.write("<?xml version=\"1.0\" encoding=\"utf-8\"?>\n<scene>\n")
+file.write("<?xml version=\"1.0\" encoding=\"utf-8\"?>\n")
+
+if cellSize > 0:
+    file.write("<scene partition=\"" + str(cellSize) + "\" streamRadius=\"" + str(cellSize * 3) + "\" memoryBudget=\"512\">\n")
+else:
+    file.write("<scene>\n")
 
 def rand():
     return random.random() * 2 - 1
@@ -25,7 +40,7 @@ for i in range(0, numHouses):
     n = math.floor(random.random() * 10) + 1
     house = f'{n:03}' + ".fbx"
 
-    pos = [str(rand() * 500), str(rand() * 500)]
+    pos = [str(rand() * extent), str(rand() * extent)]
     print(pos)
     ori = str(rand() * 180)
 
@@ -35,9 +50,13 @@ for i in range(0, numHouses):
     file.write("  </node>\n")
 
 
-file.write("  <node name=\"ground\">\n")
+# The ground spans every cell, it is loaded up front
+if cellSize > 0:
+    file.write("  <node name=\"ground\" stream=\"false\">\n")
+else:
+    file.write("  <node name=\"ground\">\n")
 file.write("    <file path=\"models/box.obj\"> </file>\n")
-file.write("    <transform translate=\"0 0 0 \" rotate=\"0 0 0\" scale=\"1000 0.1 1000\"></transform>\n")
+file.write("    <transform translate=\"0 0 0 \" rotate=\"0 0 0\" scale=\"" + str(extent * 2) + " 0.1 " + str(extent * 2) + "\"></transform>\n")
 file.write("  </node>\n")
 
 
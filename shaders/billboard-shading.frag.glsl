@@ -1,12 +1,32 @@
 #version 430 core
 
+// Defined by ShaderPermutations for the order independent transparency pass and for bindless textures
+#ifndef OIT
+#define OIT 0
+#endif
+#ifndef BINDLESS
+#define BINDLESS 0
+#endif
+#if BINDLESS
+#extension GL_ARB_bindless_texture : require
+#endif
+
 // From vertex shader
 in vec4 position;  // position of the vertex (and fragment) in eye space
 in vec3 normal ;  // surface normal vector in eye space
 in vec2 texCoord; // Texture coordinate
 
+#ifndef IMPOSTOR
+#define IMPOSTOR 0
+#endif
+
 // The end result of this shader
+#if OIT
+layout(location = 0) out vec4 color;
+layout(location = 1) out float revealage;
+#else
 out vec4 color;
+#endif
 
 uniform mat4 m, v, p;
 uniform mat4 v_inv;
@@ -24,8 +44,58 @@ struct Material
     float shininess;
     bool activeTextures[MAX_TEXTURES];
     sampler2D textures[MAX_TEXTURES];
+    // Layer of each texture in its texture array, -1 for a plain texture
+    int layers[MAX_TEXTURES];
+#if BINDLESS
+    // Entry of each texture in the bindless table, -1 for a bound texture
+    int bindlessIndices[MAX_TEXTURES];
+#endif
+};
+
+// The front surface material
+uniform Material material;
+
+// The arrays of packed textures, on the units after those of the plain textures
+layout(binding = 2) uniform sampler2DArray materialArrays[MAX_TEXTURES];
+
+#if BINDLESS
+// The bindless texture table, filled by BindlessTextures
+struct BindlessTexture
+{
+    uvec2 handle;
+    int layer;
+    int padding;
 };
 
+layout(std430, binding = 9) readonly buffer BindlessTable
+{
+    BindlessTexture bindlessTextures[];
+};
+#endif
+
+vec4 sampleMaterialTexture(int i, vec2 uv)
+{
+#if BINDLESS
+  if (material.bindlessIndices[i] >= 0)
+  {
+    BindlessTexture entry = bindlessTextures[material.bindlessIndices[i]];
+    if (entry.layer >= 0)
+    {
+      return texture(sampler2DArray(entry.handle), vec3(uv, float(entry.layer)));
+    }
+
+    return texture(sampler2D(entry.handle), uv);
+  }
+#endif
+
+  if (material.layers[i] >= 0)
+  {
+    return texture(materialArrays[i], vec3(uv, float(material.layers[i])));
+  }
+
+  return texture(material.textures[i], uv);
+}
+
 // Definition of a light source structure
 struct LightSource
 {
@@ -43,11 +113,21 @@ uniform LightSource lights[MaxNumberOfLights];
 // Some hard coded default ambient lighting
 vec4 scene_ambient = vec4(0.2, 0.2, 0.2, 1.0);
 
-// The front surface material
-uniform Material material;
+#if IMPOSTOR
+// The baked views, already lit
+uniform sampler2D impostorAtlas;
+#endif
 
 void main()
 {
+#if IMPOSTOR
+  color = texture(impostorAtlas, texCoord);
+  if (color.a < 0.5)
+    discard;
+  color.a = 1.0;
+  return;
+#endif
+
   vec3 normalDirection = normalize(normal);
   vec3 viewDirection = normalize(vec3(v_inv * vec4(0.0, 0.0, 0.0, 1.0) - position));
   vec3 lightDirection;
@@ -92,13 +172,13 @@ void main()
   // How we could check for a diffuse texture map
   if (material.activeTextures[0])
   {
-    diffuseTex = texture2D(material.textures[0], texCoord);
+    diffuseTex = sampleMaterialTexture(0, texCoord);
     mixedTextureColor = diffuseTex;
   }
 
   if(material.activeTextures[1])
   {
-    vec4 diffuseTex2 = texture2D(material.textures[1], texCoord);
+    vec4 diffuseTex2 = sampleMaterialTexture(1, texCoord);
     if(!(diffuseTex2.r == 0  && diffuseTex2.g == 0 && diffuseTex2.b == 0))
       mixedTextureColor = mix(diffuseTex, diffuseTex2, 0.5);
   }
@@ -109,4 +189,12 @@ void main()
   }
 
   color = vec4(totalLighting, mixedTextureColor.a);
+
+#if OIT
+  // Same weighting as the phong shader
+  float alpha = color.a;
+  float weight = clamp(alpha * max(1e-2, 3e3 * pow(1.0 - gl_FragCoord.z, 3.0)), 1e-2, 3e3);
+  color = vec4(color.rgb * alpha, alpha) * weight;
+  revealage = alpha;
+#endif
 }
@@ -1,5 +1,10 @@
 #version 430 core
 
+// Defined by ShaderPermutations for the instanced impostors
+#ifndef IMPOSTOR
+#define IMPOSTOR 0
+#endif
+
 struct Vertex
 {
   vec4 position;
@@ -19,8 +24,50 @@ uniform mat4 m;
 
 uniform mat3 m_3x3_inv_transp;
 
+#if IMPOSTOR
+const int IMPOSTOR_VIEWS = 8;
+
+// Two vec4 per instance: the world center and radius, then the yaw and the first atlas tile of its views
+layout(std430, binding = 8) readonly buffer Impostors
+{
+    vec4 impostors[];
+};
+
+uniform mat4 v_inv;
+uniform int impostorTilesPerRow;
+#endif
+
 void main()
 {
+#if IMPOSTOR
+    vec4 centerRadius = impostors[gl_InstanceID * 2];
+    vec4 yawTile = impostors[gl_InstanceID * 2 + 1];
+
+    // The quad turns around the y axis to face the camera, like the billboards
+    vec3 eye = vec3(v_inv[3]);
+    vec3 toEye = eye - centerRadius.xyz;
+    toEye.y = 0.0;
+    toEye = length(toEye) > 1e-4 ? normalize(toEye) : vec3(0.0, 0.0, 1.0);
+    vec3 right = cross(vec3(0.0, 1.0, 0.0), toEye);
+
+    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1) * 2.0 - 1.0;
+    vec4 world = vec4(centerRadius.xyz + (right * corner.x + vec3(0.0, corner.y, 0.0)) * centerRadius.w, 1.0);
+
+    // The view baked closest to the direction of the camera, in the space of the object
+    float viewStep = 6.28318530718 / float(IMPOSTOR_VIEWS);
+    float angle = atan(toEye.x, toEye.z) - yawTile.x;
+    int view = int(mod(floor(angle / viewStep + 0.5), float(IMPOSTOR_VIEWS)));
+    int tile = int(yawTile.y) + view;
+
+    vec2 tileOrigin = vec2(tile % impostorTilesPerRow, tile / impostorTilesPerRow);
+    texCoord = (tileOrigin + corner * 0.5 + 0.5) / float(impostorTilesPerRow);
+
+    position = v * world;
+    normal = vec3(0.0, 0.0, 1.0);
+    gl_Position = p * position;
+    return;
+#endif
+
     position = v * m * vertex.position;
     normal = normalize(m_3x3_inv_transp * vertex.normal);
     texCoord = vertex.texCoord;
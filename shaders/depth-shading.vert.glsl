@@ -1,19 +1,13 @@
 #version 430 core
 
-struct Vertex
-{
-  vec4 position;
-  vec3 normal;
-  vec2 texCoord;
-};
-
-in Vertex vertex;
+// Only the positions are bound in the shadow pass, see Geometry::renderDepth
+layout(location = 0) in vec4 vertexPosition;
 
-// model, view and projection transform
+// model and light space transform
 uniform mat4 m;
 uniform mat4 u_lightSpaceMatrix;
 
 void main()
 {
-  gl_Position = u_lightSpaceMatrix * m * vertex.position;
+  gl_Position = u_lightSpaceMatrix * m * vertexPosition;
 }
@@ -2,30 +2,181 @@
 
 layout(local_size_x = 64) in;
 
+//The stages run in this order every frame, the args and finalize stages on a single invocation
+#define STAGE_ARGS 0
+#define STAGE_EMIT 1
+#define STAGE_SIMULATE 2
+#define STAGE_FINALIZE 3
+
+//w is the remaining life in seconds
 layout(std430, binding = 0) buffer Pos
 {
 	vec4 position[];
 };
 
+//w is the full lifetime in seconds
 layout(std430, binding = 1) buffer Vel
 {
 	vec4 velocity[];
 };
 
+layout(std430, binding = 2) buffer Dead
+{
+	uint deadIndices[];
+};
+
+layout(std430, binding = 3) buffer AliveCurrent
+{
+	uint aliveCurrent[];
+};
+
+layout(std430, binding = 4) buffer AliveNext
+{
+	uint aliveNext[];
+};
+
+layout(std430, binding = 5) buffer Counters
+{
+	uint deadCount;
+	uint aliveCount[2];
+	uint emitCount;
+};
+
+layout(std430, binding = 6) buffer Indirect
+{
+	uint emitDispatch[3];
+	uint simulateDispatch[3];
+	uint drawCount;
+	uint drawInstanceCount;
+	uint drawFirst;
+	uint drawBaseInstance;
+};
+
+//Positions of the survivors in the order of the alive list, read as a vertex attribute when drawing
+layout(std430, binding = 7) buffer Draw
+{
+	vec4 drawPosition[];
+};
+
+uniform int stage;
+uniform uint current;
+uniform uint requestedEmit;
+uniform uint seed;
+uniform vec3 emitterPosition;
+uniform vec3 emitterSize;
+uniform vec2 lifetime;
 uniform vec3 followPosition;
 uniform float deltaTime;
-uniform bool isActive;
 
-void main()
+uint hash(uint x)
+{
+	x ^= x >> 16;
+	x *= 0x7feb352dU;
+	x ^= x >> 15;
+	x *= 0x846ca68bU;
+	x ^= x >> 16;
+	return x;
+}
+
+float random(inout uint state)
+{
+	state = hash(state);
+	return float(state) / 4294967295.0;
+}
+
+void args()
+{
+	//Never emit more than there are dead particles to reuse
+	uint emit = min(requestedEmit, deadCount);
+	emitCount = emit;
+
+	emitDispatch[0] = (emit + 63u) / 64u;
+	emitDispatch[1] = 1u;
+	emitDispatch[2] = 1u;
+
+	simulateDispatch[0] = (aliveCount[current] + emit + 63u) / 64u;
+	simulateDispatch[1] = 1u;
+	simulateDispatch[2] = 1u;
+
+	aliveCount[1u - current] = 0u;
+}
+
+void emit(uint i)
+{
+	if(i >= emitCount)
+	{
+		return;
+	}
+
+	uint index = deadIndices[atomicAdd(deadCount, 0xffffffffU) - 1u];
+
+	uint state = hash(i ^ hash(seed));
+	vec3 offset = vec3(random(state), random(state), random(state)) * 2.0 - 1.0;
+	float life = mix(lifetime.x, lifetime.y, random(state));
+
+	position[index] = vec4(emitterPosition + offset * emitterSize, life);
+	velocity[index] = vec4(0.0, 0.0, 0.0, life);
+
+	aliveCurrent[atomicAdd(aliveCount[current], 1u)] = index;
+}
+
+void simulate(uint i)
 {
-	if(isActive)
+	if(i >= aliveCount[current])
 	{
-		velocity[gl_GlobalInvocationID.x] += 1000 * vec4(normalize(followPosition - position[gl_GlobalInvocationID.x].xyz), 0.0) * min(0.05, deltaTime);
+		return;
 	}
-	else
+
+	uint index = aliveCurrent[i];
+	vec4 p = position[index];
+	vec4 v = velocity[index];
+
+	p.w -= deltaTime;
+
+	if(p.w <= 0.0)
 	{
-		velocity[gl_GlobalInvocationID.x] = vec4(0);
+		deadIndices[atomicAdd(deadCount, 1u)] = index;
+		return;
 	}
 
-	position[gl_GlobalInvocationID.x] += velocity[gl_GlobalInvocationID.x] * deltaTime;
-}
\ No newline at end of file
+	v.xyz += 1000 * normalize(followPosition - p.xyz) * min(0.05, deltaTime);
+	p.xyz += v.xyz * deltaTime;
+
+	position[index] = p;
+	velocity[index] = v;
+
+	//Survivors are compacted into the other list and their positions into the draw buffer
+	uint slot = atomicAdd(aliveCount[1u - current], 1u);
+	aliveNext[slot] = index;
+	drawPosition[slot] = p;
+}
+
+void finalize()
+{
+	drawCount = aliveCount[1u - current];
+	drawInstanceCount = 1u;
+	drawFirst = 0u;
+	drawBaseInstance = 0u;
+}
+
+void main()
+{
+	uint i = gl_GlobalInvocationID.x;
+
+	if(stage == STAGE_ARGS)
+	{
+		if(i == 0u) args();
+	}
+	else if(stage == STAGE_EMIT)
+	{
+		emit(i);
+	}
+	else if(stage == STAGE_SIMULATE)
+	{
+		simulate(i);
+	}
+	else if(i == 0u)
+	{
+		finalize();
+	}
+}
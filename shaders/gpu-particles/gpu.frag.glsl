@@ -1,13 +1,35 @@
 #version 430 core
 
 in vec3 fs_color;
+in float fs_alpha;
+in float fs_viewDepth;
 in vec2 fs_txCoords;
 
 out vec4 color;
 
 uniform sampler2D particleTexture;
 
+//Soft particles fade out where they get close to the scene behind them
+uniform bool softParticles;
+uniform sampler2D sceneDepth;
+uniform float softness;
+uniform vec2 nearFar;
+
+float linearDepth(float depth)
+{
+	float z = depth * 2.0 - 1.0;
+	return 2.0 * nearFar.x * nearFar.y / (nearFar.y + nearFar.x - z * (nearFar.y - nearFar.x));
+}
+
 void main()
 {
-	color = texture(particleTexture, fs_txCoords) * vec4(fs_color, 1.f);
+	float alpha = fs_alpha;
+
+	if (softParticles)
+	{
+		float scene = linearDepth(texelFetch(sceneDepth, ivec2(gl_FragCoord.xy), 0).r);
+		alpha *= clamp((scene - fs_viewDepth) / softness, 0.0, 1.0);
+	}
+
+	color = texture(particleTexture, fs_txCoords) * vec4(fs_color, alpha);
 }
\ No newline at end of file
@@ -4,7 +4,10 @@ layout(points) in;
 layout(triangle_strip, max_vertices=4) out;
 
 in vec3 vs_color[];
+in float vs_alpha[];
 out vec3 fs_color;
+out float fs_alpha;
+out float fs_viewDepth;
 out vec2 fs_txCoords;
 
 uniform mat4 projection;
@@ -19,7 +22,15 @@ const vec2 coords[4] =
 
 void main()
 {
+	//Faded out or dropped particles are not rasterized at all
+	if (vs_alpha[0] <= 0.0)
+	{
+		return;
+	}
+
 	fs_color = vs_color[0];
+	fs_alpha = vs_alpha[0];
+	fs_viewDepth = -gl_in[0].gl_Position.z;
 
 	for (int i = 0; i < 4; i++)
 	{
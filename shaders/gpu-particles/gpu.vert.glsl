@@ -1,12 +1,18 @@
 #version 430 core
 
+//Only live particles are drawn, packed by the simulation. The w is the remaining life, 0 for particles dropped by the tile limit
 layout(location = 0) in vec4 position;
 
 uniform mat4 view;
 out vec3 vs_color;
+out float vs_alpha;
 
 void main()
 {
-	vs_color = mix(vec3(0.7, 0.0, 0.5), vec3(0.0, 0.4, 0.7), smoothstep(0,1000,distance(position, vec4(position*0.1))));
-	gl_Position = view * vec4(position.xyz, 1.0);
+	vec4 worldPosition = vec4(position.xyz, 1.0);
+
+	//Particles fade out during their last second
+	vs_color = mix(vec3(0.7, 0.0, 0.5), vec3(0.0, 0.4, 0.7), smoothstep(0,1000,distance(worldPosition, worldPosition*0.1)));
+	vs_alpha = clamp(position.w, 0.0, 1.0);
+	gl_Position = view * worldPosition;
 }
\ No newline at end of file
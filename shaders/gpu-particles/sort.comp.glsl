@@ -0,0 +1,275 @@
+#version 430 core
+
+//Every workgroup owns a block of 1024 keys in shared memory, two per invocation
+layout(local_size_x = 512) in;
+
+#define BLOCK_SIZE 1024u
+
+//The stages run in this order, the sort stages are skipped when only binning is enabled
+#define STAGE_KEYS 0
+#define STAGE_SORT_LOCAL 1
+#define STAGE_MERGE_GLOBAL 2
+#define STAGE_MERGE_LOCAL 3
+#define STAGE_GATHER 4
+
+//The packed live particles of the simulation, w is the remaining life
+layout(std430, binding = 0) buffer Source
+{
+	vec4 source[];
+};
+
+layout(std430, binding = 1) buffer Keys
+{
+	float keys[];
+};
+
+layout(std430, binding = 2) buffer Values
+{
+	uint values[];
+};
+
+//Particle ids in the order of the source, the alive list on the compute backend and the emitted ids on the CPU backend.
+//Keeps the thinning stable while slots move
+layout(std430, binding = 3) buffer Ids
+{
+	uint ids[];
+};
+
+layout(std430, binding = 4) buffer Tiles
+{
+	uint tileCounts[];
+};
+
+//Only the draw count is read, it is the live count of the source
+layout(std430, binding = 6) buffer Indirect
+{
+	uint emitDispatch[3];
+	uint simulateDispatch[3];
+	uint drawCount;
+	uint drawInstanceCount;
+	uint drawFirst;
+	uint drawBaseInstance;
+};
+
+layout(std430, binding = 7) buffer Sorted
+{
+	vec4 sorted[];
+};
+
+uniform int stage;
+uniform uint paddedCount;
+uniform uint k;
+uniform uint j;
+uniform mat4 view;
+uniform mat4 projection;
+uniform bool backToFront;
+uniform bool binning;
+uniform uvec2 tileGrid;
+uniform uint tileSize;
+uniform uint tileLimit;
+uniform vec2 screenSize;
+
+shared float sharedKeys[BLOCK_SIZE];
+shared uint sharedValues[BLOCK_SIZE];
+
+uint hash(uint x)
+{
+	x ^= x >> 16;
+	x *= 0x7feb352dU;
+	x ^= x >> 15;
+	x *= 0x846ca68bU;
+	x ^= x >> 16;
+	return x;
+}
+
+//Returns the tile a view space position falls in, or -1 outside the screen
+int tileOf(vec4 viewPosition)
+{
+	vec4 clip = projection * viewPosition;
+	if(clip.w <= 0.0)
+	{
+		return -1;
+	}
+
+	vec2 pixel = (clip.xy / clip.w * 0.5 + 0.5) * screenSize;
+	if(any(lessThan(pixel, vec2(0.0))) || any(greaterThanEqual(pixel, screenSize)))
+	{
+		return -1;
+	}
+
+	uvec2 tile = min(uvec2(pixel) / tileSize, tileGrid - 1u);
+	return int(tile.y * tileGrid.x + tile.x);
+}
+
+void writeKeys(uint i)
+{
+	if(i >= paddedCount)
+	{
+		return;
+	}
+
+	values[i] = i;
+
+	//Padding sorts behind every live particle
+	if(i >= drawCount)
+	{
+		keys[i] = 3.4e38;
+		return;
+	}
+
+	vec4 viewPosition = view * vec4(source[i].xyz, 1.0);
+	float depth = -viewPosition.z;
+	keys[i] = backToFront ? -depth : depth;
+
+	if(binning)
+	{
+		int tile = tileOf(viewPosition);
+		if(tile >= 0)
+		{
+			atomicAdd(tileCounts[tile], 1u);
+		}
+	}
+}
+
+//Compare and swap of one bitonic pair, ascending or descending by the block the pair is in
+void compareShared(uint base, uint t, uint blockK, uint distance)
+{
+	uint low = 2u * distance * (t / distance) + (t % distance);
+	uint high = low + distance;
+	bool ascending = ((base + low) & blockK) == 0u;
+
+	if((sharedKeys[low] > sharedKeys[high]) == ascending)
+	{
+		float key = sharedKeys[low];
+		sharedKeys[low] = sharedKeys[high];
+		sharedKeys[high] = key;
+
+		uint value = sharedValues[low];
+		sharedValues[low] = sharedValues[high];
+		sharedValues[high] = value;
+	}
+}
+
+//Sorts whole blocks, or finishes a merge step once the pairs are closer than a block
+void sortLocal(bool merge)
+{
+	uint t = gl_LocalInvocationID.x;
+	uint base = gl_WorkGroupID.x * BLOCK_SIZE;
+
+	sharedKeys[t] = keys[base + t];
+	sharedValues[t] = values[base + t];
+	sharedKeys[t + BLOCK_SIZE / 2u] = keys[base + t + BLOCK_SIZE / 2u];
+	sharedValues[t + BLOCK_SIZE / 2u] = values[base + t + BLOCK_SIZE / 2u];
+
+	if(merge)
+	{
+		for(uint distance = BLOCK_SIZE / 2u; distance > 0u; distance /= 2u)
+		{
+			barrier();
+			compareShared(base, t, k, distance);
+		}
+	}
+	else
+	{
+		for(uint blockK = 2u; blockK <= BLOCK_SIZE; blockK *= 2u)
+		{
+			for(uint distance = blockK / 2u; distance > 0u; distance /= 2u)
+			{
+				barrier();
+				compareShared(base, t, blockK, distance);
+			}
+		}
+	}
+
+	barrier();
+
+	keys[base + t] = sharedKeys[t];
+	values[base + t] = sharedValues[t];
+	keys[base + t + BLOCK_SIZE / 2u] = sharedKeys[t + BLOCK_SIZE / 2u];
+	values[base + t + BLOCK_SIZE / 2u] = sharedValues[t + BLOCK_SIZE / 2u];
+}
+
+//One merge step with pairs a block or more apart, straight on the buffers
+void mergeGlobal(uint t)
+{
+	uint low = 2u * j * (t / j) + (t % j);
+	uint high = low + j;
+
+	if(high >= paddedCount)
+	{
+		return;
+	}
+
+	bool ascending = (low & k) == 0u;
+	float keyLow = keys[low];
+	float keyHigh = keys[high];
+
+	if((keyLow > keyHigh) == ascending)
+	{
+		keys[low] = keyHigh;
+		keys[high] = keyLow;
+
+		uint value = values[low];
+		values[low] = values[high];
+		values[high] = value;
+	}
+}
+
+//Writes the particles in sorted order, thinning out tiles holding more than the limit
+void gather(uint i)
+{
+	if(i >= drawCount)
+	{
+		return;
+	}
+
+	uint index = values[i];
+	vec4 p = source[index];
+
+	if(binning)
+	{
+		int tile = tileOf(view * vec4(p.xyz, 1.0));
+		uint count = tile >= 0 ? tileCounts[tile] : 0u;
+
+		//Every particle of a crowded tile is kept with the same chance, so the tile thins out evenly.
+		//The chance is hashed from the particle and not its slot, so the kept set does not flicker
+		if(count > tileLimit)
+		{
+			uint id = ids[index];
+			float keep = float(tileLimit) / float(count);
+
+			if(float(hash(id) & 0xffffffU) / 16777216.0 >= keep)
+			{
+				p.w = 0.0;
+			}
+		}
+	}
+
+	sorted[i] = p;
+}
+
+void main()
+{
+	uint i = gl_GlobalInvocationID.x;
+
+	if(stage == STAGE_KEYS)
+	{
+		writeKeys(i);
+	}
+	else if(stage == STAGE_SORT_LOCAL)
+	{
+		sortLocal(false);
+	}
+	else if(stage == STAGE_MERGE_GLOBAL)
+	{
+		mergeGlobal(i);
+	}
+	else if(stage == STAGE_MERGE_LOCAL)
+	{
+		sortLocal(true);
+	}
+	else
+	{
+		gather(i);
+	}
+}
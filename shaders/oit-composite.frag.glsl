@@ -0,0 +1,29 @@
+#version 430 core
+
+// Resolves the weighted blended transparency over the opaque scene, blended with (1 - alpha, alpha)
+uniform sampler2D accumulation;
+uniform sampler2D revealage;
+
+out vec4 color;
+
+void main()
+{
+	ivec2 texel = ivec2(gl_FragCoord.xy);
+	float revealed = texelFetch(revealage, texel, 0).r;
+
+	// Nothing transparent covers this pixel
+	if (revealed >= 1.0)
+	{
+		discard;
+	}
+
+	vec4 accumulated = texelFetch(accumulation, texel, 0);
+
+	// Very many bright layers can overflow the half floats
+	if (isinf(max(max(abs(accumulated.r), abs(accumulated.g)), abs(accumulated.b))))
+	{
+		accumulated.rgb = vec3(accumulated.a);
+	}
+
+	color = vec4(accumulated.rgb / max(accumulated.a, 1e-5), revealed);
+}
@@ -1,12 +1,38 @@
 #version 430 core
 
+// Feature defines, inserted by ShaderPermutations. Without them every feature is compiled in
+#ifndef SHADOWS
+#define SHADOWS 1
+#endif
+#ifndef TEXTURED
+#define TEXTURED 1
+#endif
+#ifndef ALPHA_BLEND
+#define ALPHA_BLEND 1
+#endif
+#ifndef OIT
+#define OIT 0
+#endif
+#ifndef BINDLESS
+#define BINDLESS 0
+#endif
+#if BINDLESS
+#extension GL_ARB_bindless_texture : require
+#endif
+
 // From vertex shader
 in vec4 position;  // position of the vertex (and fragment) in eye space
 in vec3 normal ;  // surface normal vector in eye space
 in vec2 texCoord; // Texture coordinate
 
 // The end result of this shader
+#if OIT
+// Weighted blended order independent transparency writes to two targets
+layout(location = 0) out vec4 color;
+layout(location = 1) out float revealage;
+#else
 out vec4 color;
+#endif
 
 uniform mat4 m, v, p;
 uniform mat4 v_inv;
@@ -25,8 +51,58 @@ struct Material
     float shininess;
     bool activeTextures[MAX_TEXTURES];
     sampler2D textures[MAX_TEXTURES];
+    // Layer of each texture in its texture array, -1 for a plain texture
+    int layers[MAX_TEXTURES];
+#if BINDLESS
+    // Entry of each texture in the bindless table, -1 for a bound texture
+    int bindlessIndices[MAX_TEXTURES];
+#endif
 };
 
+// The front surface material
+uniform Material material;
+
+// The arrays of packed textures, on the units after those of the plain textures
+layout(binding = 2) uniform sampler2DArray materialArrays[MAX_TEXTURES];
+
+#if BINDLESS
+// The bindless texture table, filled by BindlessTextures
+struct BindlessTexture
+{
+    uvec2 handle;
+    int layer;
+    int padding;
+};
+
+layout(std430, binding = 9) readonly buffer BindlessTable
+{
+    BindlessTexture bindlessTextures[];
+};
+#endif
+
+vec4 sampleMaterialTexture(int i, vec2 uv)
+{
+#if BINDLESS
+  if (material.bindlessIndices[i] >= 0)
+  {
+    BindlessTexture entry = bindlessTextures[material.bindlessIndices[i]];
+    if (entry.layer >= 0)
+    {
+      return texture(sampler2DArray(entry.handle), vec3(uv, float(entry.layer)));
+    }
+
+    return texture(sampler2D(entry.handle), uv);
+  }
+#endif
+
+  if (material.layers[i] >= 0)
+  {
+    return texture(materialArrays[i], vec3(uv, float(material.layers[i])));
+  }
+
+  return texture(material.textures[i], uv);
+}
+
 // Definition of a light source structure
 struct LightSource
 {
@@ -38,35 +114,55 @@ struct LightSource
 
 const int MaxNumberOfLights = 10;
 
+#ifndef NUM_LIGHTS
+#define NUM_LIGHTS MaxNumberOfLights
+#endif
+
 // This is the uniforms that our program communicates with
 uniform LightSource lights[MaxNumberOfLights];
 
 // Some hard coded default ambient lighting
 vec4 scene_ambient = vec4(0.2, 0.2, 0.2, 1.0);
 
-// The front surface material
-uniform Material material;
+#if SHADOWS
+const int MAX_CASCADES = 4;
 
-uniform sampler2D u_depthTexture;
-in vec4 _fragPosLightSpace;
+uniform sampler2DArray u_depthTexture;
+uniform mat4 u_lightSpaceMatrices[MAX_CASCADES];
+uniform float u_cascadeSplits[MAX_CASCADES];
+uniform int u_cascadeCount;
+in vec4 worldPosition;
 
-float ShadowCalculation(vec4 fragPosLightSpace, vec3 lightDirection)
+float ShadowCalculation(vec3 lightDirection)
 {
+    // Use the first cascade whose split contains the fragment, nothing is shadowed past the last one
+    float viewDepth = -position.z;
+    int cascade = 0;
+    while (cascade < u_cascadeCount && viewDepth > u_cascadeSplits[cascade])
+    {
+        cascade++;
+    }
+
+    if (cascade >= u_cascadeCount)
+    {
+        return 0.0;
+    }
+
+    vec4 fragPosLightSpace = u_lightSpaceMatrices[cascade] * worldPosition;
     vec3 projectedCoords = fragPosLightSpace.xyz / fragPosLightSpace.w;
     projectedCoords = projectedCoords * 0.5 + 0.5;
-    float closestDepth = texture(u_depthTexture, projectedCoords.xy).r;
     float currentDepth = projectedCoords.z;
 
     float bias = max(0.05 * (1.0 - dot(normal, lightDirection)), 0.005);
 
     //Percentage Closer Filtering
     float shadow = 0.0;
-    vec2 texelSize = 1.0 / textureSize(u_depthTexture, 0);
+    vec2 texelSize = 1.0 / vec2(textureSize(u_depthTexture, 0).xy);
     for(int x = -1; x <= 1; ++x)
     {
         for(int y = -1; y <= 1; ++y)
         {
-            float percentageCloserFiltering = texture(u_depthTexture, projectedCoords.xy + vec2(x, y) * texelSize).r;
+            float percentageCloserFiltering = texture(u_depthTexture, vec3(projectedCoords.xy + vec2(x, y) * texelSize, cascade)).r;
             shadow += currentDepth - bias > percentageCloserFiltering ? 1.0 : 0.0;
         }
     }
@@ -75,6 +171,7 @@ float ShadowCalculation(vec4 fragPosLightSpace, vec3 lightDirection)
 
     return shadow;
 }
+#endif
 
 void main()
 {
@@ -88,7 +185,7 @@ void main()
 
 
   // for all light sources
-  for (int index = 0; index < numberOfLights; index++) 
+  for (int index = 0; index < NUM_LIGHTS && index < numberOfLights; index++)
   {
     LightSource light = lights[index];
     if (0.0 == light.position.w) // directional light?
@@ -119,24 +216,29 @@ void main()
         * pow(max(0.0, dot(reflect(-lightDirection, normalDirection), viewDirection)), max(0.00001,material.shininess));
     }
 
-      float shadow = ShadowCalculation(_fragPosLightSpace, lightDirection);
+#if SHADOWS
+      float shadow = ShadowCalculation(lightDirection);
+#else
+      float shadow = 0.0;
+#endif
 
       totalLighting = totalLighting + (1.0 - shadow) * (diffuseReflection + specularReflection);
   }
 
+#if TEXTURED
   vec4 diffuseTex = vec4(0.0, 0.0, 0.0, 1.0);
   vec4 mixedTextureColor = vec4(1.0, 0.0, 0.0, 1.0);
 
   // How we could check for a diffuse texture map
   if (material.activeTextures[0])
   {
-    diffuseTex = texture2D(material.textures[0], texCoord);
+    diffuseTex = sampleMaterialTexture(0, texCoord);
     mixedTextureColor = diffuseTex;
   }
 
   if(material.activeTextures[1])
   {
-    vec4 diffuseTex2 = texture2D(material.textures[1], texCoord);
+    vec4 diffuseTex2 = sampleMaterialTexture(1, texCoord);
     if(!(diffuseTex2.r == 0  && diffuseTex2.g == 0 && diffuseTex2.b == 0))
       mixedTextureColor = mix(diffuseTex, diffuseTex2, 0.5);
   }
@@ -146,5 +248,20 @@ void main()
       totalLighting = totalLighting * mixedTextureColor.rgb;
   }
 
+#if ALPHA_BLEND
   color = vec4(totalLighting, mixedTextureColor.a);
+#else
+  color = vec4(totalLighting, 1.0);
+#endif
+#else
+  color = vec4(totalLighting, 1.0);
+#endif
+
+#if OIT
+  // Weighted blended OIT (McGuire and Bavoil 2013), the weight falls off with depth so nearer surfaces dominate the average
+  float alpha = color.a;
+  float weight = clamp(alpha * max(1e-2, 3e3 * pow(1.0 - gl_FragCoord.z, 3.0)), 1e-2, 3e3);
+  color = vec4(color.rgb * alpha, alpha) * weight;
+  revealage = alpha;
+#endif
 }
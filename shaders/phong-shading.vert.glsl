@@ -1,5 +1,9 @@
 #version 430 core
 
+#ifndef SHADOWS
+#define SHADOWS 1
+#endif
+
 struct Vertex
 {
   vec4 position;
@@ -19,15 +23,19 @@ uniform mat4 m, v, p;
 // Inverse transpose of model matrix for transforming normals
 uniform mat3 m_3x3_inv_transp;
 
-uniform mat4 u_lightSpaceMatrix;
-out vec4 _fragPosLightSpace;
+#if SHADOWS
+// The fragment shader picks the cascade and its light space matrix
+out vec4 worldPosition;
+#endif
 
 void main()
 {
   mat4 mv = v * m;
   texCoord = vertex.texCoord;
 
-  _fragPosLightSpace = u_lightSpaceMatrix * m * vertex.position;
+#if SHADOWS
+  worldPosition = m * vertex.position;
+#endif
 
   position = mv * vertex.position;
   normal = normalize(m_3x3_inv_transp * vertex.normal);
@@ -25,8 +25,26 @@ struct Material
     float shininess;
     bool activeTextures[MAX_TEXTURES];
     sampler2D textures[MAX_TEXTURES];
+    // Layer of each texture in its texture array, -1 for a plain texture
+    int layers[MAX_TEXTURES];
 };
 
+// The front surface material
+uniform Material material;
+
+// The arrays of packed textures, on the units after those of the plain textures
+layout(binding = 2) uniform sampler2DArray materialArrays[MAX_TEXTURES];
+
+vec4 sampleMaterialTexture(int i, vec2 uv)
+{
+  if (material.layers[i] >= 0)
+  {
+    return texture(materialArrays[i], vec3(uv, float(material.layers[i])));
+  }
+
+  return texture(material.textures[i], uv);
+}
+
 // Definition of a light source structure
 struct LightSource
 {
@@ -44,9 +62,6 @@ uniform LightSource lights[MaxNumberOfLights];
 // Some hard coded default ambient lighting
 vec4 scene_ambient = vec4(0.2, 0.2, 0.2, 1.0);
 
-// The front surface material
-uniform Material material;
-
 void main()
 {
   vec3 normalDirection = normalize(normal);
@@ -108,7 +123,7 @@ void main()
   // How we could check for a diffuse texture map
   if (material.activeTextures[0])
   {
-    diffuseTex = texture2D(material.textures[0], texCoord);
+    diffuseTex = sampleMaterialTexture(0, texCoord);
     mixedTextureColor = diffuseTex;
   }
 